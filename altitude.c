@@ -9,6 +9,9 @@
 #include "globals.h"
 #include "altitude.h"
 #include "circBuf.h"
+#include "timing.h"
+#include "flightMode.h"
+#include "intPriority.h"
 
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
@@ -30,12 +33,30 @@ static long maxAltitude = -1;
 // Number of ADC reads during which the heli has been landed
 static unsigned long landedCount = 0;
 
+// Most recent valid sample
+static volatile unsigned long lastSample = 0;
+
+// Cycle count when the last conversion was triggered
+static volatile unsigned long triggerCycles = 0;
+
+/**
+ * Start an ADC conversion and record the time it was started, so that
+ * ADCIntHandler() can measure its own latency.
+ */
+void triggerADC (void) {
+	triggerCycles = cycleCount();
+	ADCProcessorTrigger(ADC0_BASE, 3);
+}
+
 /**
  * Handler for the ADC conversion complete interrupt.
  */
 void ADCIntHandler (void) {
 	unsigned long ulValue;
 
+	// Latency includes the conversion time (~2 us)
+	isrEnter(ISR_ADC, cycleCount() - triggerCycles);
+
 	// Clear the ADC interrupt
 	ADCIntClear(ADC0_BASE, 3);
 
@@ -44,14 +65,16 @@ void ADCIntHandler (void) {
 
 	// Ignore invalid values
 	if (ulValue > 1023) {
+		isrExit(ISR_ADC);
 		return;
 	}
 
 	// Place ulValue in the altitude buffer
 	writeCircBuf(&altitudeBuffer, ulValue);
+	lastSample = ulValue;
 
 	// Keep track of how long the heli has been landed
-	if (_heliState == HELI_OFF) {
+	if (flightModeRuns(FM_TASK_CALIBRATE)) {
 		landedCount++;
 	} else {
 		landedCount = 0;
@@ -63,6 +86,7 @@ void ADCIntHandler (void) {
 		// Max. altitude is a lower voltage level than min. altitude
 		maxAltitude = minAltitude - V_DIFF_DISCRETE;
 	}
+	isrExit(ISR_ADC);
 }
 
 /**
@@ -131,3 +155,10 @@ void calcAvgAltitude (void) {
 	_avgAltitude = (minAltitude - (signed long)meanA) * 100 /
 			(minAltitude - maxAltitude);
 }
+
+/**
+ * @return The most recent valid ADC sample of the altitude sensor
+ */
+unsigned long getRawAltitude (void) {
+	return lastSample;
+}
@@ -25,6 +25,12 @@
  */
 void ADCIntHandler (void);
 
+/**
+ * Start an ADC conversion and record the time it was started, so that
+ * ADCIntHandler() can measure its own latency.
+ */
+void triggerADC (void);
+
 /**
  * Initialise the analogue-to-digital converter peripheral.
  */
@@ -36,4 +42,9 @@ void initADC (void);
  */
 void calcAvgAltitude (void);
 
+/**
+ * @return The most recent valid ADC sample of the altitude sensor
+ */
+unsigned long getRawAltitude (void);
+
 #endif /* ALTITUDE_H_ */
@@ -0,0 +1,337 @@
+/*
+ * autoTune.c
+ *
+ * Relay-feedback (Astrom-Hagglund) auto-tuning of the altitude and yaw
+ * PI controllers.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "globals.h"
+#include "motorControl.h"
+#include "autoTune.h"
+#include "blackBox.h"
+#include "flightLog.h"
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+
+#include "driverlib/pwm.h"
+
+/*
+ * Constants
+ */
+// Words of the gains record in flash
+#define RECORD_MAGIC 0
+#define RECORD_GAINS 1 // Kp and Ki * 100 for each axis in turn
+#define RECORD_CHECKSUM (TUNE_RECORD_WORDS - 1)
+
+/*
+ * Static variables (shared within this file)
+ */
+
+// Axis being tuned, or TUNE_NONE
+static int tuneAxis = TUNE_NONE;
+
+// Whether to save the gains to flash once both axes are tuned
+static int persistGains = 0;
+
+// Relay parameters for the current axis
+static int setpoint;
+static int bias100;
+static int relay100;
+static int hysteresis;
+static int relayHigh;
+
+// Progress of the current axis' experiment
+static unsigned int biasSteps; // PI controller outputs averaged so far
+static long biasSum;
+static unsigned int steps;
+static unsigned int cycleStart;
+static unsigned int cycles;
+static int peakMax;
+static int peakMin;
+static unsigned long periodSum; // Control steps
+static unsigned long peakToPeakSum;
+
+/**
+ * Integer square root, rounded down.
+ */
+static unsigned long isqrt (unsigned long value) {
+	unsigned long root = 0;
+	unsigned long bit = 1ul << 30;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
+
+/**
+ * Compute the checksum of a gains record. Flash words are 32 bits, so it
+ * is cut to 32 bits where an unsigned long is wider (the host build).
+ * @param record The words of the record before its checksum
+ */
+static unsigned long recordChecksum (const unsigned long* record) {
+	unsigned long sum = 0;
+	int i;
+
+	for (i = 0; i < RECORD_CHECKSUM; i++) {
+		sum += record[i];
+	}
+	return ~sum & 0xFFFFFFFFul;
+}
+
+/**
+ * Queue the current gains of both axes to be written to flash. The flight
+ * log writer erases and programs the page from the background loop, so
+ * this never waits for the flash and is safe in the control step.
+ */
+static void saveGains (void) {
+	unsigned long record[TUNE_RECORD_WORDS];
+	gains_t axisGains;
+	int axis;
+
+	record[RECORD_MAGIC] = TUNE_FLASH_MAGIC;
+	for (axis = ALTITUDE_AXIS; axis <= YAW_AXIS; axis++) {
+		getGains(axis, &axisGains);
+		record[RECORD_GAINS + 2 * axis] = axisGains.kp100;
+		record[RECORD_GAINS + 2 * axis + 1] = axisGains.ki100;
+	}
+	record[RECORD_CHECKSUM] = recordChecksum(record);
+	flightLogWritePage(TUNE_FLASH_ADDR, record, TUNE_RECORD_WORDS);
+}
+
+/**
+ * End the experiment on the current axis without a result. The axis
+ * keeps the gains it had, and the altitude axis keeps any new gains; those
+ * are saved if the experiment was to save its results.
+ */
+static void abandonAxis (void) {
+	int axis = tuneAxis;
+
+	tuneAxis = TUNE_NONE;
+	if (axis == YAW_AXIS && persistGains) {
+		saveGains();
+	}
+}
+
+/**
+ * Set up the relay experiment for an axis.
+ * @param axis Either ALTITUDE_AXIS or YAW_AXIS
+ */
+static void beginAxis (int axis) {
+	if (axis == ALTITUDE_AXIS) {
+		setpoint = _desiredAltitude;
+		relay100 = TUNE_ALT_RELAY100;
+		hysteresis = TUNE_ALT_HYSTERESIS;
+	} else {
+		setpoint = _desiredYaw100;
+		relay100 = TUNE_YAW_RELAY100;
+		hysteresis = TUNE_YAW_HYSTERESIS;
+	}
+
+	relayHigh = 1;
+	biasSteps = 0;
+	biasSum = 0;
+	steps = 0;
+	cycleStart = 0;
+	cycles = 0;
+	periodSum = 0;
+	peakToPeakSum = 0;
+	tuneAxis = axis;
+}
+
+/**
+ * Compute Ziegler-Nichols PI gains from the measured limit cycle and
+ * move on to the next axis.
+ */
+static void finishAxis (void) {
+	gains_t newGains;
+	unsigned long hystSum = 2ul * TUNE_MEASURE_CYCLES * hysteresis;
+	unsigned long peakSum = peakToPeakSum;
+	unsigned long amplitudeSum;
+	int shift = 0;
+	long ku100;
+
+	// Describing function of a relay with hysteresis:
+	// Ku = 4d / (pi * sqrt(a^2 - eps^2)). Both a and eps are scaled by
+	// 2 * TUNE_MEASURE_CYCLES here.
+	if (peakSum <= hystSum) {
+		// No oscillation beyond the hysteresis band; give up
+		abandonAxis();
+		return;
+	}
+	// Scale a and eps down until their squares fit in 32 bits: the yaw
+	// swings, in degrees * 100, can sum to more than 16 bits
+	while (peakSum > 0xFFFFul) {
+		peakSum >>= 1;
+		hystSum >>= 1;
+		shift++;
+	}
+	amplitudeSum = isqrt(peakSum * peakSum - hystSum * hystSum) << shift;
+	if (amplitudeSum == 0) {
+		abandonAxis();
+		return;
+	}
+	ku100 = 127324l * relay100 / 1000 * (2 * TUNE_MEASURE_CYCLES) /
+			(long)amplitudeSum;
+
+	// Kp = 0.45 Ku; Ki = Kp / Ti with Ti = Tu / 1.2
+	newGains.kp100 = ku100 * 45 / 100;
+	newGains.ki100 = ku100 * 54 * ALT_CTRL_RATE_HZ * TUNE_MEASURE_CYCLES /
+			(100 * (long)periodSum);
+	setGains(tuneAxis, &newGains);
+
+	if (tuneAxis == ALTITUDE_AXIS) {
+		beginAxis(YAW_AXIS);
+		return;
+	}
+
+	tuneAxis = TUNE_NONE;
+	if (persistGains) {
+		saveGains();
+	}
+}
+
+/**
+ * Load any previously persisted gains into the controllers.
+ * Must be called after initPWMchan().
+ */
+void initAutoTune (void) {
+	unsigned long record[TUNE_RECORD_WORDS];
+	gains_t axisGains;
+	int i;
+
+	for (i = 0; i < TUNE_RECORD_WORDS; i++) {
+		record[i] = HWREG(TUNE_FLASH_ADDR + i * 4);
+	}
+	if (record[RECORD_MAGIC] != TUNE_FLASH_MAGIC ||
+			record[RECORD_CHECKSUM] != recordChecksum(record)) {
+		return;
+	}
+	for (i = ALTITUDE_AXIS; i <= YAW_AXIS; i++) {
+		axisGains.kp100 = record[RECORD_GAINS + 2 * i];
+		axisGains.ki100 = record[RECORD_GAINS + 2 * i + 1];
+		setGains(i, &axisGains);
+	}
+}
+
+/**
+ * Start the relay experiment, altitude axis first and then yaw. The
+ * heli should be hovering at its desired altitude and yaw.
+ * @param persist 1 to save the resulting gains to flash, 0 otherwise
+ */
+void startAutoTune (int persist) {
+	if (tuneAxis != TUNE_NONE) {
+		return;
+	}
+	persistGains = persist;
+	beginAxis(ALTITUDE_AXIS);
+}
+
+/**
+ * Abandon the experiment. The axis being tuned keeps the gains it had,
+ * and an axis already tuned keeps its new gains, which are not saved.
+ */
+void stopAutoTune (void) {
+	// Gains are only changed once an axis is tuned, so there are none to
+	// restore
+	tuneAxis = TUNE_NONE;
+}
+
+/**
+ * @return The axis currently being tuned (ALTITUDE_AXIS or YAW_AXIS),
+ * or TUNE_NONE
+ */
+int autoTuneAxis (void) {
+	return tuneAxis;
+}
+
+/**
+ * @return 1 if the relay drives the axis being tuned, and autoTuneStep()
+ * replaces its PI controller; 0 while the PI controller still holds the
+ * axis and its bias is measured, or if no axis is being tuned
+ */
+int autoTuneRelayOn (void) {
+	return tuneAxis != TUNE_NONE && biasSteps == TUNE_BIAS_STEPS;
+}
+
+/**
+ * Add the output of the PI controller of the axis being tuned to the
+ * average taken as the relay's bias. Called after each control step of
+ * that axis until autoTuneRelayOn().
+ * @param duty100 Duty cycle % * 100 the PI controller has set
+ */
+void autoTuneBias (unsigned int duty100) {
+	if (tuneAxis == TUNE_NONE || biasSteps == TUNE_BIAS_STEPS) {
+		return;
+	}
+	biasSum += duty100;
+	if (++biasSteps == TUNE_BIAS_STEPS) {
+		bias100 = (biasSum + TUNE_BIAS_STEPS / 2) / TUNE_BIAS_STEPS;
+	}
+}
+
+/**
+ * Run one control step of the relay experiment on the current axis.
+ * Called from the axis' control function in place of the PI controller
+ * once autoTuneRelayOn().
+ * @param measurement Current altitude (%) or yaw (degrees * 100)
+ * @return Duty cycle % * 100 to apply to the axis' rotor
+ */
+unsigned int autoTuneStep (int measurement) {
+	int error = setpoint - measurement;
+
+	steps++;
+	if (steps > TUNE_TIMEOUT_STEPS) {
+		// The loop never settled into an oscillation
+		blackBoxTrigger(BB_TRIG_FAULT);
+		abandonAxis();
+		return bias100;
+	}
+
+	// Track the peaks of the current oscillation cycle
+	if (cycleStart == 0 || measurement > peakMax) {
+		peakMax = measurement;
+	}
+	if (cycleStart == 0 || measurement < peakMin) {
+		peakMin = measurement;
+	}
+
+	if (!relayHigh && error > hysteresis) {
+		relayHigh = 1;
+
+		// Each upward relay switch ends an oscillation cycle
+		if (cycleStart != 0) {
+			cycles++;
+			if (cycles > TUNE_SETTLE_CYCLES) {
+				periodSum += steps - cycleStart;
+				peakToPeakSum += peakMax - peakMin;
+			}
+			if (cycles >= TUNE_SETTLE_CYCLES + TUNE_MEASURE_CYCLES) {
+				// Hold this axis at its bias; finishAxis() may move on
+				// to the next axis
+				unsigned int duty100 = bias100;
+				finishAxis();
+				return duty100;
+			}
+		}
+		cycleStart = steps;
+		peakMax = measurement;
+		peakMin = measurement;
+	} else if (relayHigh && error < -hysteresis) {
+		relayHigh = 0;
+	}
+
+	return relayHigh ? bias100 + relay100 : bias100 - relay100;
+}
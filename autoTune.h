@@ -0,0 +1,101 @@
+#ifndef AUTOTUNE_H_
+#define AUTOTUNE_H_
+
+/*
+ * autoTune.h
+ *
+ * Relay-feedback (Astrom-Hagglund) auto-tuning of the altitude and yaw
+ * PI controllers. Each axis in turn is driven by a relay with hysteresis
+ * around its setpoint; the ultimate gain and period are estimated from the
+ * resulting limit cycle and Ziegler-Nichols PI gains are computed from them.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+/*
+ * Constants
+ */
+// Relay amplitude: duty cycle % * 100 either side of the bias. The yaw
+// relay must swing the heli well past its hysteresis against the tether,
+// so it is larger than TUNE_YAW_HYSTERESIS in duty cycle % * 100.
+#define TUNE_ALT_RELAY100 250
+#define TUNE_YAW_RELAY100 500
+
+// Relay hysteresis, in the units of the measurement
+#define TUNE_ALT_HYSTERESIS 2 // Percent
+#define TUNE_YAW_HYSTERESIS 300 // Degrees * 100
+
+// Control steps over which the PI controller's output is averaged to give
+// the relay's bias, before the relay takes over
+#define TUNE_BIAS_STEPS 8 // 4 seconds at ALT_CTRL_RATE_HZ
+
+// Number of oscillation cycles to ignore while the limit cycle settles,
+// and then the number to average the period and amplitude over
+#define TUNE_SETTLE_CYCLES 1
+#define TUNE_MEASURE_CYCLES 3
+
+// Control steps after which the experiment on an axis is abandoned
+#define TUNE_TIMEOUT_STEPS 240 // 2 minutes at ALT_CTRL_RATE_HZ
+
+// Flash page in which tuned gains are persisted (last 1 KB page of flash,
+// reserved in lm3s1968.cmd)
+#define TUNE_FLASH_ADDR 0x0003FC00
+#define TUNE_FLASH_MAGIC 0x54554E45 // "TUNE"
+
+// Words of the gains record in flash: the magic number, Kp and Ki * 100
+// of the altitude axis then the yaw axis, and a checksum
+#define TUNE_RECORD_WORDS 6
+
+// Value of autoTuneAxis() when no experiment is running
+#define TUNE_NONE -1
+
+/**
+ * Load any previously persisted gains into the controllers.
+ * Must be called after initPWMchan().
+ */
+void initAutoTune (void);
+
+/**
+ * Start the relay experiment, altitude axis first and then yaw. The
+ * heli should be hovering at its desired altitude and yaw.
+ * @param persist 1 to save the resulting gains to flash, 0 otherwise
+ */
+void startAutoTune (int persist);
+
+/**
+ * Abandon the experiment. The axis being tuned keeps the gains it had,
+ * and an axis already tuned keeps its new gains, which are not saved.
+ */
+void stopAutoTune (void);
+
+/**
+ * @return The axis currently being tuned (ALTITUDE_AXIS or YAW_AXIS),
+ * or TUNE_NONE
+ */
+int autoTuneAxis (void);
+
+/**
+ * @return 1 if the relay drives the axis being tuned, and autoTuneStep()
+ * replaces its PI controller; 0 while the PI controller still holds the
+ * axis and its bias is measured, or if no axis is being tuned
+ */
+int autoTuneRelayOn (void);
+
+/**
+ * Add the output of the PI controller of the axis being tuned to the
+ * average taken as the relay's bias. Called after each control step of
+ * that axis until autoTuneRelayOn().
+ * @param duty100 Duty cycle % * 100 the PI controller has set
+ */
+void autoTuneBias (unsigned int duty100);
+
+/**
+ * Run one control step of the relay experiment on the current axis.
+ * Called from the axis' control function in place of the PI controller
+ * once autoTuneRelayOn().
+ * @param measurement Current altitude (%) or yaw (degrees * 100)
+ * @return Duty cycle % * 100 to apply to the axis' rotor
+ */
+unsigned int autoTuneStep (int measurement);
+
+#endif /* AUTOTUNE_H_ */
@@ -0,0 +1,309 @@
+/*
+ * blackBox.c
+ *
+ * Always-on flight recorder with delta and varint encoded records.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "blackBox.h"
+#include "globals.h"
+#include "altitude.h"
+#include "motorControl.h"
+#include "telemetry.h"
+#include "timing.h"
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+
+#include "driverlib/pwm.h"
+#include "driverlib/interrupt.h"
+
+#include "string.h"
+
+/*
+ * Constants
+ */
+#define NUM_FIELDS 9
+
+// Longest encoded record: five bytes per 32-bit field
+#define MAX_RECORD_LEN (NUM_FIELDS * 5)
+
+// Dump frame header length, and room for the CRC
+#define DUMP_HEADER_LEN 6
+#define DUMP_RAW_LEN (DUMP_HEADER_LEN + BLACKBOX_BLOCK_SIZE + 2)
+
+/*
+ * Static variables (shared within this file)
+ */
+
+// Ring of blocks. blockLen is the number of bytes used in each block.
+static unsigned char blocks[BLACKBOX_BLOCKS][BLACKBOX_BLOCK_SIZE];
+static unsigned char blockLen[BLACKBOX_BLOCKS];
+// Block being written, and number of blocks holding records
+static int currentBlock = 0;
+static int usedBlocks = 0;
+
+// Field values of the previous record in the current block
+static long previous[NUM_FIELDS];
+static int previousState = -1;
+
+static int triggerMask = BLACKBOX_DEFAULT_TRIGGERS;
+// Trigger that fired, or 0
+static volatile int firedTrigger = 0;
+// Records still to write before freezing, once a trigger has fired
+static volatile int postTrigger = 0;
+static volatile int frozen = 0;
+
+// Next block to dump, or -1 if no dump is in progress
+static int dumpBlock = -1;
+static unsigned char dumpRaw[DUMP_RAW_LEN];
+
+static blackBoxStats_t stats;
+
+/**
+ * Keep blackBoxRecord() out while the background loop changes the
+ * recorder's state. With CONTROL_IN_ISR it runs in the control interrupt,
+ * which is masked; otherwise it runs in the background loop itself.
+ */
+static void lockRecorder (void) {
+#ifdef CONTROL_IN_ISR
+	IntDisable(INT_TIMER1A);
+#endif
+}
+
+/**
+ * Let blackBoxRecord() run again after lockRecorder().
+ */
+static void unlockRecorder (void) {
+#ifdef CONTROL_IN_ISR
+	IntEnable(INT_TIMER1A);
+#endif
+}
+
+/**
+ * Append a signed value to a buffer, zigzag and varint encoded.
+ * @param p Position in the buffer
+ * @param value Value to append
+ * @return Position after the value
+ */
+static unsigned char* putVarint (unsigned char* p, long value) {
+	// Zigzag: small magnitudes of either sign become small codes
+	unsigned long code = (value < 0) ?
+			((unsigned long)(-(value + 1)) << 1) | 1 :
+			(unsigned long)value << 1;
+
+	while (code >= 0x80) {
+		*p++ = (code & 0x7F) | 0x80;
+		code >>= 7;
+	}
+	*p++ = code;
+	return p;
+}
+
+/**
+ * Encode the differences between a set of fields and the previous record.
+ * @param fields Field values
+ * @param out Buffer of at least MAX_RECORD_LEN bytes
+ * @return Number of bytes written
+ */
+static unsigned int encodeRecord (const long* fields, unsigned char* out) {
+	unsigned char* p = out;
+	int i;
+
+	for (i = 0; i < NUM_FIELDS; i++) {
+		p = putVarint(p, fields[i] - previous[i]);
+	}
+	return p - out;
+}
+
+/**
+ * Move to the next block, overwriting the oldest if the ring is full.
+ */
+static void nextBlock (void) {
+	int i;
+
+	currentBlock = (currentBlock + 1) % BLACKBOX_BLOCKS;
+	blockLen[currentBlock] = 0;
+	if (usedBlocks < BLACKBOX_BLOCKS) {
+		usedBlocks++;
+	}
+	// The first record of a block is relative to zero
+	for (i = 0; i < NUM_FIELDS; i++) {
+		previous[i] = 0;
+	}
+}
+
+/**
+ * Fire a trigger, from the recorder itself or with it locked.
+ * @param trigger One of the BB_TRIG_* values
+ */
+static void fireTrigger (int trigger) {
+	if (frozen || firedTrigger != 0) {
+		return;
+	}
+	if (trigger == BB_TRIG_COMMAND) {
+		firedTrigger = trigger;
+		frozen = 1;
+	} else if (triggerMask & trigger) {
+		postTrigger = BLACKBOX_POST_TRIGGER;
+		firedTrigger = trigger;
+	}
+}
+
+/**
+ * Record one control step. Called after each run of the control laws.
+ * Does nothing once the recorder has frozen.
+ * @param timeMs Time since reset in milliseconds
+ */
+void blackBoxRecord (unsigned long timeMs) {
+	unsigned long start = cycleCount();
+	unsigned char record[MAX_RECORD_LEN];
+	unsigned int len;
+	long fields[NUM_FIELDS];
+	heliSnapshot_t now;
+	int i;
+
+	if (frozen) {
+		return;
+	}
+
+	getSnapshot(&now);
+	fields[0] = timeMs;
+	fields[1] = getRawAltitude();
+	fields[2] = now.avgAltitude;
+	fields[3] = now.desiredAltitude;
+	fields[4] = now.yaw100;
+	fields[5] = now.desiredYaw100;
+	fields[6] = getDutyCycle100(MAIN_ROTOR);
+	fields[7] = getDutyCycle100(TAIL_ROTOR);
+	fields[8] = now.heliState;
+
+	if (usedBlocks == 0) {
+		usedBlocks = 1;
+	}
+	len = encodeRecord(fields, record);
+	if (blockLen[currentBlock] + len > BLACKBOX_BLOCK_SIZE) {
+		nextBlock();
+		len = encodeRecord(fields, record);
+	}
+	memcpy(&blocks[currentBlock][blockLen[currentBlock]], record, len);
+	blockLen[currentBlock] += len;
+	for (i = 0; i < NUM_FIELDS; i++) {
+		previous[i] = fields[i];
+	}
+	stats.records++;
+
+	// A state change is a trigger, but not the first record after arming
+	if (previousState != -1 && fields[8] != previousState) {
+		fireTrigger(BB_TRIG_STATE);
+	}
+	previousState = fields[8];
+
+	if (firedTrigger != 0 && --postTrigger <= 0) {
+		frozen = 1;
+	}
+
+	stats.lastCycles = cycleCount() - start;
+	if (stats.lastCycles > stats.maxCycles) {
+		stats.maxCycles = stats.lastCycles;
+	}
+}
+
+/**
+ * Fire a trigger. If it is enabled and the recorder is running, the
+ * recorder freezes after BLACKBOX_POST_TRIGGER more records, or at once
+ * for BB_TRIG_COMMAND.
+ * @param trigger One of the BB_TRIG_* values
+ */
+void blackBoxTrigger (int trigger) {
+	lockRecorder();
+	fireTrigger(trigger);
+	unlockRecorder();
+}
+
+/**
+ * Choose which triggers freeze the recorder.
+ * @param mask Combination of BB_TRIG_STATE and BB_TRIG_FAULT
+ */
+void setBlackBoxTriggers (int mask) {
+	triggerMask = mask;
+}
+
+/**
+ * Clear the record and start recording again.
+ */
+void blackBoxArm (void) {
+	int i;
+
+	lockRecorder();
+	dumpBlock = -1;
+	currentBlock = 0;
+	usedBlocks = 0;
+	blockLen[0] = 0;
+	for (i = 0; i < NUM_FIELDS; i++) {
+		previous[i] = 0;
+	}
+	previousState = -1;
+	stats.records = 0;
+	stats.maxCycles = 0;
+	firedTrigger = 0;
+	frozen = 0;
+	unlockRecorder();
+}
+
+/**
+ * @return 1 if the recorder has frozen, otherwise 0
+ */
+int blackBoxFrozen (void) {
+	return frozen;
+}
+
+/**
+ * Start dumping the record. The recorder is frozen first if necessary.
+ */
+void blackBoxDump (void) {
+	lockRecorder();
+	fireTrigger(BB_TRIG_COMMAND);
+	dumpBlock = 0;
+	unlockRecorder();
+}
+
+/**
+ * Continue a dump: sends at most one block if a frame buffer is free.
+ * Called from the background loop.
+ */
+void blackBoxService (void) {
+	int block;
+
+	if (dumpBlock < 0 || !frozen) {
+		return;
+	}
+	if (dumpBlock >= usedBlocks) {
+		dumpBlock = -1;
+		return;
+	}
+
+	// Oldest block first
+	block = (currentBlock - usedBlocks + 1 + dumpBlock + BLACKBOX_BLOCKS)
+			% BLACKBOX_BLOCKS;
+
+	dumpRaw[0] = TELEMETRY_VERSION;
+	dumpRaw[1] = TELEM_BLACKBOX;
+	dumpRaw[2] = dumpBlock;
+	dumpRaw[3] = usedBlocks;
+	dumpRaw[4] = firedTrigger;
+	dumpRaw[5] = blockLen[block];
+	memcpy(dumpRaw + DUMP_HEADER_LEN, blocks[block], blockLen[block]);
+	if (sendTelemetryFrame(dumpRaw, DUMP_HEADER_LEN + blockLen[block])) {
+		dumpBlock++;
+	}
+}
+
+/**
+ * @return The recorder statistics
+ */
+const blackBoxStats_t* getBlackBoxStats (void) {
+	return &stats;
+}
@@ -0,0 +1,110 @@
+#ifndef BLACKBOX_H_
+#define BLACKBOX_H_
+
+/*
+ * blackBox.h
+ *
+ * Always-on flight recorder. Every control step's inputs and outputs are
+ * recorded in a ring of fixed-size blocks in RAM. When a trigger fires,
+ * recording continues for BLACKBOX_POST_TRIGGER steps and then stops, so
+ * that the record shows what led up to the trigger. The frozen record is
+ * dumped via UART0 as telemetry frames and decoded on the host by
+ * tools/decodeBlackBox.cpp.
+ *
+ * With CONTROL_IN_ISR the control step records from the control
+ * interrupt. The other functions are called from the background loop, and
+ * mask that interrupt while they change the recorder's state.
+ *
+ * Each block starts with a record relative to zero and the rest are
+ * relative to the record before, so a block decodes on its own and the
+ * oldest block can simply be overwritten. Each field of a record is the
+ * difference from the previous value, zigzag and varint encoded (7 bits
+ * per byte, least significant first, top bit set if more bytes follow),
+ * so a field that has not changed takes one byte.
+ *
+ * Record fields, in order:
+ *  time (ms), raw ADC, altitude (%), desired altitude (%), yaw100,
+ *  desired yaw100, main duty100, tail duty100, heli state
+ *
+ * Dump frame payload (TELEM_BLACKBOX):
+ *  u8  version        u8  type (TELEM_BLACKBOX)
+ *  u8  block number   u8  number of blocks (oldest is block 0)
+ *  u8  trigger (BB_TRIG_*)
+ *  u8  bytes used in the block, followed by the block's records
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+/*
+ * Constants
+ */
+// Size of each block and number of blocks: 4 KB in total
+#define BLACKBOX_BLOCK_SIZE 128
+#define BLACKBOX_BLOCKS 32
+
+// Number of steps recorded after a trigger
+#define BLACKBOX_POST_TRIGGER 8
+
+// Triggers, as a mask
+#define BB_TRIG_COMMAND 0x01 // Requested via the command interface
+#define BB_TRIG_STATE 0x02 // The helicopter state changed
+#define BB_TRIG_FAULT 0x04 // A fault was detected
+
+// Triggers enabled at reset. A freeze by command is always possible.
+#define BLACKBOX_DEFAULT_TRIGGERS BB_TRIG_FAULT
+
+// Recorder statistics
+typedef struct {
+	unsigned long records; // Records written since the recorder was armed
+	unsigned long lastCycles; // Cycles taken to encode the last record
+	unsigned long maxCycles; // Most cycles taken to encode a record
+} blackBoxStats_t;
+
+/**
+ * Record one control step. Called after each run of the control laws.
+ * Does nothing once the recorder has frozen.
+ * @param timeMs Time since reset in milliseconds
+ */
+void blackBoxRecord (unsigned long timeMs);
+
+/**
+ * Fire a trigger. If it is enabled and the recorder is running, the
+ * recorder freezes after BLACKBOX_POST_TRIGGER more records, or at once
+ * for BB_TRIG_COMMAND.
+ * @param trigger One of the BB_TRIG_* values
+ */
+void blackBoxTrigger (int trigger);
+
+/**
+ * Choose which triggers freeze the recorder.
+ * @param mask Combination of BB_TRIG_STATE and BB_TRIG_FAULT
+ */
+void setBlackBoxTriggers (int mask);
+
+/**
+ * Clear the record and start recording again.
+ */
+void blackBoxArm (void);
+
+/**
+ * @return 1 if the recorder has frozen, otherwise 0
+ */
+int blackBoxFrozen (void);
+
+/**
+ * Start dumping the record. The recorder is frozen first if necessary.
+ */
+void blackBoxDump (void);
+
+/**
+ * Continue a dump: sends at most one block if a frame buffer is free.
+ * Called from the background loop.
+ */
+void blackBoxService (void);
+
+/**
+ * @return The recorder statistics
+ */
+const blackBoxStats_t* getBlackBoxStats (void);
+
+#endif /* BLACKBOX_H_ */
@@ -12,6 +12,7 @@
 
 #include "button.h"
 #include "buttonSet.h"
+#include "intPriority.h"
 
 // Pin values for Port B (virtual buttons)
 const unsigned char BUTTON_PINS_B[] = {
@@ -33,14 +34,88 @@ const unsigned char BUTTON_PINS_G[] = {
 	0 // No GPIO pin for physical Reset
 };
 
+/*
+ * Constants
+ */
+// Bits in each debounce counter. Must hold the longest debounce time in
+// SysTick interrupts, plus one.
+#define COUNT_BITS 8
+#define MAX_COUNT ((1 << COUNT_BITS) - 1)
+
+/*
+ * Static variables (shared within this file)
+ */
+
 // Array of button structs
 static button_t buttonsArray[6];
 
 // Flag for whether initButSet has been called
 static unsigned int initialised = 0;
 
-// Number of SysTick interrupts in 1 msec.
-static unsigned long sysTickmHz;
+// Port holding the buttons, and the pins of all the buttons on it
+static unsigned long buttonPort = 0;
+static unsigned char buttonPins = 0;
+
+// Debounced state: a pin's bit is set while its button is pressed
+static volatile unsigned char heldPins = 0;
+
+// Pins whose debounce counter is running
+static unsigned char unsettled = 0;
+
+// 1 if the buttons are read on every SysTick interrupt. In edge mode this
+// is only set from an edge until the buttons are released and settled.
+static volatile int scanning = 1;
+static int edgeMode = 0;
+
+// Number of times the buttons have been read
+static unsigned long scans = 0;
+
+// Vertical counters: bit b of count[i] is bit i of the number of
+// consecutive interrupts for which pin b has differed from heldPins
+static unsigned char count[COUNT_BITS];
+
+// Consecutive interrupts for which a pin must differ from its debounced
+// state before a press or release is accepted, one bit per entry: each
+// entry is 0xFF if that bit of the limit is set, otherwise 0
+static unsigned char pressLimit[COUNT_BITS];
+static unsigned char releaseLimit[COUNT_BITS];
+
+// Event queue. eventHead is only written by updateButtons() and eventTail
+// only by getButEvent().
+static butEvent_t events[BUT_QUEUE_SIZE];
+static volatile unsigned int eventHead = 0;
+static volatile unsigned int eventTail = 0;
+static unsigned long eventsDropped = 0;
+
+// SysTick interrupts since initButSet() was called, and per millisecond
+static unsigned long ticks = 0;
+static unsigned int ticksPerMs = 1;
+
+// Interrupts from a press to its long-press event, and between repeats
+static unsigned long longPressTicks;
+static unsigned long repeatTicks;
+
+// Interrupt count at which each held button's next long-press or repeat
+// event is due, and the pins whose long-press event has been queued
+static unsigned long repeatAt[NUM_BUTTONS];
+static unsigned char longPressSent = 0;
+
+// A pin's bit is toggled by the interrupt at each press, and by
+// checkBut() when the press is taken, so that neither writes the
+// other's variable. A press is waiting while the two bits differ.
+static volatile unsigned char pressToggle = 0;
+static unsigned char pressTaken = 0;
+
+/**
+ * @param ms Time in milliseconds
+ * @param tickRateHz Rate of SysTick interrupts
+ * @return Consecutive interrupts needed to span the time, at most MAX_COUNT
+ */
+static unsigned int ticksFor (unsigned int ms, unsigned int tickRateHz) {
+	unsigned long ticks = (unsigned long)ms * (tickRateHz / 1000) + 1;
+
+	return (ticks > MAX_COUNT) ? MAX_COUNT : ticks;
+}
 
 /**
  * Initialise the button instance for the specific button & pin.
@@ -68,6 +143,8 @@ void initButSet (unsigned char buttons, unsigned long port, unsigned int tickRat
 	unsigned char ucPins = 0;
 	int i;
 	const unsigned char* pinArray;
+	unsigned int pressTicks = 1;
+	unsigned int releaseTicks = 1;
 
 	// Choose the pin array based on the port
 	if (port == VIRTUAL_PORT) {
@@ -76,15 +153,26 @@ void initButSet (unsigned char buttons, unsigned long port, unsigned int tickRat
 		pinArray = BUTTON_PINS_G;
 	}
 
-	// Initialise the buttons to be inactive, with count 0
+	// Initialise the buttons to be inactive
 	for (i = 0; i < NUM_BUTTONS; i++) {
 		buttonsArray[i].iState = BUT_INACTIVE;
-		buttonsArray[i].uiCnt = 0;
 	}
 
-	// Store the number of SysTick interrupts in one msec:
-	// (a thousandth of the number of SysTick interrupts per second)
-	sysTickmHz = tickRateHz / 1000;
+	// The physical buttons bounce: a press must last BUT_DETECT ms and
+	// a release BUT_HOLDOFF ms. The virtual buttons are taken at once.
+	if (port == PHYSICAL_PORT) {
+		pressTicks = ticksFor(BUT_DETECT, tickRateHz);
+		releaseTicks = ticksFor(BUT_HOLDOFF, tickRateHz);
+	}
+	ticks = 0;
+	ticksPerMs = (tickRateHz >= 1000) ? tickRateHz / 1000 : 1;
+	longPressTicks = (unsigned long)BUT_LONG_PRESS * ticksPerMs;
+	repeatTicks = (unsigned long)BUT_REPEAT * ticksPerMs;
+	for (i = 0; i < COUNT_BITS; i++) {
+		pressLimit[i] = (pressTicks >> i) & 1 ? 0xFF : 0;
+		releaseLimit[i] = (releaseTicks >> i) & 1 ? 0xFF : 0;
+		count[i] = 0;
+	}
 
 	// Determine the buttons and pins to activate
 	if (buttons & UP_B) {
@@ -119,84 +207,228 @@ void initButSet (unsigned char buttons, unsigned long port, unsigned int tickRat
 	GPIOPadConfigSet(port, ucPins, GPIO_STRENGTH_2MA,
 	   GPIO_PIN_TYPE_STD_WPU);
 
+	buttonPort = port;
+	buttonPins = ucPins;
 	initialised = 1;
 }
 
 
+/**
+ * Read the buttons and debounce them. All pins are debounced together,
+ * one bit per pin in each variable. A pin's counter runs while the pin
+ * differs from its debounced state and is cleared when it agrees. When
+ * the counter reaches the press limit (for a released button) or the
+ * release limit (for a pressed one) the debounced state changes.
+ * @return The pins whose debounced state changed
+ */
+static unsigned char debounce (void) {
+	unsigned char pressed;
+	unsigned char changed;
+	unsigned char carry;
+	unsigned char next;
+	unsigned char match;
+	int i;
+
+	// A pin reads 0 while its button is pressed
+	pressed = ~GPIOPinRead(buttonPort, buttonPins) & buttonPins;
+	changed = pressed ^ heldPins;
+	if (changed == 0) {
+		for (i = 0; i < COUNT_BITS; i++) {
+			count[i] = 0;
+		}
+		unsettled = 0;
+		return 0;
+	}
+
+	// Clear the counters of pins that agree, count up the others, and
+	// find the pins whose counter has reached its limit
+	carry = changed;
+	match = changed;
+	for (i = 0; i < COUNT_BITS; i++) {
+		count[i] &= changed;
+		next = count[i] & carry;
+		count[i] ^= carry;
+		carry = next;
+		// Bit i of each pin's limit
+		next = (heldPins & releaseLimit[i]) | (~heldPins & pressLimit[i]);
+		match &= ~(count[i] ^ next);
+	}
+
+	if (match != 0) {
+		for (i = 0; i < COUNT_BITS; i++) {
+			count[i] &= ~match;
+		}
+		heldPins ^= match;
+	}
+	unsettled = changed & ~match;
+	return match;
+}
+
+/**
+ * Add an event to the queue, or count it as dropped if the queue is full.
+ * @param button One of the enumerated buttons (e.g. UP)
+ * @param type One of the button event types
+ */
+static void pushEvent (unsigned int button, unsigned int type) {
+	unsigned int next = (eventHead + 1) & (BUT_QUEUE_SIZE - 1);
+
+	if (next == eventTail) {
+		eventsDropped++;
+		return;
+	}
+	events[eventHead].timeMs = ticks / ticksPerMs;
+	events[eventHead].button = button;
+	events[eventHead].type = type;
+	eventHead = next;
+}
+
+/**
+ * In edge mode, stop reading the buttons once they are all released and
+ * settled, and wait for the next edge. The pins are read again after
+ * the edges are cleared, so that an edge in between is not lost.
+ */
+static void stopScanning (void) {
+	GPIOPinIntClear(buttonPort, buttonPins);
+	if ((~GPIOPinRead(buttonPort, buttonPins) & buttonPins) == 0) {
+		scanning = 0;
+		GPIOPinIntEnable(buttonPort, buttonPins);
+	}
+}
+
 /**
  * Designed to be called from the SysTick interrupt handler.
  * It has no return type or argument list. A call to initButSet()
  * is required before the first call to this.
+ * Debounces the buttons and queues an event for each press and release,
+ * a long-press event once a button has been held for BUT_LONG_PRESS ms,
+ * and then a repeat event every BUT_REPEAT ms until it is released.
+ * In edge mode the buttons are only read after an edge, until they are
+ * released and settled again.
  */
 void updateButtons (void) {
-	if (!initialised) { return; }
-
-	unsigned char ucPins = 0;
-	unsigned long pinRead, ulPort;
+	unsigned char edges;
+	unsigned char pin;
 	int i;
 
-	// Figure out which port and pins to read
-	for (i = 0; i < NUM_BUTTONS; i++) {
-		if (buttonsArray[i].iState != BUT_INACTIVE) {
-			ulPort = buttonsArray[i].ulPort;
-			ucPins |= buttonsArray[i].ucPin;
+	if (!initialised) { return; }
+
+	ticks++;
+	if (!scanning) {
+		return;
+	}
+	scans++;
+	edges = debounce();
+	if ((edges | heldPins) == 0) {
+		if (edgeMode && unsettled == 0) {
+			stopScanning();
 		}
+		return;
 	}
-
-	pinRead = GPIOPinRead(ulPort, ucPins);
+	pressToggle ^= edges & heldPins;
 
 	for (i = 0; i < NUM_BUTTONS; i++) {
-		// Isolate the read value of this button's pin.
-		// If the value is 0, the button is pressed
-		unsigned long pinVal = pinRead & buttonsArray[i].ucPin;
-
-		switch (buttonsArray[i].iState) {
-		case BUT_IN:
-			if (pinVal && ulPort == PHYSICAL_PORT) {
-				// Button is not being pressed (physical)
-				if (buttonsArray[i].uiCnt >= sysTickmHz * BUT_HOLDOFF) {
-					buttonsArray[i].iState = BUT_OUT;
-					buttonsArray[i].uiCnt = 0;
-				} else {
-					buttonsArray[i].uiCnt += 1;
-				}
-			} else if (pinVal) {
-				// Button is not being pressed (virtual)
-				buttonsArray[i].iState = BUT_OUT;
+		pin = buttonsArray[i].ucPin;
+		if (buttonsArray[i].iState == BUT_INACTIVE ||
+				!((edges | heldPins) & pin)) {
+			continue;
+		}
+		if (edges & pin) {
+			if (heldPins & pin) {
+				pushEvent(i, BUT_EV_PRESS);
+				repeatAt[i] = ticks + longPressTicks;
+				longPressSent &= ~pin;
+			} else {
+				pushEvent(i, BUT_EV_RELEASE);
 			}
-			break;
-		case BUT_OUT:
-			if (!pinVal && ulPort == PHYSICAL_PORT) {
-				// Button is being pressed (physical)
-				if (buttonsArray[i].uiCnt >= sysTickmHz * BUT_DETECT) {
-					buttonsArray[i].iState = BUT_PUSHED;
-					buttonsArray[i].uiCnt = 0;
-				} else {
-					buttonsArray[i].uiCnt += 1;
-				}
-			} else if (!pinVal) {
-				// Button is being pressed (virtual)
-				buttonsArray[i].iState = BUT_PUSHED;
+		} else if (ticks == repeatAt[i]) {
+			if (longPressSent & pin) {
+				pushEvent(i, BUT_EV_REPEAT);
+			} else {
+				pushEvent(i, BUT_EV_LONG);
+				longPressSent |= pin;
 			}
-			break;
-		default:
-			// Button is inactive: do nothing
-			break;
+			repeatAt[i] = ticks + repeatTicks;
 		}
 	}
 }
 
+/**
+ * Switch to edge mode: the buttons are read on each SysTick interrupt
+ * only from an edge on a button pin until they are released and
+ * settled. Must be called after initButSet().
+ */
+void enableButInts (void) {
+	GPIOIntTypeSet(buttonPort, buttonPins, GPIO_BOTH_EDGES);
+	GPIOPortIntRegister(buttonPort, ButtonIntHandler);
+	edgeMode = 1;
+	// Read the buttons until they are settled, then wait for an edge
+	scanning = 1;
+}
+
+/**
+ * The interrupt handler called on an edge of a button pin in edge mode.
+ * Starts reading the buttons on each SysTick interrupt, which debounces
+ * them, and ignores further edges until they have settled.
+ */
+void ButtonIntHandler (void) {
+	// Edges are not timestamped by hardware, so the entry latency of this
+	// handler cannot be measured
+	isrEnter(ISR_BUTTON, 0);
+	GPIOPinIntDisable(buttonPort, buttonPins);
+	GPIOPinIntClear(buttonPort, buttonPins);
+	scanning = 1;
+	isrExit(ISR_BUTTON);
+}
+
+/**
+ * @return Number of times the buttons have been read
+ */
+unsigned long getButScans (void) {
+	return scans;
+}
+
+/**
+ * Take the oldest button event from the queue.
+ * @param event Set to the event, if there is one
+ * @return 1 if an event was taken, 0 if the queue was empty
+ */
+int getButEvent (butEvent_t* event) {
+	if (eventTail == eventHead) {
+		return 0;
+	}
+	*event = events[eventTail];
+	eventTail = (eventTail + 1) & (BUT_QUEUE_SIZE - 1);
+	return 1;
+}
+
+/**
+ * @return Number of button events lost because the queue was full
+ */
+unsigned long getButEventsDropped (void) {
+	return eventsDropped;
+}
+
+/**
+ * @param button One of the enumerated buttons (e.g. UP)
+ * @return 1 if the button is active and has been pressed since the last
+ * time its press was taken, otherwise 0
+ */
+static unsigned int isPressWaiting (unsigned int button) {
+	return buttonsArray[button].iState != BUT_INACTIVE &&
+			((pressToggle ^ pressTaken) & buttonsArray[button].ucPin);
+}
+
 
 /**
  * Checks the specified individual button and returns true
- * (1) if the button is active and has state BUT_PUSHED (newly pushed)
- * and modifies state to BUT_IN. Returns false (0) otherwise.
+ * (1) if the button is active and has been newly pushed, and takes
+ * the press. Returns false (0) otherwise.
  * @param button One of the enumerated buttons (e.g. UP)
  * @return true (1) if the button was newly pushed, false (0) otherwise
  */
 unsigned int checkBut (unsigned int button) {
-	if (buttonsArray[button].iState == BUT_PUSHED) {
-		buttonsArray[button].iState = BUT_IN;
+	if (isPressWaiting(button)) {
+		pressTaken ^= buttonsArray[button].ucPin;
 		return 1;
 	} else {
 		return 0;
@@ -206,22 +438,20 @@ unsigned int checkBut (unsigned int button) {
 
 /**
  * Checks the current set of active buttons and returns true (>0)
- * if any of them have state = BUT_PUSHED. Value returned is an ORed
+ * if any of them have been newly pushed. Value returned is an ORed
  * set of the bits representing the button(s) newly pushed,
  * e.g., if "UP" and "SELECT" have been recently pushed, the
  * value returned is (UP_B | SELECT_B). Otherwise returns false (0).
- * State of any pushed button is altered to BUT_IN.
+ * The press of any pushed button is taken.
  * @return a set of bits representing the button(s) that were pushed
  */
 unsigned char anyButPushed (void) {
 	unsigned char pushedButs = 0;
 
-	if (buttonsArray[UP].iState == BUT_PUSHED) {
-		buttonsArray[UP].iState = BUT_IN;
+	if (checkBut(UP)) {
 		pushedButs |= UP_B;
 	}
-	if (buttonsArray[DOWN].iState == BUT_PUSHED) {
-		buttonsArray[DOWN].iState = BUT_IN;
+	if (checkBut(DOWN)) {
 		pushedButs |= DOWN_B;
 	}
 
@@ -229,13 +459,29 @@ unsigned char anyButPushed (void) {
 }
 
 
+/**
+ * Returns true (1) if the specified button is active and currently
+ * pushed in (after debouncing), false (0) otherwise.
+ * Does not alter the state of the button.
+ * @param button One of the enumerated buttons (e.g. UP)
+ * @return true (1) if the button is held in, false (0) otherwise
+ */
+unsigned int isButHeld (unsigned int button) {
+	return buttonsArray[button].iState != BUT_INACTIVE &&
+			(heldPins & buttonsArray[button].ucPin) != 0;
+}
+
+
 /**
  * Alters the state of the specified button to BUT_OUT,
  * if it was previously BUT_INACTIVE, otherwise makes no change.
+ * Any press while the button was inactive is ignored.
  * @param button One of the enumerated buttons (e.g. UP)
  */
 void enableBut (unsigned int button) {
 	if (buttonsArray[button].iState == BUT_INACTIVE) {
+		pressTaken = (pressTaken & ~buttonsArray[button].ucPin) |
+				(pressToggle & buttonsArray[button].ucPin);
 		buttonsArray[button].iState = BUT_OUT;
 	}
 }
@@ -12,17 +12,23 @@
 // *******************************************************
 
 // Constants for button states (order is important). "Pushed"
-//  implies newly pushed.
+//  implies newly pushed. Only BUT_INACTIVE and BUT_OUT (active) are
+//  stored in a button; whether it is in or pushed is kept by the
+//  debouncer for all buttons together.
 enum but_state {BUT_INACTIVE = -1, BUT_OUT = 0, BUT_IN, BUT_PUSHED};
-// Constants for debounce in msec
+// Constants for debounce in msec: a press must last BUT_DETECT and a
+//  release BUT_HOLDOFF (physical buttons only)
 #define BUT_DETECT 4
 #define BUT_HOLDOFF 100
+// Constants for held buttons in msec: time from a press to its long-press
+//  event, and between the repeat events that follow
+#define BUT_LONG_PRESS 500
+#define BUT_REPEAT 100
 
 // *******************************************************
 // Button structure
 typedef struct {
-   int iState;	// Value from enum but_state
-   unsigned int uiCnt;	// Counter for debouncing delay
+   int iState;	// BUT_INACTIVE or BUT_OUT
    unsigned long ulPort;	// Base argument for GPIO port
    unsigned char ucPin;	// Pin mask for GPIO port for button
 } button_t;
@@ -9,12 +9,26 @@
 #include "buttonSet.h"
 #include "button.h"
 #include "globals.h"
+#include "motorControl.h"
+#include "flightMode.h"
+#include "autoTune.h"
+#include "display.h"
 
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
 
 #include "driverlib/sysctl.h"
 
+/*
+ * Static variables (shared within this file)
+ */
+
+// UP and DOWN also modify other buttons, so each holds back its altitude
+// step until it is released or repeats: STEP_PENDING while a press has
+// not stepped yet, STEP_CANCELLED once another button was pressed with it
+enum step_state { STEP_DONE = 0, STEP_PENDING, STEP_CANCELLED };
+static int stepState[DOWN + 1];
+
 /**
  * Initialise the buttons.
  * @param port Either PHYSICAL or VIRTUAL
@@ -37,56 +51,177 @@ void initButtons (int port) {
 		initButSet(UP_B | DOWN_B | LEFT_B | RIGHT_B | SELECT_B,
 				PHYSICAL_PORT, SYSTICK_RATE_HZ);
 	}
+#ifndef BUTTONS_POLLED
+	enableButInts();
+#endif
 }
 
 /**
- * Checks each button for a press and performs an associated action:
- *  UP: Increases desired altitude
- *  DOWN: Decreases desired altitude
- *  LEFT: Increments yaw counterclockwise
- *  RIGHT: Increments yaw clockwise
- *  SELECT: Starts up or lands the helicopter
- *  RESET: Perform a "soft" system reset via SysCtl
+ * Change the desired altitude, keeping it within 0 to 100%.
+ * @param step Percent to add
  */
-void checkButtons (void) {
-	if (checkBut(UP) && _heliState == HELI_ON) {
-		_desiredAltitude += ALTITUDE_STEP;
-		if (_desiredAltitude > 100) {
-			_desiredAltitude = 100;
-		}
+static void stepAltitude (int step) {
+	_desiredAltitude += step;
+	if (_desiredAltitude > 100) {
+		_desiredAltitude = 100;
+	} else if (_desiredAltitude < 0) {
+		_desiredAltitude = 0;
 	}
-	else if (checkBut(DOWN) && _heliState == HELI_ON) {
-		_desiredAltitude -= ALTITUDE_STEP;
-		if (_desiredAltitude < 0) {
-			_desiredAltitude = 0;
-		}
+}
+
+/**
+ * Change the desired yaw, keeping it within +/- 345 degrees.
+ * @param step100 Degrees * 100 to add
+ */
+static void stepYaw (int step100) {
+	_desiredYaw100 += step100;
+	if (_desiredYaw100 > 34500) {
+		_desiredYaw100 = 34500;
+	} else if (_desiredYaw100 < -34500) {
+		_desiredYaw100 = -34500;
 	}
-	else if (checkBut(LEFT) && _heliState == HELI_ON) {
-		_desiredYaw100 -= YAW_STEP_100;
-		if (_desiredYaw100 < -34500) {
-			_desiredYaw100 = -34500;
+}
+
+/**
+ * Handle an event of UP or DOWN. A press steps the altitude when it is
+ * released, or when it first repeats, after which each repeat ramps it.
+ * Nothing is stepped if another button is pressed while it is held.
+ * @param event The event
+ * @param direction 1 for up, -1 for down
+ * @param flying 1 if the desired altitude may change
+ */
+static void altitudeButton (const butEvent_t* event, int direction,
+		int flying) {
+	int* state = &stepState[event->button];
+
+	switch (event->type) {
+	case BUT_EV_PRESS:
+		*state = STEP_PENDING;
+		break;
+	case BUT_EV_REPEAT:
+		if (*state == STEP_CANCELLED || !flying) {
+			break;
+		}
+		if (*state == STEP_PENDING) {
+			stepAltitude(direction * ALTITUDE_STEP);
+			*state = STEP_DONE;
+		}
+		stepAltitude(direction * ALTITUDE_RAMP_STEP);
+		break;
+	case BUT_EV_RELEASE:
+		if (*state == STEP_PENDING && flying) {
+			stepAltitude(direction * ALTITUDE_STEP);
 		}
+		*state = STEP_DONE;
+		break;
+	}
+}
+
+/**
+ * Cancel the altitude step of UP or DOWN if either is held, as another
+ * button has been pressed with it.
+ */
+static void modifierUsed (void) {
+	if (isButHeld(UP)) {
+		stepState[UP] = STEP_CANCELLED;
 	}
-	else if (checkBut(RIGHT) && _heliState == HELI_ON) {
-		_desiredYaw100 += YAW_STEP_100;
-		if (_desiredYaw100 > 34500) {
-			_desiredYaw100 = 34500;
+	if (isButHeld(DOWN)) {
+		stepState[DOWN] = STEP_CANCELLED;
+	}
+}
+
+/**
+ * Start up, land or auto-tune the helicopter after a SELECT press.
+ */
+static void selectPressed (void) {
+	switch (_heliState) {
+	case HELI_OFF:
+		flightModeEvent(FM_EV_SELECT);
+		break;
+	case HELI_ON:
+		if (autoTuneAxis() != TUNE_NONE) {
+			// Abandon auto-tuning and keep hovering
+			requestControl(CTRL_REQ_TUNE_STOP);
+		} else if (isButHeld(UP)) {
+			requestControl(CTRL_REQ_TUNE);
+		} else if (isButHeld(DOWN)) {
+			// Tune and save the gains to flash
+			requestControl(CTRL_REQ_TUNE_SAVE);
+		} else {
+			requestControl(CTRL_REQ_LAND);
 		}
+		break;
+	default:
+		// If helicopter is currently starting or stopping, do nothing
+		break;
 	}
-	else if (checkBut(SELECT)) {
-		switch (_heliState) {
-		case HELI_OFF:
-			_heliState = HELI_STARTING;
+}
+
+/**
+ * Handles every queued button event:
+ *  UP: Increases desired altitude on release, or ramps it up while held
+ *  DOWN: Decreases desired altitude on release, or ramps it down while held
+ *  LEFT: Increments yaw counterclockwise, then ramps it while held
+ *  RIGHT: Increments yaw clockwise, then ramps it while held
+ *  LEFT or RIGHT while UP held, or while not flying: Shows the previous or
+ *   next display page
+ *  SELECT: Starts up or lands the helicopter
+ *  SELECT while UP held: Auto-tunes the controllers
+ *  SELECT while DOWN held: Auto-tunes the controllers and saves the gains
+ *  SELECT while auto-tuning: Abandons auto-tuning
+ *  RESET: Perform a "soft" system reset via SysCtl
+ * UP or DOWN held with another button changes no altitude.
+ */
+void checkButtons (void) {
+	butEvent_t event;
+	int flying;
+	int pressed;
+
+	while (getButEvent(&event)) {
+		flying = flightModeRuns(FM_TASK_SETPOINTS);
+		if (event.button == UP || event.button == DOWN) {
+			altitudeButton(&event, event.button == UP ? 1 : -1, flying);
+			continue;
+		}
+		if (event.type == BUT_EV_PRESS) {
+			modifierUsed();
+			pressed = 1;
+		} else if (event.type == BUT_EV_REPEAT) {
+			pressed = 0;
+		} else {
+			// Releases and long presses have no action
+			continue;
+		}
+
+		switch (event.button) {
+		case LEFT:
+			if (!flying || isButHeld(UP)) {
+				if (pressed) {
+					changeDisplayPage(-1);
+				}
+			} else {
+				stepYaw(pressed ? -YAW_STEP_100 : -YAW_RAMP_STEP_100);
+			}
+			break;
+		case RIGHT:
+			if (!flying || isButHeld(UP)) {
+				if (pressed) {
+					changeDisplayPage(1);
+				}
+			} else {
+				stepYaw(pressed ? YAW_STEP_100 : YAW_RAMP_STEP_100);
+			}
 			break;
-		case HELI_ON:
-			_heliState = HELI_STOPPING;
+		case SELECT:
+			if (pressed) {
+				selectPressed();
+			}
+			break;
+		case RESET:
+			if (pressed) {
+				SysCtlReset();
+			}
 			break;
-		default:
-			// If helicopter is currently starting or stopping, do nothing
-			return;
 		}
 	}
-	else if (checkBut(RESET)) {
-		SysCtlReset();
-	}
 }
@@ -17,12 +17,17 @@ enum buttonPorts {PHYSICAL = 0, VIRTUAL = 1};
 void initButtons (int port);
 
 /**
- * Checks each button for a press and performs an associated action:
- *  UP: Increases desired altitude
- *  DOWN: Decreases desired altitude
- *  LEFT: Increments yaw counterclockwise
- *  RIGHT: Increments yaw clockwise
+ * Handles every queued button event:
+ *  UP: Increases desired altitude, then ramps it up while held
+ *  DOWN: Decreases desired altitude, then ramps it down while held
+ *  LEFT: Increments yaw counterclockwise, then ramps it while held
+ *  RIGHT: Increments yaw clockwise, then ramps it while held
+ *  LEFT or RIGHT while UP held, or while not flying: Shows the previous or
+ *   next display page
  *  SELECT: Starts up or lands the helicopter
+ *  SELECT while UP held: Auto-tunes the controllers
+ *  SELECT while DOWN held: Auto-tunes the controllers and saves the gains
+ *  SELECT while auto-tuning: Abandons auto-tuning
  *  RESET: Perform a "soft" system reset via SysCtl
  */
 void checkButtons (void);
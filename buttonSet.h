@@ -29,6 +29,17 @@
 enum butDefs {UP = 0, DOWN = 1, LEFT = 2, RIGHT = 3, SELECT = 4, RESET = 5};
 #define NUM_BUTTONS 6
 
+// Button events, queued by updateButtons()
+enum but_event {BUT_EV_PRESS = 0, BUT_EV_RELEASE, BUT_EV_LONG, BUT_EV_REPEAT};
+// Size of the event queue (must be a power of 2)
+#define BUT_QUEUE_SIZE 16
+
+typedef struct {
+   unsigned long timeMs;	// Time since initButSet() in msec
+   unsigned char button;	// Value from enum butDefs
+   unsigned char type;	// Value from enum but_event
+} butEvent_t;
+
 
 // *******************************************************
 // initButSet: Initialise the button instances for the specific 
@@ -44,29 +55,76 @@ initButSet (unsigned char buttons, unsigned long port, unsigned int tickRateHz);
 // updateButtons: Function designed to be called from the SysTick
 //  interrupt handler.  It has no return type or argument list. A
 //  call to initButSet() is required before the first call to this.
+//  Debounces all the buttons together with vertical counters, and
+//  queues press, release, long-press and repeat events.
 void
 updateButtons (void);
 
 
+// *******************************************************
+// enableButInts: Switches to edge mode. The buttons are then only read
+//  by updateButtons() from an edge on a button pin until they are all
+//  released and settled, so they cost nothing while idle. Must be
+//  called after initButSet().
+void
+enableButInts (void);
+
+
+// *******************************************************
+// ButtonIntHandler: Interrupt handler for edges on the button pins,
+//  registered by enableButInts().
+void
+ButtonIntHandler (void);
+
+
+// *******************************************************
+// getButScans: Returns the number of times the buttons have been read.
+unsigned long
+getButScans (void);
+
+
+// *******************************************************
+// getButEvent: Takes the oldest button event from the queue. Returns
+//  1 and sets *event if there was one, otherwise returns 0. Events are
+//  only queued for active buttons.
+int
+getButEvent (butEvent_t* event);
+
+
+// *******************************************************
+// getButEventsDropped: Returns the number of button events lost
+//  because the queue was full.
+unsigned long
+getButEventsDropped (void);
+
+
 // *******************************************************
 // checkBut: Checks the specified individual button and returns true 
-//  (1) if the button is active and has state BUT_PUSHED (newly pushed) 
-//  and modifies state to BUT_IN. Returns false (0) otherwise.
+//  (1) if the button is active and has been newly pushed, and takes
+//  the press. Returns false (0) otherwise.
 unsigned int
 checkBut (unsigned int button);
 
 
 // *******************************************************
 // anyButPushed: Checks the current set of active buttons and returns 
-//  true (>0) if any of them have state = BUT_PUSHED. Value returned 
+//  true (>0) if any of them have been newly pushed. Value returned 
 //  is an ORed set of the bits representing the button(s) newly pushed,
 //  e.g., if "UP" and "SELECT" have been recently pushed, the 
 //  value returned is (UP_B | SELECT_B). Otherwise returns false (0). 
-//  State of any pushed button is altered to BUT_IN.
+//  The press of any pushed button is taken.
 unsigned char
 anyButPushed (void);
 
 
+// *******************************************************
+// isButHeld: Returns true (1) if the specified button is active
+//  and currently pushed in (after debouncing), false (0) otherwise.
+//  Does not alter the state of the button.
+unsigned int
+isButHeld (unsigned int button);
+
+
 // *******************************************************
 // enableBut: Alters the state of the specified button to BUT_OUT, 
 //  if it was previously BUT_INACTIVE, otherwise makes no change.
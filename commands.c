@@ -0,0 +1,481 @@
+/*
+ * commands.c
+ *
+ * Line-based command interface on UART0.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "commands.h"
+#include "globals.h"
+#include "motorControl.h"
+#include "flightMode.h"
+#include "autoTune.h"
+#include "serialLink.h"
+#include "telemetry.h"
+#include "format.h"
+#include "blackBox.h"
+#include "flightLog.h"
+#include "stackCheck.h"
+
+#include "string.h"
+
+/*
+ * Constants
+ */
+// Most words in a command line
+#define MAX_WORDS 4
+
+// Longest reply line, with its terminating null. A line with three
+// numbers of up to 11 characters each and 30 of text fits; longer replies
+// are split into lines.
+#define REPLY_LEN 64
+
+/*
+ * Static variables (shared within this file)
+ */
+
+// Command line being received
+static char line[CMD_LINE_LEN + 1];
+static unsigned int lineLen = 0;
+// Set when the line is too long; the rest of it is discarded
+static int lineOverflow = 0;
+
+static int statsRequested = 0;
+
+// Next line of the CHANNELS reply to send, or -1 if none is being sent
+static int channelLine = -1;
+
+/**
+ * Send a reply to a command.
+ * @param text Null-terminated reply, without the newline
+ */
+static void reply (const char* text) {
+	char buf[REPLY_LEN];
+	unsigned int len;
+
+	len = fmtStr(buf, 0, text);
+	len = fmtStr(buf, len, "\n");
+	telemetryText(buf, len);
+}
+
+/**
+ * Parse a signed decimal integer.
+ * @param word Null-terminated word to parse
+ * @param value Set to the value if the word is a valid integer
+ * @return 1 if the word is a valid integer, otherwise 0
+ */
+static int parseInt (const char* word, long* value) {
+	long result = 0;
+	int negative = 0;
+	int digits = 0;
+
+	if (*word == '-') {
+		negative = 1;
+		word++;
+	}
+	while (*word >= '0' && *word <= '9') {
+		// Limit the length so that the result cannot overflow
+		if (++digits > 9) {
+			return 0;
+		}
+		result = result * 10 + (*word++ - '0');
+	}
+	if (*word != '\0' || digits == 0) {
+		return 0;
+	}
+	*value = negative ? -result : result;
+	return 1;
+}
+
+/**
+ * Split the command line into words, in place.
+ * @param words Filled in with pointers to the words
+ * @return Number of words, or -1 if there are more than MAX_WORDS
+ */
+static int splitLine (char* words[]) {
+	int count = 0;
+	char* p = line;
+
+	while (1) {
+		while (*p == ' ') {
+			p++;
+		}
+		if (*p == '\0') {
+			return count;
+		}
+		if (count == MAX_WORDS) {
+			return -1;
+		}
+		words[count++] = p;
+		while (*p != ' ' && *p != '\0') {
+			p++;
+		}
+		if (*p == ' ') {
+			*p++ = '\0';
+		}
+	}
+}
+
+/**
+ * Report the gains of both axes.
+ */
+static void replyGains (void) {
+	char buf[REPLY_LEN];
+	unsigned int len;
+	gains_t axisGains;
+
+	getGains(ALTITUDE_AXIS, &axisGains);
+	len = fmtStr(buf, 0, "ALT ");
+	len = fmtInt(buf, len, axisGains.kp100);
+	len = fmtStr(buf, len, " ");
+	len = fmtInt(buf, len, axisGains.ki100);
+	getGains(YAW_AXIS, &axisGains);
+	len = fmtStr(buf, len, " YAW ");
+	len = fmtInt(buf, len, axisGains.kp100);
+	len = fmtStr(buf, len, " ");
+	len = fmtInt(buf, len, axisGains.ki100);
+	len = fmtStr(buf, len, "\n");
+	telemetryText(buf, len);
+}
+
+/**
+ * Report the UART statistics.
+ */
+static void replyStats (void) {
+	char buf[REPLY_LEN];
+	unsigned int len;
+	const txStats_t* stats = getTxStats();
+
+	len = fmtStr(buf, 0, "UART dropped=");
+	len = fmtUint(buf, len, stats->dropped);
+	len = fmtStr(buf, len, " max=");
+	len = fmtUint(buf, len, stats->highWater);
+	len = fmtStr(buf, len, " rxDropped=");
+	len = fmtUint(buf, len, stats->rxDropped);
+	len = fmtStr(buf, len, "\n");
+	telemetryText(buf, len);
+
+	len = fmtStr(buf, 0, "Stack used=");
+	len = fmtUint(buf, len, getStackHighWater());
+	len = fmtStr(buf, len, " of ");
+	len = fmtUint(buf, len, getStackSize());
+	len = fmtStr(buf, len, "\n");
+	telemetryText(buf, len);
+}
+
+/**
+ * Send the next line of the CHANNELS reply, which lists the telemetry
+ * channels one per line with their rates, if there is room for it. The
+ * whole list does not fit in the transmit buffer at once.
+ */
+static void replyChannelLine (void) {
+	char buf[REPLY_LEN];
+	unsigned int len;
+
+	if (!telemetryTextFits(REPLY_LEN)) {
+		return;
+	}
+	len = fmtInt(buf, 0, channelLine);
+	len = fmtStr(buf, len, " ");
+	len = fmtStr(buf, len, getTelemetryChannelName(channelLine));
+	len = fmtStr(buf, len, " ");
+	len = fmtUint(buf, len, getTelemetryChannelRate(channelLine));
+	len = fmtStr(buf, len, " Hz\n");
+	telemetryText(buf, len);
+
+	if (++channelLine >= getTelemetryChannelCount()) {
+		channelLine = -1;
+	}
+}
+
+/**
+ * Find a telemetry channel by number or name. Command lines are upper
+ * case and channel names lower case, so names are compared ignoring case.
+ * @param word Channel number or name
+ * @return The channel number, or -1 if there is no such channel
+ */
+static int findChannel (char* word) {
+	long channel;
+	char* p;
+
+	if (parseInt(word, &channel)) {
+		return (channel >= 0 && channel < getTelemetryChannelCount())
+				? channel : -1;
+	}
+	for (p = word; *p != '\0'; p++) {
+		if (*p >= 'A' && *p <= 'Z') {
+			*p = *p - 'A' + 'a';
+		}
+	}
+	return findTelemetryChannel(word);
+}
+
+/**
+ * Report the state of the black box recorder.
+ */
+static void replyBlackBox (void) {
+	char buf[REPLY_LEN];
+	unsigned int len;
+	const blackBoxStats_t* stats = getBlackBoxStats();
+
+	len = fmtStr(buf, 0, blackBoxFrozen() ? "BB frozen" : "BB recording");
+	len = fmtStr(buf, len, " records=");
+	len = fmtUint(buf, len, stats->records);
+	len = fmtStr(buf, len, " cyc=");
+	len = fmtUint(buf, len, stats->lastCycles);
+	len = fmtStr(buf, len, "/");
+	len = fmtUint(buf, len, stats->maxCycles);
+	len = fmtStr(buf, len, "\n");
+	telemetryText(buf, len);
+}
+
+/**
+ * Execute a black box command.
+ * @param words Words of the command, starting with "BB"
+ * @param count Number of words
+ */
+static void executeBlackBox (char* words[], int count) {
+	if (count == 1) {
+		replyBlackBox();
+	} else if (count == 2 && strcmp(words[1], "FREEZE") == 0) {
+		blackBoxTrigger(BB_TRIG_COMMAND);
+		reply("OK");
+	} else if (count == 2 && strcmp(words[1], "DUMP") == 0) {
+		reply("OK");
+		blackBoxDump();
+	} else if (count == 2 && strcmp(words[1], "ARM") == 0) {
+		blackBoxArm();
+		reply("OK");
+	} else if (count == 3 && strcmp(words[1], "TRIG") == 0) {
+		if (strcmp(words[2], "NONE") == 0) {
+			setBlackBoxTriggers(0);
+		} else if (strcmp(words[2], "STATE") == 0) {
+			setBlackBoxTriggers(BB_TRIG_STATE);
+		} else if (strcmp(words[2], "FAULT") == 0) {
+			setBlackBoxTriggers(BB_TRIG_FAULT);
+		} else if (strcmp(words[2], "ALL") == 0) {
+			setBlackBoxTriggers(BB_TRIG_STATE | BB_TRIG_FAULT);
+		} else {
+			reply("ERR unknown trigger");
+			return;
+		}
+		reply("OK");
+	} else {
+		reply("ERR unknown black box command");
+	}
+}
+
+/**
+ * Report the state of the flight log, on two lines to fit REPLY_LEN.
+ */
+static void replyFlightLog (void) {
+	char buf[REPLY_LEN];
+	unsigned int len;
+	const flightLogStats_t* stats = getFlightLogStats();
+
+	len = fmtStr(buf, 0, "LOG page=");
+	len = fmtUint(buf, len, stats->pageSeq);
+	len = fmtStr(buf, len, " slot=");
+	len = fmtUint(buf, len, stats->slot);
+	len = fmtStr(buf, len, " erases=");
+	len = fmtUint(buf, len, stats->eraseCount);
+	len = fmtStr(buf, len, "\n");
+	telemetryText(buf, len);
+
+	len = fmtStr(buf, 0, "LOG queued=");
+	len = fmtUint(buf, len, stats->queued);
+	len = fmtStr(buf, len, " dropped=");
+	len = fmtUint(buf, len, stats->dropped);
+	len = fmtStr(buf, len, " spares=");
+	len = fmtUint(buf, len, stats->spares);
+	len = fmtStr(buf, len, "\n");
+	telemetryText(buf, len);
+}
+
+/**
+ * Execute the command in the line buffer.
+ */
+static void execute (void) {
+	char* words[MAX_WORDS];
+	int count = splitLine(words);
+	long value;
+	long ki;
+	gains_t axisGains;
+
+	if (count == 0) {
+		return; // Blank line
+	}
+	if (count < 0) {
+		reply("ERR too many words");
+	}
+	else if (strcmp(words[0], "ALT") == 0 && count == 2) {
+		if (!parseInt(words[1], &value) || value < 0 || value > 100) {
+			reply("ERR altitude must be 0 to 100");
+		} else if (!flightModeRuns(FM_TASK_SETPOINTS)) {
+			reply("ERR not flying");
+		} else {
+			_desiredAltitude = value;
+			reply("OK");
+		}
+	}
+	else if (strcmp(words[0], "YAW") == 0 && count == 2) {
+		if (!parseInt(words[1], &value) || value < -345 || value > 345) {
+			reply("ERR yaw must be -345 to 345");
+		} else if (!flightModeRuns(FM_TASK_SETPOINTS)) {
+			reply("ERR not flying");
+		} else {
+			_desiredYaw100 = value * 100;
+			reply("OK");
+		}
+	}
+	else if (strcmp(words[0], "GAINS") == 0 && count == 1) {
+		replyGains();
+	}
+	else if (strcmp(words[0], "GAINS") == 0 && count == 4) {
+		if (!parseInt(words[2], &value) || !parseInt(words[3], &ki)
+				|| value < 0 || ki < 0
+				|| value > MAX_GAIN100 || ki > MAX_GAIN100) {
+			reply("ERR gains must be 0 to 20000");
+		} else if (strcmp(words[1], "ALT") == 0
+				|| strcmp(words[1], "YAW") == 0) {
+			axisGains.kp100 = value;
+			axisGains.ki100 = ki;
+			setGains((words[1][0] == 'A') ? ALTITUDE_AXIS : YAW_AXIS,
+					&axisGains);
+			reply("OK");
+		} else {
+			reply("ERR axis must be ALT or YAW");
+		}
+	}
+	else if (strcmp(words[0], "RATE") == 0 && count == 2) {
+		if (!parseInt(words[1], &value) || value < 0
+				|| value > TELEMETRY_MAX_RATE_HZ) {
+			reply("ERR rate out of range");
+		} else {
+			setTelemetryRate(value);
+			reply("OK");
+		}
+	}
+	else if (strcmp(words[0], "CHANNELS") == 0 && count == 1) {
+		channelLine = 0;
+	}
+	else if (strcmp(words[0], "SUB") == 0 && count == 3) {
+		int channel = findChannel(words[1]);
+
+		if (channel < 0) {
+			reply("ERR unknown channel");
+		} else if (!parseInt(words[2], &value) || value < 0
+				|| value > TELEMETRY_MAX_RATE_HZ) {
+			reply("ERR rate out of range");
+		} else {
+			subscribeTelemetryChannel(channel, value);
+			reply("OK");
+		}
+	}
+	else if (strcmp(words[0], "MODE") == 0 && count == 2) {
+		if (strcmp(words[1], "TEXT") == 0) {
+			setTelemetryMode(TELEMETRY_TEXT);
+			reply("OK");
+		} else if (strcmp(words[1], "BINARY") == 0) {
+			// Reply before switching, while the host still expects text
+			reply("OK");
+			setTelemetryMode(TELEMETRY_BINARY);
+		} else {
+			reply("ERR mode must be TEXT or BINARY");
+		}
+	}
+	else if (strcmp(words[0], "STATS") == 0 && count == 1) {
+		replyStats();
+		statsRequested = 1;
+	}
+	else if (strcmp(words[0], "TUNE") == 0 && count <= 2) {
+		if (!flightModeRuns(FM_TASK_SETPOINTS)) {
+			reply("ERR not flying");
+		} else if (count == 1) {
+			requestControl(CTRL_REQ_TUNE);
+			reply("OK");
+		} else if (strcmp(words[1], "SAVE") == 0) {
+			requestControl(CTRL_REQ_TUNE_SAVE);
+			reply("OK");
+		} else if (strcmp(words[1], "STOP") == 0) {
+			requestControl(CTRL_REQ_TUNE_STOP);
+			reply("OK");
+		} else {
+			reply("ERR unknown tune option");
+		}
+	}
+	else if (strcmp(words[0], "LOG") == 0 && count == 1) {
+		replyFlightLog();
+	}
+	else if (strcmp(words[0], "LOG") == 0 && count == 2
+			&& strcmp(words[1], "FLUSH") == 0) {
+		flightLogFlush();
+		reply("OK");
+	}
+	else if (strcmp(words[0], "LOG") == 0 && count == 2
+			&& strcmp(words[1], "DUMP") == 0) {
+		reply("OK");
+		flightLogDump();
+	}
+	else if (strcmp(words[0], "BB") == 0) {
+		executeBlackBox(words, count);
+	}
+	else {
+		reply("ERR unknown command");
+	}
+}
+
+/**
+ * Handle received characters, executing at most one complete command.
+ * Never waits, and handles at most CMD_CHARS_PER_CALL characters, so the
+ * time taken by each call is bounded. While a CHANNELS reply is being
+ * sent, sends its next line instead, and later commands wait.
+ */
+void processCommands (void) {
+	int i;
+	int c;
+
+	if (channelLine >= 0) {
+		replyChannelLine();
+		return;
+	}
+
+	for (i = 0; i < CMD_CHARS_PER_CALL; i++) {
+		c = UARTGetChar();
+		if (c < 0) {
+			return;
+		}
+
+		if (c == '\r' || c == '\n') {
+			line[lineLen] = '\0';
+			if (lineOverflow) {
+				reply("ERR line too long");
+			} else {
+				execute();
+			}
+			lineLen = 0;
+			lineOverflow = 0;
+			return; // At most one command per call
+		}
+
+		if (lineLen < CMD_LINE_LEN) {
+			// Commands are not case sensitive
+			line[lineLen++] = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+		} else {
+			lineOverflow = 1;
+		}
+	}
+}
+
+/**
+ * Check for, and clear, a request made by the STATS command for the
+ * periodic status reports to be sent now.
+ * @return 1 if the reports were requested, otherwise 0
+ */
+int takeStatsRequest (void) {
+	int requested = statsRequested;
+
+	statsRequested = 0;
+	return requested;
+}
@@ -0,0 +1,56 @@
+#ifndef COMMANDS_H_
+#define COMMANDS_H_
+
+/*
+ * commands.h
+ *
+ * Line-based command interface on UART0. Commands are words separated by
+ * spaces and terminated by a carriage return or newline; letters may be
+ * either case. Each command is answered with "OK" or "ERR <reason>".
+ *
+ *  ALT <percent>            Set the desired altitude (when flying)
+ *  YAW <degrees>            Set the desired yaw (when flying)
+ *  GAINS                    Report the PI gains (* 100) of both axes
+ *  GAINS ALT|YAW <kp> <ki>  Set the PI gains (* 100, 0 to 20000) of one
+ *                           axis
+ *  RATE <hz>                Set the status frame rate (0 for none)
+ *  CHANNELS                 List the telemetry channels and their rates
+ *  SUB <channel> <hz>       Subscribe to a channel by name or number
+ *                           (0 Hz unsubscribes)
+ *  MODE TEXT|BINARY         Set the telemetry format
+ *  STATS                    Report the interrupt, task, UART and stack stats
+ *  TUNE [SAVE|STOP]         Start (and save) or abandon auto-tuning
+ *  BB                       Report the black box recorder's state
+ *  BB FREEZE|DUMP|ARM       Freeze, dump or clear and restart the recorder
+ *  BB TRIG NONE|STATE|FAULT|ALL  Choose the recorder's triggers
+ *  LOG                      Report the flash flight log's state
+ *  LOG FLUSH|DUMP           Write queued records now, or send the log
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+/*
+ * Constants
+ */
+// Longest command line, excluding the terminator
+#define CMD_LINE_LEN 40
+
+// Most received characters handled by one call to processCommands()
+#define CMD_CHARS_PER_CALL 16
+
+/**
+ * Handle received characters, executing at most one complete command.
+ * Never waits, and handles at most CMD_CHARS_PER_CALL characters, so the
+ * time taken by each call is bounded. While a CHANNELS reply is being
+ * sent, sends its next line instead, and later commands wait.
+ */
+void processCommands (void);
+
+/**
+ * Check for, and clear, a request made by the STATS command for the
+ * periodic status reports to be sent now.
+ * @return 1 if the reports were requested, otherwise 0
+ */
+int takeStatsRequest (void);
+
+#endif /* COMMANDS_H_ */
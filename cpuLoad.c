@@ -0,0 +1,110 @@
+/*
+ * cpuLoad.c
+ *
+ * CPU load meter.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "cpuLoad.h"
+#include "intPriority.h"
+#include "timing.h"
+
+#include "inc/hw_types.h"
+
+#include "driverlib/interrupt.h"
+
+/*
+ * Static variables (shared within this file)
+ */
+
+// Cycle count and total interrupt cycles at the previous mark
+static unsigned long lastCycles = 0;
+static unsigned long lastIsrCycles = 0;
+
+// Cycles counted since the previous update
+static unsigned long isrCycles = 0;
+static unsigned long taskCycles = 0;
+static unsigned long idleCycles = 0;
+
+static cpuLoad_t load = {0, 0, 0};
+
+/**
+ * @param cycles Cycles spent on one activity
+ * @param perMille Cycles in one thousandth of the time counted
+ * @return Share of the time spent on the activity, in tenths of a percent
+ */
+static unsigned int share10 (unsigned long cycles, unsigned long perMille) {
+	unsigned long share;
+
+	if (perMille == 0) {
+		return 0;
+	}
+	share = cycles / perMille;
+	return (share > 1000) ? 1000 : share;
+}
+
+/**
+ * Start counting from now. Call just before the background loop.
+ */
+void initCpuLoad (void) {
+	IntMasterDisable();
+	lastIsrCycles = getIsrCyclesTotal();
+	lastCycles = cycleCount();
+	IntMasterEnable();
+}
+
+/**
+ * Count the time since the previous call as task time or idle time. Call
+ * at the start of each pass of the background loop.
+ * @param busy 1 if the previous pass ran a task, otherwise 0
+ */
+void cpuLoadMark (int busy) {
+	unsigned long now;
+	unsigned long isrTotal;
+	unsigned long isr;
+	unsigned long background;
+
+	// Read both counts with no handler in between, so that every handler
+	// counted ran inside the period measured
+	IntMasterDisable();
+	isrTotal = getIsrCyclesTotal();
+	now = cycleCount();
+	IntMasterEnable();
+
+	// Unsigned subtraction handles counter wrap-around
+	isr = isrTotal - lastIsrCycles;
+	background = (now - lastCycles) - isr;
+	lastIsrCycles = isrTotal;
+	lastCycles = now;
+
+	isrCycles += isr;
+	if (busy) {
+		taskCycles += background;
+	} else {
+		idleCycles += background;
+	}
+}
+
+/**
+ * Work out the CPU shares from the cycles counted since the previous
+ * call, and start counting again. Called once a second.
+ */
+void cpuLoadUpdate (void) {
+	unsigned long perMille = (isrCycles + taskCycles + idleCycles) / 1000;
+
+	load.isr10 = share10(isrCycles, perMille);
+	load.tasks10 = share10(taskCycles, perMille);
+	load.busy10 = share10(isrCycles + taskCycles, perMille);
+
+	isrCycles = 0;
+	taskCycles = 0;
+	idleCycles = 0;
+}
+
+/**
+ * @return CPU shares worked out by the last cpuLoadUpdate()
+ */
+const cpuLoad_t* getCpuLoad (void) {
+	return &load;
+}
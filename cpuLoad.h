@@ -0,0 +1,51 @@
+#ifndef CPULOAD_H_
+#define CPULOAD_H_
+
+/*
+ * cpuLoad.h
+ *
+ * CPU load meter. Every cycle is counted as interrupt time, background
+ * task time or idle time, using the DWT cycle counter and the cycles
+ * spent in each interrupt handler (see intPriority.h):
+ *  - Interrupt time is the handlers' own cycles.
+ *  - Each pass of the background loop that ran a task counts as task
+ *    time, and each pass that found nothing to do as idle time, less
+ *    the interrupt cycles taken during the pass.
+ * The shares are worked out once a second. Counting cycles rather than
+ * idle loop passes needs no calibration, and stays right when the
+ * system clock changes with the flight mode.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+// Share of the CPU, in tenths of a percent, over the last second
+typedef struct {
+	unsigned int busy10; // Interrupts and background tasks
+	unsigned int isr10; // Interrupt handlers
+	unsigned int tasks10; // Background tasks
+} cpuLoad_t;
+
+/**
+ * Start counting from now. Call just before the background loop.
+ */
+void initCpuLoad (void);
+
+/**
+ * Count the time since the previous call as task time or idle time. Call
+ * at the start of each pass of the background loop.
+ * @param busy 1 if the previous pass ran a task, otherwise 0
+ */
+void cpuLoadMark (int busy);
+
+/**
+ * Work out the CPU shares from the cycles counted since the previous
+ * call, and start counting again. Called once a second.
+ */
+void cpuLoadUpdate (void);
+
+/**
+ * @return CPU shares worked out by the last cpuLoadUpdate()
+ */
+const cpuLoad_t* getCpuLoad (void);
+
+#endif /* CPULOAD_H_ */
@@ -5,50 +5,180 @@
 * Author: J. Shaw and M. Rattner
 **/
 
+#include "display.h"
 #include "globals.h"
+#include "format.h"
+#include "frameBuffer.h"
+#include "stripChart.h"
 #include "inc/hw_types.h"
 #include "drivers/rit128x96x4.h"
-#include "stdio.h"
+
+#include "string.h"
+
+/*
+ * Constants
+ */
+// Characters per display line. Lines are padded with spaces to this
+// width so that they overwrite any longer text drawn before.
+#define LINE_WIDTH 19
+// Line buffer size: room for a label and the longest formatted number
+#define LINE_BUF_SIZE (LINE_WIDTH + 12)
+
+// Position of the text and width of each character cell, in pixels
+#define LINE_X 4
+#define CHAR_WIDTH FB_CHAR_WIDTH
+
+// SSI clock for the display. The controller accepts up to several MHz;
+// only the text drawing speed kept this low before the frame buffer.
+#define DISPLAY_SSI_CLOCK 1000000
+
+// Lines of the display, and the y position of each
+enum display_line { ALT_LINE = 0, DESIRED_ALT_LINE, YAW_LINE, DESIRED_YAW_LINE,
+	MAIN_LINE, TAIL_LINE, STATE_LINE, CPU_LINE, NUM_LINES };
+static const unsigned char lineY[NUM_LINES] = {14, 24, 34, 44, 54, 64, 74, 84};
+
+/*
+ * Static variables (shared within this file)
+ */
+
+// Text last drawn on each line. Starts empty, so every cell differs and
+// is drawn the first time.
+static char shown[NUM_LINES][LINE_WIDTH + 1];
+
+// Characters drawn since reset
+static unsigned long glyphsDrawn = 0;
+
+static int page = PAGE_TEXT;
+
+/**
+ * Draw a line of text into the frame buffer, rendering only the
+ * characters that differ from those already drawn. Each run of changed
+ * characters is drawn with one call.
+ * @param line One of the display lines
+ * @param text Text of the line, padded to LINE_WIDTH
+ */
+static void drawLine (int line, const char* text) {
+	char run[LINE_WIDTH + 1];
+	int start;
+	int end;
+
+	for (start = 0; start < LINE_WIDTH; start = end) {
+		if (text[start] == shown[line][start]) {
+			end = start + 1;
+			continue;
+		}
+		for (end = start; end < LINE_WIDTH && text[end] != shown[line][end];
+				end++) {
+			run[end - start] = text[end];
+			shown[line][end] = text[end];
+		}
+		run[end - start] = '\0';
+		fbDrawString(run, LINE_X + start * CHAR_WIDTH, lineY[line], 15);
+		glyphsDrawn += end - start;
+	}
+}
 
 /**
- * Initialise the OLED display with an SSI clock frequency of 200 kHz.
- * Note that this can only be called after serialLink's initConsole()
- * function because initConsole() resets GPIOA.
+ * Initialise the OLED display with an SSI clock frequency of 1 MHz and
+ * clear the frame buffer. Note that this can only be called after
+ * serialLink's initConsole() function because initConsole() resets GPIOA.
  */
 void initDisplay (void) {
-	RIT128x96x4Init(200000);
+	RIT128x96x4Init(DISPLAY_SSI_CLOCK);
+	fbClear();
+}
+
+/**
+ * Reconfigure the SSI link to the display after the system clock has
+ * changed, keeping the 1 MHz SSI clock.
+ */
+void displayClockChanged (void) {
+	RIT128x96x4Disable();
+	RIT128x96x4Enable(DISPLAY_SSI_CLOCK);
+}
+
+/**
+ * Send part of the changes in the frame buffer to the display. Called
+ * often from the background loop; each call sends at most FB_FLUSH_ROWS
+ * rows.
+ * @return Number of rows sent
+ */
+unsigned int displayFlush (void) {
+	return fbFlush(FB_FLUSH_ROWS);
+}
+
+/**
+ * Show another page, cycling through the pages in order. Only the page
+ * shown is drawn.
+ * @param step 1 for the next page, -1 for the previous page
+ */
+void changeDisplayPage (int step) {
+	page = (page + step + NUM_PAGES) % NUM_PAGES;
+	fbClear();
+	// Forget the text shown, so that it is all drawn again
+	memset(shown, 0, sizeof(shown));
+	if (page == PAGE_CHART) {
+		chartRedraw();
+	}
+}
+
+/**
+ * @return The page shown, one of the display pages
+ */
+int getDisplayPage (void) {
+	return page;
 }
 
 /**
  * Display the altitude of the heli rig. The measured value from
  * the ADC will be ~1-2 V. Decreasing voltage = increasing altitude.
+ * @param now Snapshot of the values to display
  */
-void displayAltitude () {
-	char actualString[20];
-	char desiredString[20];
-	char stateString[20];
-
-	snprintf(actualString, 20, "Altitude: %d%%        ", _avgAltitude);
-	snprintf(desiredString, 20, "Desired: %d%%   ", _desiredAltitude);
-	snprintf(stateString, 20, "Heli state: %d", _heliState);
-
-	RIT128x96x4StringDraw(actualString, 4, 14, 15);
-	RIT128x96x4StringDraw(desiredString, 4, 24, 15);
-	RIT128x96x4StringDraw(stateString, 4, 74, 15);
+void displayAltitude (const heliSnapshot_t* now) {
+	char actualString[LINE_BUF_SIZE];
+	char desiredString[LINE_BUF_SIZE];
+	char stateString[LINE_BUF_SIZE];
+	unsigned int len;
+
+	len = fmtStr(actualString, 0, "Altitude: ");
+	len = fmtInt(actualString, len, now->avgAltitude);
+	len = fmtStr(actualString, len, "%");
+	fmtPad(actualString, len, LINE_WIDTH);
+
+	len = fmtStr(desiredString, 0, "Desired: ");
+	len = fmtInt(desiredString, len, now->desiredAltitude);
+	len = fmtStr(desiredString, len, "%");
+	fmtPad(desiredString, len, LINE_WIDTH);
+
+	len = fmtStr(stateString, 0, "Heli state: ");
+	len = fmtInt(stateString, len, now->heliState);
+	fmtPad(stateString, len, LINE_WIDTH);
+
+	drawLine(ALT_LINE, actualString);
+	drawLine(DESIRED_ALT_LINE, desiredString);
+	drawLine(STATE_LINE, stateString);
 }
 
 /**
  * Display the yaw of the heli rig in degrees, relative to start
  * position.
+ * @param now Snapshot of the values to display
  */
-void displayYaw () {
-	char actualString[20];
-	char desiredString[20];
-	snprintf(actualString, 20, "Yaw*100: %d    ", _yaw100);
-	snprintf(desiredString, 20, "Desired*100: %d    ", _desiredYaw100);
-
-	RIT128x96x4StringDraw(actualString, 4, 34, 15);
-	RIT128x96x4StringDraw(desiredString, 4, 44, 15);
+void displayYaw (const heliSnapshot_t* now) {
+	char actualString[LINE_BUF_SIZE];
+	char desiredString[LINE_BUF_SIZE];
+	unsigned int len;
+
+	len = fmtStr(actualString, 0, "Yaw*100: ");
+	len = fmtInt(actualString, len, now->yaw100);
+	fmtPad(actualString, len, LINE_WIDTH);
+
+	len = fmtStr(desiredString, 0, "Desired*100: ");
+	len = fmtInt(desiredString, len, now->desiredYaw100);
+	fmtPad(desiredString, len, LINE_WIDTH);
+
+	drawLine(YAW_LINE, actualString);
+	drawLine(DESIRED_YAW_LINE, desiredString);
 }
 
 /**
@@ -57,11 +187,46 @@ void displayYaw () {
  * @param tailDuty Duty cycle of the tail rotor
  */
 void displayPWMStatus (unsigned int mainDuty100, unsigned int tailDuty100) {
-	char mainString[20];
-	char tailString[20];
-	snprintf(mainString, 20, "Main rotor: %d   ", mainDuty100);
-	snprintf(tailString, 20, "Tail rotor: %d   ", tailDuty100);
+	char mainString[LINE_BUF_SIZE];
+	char tailString[LINE_BUF_SIZE];
+	unsigned int len;
 
-	RIT128x96x4StringDraw(mainString, 4, 54, 15);
-	RIT128x96x4StringDraw(tailString, 4, 64, 15);
+	len = fmtStr(mainString, 0, "Main rotor: ");
+	len = fmtFixed(mainString, len, mainDuty100, 2);
+	len = fmtStr(mainString, len, "%");
+	fmtPad(mainString, len, LINE_WIDTH);
+
+	len = fmtStr(tailString, 0, "Tail rotor: ");
+	len = fmtFixed(tailString, len, tailDuty100, 2);
+	len = fmtStr(tailString, len, "%");
+	fmtPad(tailString, len, LINE_WIDTH);
+
+	drawLine(MAIN_LINE, mainString);
+	drawLine(TAIL_LINE, tailString);
+}
+
+/**
+ * Display the CPU load and the share of it taken by interrupts.
+ * @param load CPU shares over the last second
+ */
+void displayCpuLoad (const cpuLoad_t* load) {
+	char loadString[LINE_BUF_SIZE];
+	unsigned int len;
+
+	len = fmtStr(loadString, 0, "CPU ");
+	len = fmtUint(loadString, len, (load->busy10 + 5) / 10);
+	len = fmtStr(loadString, len, "% (ISR ");
+	len = fmtUint(loadString, len, (load->isr10 + 5) / 10);
+	len = fmtStr(loadString, len, "%)");
+	fmtPad(loadString, len, LINE_WIDTH);
+
+	drawLine(CPU_LINE, loadString);
+}
+
+/**
+ * @return Number of characters drawn since reset. Unchanged characters
+ * are not redrawn.
+ */
+unsigned long getGlyphsDrawn (void) {
+	return glyphsDrawn;
 }
@@ -6,24 +6,59 @@
  * Author: J. Shaw and Marcy Rattner
  */
 
+#include "globals.h"
+#include "cpuLoad.h"
+
+// Pages of the display: text showing the current values, and strip
+// charts of their history
+enum display_page { PAGE_TEXT = 0, PAGE_CHART, NUM_PAGES };
+
 /**
- * Initialise the OLED display with an SSI clock frequency of 200 kHz.
- * Note that this can only be called after serialLink's initConsole()
- * function because initConsole() resets GPIOA.
+ * Initialise the OLED display with an SSI clock frequency of 1 MHz and
+ * clear the frame buffer. Note that this can only be called after
+ * serialLink's initConsole() function because initConsole() resets GPIOA.
  */
 void initDisplay (void);
 
+/**
+ * Reconfigure the SSI link to the display after the system clock has
+ * changed, keeping the 1 MHz SSI clock.
+ */
+void displayClockChanged (void);
+
+/**
+ * Send part of the changes in the frame buffer to the display. Called
+ * often from the background loop; each call sends at most FB_FLUSH_ROWS
+ * rows.
+ * @return Number of rows sent
+ */
+unsigned int displayFlush (void);
+
+/**
+ * Show another page, cycling through the pages in order. Only the page
+ * shown is drawn.
+ * @param step 1 for the next page, -1 for the previous page
+ */
+void changeDisplayPage (int step);
+
+/**
+ * @return The page shown, one of the display pages
+ */
+int getDisplayPage (void);
+
 /**
  * Display the altitude of the heli rig. The measured value from
  * the ADC will be ~1-2 V. Decreasing voltage = increasing altitude.
+ * @param now Snapshot of the values to display
  */
-void displayAltitude ();
+void displayAltitude (const heliSnapshot_t* now);
 
 /**
  * Display the yaw of the heli rig in degrees, relative to start
  * position.
+ * @param now Snapshot of the values to display
  */
-void displayYaw ();
+void displayYaw (const heliSnapshot_t* now);
 
 /**
  * Display the duty cycle of the PWM generators.
@@ -31,3 +66,15 @@ void displayYaw ();
  * @param tailDuty Duty cycle of the tail rotor
  */
 void displayPWMStatus (unsigned int mainDuty100, unsigned int tailDuty100);
+
+/**
+ * Display the CPU load and the share of it taken by interrupts.
+ * @param load CPU shares over the last second
+ */
+void displayCpuLoad (const cpuLoad_t* load);
+
+/**
+ * @return Number of characters drawn since reset. Unchanged characters
+ * are not redrawn.
+ */
+unsigned long getGlyphsDrawn (void);
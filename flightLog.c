@@ -0,0 +1,522 @@
+/*
+ * flightLog.c
+ *
+ * Append-only flight log in on-chip flash.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "flightLog.h"
+#include "globals.h"
+#include "altitude.h"
+#include "motorControl.h"
+#include "flightMode.h"
+#include "telemetry.h"
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_flash.h"
+
+#include "driverlib/sysctl.h"
+#include "driverlib/flash.h"
+#include "driverlib/pwm.h"
+
+/*
+ * Constants
+ */
+#define ERASED 0xFFFFFFFF
+
+// Page header words
+#define HEADER_MAGIC 0
+#define HEADER_SEQ 1
+#define HEADER_ERASES 2
+
+// Dump frame header length, and room for the CRC
+#define DUMP_HEADER_LEN 3
+#define DUMP_RAW_LEN (DUMP_HEADER_LEN + LOG_RECORDS_PER_FRAME * \
+		LOG_RECORD_WORDS * 4 + 2)
+
+// What the flash writer is doing
+enum log_state { LOG_IDLE = 0, LOG_SPARE_ERASING, LOG_SPARE_HEADER,
+	LOG_PROGRAMMING, LOG_PAGE_ERASING, LOG_PAGE_PROGRAMMING };
+
+/*
+ * Static variables (shared within this file)
+ */
+
+// Records waiting to be written. queueHead is only changed by
+// flightLogRecord(), and queueTail only by flightLogService().
+static unsigned long queue[LOG_QUEUE_SIZE][LOG_RECORD_WORDS];
+static volatile unsigned int queueHead = 0;
+static volatile unsigned int queueTail = 0;
+static int flushRequested = 0;
+
+// Page being written, and the writer's progress
+static unsigned int page = 0;
+static int state = LOG_IDLE;
+static unsigned int word = 0; // Next word of the header or record
+static unsigned int batch = 0; // Records left in the current batch
+
+// Erase count of the spare page being prepared, from its old header
+static unsigned long spareErases;
+
+// Page write queued by flightLogWritePage(). The words are only changed
+// while pageWritePending is 0, and only read while it is 1.
+static unsigned long pageWriteAddr;
+static unsigned long pageWords[LOG_PAGE_WRITE_WORDS];
+static unsigned int pageWriteCount;
+static volatile int pageWritePending = 0;
+
+// Dump position: page (counted from the oldest) and slot, or -1
+static int dumpPage = -1;
+static unsigned int dumpSlot = 0;
+static unsigned char dumpRaw[DUMP_RAW_LEN];
+
+static flightLogStats_t stats;
+
+/**
+ * @param pageIndex Page number within the log region
+ * @return Address of the page
+ */
+static unsigned long pageAddr (unsigned int pageIndex) {
+	return LOG_FLASH_START + pageIndex * LOG_PAGE_SIZE;
+}
+
+/**
+ * @param pageIndex Page number within the log region
+ * @param slot Record slot within the page
+ * @return Address of the slot
+ */
+static unsigned long slotAddr (unsigned int pageIndex, unsigned int slot) {
+	return pageAddr(pageIndex) + (slot + 1) * LOG_RECORD_WORDS * 4;
+}
+
+/**
+ * @return 1 if the flash controller is still erasing or programming
+ */
+static int flashBusy (void) {
+	return (HWREG(FLASH_FMC) & (FLASH_FMC_WRITE | FLASH_FMC_ERASE)) != 0;
+}
+
+/**
+ * Start programming one word, without waiting for it to finish.
+ * @param addr Address of the word
+ * @param data Value to program
+ */
+static void startProgram (unsigned long addr, unsigned long data) {
+	HWREG(FLASH_FMD) = data;
+	HWREG(FLASH_FMA) = addr;
+	HWREG(FLASH_FMC) = FLASH_FMC_WRKEY | FLASH_FMC_WRITE;
+}
+
+/**
+ * Start erasing one page, without waiting for it to finish.
+ * @param addr Address of the page
+ */
+static void startErase (unsigned long addr) {
+	HWREG(FLASH_FMA) = addr;
+	HWREG(FLASH_FMC) = FLASH_FMC_WRKEY | FLASH_FMC_ERASE;
+}
+
+/**
+ * Compute the check word of a record.
+ * @param record The first LOG_RECORD_WORDS - 1 words of the record
+ * @return The check word
+ */
+static unsigned long checkWord (const unsigned long* record) {
+	unsigned long sum = 0;
+	int i;
+
+	for (i = 0; i < LOG_RECORD_WORDS - 1; i++) {
+		sum += record[i];
+	}
+	return sum ^ LOG_CHECK_KEY;
+}
+
+/**
+ * @param pageIndex Page number within the log region
+ * @return 1 if the page has a complete header
+ */
+static int pageValid (unsigned int pageIndex) {
+	return HWREG(pageAddr(pageIndex) + HEADER_MAGIC * 4) == LOG_PAGE_MAGIC;
+}
+
+/**
+ * @param pageIndex Page number within the log region
+ * @param slot Record slot within the page
+ * @return 1 if every word of the slot is erased
+ */
+static int slotErased (unsigned int pageIndex, unsigned int slot) {
+	unsigned long addr = slotAddr(pageIndex, slot);
+	int i;
+
+	for (i = 0; i < LOG_RECORD_WORDS; i++) {
+		if (HWREG(addr + i * 4) != ERASED) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * @param pageIndex Page number within the log region
+ * @param seq Sequence number the page should have
+ * @return 1 if the page is a spare: erased but for the sequence number
+ * and erase count of its header
+ */
+static int pageSpare (unsigned int pageIndex, unsigned long seq) {
+	unsigned int slot;
+
+	if (HWREG(pageAddr(pageIndex) + HEADER_MAGIC * 4) != ERASED
+			|| HWREG(pageAddr(pageIndex) + HEADER_SEQ * 4) != seq
+			|| HWREG(pageAddr(pageIndex) + HEADER_ERASES * 4) == ERASED) {
+		return 0;
+	}
+	for (slot = 0; slot < LOG_SLOTS_PER_PAGE; slot++) {
+		if (!slotErased(pageIndex, slot)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * @param n Number of pages after the one being written, from 0
+ * @return Page number within the log region of that page
+ */
+static unsigned int sparePage (unsigned int n) {
+	return (page + 1 + n) % LOG_PAGES;
+}
+
+/**
+ * @param pageIndex Page number within the log region
+ * @param slot Record slot within the page
+ * @return 1 if the slot holds a complete record
+ */
+static int slotValid (unsigned int pageIndex, unsigned int slot) {
+	unsigned long record[LOG_RECORD_WORDS];
+	unsigned long addr = slotAddr(pageIndex, slot);
+	int i;
+
+	for (i = 0; i < LOG_RECORD_WORDS; i++) {
+		record[i] = HWREG(addr + i * 4);
+	}
+	return record[LOG_RECORD_WORDS - 1] == checkWord(record);
+}
+
+/**
+ * Find where the log ends and prepare to continue it. Formats the region
+ * if it holds no log. Must be called after the system clock is set.
+ */
+void initFlightLog (void) {
+	unsigned long header[3];
+	unsigned int i;
+	int newest = -1;
+
+	// Flash timing is derived from the number of clocks per microsecond
+	FlashUsecSet(SysCtlClockGet() / 1000000);
+
+	for (i = 0; i < LOG_PAGES; i++) {
+		if (pageValid(i) && (newest < 0 || HWREG(pageAddr(i) + HEADER_SEQ * 4)
+				> HWREG(pageAddr(newest) + HEADER_SEQ * 4))) {
+			newest = i;
+		}
+	}
+
+	if (newest < 0) {
+		// No log yet: start one in the first page. This is done before
+		// flight, so it may wait for the flash.
+		page = 0;
+		header[HEADER_MAGIC] = LOG_PAGE_MAGIC;
+		header[HEADER_SEQ] = 1;
+		header[HEADER_ERASES] = 1;
+		if (FlashErase(pageAddr(page)) == 0) {
+			FlashProgram(header, pageAddr(page), sizeof(header));
+		}
+		stats.slot = 0;
+	} else {
+		// Continue after the last slot that has been written to. A torn
+		// record is left in place and skipped when the log is read.
+		page = newest;
+		stats.slot = LOG_SLOTS_PER_PAGE;
+		while (stats.slot > 0 && slotErased(page, stats.slot - 1)) {
+			stats.slot--;
+		}
+	}
+	stats.pageSeq = HWREG(pageAddr(page) + HEADER_SEQ * 4);
+	stats.eraseCount = HWREG(pageAddr(page) + HEADER_ERASES * 4);
+
+	// Spare pages erased before the reset, in order. A page whose erase
+	// or header was cut short is not one, and is erased again.
+	stats.spares = 0;
+	while (stats.spares < LOG_SPARE_PAGES && pageSpare(sparePage(stats.spares),
+			stats.pageSeq + 1 + stats.spares)) {
+		stats.spares++;
+	}
+}
+
+/**
+ * Queue a record of the current state. Called after each control step
+ * while flying. Never waits.
+ * @param timeMs Time since reset in milliseconds
+ */
+void flightLogRecord (unsigned long timeMs) {
+	unsigned int next = (queueHead + 1) & (LOG_QUEUE_SIZE - 1);
+	unsigned long* record = queue[queueHead];
+	heliSnapshot_t now;
+
+	if (next == queueTail) {
+		stats.dropped++;
+		return;
+	}
+
+	getSnapshot(&now);
+	record[0] = timeMs;
+	record[1] = now.yaw100;
+	record[2] = now.desiredYaw100;
+	record[3] = (now.avgAltitude & 0xFFFF)
+			| ((unsigned long)now.desiredAltitude << 16);
+	record[4] = getDutyCycle100(MAIN_ROTOR)
+			| ((unsigned long)getDutyCycle100(TAIL_ROTOR) << 16);
+	record[5] = (getRawAltitude() & 0xFFFF) | ((unsigned long)now.heliState << 16);
+	record[6] = getIntegrator(ALTITUDE_AXIS);
+	record[7] = checkWord(record);
+	queueHead = next;
+}
+
+/**
+ * Write queued records to flash on the next calls, even if they do not
+ * fill a page.
+ */
+void flightLogFlush (void) {
+	flushRequested = 1;
+}
+
+/**
+ * Start erasing the page after the last spare, keeping its erase count
+ * for its new header.
+ */
+static void startSpare (void) {
+	unsigned long addr = pageAddr(sparePage(stats.spares));
+	unsigned long erases = HWREG(addr + HEADER_ERASES * 4);
+
+	spareErases = (erases == ERASED) ? 1 : erases + 1;
+	startErase(addr);
+	state = LOG_SPARE_ERASING;
+}
+
+/**
+ * Take one step of writing the log: start at most one flash operation.
+ * Pages are only erased when the flight mode allows it.
+ */
+static void writeStep (void) {
+	unsigned int queued = (queueHead - queueTail) & (LOG_QUEUE_SIZE - 1);
+	int mayErase = flightModeRuns(FM_TASK_FLASH_ERASE);
+	unsigned long addr;
+
+	if (flashBusy()) {
+		return;
+	}
+
+	switch (state) {
+	case LOG_IDLE:
+		// A page write goes ahead of the next batch of records
+		if (pageWritePending && mayErase) {
+			startErase(pageWriteAddr);
+			word = 0;
+			state = LOG_PAGE_ERASING;
+			break;
+		}
+
+		// Flush what is left once no more records are being made
+		if (!flightModeRuns(FM_TASK_CONTROL)) {
+			flushRequested = 1;
+		}
+		if (queued == 0) {
+			flushRequested = 0;
+		} else if (stats.slot == LOG_SLOTS_PER_PAGE) {
+			// Page full: move on to the next spare page, which only needs
+			// its magic number. With none left, the queue fills and
+			// records are dropped until one can be erased.
+			if (stats.spares > 0) {
+				page = sparePage(0);
+				stats.spares--;
+				stats.pageSeq++;
+				stats.eraseCount = HWREG(pageAddr(page) + HEADER_ERASES * 4);
+				stats.slot = 0;
+				startProgram(pageAddr(page) + HEADER_MAGIC * 4, LOG_PAGE_MAGIC);
+			} else if (mayErase) {
+				startSpare();
+			}
+			break;
+		} else if (queued >= LOG_SLOTS_PER_PAGE - stats.slot || flushRequested) {
+			// Write a batch: enough to fill the page, or all if flushing
+			batch = LOG_SLOTS_PER_PAGE - stats.slot;
+			if (queued < batch) {
+				batch = queued;
+			}
+			word = 0;
+			state = LOG_PROGRAMMING;
+			break;
+		}
+
+		// Nothing to write: erase pages ahead while that is allowed
+		if (mayErase && stats.spares < LOG_SPARE_PAGES) {
+			startSpare();
+		}
+		break;
+
+	case LOG_SPARE_ERASING:
+		// The magic number is left erased until the log moves on to the
+		// page, so the page is not part of the log until then
+		word = HEADER_SEQ;
+		state = LOG_SPARE_HEADER;
+		// Fall through to start on the header at once
+
+	case LOG_SPARE_HEADER:
+		addr = pageAddr(sparePage(stats.spares));
+		if (word == HEADER_SEQ) {
+			startProgram(addr + HEADER_SEQ * 4, stats.pageSeq + 1 + stats.spares);
+			word = HEADER_ERASES;
+		} else {
+			startProgram(addr + HEADER_ERASES * 4, spareErases);
+			stats.spares++;
+			state = LOG_IDLE;
+		}
+		break;
+
+	case LOG_PROGRAMMING:
+		// Words go in order, so the check word is written last
+		startProgram(slotAddr(page, stats.slot) + word * 4,
+				queue[queueTail][word]);
+		if (++word == LOG_RECORD_WORDS) {
+			word = 0;
+			queueTail = (queueTail + 1) & (LOG_QUEUE_SIZE - 1);
+			stats.slot++;
+			stats.written++;
+			if (--batch == 0) {
+				state = LOG_IDLE;
+			}
+		}
+		break;
+
+	case LOG_PAGE_ERASING:
+	case LOG_PAGE_PROGRAMMING:
+		startProgram(pageWriteAddr + word * 4, pageWords[word]);
+		state = LOG_PAGE_PROGRAMMING;
+		if (++word == pageWriteCount) {
+			pageWritePending = 0;
+			state = LOG_IDLE;
+		}
+		break;
+	}
+}
+
+/**
+ * Queue a flash page outside the log to be erased, and words to be
+ * programmed at its start. The writer does this between batches of log
+ * records once the heli is off, so it never waits and never erases in
+ * flight. Safe to call from the control step.
+ * @param addr Address of the page
+ * @param words Words to program, copied before returning
+ * @param count Number of words, at most LOG_PAGE_WRITE_WORDS
+ * @return 1 if the write is queued, 0 if an earlier one is still pending
+ */
+int flightLogWritePage (unsigned long addr, const unsigned long* words,
+		unsigned int count) {
+	unsigned int i;
+
+	if (pageWritePending || count == 0 || count > LOG_PAGE_WRITE_WORDS) {
+		return 0;
+	}
+	for (i = 0; i < count; i++) {
+		pageWords[i] = words[i];
+	}
+	pageWriteAddr = addr;
+	pageWriteCount = count;
+	pageWritePending = 1;
+	return 1;
+}
+
+/**
+ * Send the next dump frame, holding up to LOG_RECORDS_PER_FRAME records.
+ * Scans at most one page per call.
+ */
+static void dumpStep (void) {
+	// Pages in order from the oldest; the page being written is last
+	unsigned int dumpIndex = (page + 1 + dumpPage) % LOG_PAGES;
+	unsigned int slot = dumpSlot;
+	unsigned int count = 0;
+	unsigned char* p = dumpRaw + DUMP_HEADER_LEN;
+	unsigned int i;
+
+	if (dumpPage >= LOG_PAGES) {
+		// End of the log: send an empty frame
+		dumpRaw[0] = TELEMETRY_VERSION;
+		dumpRaw[1] = TELEM_FLIGHTLOG;
+		dumpRaw[2] = 0;
+		if (sendTelemetryFrame(dumpRaw, DUMP_HEADER_LEN)) {
+			dumpPage = -1;
+		}
+		return;
+	}
+
+	if (pageValid(dumpIndex)) {
+		while (slot < LOG_SLOTS_PER_PAGE && count < LOG_RECORDS_PER_FRAME) {
+			if (slotValid(dumpIndex, slot)) {
+				// Flash is little-endian, as is the frame
+				for (i = 0; i < LOG_RECORD_WORDS * 4; i++) {
+					*p++ = HWREG(slotAddr(dumpIndex, slot) + (i & ~3))
+							>> ((i & 3) * 8);
+				}
+				count++;
+			}
+			slot++;
+		}
+	} else {
+		slot = LOG_SLOTS_PER_PAGE;
+	}
+
+	if (count > 0) {
+		dumpRaw[0] = TELEMETRY_VERSION;
+		dumpRaw[1] = TELEM_FLIGHTLOG;
+		dumpRaw[2] = count;
+		if (!sendTelemetryFrame(dumpRaw, p - dumpRaw)) {
+			return; // Try again next time
+		}
+	}
+	if (slot == LOG_SLOTS_PER_PAGE) {
+		dumpPage++;
+		dumpSlot = 0;
+	} else {
+		dumpSlot = slot;
+	}
+}
+
+/**
+ * Continue writing the log and any dump. Starts at most one flash
+ * operation and sends at most one dump frame. Called from the background
+ * loop.
+ */
+void flightLogService (void) {
+	writeStep();
+	if (dumpPage >= 0) {
+		dumpStep();
+	}
+}
+
+/**
+ * Start sending the whole log, oldest record first.
+ */
+void flightLogDump (void) {
+	dumpPage = 0;
+	dumpSlot = 0;
+}
+
+/**
+ * @return The log statistics
+ */
+const flightLogStats_t* getFlightLogStats (void) {
+	stats.queued = (queueHead - queueTail) & (LOG_QUEUE_SIZE - 1);
+	return &stats;
+}
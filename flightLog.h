@@ -0,0 +1,149 @@
+#ifndef FLIGHTLOG_H_
+#define FLIGHTLOG_H_
+
+/*
+ * flightLog.h
+ *
+ * Append-only flight log in a reserved region of on-chip flash, kept
+ * across resets. The region is used as a ring of 1 KB pages: the oldest
+ * pages are erased and reused in turn, so every page is erased equally
+ * often.
+ *
+ * Erasing a page stalls the processor (see below), so pages are only
+ * erased while the heli is off (FM_TASK_FLASH_ERASE): up to
+ * LOG_SPARE_PAGES pages after the newest are erased ahead of time, and
+ * given the sequence number and erase count of their header. When the
+ * newest page fills in flight, logging moves on to the next spare page
+ * by programming its magic number. If no spare page is left, records are
+ * dropped until the heli lands.
+ *
+ * Each page starts with a 32-byte header (magic, page sequence number,
+ * erase count) followed by LOG_SLOTS_PER_PAGE 32-byte record slots. A
+ * record's last word is a check word written after the others, so a
+ * record torn by a reset is recognised and skipped. At start-up the page
+ * with the highest sequence number and its first erased slot are found,
+ * and logging continues from there.
+ *
+ * Records are added to a RAM queue by the control step, which never
+ * touches the flash. The background loop copies a page's worth at a
+ * time to flash, one word per call, starting flash operations and
+ * checking on them later rather than waiting for them. The same writer
+ * takes turns at erasing and programming other pages, such as the saved
+ * auto-tune gains, so that nothing else waits on the flash controller.
+ *
+ * The writer never waits, but the processor does: the LM3S1968 has one
+ * flash bank, so code fetches stall while it is erased or programmed,
+ * interrupts included. Each word programmed stalls it for about 50 us,
+ * and each page erase for about 20 ms. In the host build, one erase left
+ * the SysTick count 40 ticks short at 30 s, ADC samples due during an
+ * erase are lost, and encoder edges coalesce. Hence no page is erased in
+ * flight, including the page written by flightLogWritePage(), which
+ * waits for the heli to land.
+ *
+ * Record (8 little-endian words):
+ *  time (ms)         yaw100            desired yaw100
+ *  altitude (% low half) | desired altitude (% high half)
+ *  main duty100 (low half) | tail duty100 (high half)
+ *  raw ADC (low half) | heli state (high half)
+ *  altitude integrator
+ *  check word: LOG_CHECK_KEY ^ sum of the other seven words
+ *
+ * Dump frame payload (TELEM_FLIGHTLOG):
+ *  u8  version        u8  type (TELEM_FLIGHTLOG)
+ *  u8  number of records, followed by the records (32 bytes each)
+ *  A frame with no records ends the dump.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+/*
+ * Constants
+ */
+// Flash region reserved for the log, below the auto-tune page. Must match
+// lm3s1968.cmd.
+#define LOG_FLASH_START 0x00030000
+#define LOG_FLASH_END 0x0003FC00
+#define LOG_PAGE_SIZE 1024
+#define LOG_PAGES ((LOG_FLASH_END - LOG_FLASH_START) / LOG_PAGE_SIZE)
+
+#define LOG_RECORD_WORDS 8
+#define LOG_SLOTS_PER_PAGE (LOG_PAGE_SIZE / (LOG_RECORD_WORDS * 4) - 1)
+
+#define LOG_PAGE_MAGIC 0x464C4F47 // "FLOG"
+#define LOG_CHECK_KEY 0x5A5AA5A5
+
+// Pages erased ahead while the heli is off, for the log to move on to in
+// flight: 16 pages is about 4 minutes of flight (15.5 s per page)
+#define LOG_SPARE_PAGES 16
+
+// Records waiting to be written (must be a power of 2). Holds two pages'
+// worth so that logging continues while a batch is programmed.
+#define LOG_QUEUE_SIZE 64
+
+// Records sent in each dump frame
+#define LOG_RECORDS_PER_FRAME 4
+
+// Most words flightLogWritePage() can write
+#define LOG_PAGE_WRITE_WORDS 8
+
+// Log statistics
+typedef struct {
+	unsigned long pageSeq; // Sequence number of the page being written
+	unsigned int slot; // Next slot to write in that page
+	unsigned long eraseCount; // Erase count of that page
+	unsigned long written; // Records written since reset
+	unsigned long dropped; // Records lost because the queue was full
+	unsigned int queued; // Records waiting to be written
+	unsigned int spares; // Pages erased ahead, ready for the log
+} flightLogStats_t;
+
+/**
+ * Find where the log ends and prepare to continue it. Formats the region
+ * if it holds no log. Must be called after the system clock is set.
+ */
+void initFlightLog (void);
+
+/**
+ * Queue a record of the current state. Called after each control step
+ * while flying. Never waits.
+ * @param timeMs Time since reset in milliseconds
+ */
+void flightLogRecord (unsigned long timeMs);
+
+/**
+ * Write queued records to flash on the next calls, even if they do not
+ * fill a page.
+ */
+void flightLogFlush (void);
+
+/**
+ * Queue a flash page outside the log to be erased, and words to be
+ * programmed at its start. The writer does this between batches of log
+ * records once the heli is off, so it never waits and never erases in
+ * flight. Safe to call from the control step.
+ * @param addr Address of the page
+ * @param words Words to program, copied before returning
+ * @param count Number of words, at most LOG_PAGE_WRITE_WORDS
+ * @return 1 if the write is queued, 0 if an earlier one is still pending
+ */
+int flightLogWritePage (unsigned long addr, const unsigned long* words,
+		unsigned int count);
+
+/**
+ * Continue writing the log and any dump. Starts at most one flash
+ * operation and sends at most one dump frame. Called from the background
+ * loop.
+ */
+void flightLogService (void);
+
+/**
+ * Start sending the whole log, oldest record first.
+ */
+void flightLogDump (void);
+
+/**
+ * @return The log statistics
+ */
+const flightLogStats_t* getFlightLogStats (void);
+
+#endif /* FLIGHTLOG_H_ */
@@ -0,0 +1,122 @@
+/*
+ * flightMode.c
+ *
+ * Table-driven state machine for the heli flight mode.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "flightMode.h"
+#include "globals.h"
+#include "motorControl.h"
+#include "autoTune.h"
+
+/*
+ * Constants
+ */
+// Number of flight modes (enum heli_state)
+#define NUM_MODES 4
+
+// No transition for an event
+#define NONE (-1)
+
+// One flight mode: the mode to change to on each event, the entry and
+// exit actions, the tasks enabled in the mode and its clock profile
+typedef struct {
+	signed char next[NUM_FM_EVENTS];
+	int (*entry)(void);
+	void (*exit)(void);
+	unsigned char tasks;
+	unsigned char clock;
+} flightMode_t;
+
+/**
+ * Entry to HELI_OFF: turn the motors off. The flight log writes out what
+ * is left once control has stopped.
+ * @return FM_EV_NONE
+ */
+static int enterOff (void) {
+	motorsOff();
+	return FM_EV_NONE;
+}
+
+/**
+ * Entry to HELI_STARTING: turn the motors on at their initial duty
+ * cycles, after which the heli is flying.
+ * @return FM_EV_AIRBORNE
+ */
+static int enterStarting (void) {
+	powerUp();
+	return FM_EV_AIRBORNE;
+}
+
+/**
+ * Exit from HELI_ON: abandon any auto-tuning.
+ */
+static void exitOn (void) {
+	stopAutoTune();
+}
+
+/**
+ * Entry to HELI_STOPPING: start the controlled-descent landing.
+ * @return FM_EV_NONE
+ */
+static int enterStopping (void) {
+	beginLanding();
+	return FM_EV_NONE;
+}
+
+// Indexed by enum heli_state. Events in the order of enum flight_event:
+// SELECT, AIRBORNE, LAND, TOUCHDOWN, FAULT.
+static const flightMode_t modes[NUM_MODES] = {
+	// HELI_OFF
+	{{HELI_STARTING, NONE, NONE, NONE, NONE},
+			enterOff, 0, FM_TASK_CALIBRATE | FM_TASK_FLASH_ERASE, CLOCK_LANDED},
+	// HELI_STARTING
+	{{NONE, HELI_ON, NONE, NONE, HELI_OFF},
+			enterStarting, 0, 0, CLOCK_FLYING},
+	// HELI_ON
+	{{NONE, NONE, HELI_STOPPING, NONE, HELI_STOPPING},
+			0, exitOn, FM_TASK_CONTROL | FM_TASK_SETPOINTS, CLOCK_FLYING},
+	// HELI_STOPPING
+	{{NONE, NONE, NONE, HELI_OFF, NONE},
+			enterStopping, 0, FM_TASK_CONTROL, CLOCK_FLYING}
+};
+
+/**
+ * Handle an event: if the current mode has a transition for it, run the
+ * exit action of the current mode, change mode and run the entry action
+ * of the new one, then handle any event that the entry action raises.
+ * @param event One of the flight mode events
+ */
+void flightModeEvent (int event) {
+	int next;
+
+	while (event != FM_EV_NONE) {
+		next = modes[_heliState].next[event];
+		if (next == NONE) {
+			return;
+		}
+		if (modes[_heliState].exit) {
+			modes[_heliState].exit();
+		}
+		_heliState = next;
+		event = modes[next].entry ? modes[next].entry() : FM_EV_NONE;
+	}
+}
+
+/**
+ * @param tasks Combination of FM_TASK_* values
+ * @return 1 if any of the tasks is enabled in the current mode, otherwise 0
+ */
+int flightModeRuns (int tasks) {
+	return (modes[_heliState].tasks & tasks) != 0;
+}
+
+/**
+ * @return The clock profile of the current mode, one of the enumerated
+ * clock_profile values
+ */
+int flightModeClock (void) {
+	return modes[_heliState].clock;
+}
@@ -0,0 +1,73 @@
+#ifndef FLIGHTMODE_H_
+#define FLIGHTMODE_H_
+
+/*
+ * flightMode.h
+ *
+ * Table-driven state machine for the heli flight mode (_heliState).
+ * Every change of mode is made by an event, looked up in a table of next
+ * states. Leaving a mode runs its exit action and entering one runs its
+ * entry action, which may raise a further event. Each mode also lists
+ * the kinds of task that may run in it, and the clock profile it runs
+ * at: a slow clock and slow background tasks while landed, and the full
+ * clock rate for the rest of the flight.
+ *
+ * Events that leave HELI_OFF or HELI_STARTING are raised by the
+ * background loop, and those that leave HELI_ON or HELI_STOPPING by the
+ * altitude control step, which only runs in those modes. So each mode
+ * has one owner and two events are never handled at once, even with
+ * CONTROL_IN_ISR. Other code asks the control step for a change with
+ * requestControl().
+ *
+ *  Mode           Event        Next mode      Action
+ *  HELI_OFF       SELECT       HELI_STARTING  motors on (entry)
+ *  HELI_STARTING  AIRBORNE     HELI_ON        raised by the entry action
+ *  HELI_STARTING  FAULT        HELI_OFF       motors off (entry)
+ *  HELI_ON        LAND, FAULT  HELI_STOPPING  stop auto-tune (exit),
+ *                                             start landing (entry)
+ *  HELI_STOPPING  TOUCHDOWN    HELI_OFF       motors off (entry)
+ * Any other event is ignored.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+/*
+ * Constants
+ */
+// Flight mode events
+enum flight_event { FM_EV_SELECT = 0, FM_EV_AIRBORNE, FM_EV_LAND,
+	FM_EV_TOUCHDOWN, FM_EV_FAULT, NUM_FM_EVENTS };
+
+// Returned by an entry action that raises no further event
+#define FM_EV_NONE (-1)
+
+// Kinds of task, as a mask, enabled in each mode
+#define FM_TASK_CONTROL 0x01 // Control laws, landing profile and flight log
+#define FM_TASK_SETPOINTS 0x02 // Changes of desired altitude and yaw
+#define FM_TASK_CALIBRATE 0x04 // Altitude recalibration while landed
+#define FM_TASK_FLASH_ERASE 0x08 // Flash page erases, which stall the CPU
+
+// Power/performance profiles of the system clock and background tasks
+enum clock_profile { CLOCK_LANDED = 0, CLOCK_FLYING, NUM_CLOCK_PROFILES };
+
+/**
+ * Handle an event: if the current mode has a transition for it, run the
+ * exit action of the current mode, change mode and run the entry action
+ * of the new one, then handle any event that the entry action raises.
+ * @param event One of the flight mode events
+ */
+void flightModeEvent (int event);
+
+/**
+ * @param tasks Combination of FM_TASK_* values
+ * @return 1 if any of the tasks is enabled in the current mode, otherwise 0
+ */
+int flightModeRuns (int tasks);
+
+/**
+ * @return The clock profile of the current mode, one of the enumerated
+ * clock_profile values
+ */
+int flightModeClock (void);
+
+#endif /* FLIGHTMODE_H_ */
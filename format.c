@@ -0,0 +1,142 @@
+/*
+ * format.c
+ *
+ * Allocation-free text formatting into caller-provided buffers.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "format.h"
+
+/**
+ * Append a string.
+ * @param buf Buffer to append to
+ * @param len Current length of the text in buf
+ * @param str Null-terminated string to append
+ * @return New length of the text in buf
+ */
+unsigned int fmtStr (char* buf, unsigned int len, const char* str) {
+	while (*str) {
+		buf[len++] = *str++;
+	}
+	buf[len] = '\0';
+	return len;
+}
+
+/**
+ * Append an unsigned integer in decimal (at most 10 characters).
+ * @param buf Buffer to append to
+ * @param len Current length of the text in buf
+ * @param value Value to append
+ * @return New length of the text in buf
+ */
+unsigned int fmtUint (char* buf, unsigned int len, unsigned long value) {
+	char digits[3 * sizeof(unsigned long)];
+	unsigned int n = 0;
+
+	// Generate the digits least significant first
+	do {
+		digits[n++] = '0' + value % 10;
+		value /= 10;
+	} while (value != 0);
+
+	while (n > 0) {
+		buf[len++] = digits[--n];
+	}
+	buf[len] = '\0';
+	return len;
+}
+
+/**
+ * Append a signed integer in decimal (at most 11 characters).
+ * @param buf Buffer to append to
+ * @param len Current length of the text in buf
+ * @param value Value to append
+ * @return New length of the text in buf
+ */
+unsigned int fmtInt (char* buf, unsigned int len, long value) {
+	if (value < 0) {
+		buf[len++] = '-';
+		// Negate as unsigned so that the most negative value works
+		return fmtUint(buf, len, 0ul - (unsigned long)value);
+	}
+	return fmtUint(buf, len, value);
+}
+
+/**
+ * Append a signed integer right-aligned in a field of spaces (at most
+ * the larger of width and 11 characters).
+ * @param buf Buffer to append to
+ * @param len Current length of the text in buf
+ * @param value Value to append
+ * @param width Minimum number of characters to append
+ * @return New length of the text in buf
+ */
+unsigned int fmtIntPadded (char* buf, unsigned int len, long value,
+		unsigned int width) {
+	char field[3 * sizeof(long) + 2];
+	unsigned int fieldLen = fmtInt(field, 0, value);
+	unsigned int i;
+
+	len = fmtPad(buf, len, len + ((width > fieldLen) ? width - fieldLen : 0));
+	for (i = 0; i < fieldLen; i++) {
+		buf[len++] = field[i];
+	}
+	buf[len] = '\0';
+	return len;
+}
+
+/**
+ * Append a fixed-point number, e.g. value 1234 with 2 decimals appends
+ * "12.34" (at most 13 characters).
+ * @param buf Buffer to append to
+ * @param len Current length of the text in buf
+ * @param value Value scaled by 10^decimals
+ * @param decimals Number of digits after the decimal point, 0 to 9
+ * @return New length of the text in buf
+ */
+unsigned int fmtFixed (char* buf, unsigned int len, long value,
+		unsigned int decimals) {
+	unsigned long magnitude, scale = 1;
+	unsigned long fraction;
+	unsigned int i;
+
+	for (i = 0; i < decimals; i++) {
+		scale *= 10;
+	}
+	if (value < 0) {
+		buf[len++] = '-';
+		magnitude = 0ul - (unsigned long)value;
+	} else {
+		magnitude = value;
+	}
+
+	len = fmtUint(buf, len, magnitude / scale);
+	if (decimals == 0) {
+		return len;
+	}
+	buf[len++] = '.';
+
+	// Leading zeros of the fraction, most significant digit first
+	fraction = magnitude % scale;
+	for (scale /= 10; scale > 0; scale /= 10) {
+		buf[len++] = '0' + (fraction / scale) % 10;
+	}
+	buf[len] = '\0';
+	return len;
+}
+
+/**
+ * Append spaces until the text is width characters long.
+ * @param buf Buffer to append to
+ * @param len Current length of the text in buf
+ * @param width Length to pad the text to
+ * @return New length of the text in buf
+ */
+unsigned int fmtPad (char* buf, unsigned int len, unsigned int width) {
+	while (len < width) {
+		buf[len++] = ' ';
+	}
+	buf[len] = '\0';
+	return len;
+}
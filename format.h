@@ -0,0 +1,77 @@
+#ifndef FORMAT_H_
+#define FORMAT_H_
+
+/*
+ * format.h
+ *
+ * Allocation-free text formatting. Each function appends to a
+ * caller-provided buffer at position len, keeps the buffer
+ * null-terminated, and returns the new length, so calls can be chained
+ * without rescanning the string. The caller must make sure the buffer is
+ * large enough; the maximum number of characters each call appends is
+ * given below.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+/**
+ * Append a string.
+ * @param buf Buffer to append to
+ * @param len Current length of the text in buf
+ * @param str Null-terminated string to append
+ * @return New length of the text in buf
+ */
+unsigned int fmtStr (char* buf, unsigned int len, const char* str);
+
+/**
+ * Append an unsigned integer in decimal (at most 10 characters).
+ * @param buf Buffer to append to
+ * @param len Current length of the text in buf
+ * @param value Value to append
+ * @return New length of the text in buf
+ */
+unsigned int fmtUint (char* buf, unsigned int len, unsigned long value);
+
+/**
+ * Append a signed integer in decimal (at most 11 characters).
+ * @param buf Buffer to append to
+ * @param len Current length of the text in buf
+ * @param value Value to append
+ * @return New length of the text in buf
+ */
+unsigned int fmtInt (char* buf, unsigned int len, long value);
+
+/**
+ * Append a signed integer right-aligned in a field of spaces (at most
+ * the larger of width and 11 characters).
+ * @param buf Buffer to append to
+ * @param len Current length of the text in buf
+ * @param value Value to append
+ * @param width Minimum number of characters to append
+ * @return New length of the text in buf
+ */
+unsigned int fmtIntPadded (char* buf, unsigned int len, long value,
+		unsigned int width);
+
+/**
+ * Append a fixed-point number, e.g. value 1234 with 2 decimals appends
+ * "12.34" (at most 13 characters).
+ * @param buf Buffer to append to
+ * @param len Current length of the text in buf
+ * @param value Value scaled by 10^decimals
+ * @param decimals Number of digits after the decimal point, 0 to 9
+ * @return New length of the text in buf
+ */
+unsigned int fmtFixed (char* buf, unsigned int len, long value,
+		unsigned int decimals);
+
+/**
+ * Append spaces until the text is width characters long.
+ * @param buf Buffer to append to
+ * @param len Current length of the text in buf
+ * @param width Length to pad the text to
+ * @return New length of the text in buf
+ */
+unsigned int fmtPad (char* buf, unsigned int len, unsigned int width);
+
+#endif /* FORMAT_H_ */
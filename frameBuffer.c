@@ -0,0 +1,310 @@
+/*
+ * frameBuffer.c
+ *
+ * Shadow frame buffer for the OLED display, flushed a few rows at a time.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "frameBuffer.h"
+
+#include "inc/hw_types.h"
+#include "drivers/rit128x96x4.h"
+
+/*
+ * Constants
+ */
+// First and last characters in the font
+#define FONT_FIRST ' '
+#define FONT_LAST '~'
+
+// 5 x 7 font, one byte per column with the top row in bit 0
+static const unsigned char font[FONT_LAST - FONT_FIRST + 1][5] = {
+	{0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+	{0x00, 0x00, 0x5f, 0x00, 0x00}, // '!'
+	{0x00, 0x07, 0x00, 0x07, 0x00}, // '"'
+	{0x14, 0x7f, 0x14, 0x7f, 0x14}, // '#'
+	{0x24, 0x2a, 0x7f, 0x2a, 0x12}, // '$'
+	{0x23, 0x13, 0x08, 0x64, 0x62}, // '%'
+	{0x36, 0x49, 0x55, 0x22, 0x50}, // '&'
+	{0x00, 0x05, 0x03, 0x00, 0x00}, // '\''
+	{0x00, 0x1c, 0x22, 0x41, 0x00}, // '('
+	{0x00, 0x41, 0x22, 0x1c, 0x00}, // ')'
+	{0x14, 0x08, 0x3e, 0x08, 0x14}, // '*'
+	{0x08, 0x08, 0x3e, 0x08, 0x08}, // '+'
+	{0x00, 0x50, 0x30, 0x00, 0x00}, // ','
+	{0x08, 0x08, 0x08, 0x08, 0x08}, // '-'
+	{0x00, 0x60, 0x60, 0x00, 0x00}, // '.'
+	{0x20, 0x10, 0x08, 0x04, 0x02}, // '/'
+	{0x3e, 0x51, 0x49, 0x45, 0x3e}, // '0'
+	{0x00, 0x42, 0x7f, 0x40, 0x00}, // '1'
+	{0x42, 0x61, 0x51, 0x49, 0x46}, // '2'
+	{0x21, 0x41, 0x45, 0x4b, 0x31}, // '3'
+	{0x18, 0x14, 0x12, 0x7f, 0x10}, // '4'
+	{0x27, 0x45, 0x45, 0x45, 0x39}, // '5'
+	{0x3c, 0x4a, 0x49, 0x49, 0x30}, // '6'
+	{0x01, 0x71, 0x09, 0x05, 0x03}, // '7'
+	{0x36, 0x49, 0x49, 0x49, 0x36}, // '8'
+	{0x06, 0x49, 0x49, 0x29, 0x1e}, // '9'
+	{0x00, 0x36, 0x36, 0x00, 0x00}, // ':'
+	{0x00, 0x56, 0x36, 0x00, 0x00}, // ';'
+	{0x08, 0x14, 0x22, 0x41, 0x00}, // '<'
+	{0x14, 0x14, 0x14, 0x14, 0x14}, // '='
+	{0x00, 0x41, 0x22, 0x14, 0x08}, // '>'
+	{0x02, 0x01, 0x51, 0x09, 0x06}, // '?'
+	{0x32, 0x49, 0x79, 0x41, 0x3e}, // '@'
+	{0x7e, 0x11, 0x11, 0x11, 0x7e}, // 'A'
+	{0x7f, 0x49, 0x49, 0x49, 0x36}, // 'B'
+	{0x3e, 0x41, 0x41, 0x41, 0x22}, // 'C'
+	{0x7f, 0x41, 0x41, 0x22, 0x1c}, // 'D'
+	{0x7f, 0x49, 0x49, 0x49, 0x41}, // 'E'
+	{0x7f, 0x09, 0x09, 0x09, 0x01}, // 'F'
+	{0x3e, 0x41, 0x49, 0x49, 0x7a}, // 'G'
+	{0x7f, 0x08, 0x08, 0x08, 0x7f}, // 'H'
+	{0x00, 0x41, 0x7f, 0x41, 0x00}, // 'I'
+	{0x20, 0x40, 0x41, 0x3f, 0x01}, // 'J'
+	{0x7f, 0x08, 0x14, 0x22, 0x41}, // 'K'
+	{0x7f, 0x40, 0x40, 0x40, 0x40}, // 'L'
+	{0x7f, 0x02, 0x0c, 0x02, 0x7f}, // 'M'
+	{0x7f, 0x04, 0x08, 0x10, 0x7f}, // 'N'
+	{0x3e, 0x41, 0x41, 0x41, 0x3e}, // 'O'
+	{0x7f, 0x09, 0x09, 0x09, 0x06}, // 'P'
+	{0x3e, 0x41, 0x51, 0x21, 0x5e}, // 'Q'
+	{0x7f, 0x09, 0x19, 0x29, 0x46}, // 'R'
+	{0x46, 0x49, 0x49, 0x49, 0x31}, // 'S'
+	{0x01, 0x01, 0x7f, 0x01, 0x01}, // 'T'
+	{0x3f, 0x40, 0x40, 0x40, 0x3f}, // 'U'
+	{0x1f, 0x20, 0x40, 0x20, 0x1f}, // 'V'
+	{0x3f, 0x40, 0x38, 0x40, 0x3f}, // 'W'
+	{0x63, 0x14, 0x08, 0x14, 0x63}, // 'X'
+	{0x07, 0x08, 0x70, 0x08, 0x07}, // 'Y'
+	{0x61, 0x51, 0x49, 0x45, 0x43}, // 'Z'
+	{0x00, 0x7f, 0x41, 0x41, 0x00}, // '['
+	{0x02, 0x04, 0x08, 0x10, 0x20}, // '\\'
+	{0x00, 0x41, 0x41, 0x7f, 0x00}, // ']'
+	{0x04, 0x02, 0x01, 0x02, 0x04}, // '^'
+	{0x40, 0x40, 0x40, 0x40, 0x40}, // '_'
+	{0x00, 0x01, 0x02, 0x04, 0x00}, // '`'
+	{0x20, 0x54, 0x54, 0x54, 0x78}, // 'a'
+	{0x7f, 0x48, 0x44, 0x44, 0x38}, // 'b'
+	{0x38, 0x44, 0x44, 0x44, 0x20}, // 'c'
+	{0x38, 0x44, 0x44, 0x48, 0x7f}, // 'd'
+	{0x38, 0x54, 0x54, 0x54, 0x18}, // 'e'
+	{0x08, 0x7e, 0x09, 0x01, 0x02}, // 'f'
+	{0x0c, 0x52, 0x52, 0x52, 0x3e}, // 'g'
+	{0x7f, 0x08, 0x04, 0x04, 0x78}, // 'h'
+	{0x00, 0x44, 0x7d, 0x40, 0x00}, // 'i'
+	{0x20, 0x40, 0x44, 0x3d, 0x00}, // 'j'
+	{0x7f, 0x10, 0x28, 0x44, 0x00}, // 'k'
+	{0x00, 0x41, 0x7f, 0x40, 0x00}, // 'l'
+	{0x7c, 0x04, 0x18, 0x04, 0x78}, // 'm'
+	{0x7c, 0x08, 0x04, 0x04, 0x78}, // 'n'
+	{0x38, 0x44, 0x44, 0x44, 0x38}, // 'o'
+	{0x7c, 0x14, 0x14, 0x14, 0x08}, // 'p'
+	{0x08, 0x14, 0x14, 0x18, 0x7c}, // 'q'
+	{0x7c, 0x08, 0x04, 0x04, 0x08}, // 'r'
+	{0x48, 0x54, 0x54, 0x54, 0x20}, // 's'
+	{0x04, 0x3f, 0x44, 0x40, 0x20}, // 't'
+	{0x3c, 0x40, 0x40, 0x20, 0x7c}, // 'u'
+	{0x1c, 0x20, 0x40, 0x20, 0x1c}, // 'v'
+	{0x3c, 0x40, 0x30, 0x40, 0x3c}, // 'w'
+	{0x44, 0x28, 0x10, 0x28, 0x44}, // 'x'
+	{0x0c, 0x50, 0x50, 0x50, 0x3c}, // 'y'
+	{0x44, 0x64, 0x54, 0x4c, 0x44}, // 'z'
+	{0x00, 0x08, 0x36, 0x41, 0x00}, // '{'
+	{0x00, 0x00, 0x7f, 0x00, 0x00}, // '|'
+	{0x00, 0x41, 0x36, 0x08, 0x00}, // '}'
+	{0x02, 0x01, 0x02, 0x04, 0x02}  // '~'
+};
+
+/*
+ * Static variables (shared within this file)
+ */
+
+static unsigned char pixels[FB_HEIGHT][FB_ROW_BYTES];
+
+// Changed span of each row, in bytes: dirtyEnd[row] == 0 if unchanged
+static unsigned char dirtyStart[FB_HEIGHT];
+static unsigned char dirtyEnd[FB_HEIGHT];
+
+// Row after the last one sent, so that flushes take turns over the rows
+static unsigned int nextRow = 0;
+
+static unsigned long bytesSent = 0;
+
+/**
+ * Mark a span of a row as changed.
+ * @param y Row
+ * @param x0 First column changed
+ * @param x1 Last column changed
+ */
+static void markDirty (unsigned int y, unsigned int x0, unsigned int x1) {
+	unsigned int start = x0 / 2;
+	unsigned int end = x1 / 2 + 1;
+
+	if (dirtyEnd[y] == 0) {
+		dirtyStart[y] = start;
+		dirtyEnd[y] = end;
+		return;
+	}
+	if (start < dirtyStart[y]) {
+		dirtyStart[y] = start;
+	}
+	if (end > dirtyEnd[y]) {
+		dirtyEnd[y] = end;
+	}
+}
+
+/**
+ * Set one pixel without marking it as changed.
+ * @param x Column
+ * @param y Row
+ * @param level Brightness, 0 to 15
+ */
+static void putPixel (unsigned int x, unsigned int y, unsigned char level) {
+	unsigned char* p = &pixels[y][x / 2];
+
+	if (x & 1) {
+		*p = (*p & 0xF0) | (level & 0x0F);
+	} else {
+		*p = (*p & 0x0F) | (level << 4);
+	}
+}
+
+/**
+ * Clear the frame buffer and mark every row as changed, so that the
+ * whole display is sent by the following flushes.
+ */
+void fbClear (void) {
+	unsigned int x;
+	unsigned int y;
+
+	for (y = 0; y < FB_HEIGHT; y++) {
+		for (x = 0; x < FB_ROW_BYTES; x++) {
+			pixels[y][x] = 0;
+		}
+		dirtyStart[y] = 0;
+		dirtyEnd[y] = FB_ROW_BYTES;
+	}
+}
+
+/**
+ * Set one pixel.
+ * @param x Column, 0 to FB_WIDTH - 1
+ * @param y Row, 0 to FB_HEIGHT - 1
+ * @param level Brightness, 0 to 15
+ */
+void fbSetPixel (unsigned int x, unsigned int y, unsigned char level) {
+	if (x >= FB_WIDTH || y >= FB_HEIGHT) {
+		return;
+	}
+	putPixel(x, y, level);
+	markDirty(y, x, x);
+}
+
+/**
+ * Fill a rectangle. Parts outside the display are ignored.
+ * @param x Left column
+ * @param y Top row
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @param level Brightness, 0 to 15
+ */
+void fbFillRect (unsigned int x, unsigned int y, unsigned int width,
+		unsigned int height, unsigned char level) {
+	unsigned int i;
+	unsigned int j;
+
+	if (x >= FB_WIDTH || y >= FB_HEIGHT || width == 0) {
+		return;
+	}
+	if (x + width > FB_WIDTH) {
+		width = FB_WIDTH - x;
+	}
+	if (y + height > FB_HEIGHT) {
+		height = FB_HEIGHT - y;
+	}
+	for (j = y; j < y + height; j++) {
+		for (i = x; i < x + width; i++) {
+			putPixel(i, j, level);
+		}
+		markDirty(j, x, x + width - 1);
+	}
+}
+
+/**
+ * Draw a string in the built-in font. Each character cell is cleared
+ * first. Characters outside the printable ASCII range are drawn as
+ * spaces.
+ * @param text Null-terminated string
+ * @param x Left column of the first character
+ * @param y Top row of the characters
+ * @param level Brightness, 0 to 15
+ */
+void fbDrawString (const char* text, unsigned int x, unsigned int y,
+		unsigned char level) {
+	const unsigned char* glyph;
+	unsigned int col;
+	unsigned int row;
+	char c;
+
+	for (; *text != '\0' && x + FB_CHAR_WIDTH <= FB_WIDTH;
+			text++, x += FB_CHAR_WIDTH) {
+		c = *text;
+		if (c < FONT_FIRST || c > FONT_LAST) {
+			c = ' ';
+		}
+		glyph = font[c - FONT_FIRST];
+		fbFillRect(x, y, FB_CHAR_WIDTH, FB_CHAR_HEIGHT, 0);
+		for (col = 0; col < 5; col++) {
+			for (row = 0; row < 7 && y + row < FB_HEIGHT; row++) {
+				if (glyph[col] & (1 << row)) {
+					putPixel(x + col, y + row, level);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Send up to maxRows changed rows to the display, starting after the
+ * last row sent. Only the changed span of each row is sent.
+ * @param maxRows Most rows to send
+ * @return Number of rows sent
+ */
+unsigned int fbFlush (unsigned int maxRows) {
+	unsigned int sent = 0;
+	unsigned int checked;
+	unsigned int y;
+	unsigned int start;
+	unsigned int len;
+
+	for (checked = 0; checked < FB_HEIGHT && sent < maxRows; checked++) {
+		y = nextRow;
+		nextRow = (nextRow + 1) % FB_HEIGHT;
+		if (dirtyEnd[y] == 0) {
+			continue;
+		}
+		start = dirtyStart[y];
+		len = dirtyEnd[y] - start;
+		dirtyEnd[y] = 0;
+		RIT128x96x4ImageDraw(&pixels[y][start], start * 2, y, len * 2, 1);
+		bytesSent += len;
+		sent++;
+	}
+	return sent;
+}
+
+/**
+ * @return Bytes of pixel data sent to the display since reset
+ */
+unsigned long fbBytesSent (void) {
+	return bytesSent;
+}
+
+/**
+ * @return The frame buffer, FB_HEIGHT rows of FB_ROW_BYTES bytes
+ */
+const unsigned char* fbPixels (void) {
+	return &pixels[0][0];
+}
@@ -0,0 +1,88 @@
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+/*
+ * frameBuffer.h
+ *
+ * Shadow copy in RAM of the 128 x 96 pixel, 4 bits per pixel OLED
+ * display. Drawing only changes RAM and marks the changed span of each
+ * row. fbFlush() then sends the changed spans to the display a few rows
+ * at a time, so that no single call holds up the background loop for
+ * long.
+ *
+ * Each byte holds two pixels, the left one in the upper nibble, as the
+ * display expects.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+/*
+ * Constants
+ */
+#define FB_WIDTH 128
+#define FB_HEIGHT 96
+#define FB_ROW_BYTES (FB_WIDTH / 2)
+
+// Character cell of the built-in 5 x 7 font, including spacing
+#define FB_CHAR_WIDTH 6
+#define FB_CHAR_HEIGHT 8
+
+// Rows sent by each call to fbFlush() from the background loop
+#define FB_FLUSH_ROWS 4
+
+/**
+ * Clear the frame buffer and mark every row as changed, so that the
+ * whole display is sent by the following flushes.
+ */
+void fbClear (void);
+
+/**
+ * Set one pixel.
+ * @param x Column, 0 to FB_WIDTH - 1
+ * @param y Row, 0 to FB_HEIGHT - 1
+ * @param level Brightness, 0 to 15
+ */
+void fbSetPixel (unsigned int x, unsigned int y, unsigned char level);
+
+/**
+ * Fill a rectangle. Parts outside the display are ignored.
+ * @param x Left column
+ * @param y Top row
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @param level Brightness, 0 to 15
+ */
+void fbFillRect (unsigned int x, unsigned int y, unsigned int width,
+		unsigned int height, unsigned char level);
+
+/**
+ * Draw a string in the built-in font. Each character cell is cleared
+ * first. Characters outside the printable ASCII range are drawn as
+ * spaces.
+ * @param text Null-terminated string
+ * @param x Left column of the first character
+ * @param y Top row of the characters
+ * @param level Brightness, 0 to 15
+ */
+void fbDrawString (const char* text, unsigned int x, unsigned int y,
+		unsigned char level);
+
+/**
+ * Send up to maxRows changed rows to the display, starting after the
+ * last row sent. Only the changed span of each row is sent.
+ * @param maxRows Most rows to send
+ * @return Number of rows sent
+ */
+unsigned int fbFlush (unsigned int maxRows);
+
+/**
+ * @return Bytes of pixel data sent to the display since reset
+ */
+unsigned long fbBytesSent (void);
+
+/**
+ * @return The frame buffer, FB_HEIGHT rows of FB_ROW_BYTES bytes
+ */
+const unsigned char* fbPixels (void);
+
+#endif /* FRAMEBUFFER_H_ */
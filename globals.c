@@ -14,8 +14,49 @@ volatile int _yaw100 = 0; // Degrees * 100
 volatile int _avgAltitude = 0; // Percent
 
 // Desired values - set by button presses
-int _desiredYaw100 = 0; // Degrees * 100
-int _desiredAltitude = 0; // Percent
+volatile int _desiredYaw100 = 0; // Degrees * 100
+volatile int _desiredAltitude = 0; // Percent
 
 // State of the helicopter
-int _heliState = HELI_OFF;
+volatile int _heliState = HELI_OFF;
+
+/* Snapshot */
+
+// Sequence lock: odd while the snapshot is being written. A reader that
+// sees the same even value before and after copying has a consistent copy.
+static volatile unsigned long snapshotSeq = 0;
+static volatile heliSnapshot_t snapshot;
+
+/**
+ * Copy the globals into the snapshot. Called only after each altitude
+ * average (in the background loop, or in the control interrupt with
+ * CONTROL_IN_ISR), so there is a single writer.
+ */
+void publishSnapshot (void) {
+	snapshotSeq++;
+	snapshot.yaw100 = _yaw100;
+	snapshot.avgAltitude = _avgAltitude;
+	snapshot.desiredYaw100 = _desiredYaw100;
+	snapshot.desiredAltitude = _desiredAltitude;
+	snapshot.heliState = _heliState;
+	snapshotSeq++;
+}
+
+/**
+ * Take a consistent copy of the last snapshot published, retrying if it
+ * was being published at the time. Must not be called from an interrupt
+ * that can preempt publishSnapshot().
+ * @param copy Set to the snapshot
+ */
+void getSnapshot (heliSnapshot_t* copy) {
+	unsigned long seq;
+
+	do {
+		seq = snapshotSeq;
+		copy->yaw100 = snapshot.yaw100;
+		copy->avgAltitude = snapshot.avgAltitude;
+		copy->desiredYaw100 = snapshot.desiredYaw100;
+		copy->desiredAltitude = snapshot.desiredAltitude;
+		copy->heliState = snapshot.heliState;
+	} while ((seq & 1) || seq != snapshotSeq);
+}
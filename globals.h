@@ -16,6 +16,19 @@
 #define ALTITUDE_STEP 10
 // Degrees * 100 the yaw should change when buttons are pressed
 #define YAW_STEP_100 1500
+// Percent and degrees * 100 the altitude and yaw change by at each
+// repeat while a button is held
+#define ALTITUDE_RAMP_STEP 2
+#define YAW_RAMP_STEP_100 500
+
+// Build option: define CONTROL_IN_ISR to run the altitude average,
+// control laws and PWM updates in the TIMER1 interrupt at a fixed rate
+// instead of in the background loop.
+//#define CONTROL_IN_ISR
+
+// Build option: define BUTTONS_POLLED to read the buttons on every
+// SysTick interrupt instead of only after an edge on a button pin.
+//#define BUTTONS_POLLED
 
 enum heli_state { HELI_OFF = 0, HELI_STARTING, HELI_ON, HELI_STOPPING };
 
@@ -26,11 +39,35 @@ extern volatile int _yaw100; // Degrees * 100
 extern volatile int _avgAltitude; // Percent
 
 // Desired values - set by button presses
-extern int _desiredYaw100; // Degrees * 100
-extern int _desiredAltitude; // Percent
+extern volatile int _desiredYaw100; // Degrees * 100
+extern volatile int _desiredAltitude; // Percent
 
 // State of the helicopter
-extern int _heliState;
+extern volatile int _heliState;
+
+// Consistent copy of the globals above, taken at one instant
+typedef struct {
+	int yaw100; // Degrees * 100
+	int avgAltitude; // Percent
+	int desiredYaw100; // Degrees * 100
+	int desiredAltitude; // Percent
+	int heliState;
+} heliSnapshot_t;
+
+/**
+ * Copy the globals into the snapshot. Called only after each altitude
+ * average (in the background loop, or in the control interrupt with
+ * CONTROL_IN_ISR), so there is a single writer.
+ */
+void publishSnapshot (void);
+
+/**
+ * Take a consistent copy of the last snapshot published, retrying if it
+ * was being published at the time. Must not be called from an interrupt
+ * that can preempt publishSnapshot().
+ * @param copy Set to the snapshot
+ */
+void getSnapshot (heliSnapshot_t* copy);
 
 
 #endif /* GLOBALS_H_ */
@@ -6,15 +6,30 @@
 **/
 #include "globals.h"
 #include "display.h"
+#include "frameBuffer.h"
+#include "stripChart.h"
 #include "altitude.h"
 #include "buttonSet.h"
 #include "buttonCheck.h"
 #include "motorControl.h"
+#include "flightMode.h"
+#include "autoTune.h"
 #include "serialLink.h"
+#include "telemetry.h"
+#include "timing.h"
+#include "intPriority.h"
+#include "format.h"
+#include "commands.h"
+#include "blackBox.h"
+#include "flightLog.h"
+#include "stackCheck.h"
+#include "cpuLoad.h"
 
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
 #include "inc/hw_ints.h"
+#include "inc/hw_sysctl.h"
+#include "inc/hw_flash.h"
 
 #include "driverlib/adc.h"
 #include "driverlib/pwm.h"
@@ -24,9 +39,9 @@
 #include "driverlib/interrupt.h"
 #include "driverlib/timer.h"
 #include "driverlib/debug.h"
+#include "driverlib/flash.h"
 
 #include "stdlib.h"
-#include "stdio.h"
 #include "string.h"
 
 /*
@@ -40,21 +55,104 @@ enum tasks {ALTITUDE_CTRL = 0,
 	DISPLAY = 2,
 	BUTTONS = 3,
 	MESSAGE = 4,
-	BUFFER_AVG = 5};
+	BUFFER_AVG = 5,
+	TELEMETRY = 6,
+	COMMANDS = 7,
+	FLIGHT_LOG = 8,
+	DISPLAY_FLUSH = 9,
+	CHART = 10,
+	CPU_LOAD = 11,
+	NUM_TASKS = 12};
 
 typedef struct {
 	unsigned long lastExecuted; // Timer count when it last occurred
 	unsigned int waitTimeUsec; // Time between executions in microseconds
 	unsigned long waitTicks; // Number of systicks between executions
 	unsigned int blocked; // 0 if not blocked, 1 if blocked
+	unsigned int deadlineUsec; // Lateness allowed once due, in microseconds
+	unsigned long deadlineTicks; // Lateness allowed once due, in systicks
+	int policy; // One of the enumerated deadline_policy values
+	unsigned long readyTicks; // Timer count deadlines are counted from, if
+		// later than when the task is due
+	unsigned long misses; // Runs later than the deadline
+	unsigned long maxLateness; // Most systicks late since the last report
+	unsigned int consecutiveMisses; // Late runs since the last on-time run
 } backgroundTask_t;
 
+// What isTimeFor() does when a task is run later than its deadline
+enum deadline_policy {DEADLINE_LOG = 0, // Count the miss only
+	DEADLINE_SKIP = 1, // Skip the run, but never two in a row
+	DEADLINE_LAND = 2}; // Land after DEADLINE_LAND_MISSES in a row
+
+// Consecutive misses by a DEADLINE_LAND task that make the heli land
+#define DEADLINE_LAND_MISSES 3
+
+// Longest line of the STATS report, with the blank line ending a section
+#define REPORT_LINE_LEN (INT_REPORT_LINE_LEN + 1)
+
+// Task names for the STATS report, indexed by enum tasks
+static const char* const taskNames[NUM_TASKS] = {"Alt ctrl", "Yaw ctrl",
+	"Display", "Buttons", "Message", "Buffer avg", "Telemetry", "Commands",
+	"Flight log", "Flush", "Chart", "CPU load"};
+
+// Background tasks that are run less often while landed
+static const int slowTasks[] = {BUFFER_AVG, BUTTONS, DISPLAY};
+#define NUM_SLOW_TASKS (sizeof(slowTasks) / sizeof(slowTasks[0]))
+
+// System clock divisor of the 200 MHz PLL, and multiple of the usual
+// periods of the slow tasks, for each clock profile. The control tasks run
+// at ALT_CTRL_RATE_HZ in both (see motorControl.h).
+typedef struct {
+	unsigned long sysDiv; // SYSCTL_SYSDIV_n, n <= 16
+	unsigned int slowTaskScale;
+} clockProfile_t;
+
+// Indexed by enum clock_profile
+#ifdef CLOCK_FIXED
+// The 20 MHz clock and task periods the profiles replaced, kept for the
+// host tests to compare against
+static const clockProfile_t profiles[NUM_CLOCK_PROFILES] = {
+	{SYSCTL_SYSDIV_10, 1}, // CLOCK_LANDED: 20 MHz
+	{SYSCTL_SYSDIV_10, 1} // CLOCK_FLYING: 20 MHz
+};
+#else
+static const clockProfile_t profiles[NUM_CLOCK_PROFILES] = {
+	{SYSCTL_SYSDIV_16, 4}, // CLOCK_LANDED: 12.5 MHz
+	{SYSCTL_SYSDIV_4, 1} // CLOCK_FLYING: 50 MHz
+};
+#endif
+
 // Array of background tasks
-static backgroundTask_t tasks[6];
+static backgroundTask_t tasks[NUM_TASKS];
+
+// Clock profile in use
+static int clockProfile = CLOCK_LANDED;
+
+// 1 if a task has run in this pass of the background loop
+static int taskRan = 0;
+
+// Most systicks any task has been late since the last telemetry sample
+static unsigned long latenessSample = 0;
 
 // How many timer ticks have occurred. Will take over 24 days to overflow
 volatile static unsigned long timerTicks = 0;
 
+// Period between successive runs of the altitude control law, since the
+// last status message and since the last telemetry sample
+static periodStats_t controlPeriod;
+static periodStats_t controlPeriodSample;
+
+// Next line of the STATS report to send, or -1 if none is being sent
+static int reportLine = -1;
+
+// Telemetry channels that could not be registered at start-up
+static unsigned int channelsLost = 0;
+
+// Cycles taken by the last display refresh, and most cycles taken by a
+// display flush since the last sample
+static unsigned long displayCycles = 0;
+static unsigned long flushCycles = 0;
+
 /**
  * Defines the time to wait between execution of background tasks.
  */
@@ -62,6 +160,12 @@ void defineTasks (void) {
 	// 1000 us = 1 ms; 1,000,000 us = 1 s
 	tasks[DISPLAY].waitTimeUsec = 250000;
 	tasks[MESSAGE].waitTimeUsec = 6000000;
+	tasks[TELEMETRY].waitTimeUsec = 1000000 / TELEMETRY_MAX_RATE_HZ;
+	tasks[COMMANDS].waitTimeUsec = 10000;
+	tasks[FLIGHT_LOG].waitTimeUsec = 1000;
+	tasks[DISPLAY_FLUSH].waitTimeUsec = 1000;
+	tasks[CHART].waitTimeUsec = CHART_SAMPLE_MS * 1000;
+	tasks[CPU_LOAD].waitTimeUsec = 1000000;
 
 	tasks[BUTTONS].waitTimeUsec = 500;
 	tasks[BUFFER_AVG].waitTimeUsec = 500;
@@ -69,81 +173,322 @@ void defineTasks (void) {
 	tasks[ALTITUDE_CTRL].waitTimeUsec = 500000;
 	tasks[YAW_CTRL].waitTimeUsec = 500000;
 
+	// Lateness allowed, and what is done about a miss. Every task not
+	// listed only counts its misses.
+	tasks[DISPLAY].deadlineUsec = 100000;
+	tasks[DISPLAY].policy = DEADLINE_SKIP;
+	tasks[MESSAGE].deadlineUsec = 100000;
+	tasks[TELEMETRY].deadlineUsec = 1000000 / TELEMETRY_MAX_RATE_HZ;
+	tasks[COMMANDS].deadlineUsec = 10000;
+	tasks[FLIGHT_LOG].deadlineUsec = 10000;
+	tasks[DISPLAY_FLUSH].deadlineUsec = 5000;
+	tasks[DISPLAY_FLUSH].policy = DEADLINE_SKIP;
+	tasks[CHART].deadlineUsec = CHART_SAMPLE_MS * 1000;
+	tasks[CPU_LOAD].deadlineUsec = 100000;
+
+	tasks[BUTTONS].deadlineUsec = 5000;
+	tasks[BUFFER_AVG].deadlineUsec = 2000;
+
+	tasks[ALTITUDE_CTRL].deadlineUsec = 5000;
+	tasks[ALTITUDE_CTRL].policy = DEADLINE_LAND;
+	tasks[YAW_CTRL].deadlineUsec = 5000;
+	tasks[YAW_CTRL].policy = DEADLINE_LAND;
+
 	unsigned long usecPerTick = 1000000 / SYSTICK_RATE_HZ;
 	int i;
-	for (i = 0; i < 6; i++) {
+	for (i = 0; i < NUM_TASKS; i++) {
 		tasks[i].lastExecuted = 0ul;
 		tasks[i].waitTicks =
 				tasks[i].waitTimeUsec / usecPerTick;
+		tasks[i].deadlineTicks =
+				tasks[i].deadlineUsec / usecPerTick;
 		tasks[i].blocked = 1; // Block all tasks initially
 	}
 }
 
+/**
+ * Count a task's next deadline from now at the earliest. Used when a task
+ * has not been run for a reason other than lateness, or its period has
+ * changed, so that its next run is not counted late.
+ * @param task One of the enumerated background tasks
+ */
+void holdTask (int task) {
+	tasks[task].readyTicks = timerTicks;
+}
+
+/**
+ * Set the periods of the slow background tasks.
+ * @param scale Multiple of their usual periods
+ */
+void scaleSlowTasks (unsigned int scale) {
+	unsigned long usecPerTick = 1000000 / SYSTICK_RATE_HZ;
+	unsigned int i;
+
+	for (i = 0; i < NUM_SLOW_TASKS; i++) {
+		tasks[slowTasks[i]].waitTicks =
+				tasks[slowTasks[i]].waitTimeUsec * scale / usecPerTick;
+		holdTask(slowTasks[i]); // Not late by the new period
+	}
+}
+
+/**
+ * Count how late a task that is due is being run, and apply its deadline
+ * policy if it is later than its deadline. The task is due one period
+ * after it last ran, or when it was last held, whichever is later.
+ * @param task One of the enumerated background tasks
+ * @param now Timer count
+ * @return 0 if this run is to be skipped, otherwise 1
+ */
+static unsigned int checkDeadline (int task, unsigned long now) {
+	backgroundTask_t* t = &tasks[task];
+	unsigned long due = t->lastExecuted + t->waitTicks;
+	unsigned long lateness;
+
+	if ((long)(t->readyTicks - due) > 0) {
+		due = t->readyTicks;
+	}
+	lateness = now - due;
+	if (lateness > t->maxLateness) {
+		t->maxLateness = lateness;
+	}
+	if (lateness > latenessSample) {
+		latenessSample = lateness;
+	}
+	if (lateness <= t->deadlineTicks) {
+		t->consecutiveMisses = 0;
+		return 1;
+	}
+
+	t->misses++;
+	t->consecutiveMisses++;
+	switch (t->policy) {
+	case DEADLINE_SKIP:
+		// A task that is always late still runs on every other period
+		if (t->consecutiveMisses & 1) {
+			t->lastExecuted = now;
+			return 0;
+		}
+		break;
+	case DEADLINE_LAND:
+		// The control task is still run, to fly the landing
+		if (t->consecutiveMisses == DEADLINE_LAND_MISSES) {
+			blackBoxTrigger(BB_TRIG_FAULT);
+			requestControl(CTRL_REQ_FAULT);
+		}
+		break;
+	default:
+		break;
+	}
+	return 1;
+}
+
 /**
  * Determines whether it is time to perform a background task.
  * @param task One of the enumerated background tasks
  * @return 0 if not enough time has passed since the last execution
- * of the task (or it is blocked); 1 if the task should be executed
- * again now
+ * of the task (or it is blocked, or this run is skipped by its deadline
+ * policy); 1 if the task should be executed again now
  */
 unsigned int isTimeFor(int task) {
+	unsigned long now = timerTicks;
+
 	if (tasks[task].blocked == 1) {
 		return 0;
 	}
-	unsigned long diff = timerTicks - tasks[task].lastExecuted;
-	return (diff >= tasks[task].waitTicks) ? 1 : 0;
+	unsigned long diff = now - tasks[task].lastExecuted;
+	if (diff < tasks[task].waitTicks) {
+		return 0;
+	}
+	if (!checkDeadline(task, now)) {
+		return 0;
+	}
+	taskRan = 1;
+	return 1;
+}
+
+/**
+ * Format a line reporting a background task's deadline misses and clear
+ * its maximum lateness.
+ * @param task One of the enumerated background tasks
+ * @param string Buffer of at least REPORT_LINE_LEN characters
+ * @return Length of the line
+ */
+static unsigned int formatTaskReport (int task, char* string) {
+	unsigned long usecPerTick = 1000000 / SYSTICK_RATE_HZ;
+	unsigned int len;
+
+	len = fmtStr(string, 0, taskNames[task]);
+	len = fmtStr(string, len, ": miss=");
+	len = fmtUint(string, len, tasks[task].misses);
+	len = fmtStr(string, len, " late=");
+	len = fmtUint(string, len, tasks[task].maxLateness * usecPerTick);
+	len = fmtStr(string, len, "/");
+	len = fmtUint(string, len, tasks[task].deadlineUsec);
+	len = fmtStr(string, len, " us \n");
+	tasks[task].maxLateness = 0;
+	return len;
+}
+
+/**
+ * Start sending the STATS report: a line for each interrupt, then a line
+ * for each background task. Any report still being sent is started again.
+ */
+void startReport (void) {
+	reportLine = 0;
+}
+
+/**
+ * Send the next line of the STATS report, if one is being sent. The
+ * report is sent a line at a time, each only once there is room for it in
+ * the transmit queue, so that none of it is dropped and the background
+ * loop never waits for the UART.
+ */
+void sendReportLine (void) {
+	char string[REPORT_LINE_LEN];
+	unsigned int len;
+
+	if (reportLine < 0 || !telemetryTextFits(REPORT_LINE_LEN)) {
+		return;
+	}
+
+	if (reportLine < NUM_ISRS) {
+		len = formatIntReport(reportLine, string);
+	} else {
+		len = formatTaskReport(reportLine - NUM_ISRS, string);
+	}
+	reportLine++;
+
+	// A blank line ends each section
+	if (reportLine == NUM_ISRS || reportLine == NUM_ISRS + NUM_TASKS) {
+		string[len++] = '\n';
+	}
+	telemetryText(string, len);
+	if (reportLine == NUM_ISRS + NUM_TASKS) {
+		reportLine = -1;
+	}
+}
+
+/**
+ * Count a run of the altitude control law in both of its period
+ * statistics.
+ */
+static void markControlPeriod (void) {
+	unsigned long now = cycleCount();
+
+	updatePeriodStats(&controlPeriod, now);
+	updatePeriodStats(&controlPeriodSample, now);
 }
 
 /**
  * The interrupt handler called when the timer reaches 0.
  */
 void TimerIntHandler (void) {
+	isrEnter(ISR_TIMEBASE,
+			TimerLoadGet(TIMER0_BASE, TIMER_A) - TimerValueGet(TIMER0_BASE, TIMER_A));
 	TimerIntClear(TIMER0_BASE, TIMER_TIMA_TIMEOUT);
 	timerTicks++;
 	SysCtlDelay(5); // Allow enough time for the interrupt to be cleared
+	isrExit(ISR_TIMEBASE);
 }
 
 /**
- * The interrupt handler called when the SysTick counter reaches 0.
+ * The interrupt handler called on either edge of yaw encoder channel A.
+ * Runs at the highest priority so that no edge is missed.
  */
-void SysTickIntHandler (void) {
-	static int prevA = -1;
+void YawIntHandler (void) {
 	unsigned long pinRead;
 	unsigned int yawA, yawB;
 
-	// Trigger an ADC conversion
-	ADCProcessorTrigger(ADC_BASE, 3);
-	tasks[BUFFER_AVG].blocked = 0; // Can take average after new value stored
-
-	// Update the status of the buttons
-	updateButtons();
-	tasks[BUTTONS].blocked = 0; // Can respond to new button press now
+	// Encoder edges are not timestamped by hardware, so the entry
+	// latency of this handler cannot be measured
+	isrEnter(ISR_ENCODER, 0);
+	GPIOPinIntClear(GPIO_PORTF_BASE, GPIO_PIN_5);
 
 	// Read the GPIO pins
 	pinRead = GPIOPinRead(GPIO_PORTF_BASE, GPIO_PIN_5 | GPIO_PIN_7);
 	yawA = pinRead & GPIO_PIN_5;
 	yawB = pinRead & GPIO_PIN_7;
 
-	if (!prevA && yawA) {
+	if (yawA) {
+		// Rising edge on channel A
 		if (yawB) {
 			_yaw100 += YAW_DEG_STEP_100;
 		} else {
 			_yaw100 -= YAW_DEG_STEP_100;
 		}
-	} else if (prevA && !yawA) {
+	} else {
+		// Falling edge on channel A
 		if (yawB) {
 			_yaw100 -= YAW_DEG_STEP_100;
 		} else {
 			_yaw100 += YAW_DEG_STEP_100;
 		}
 	}
-	prevA = yawA;
+	isrExit(ISR_ENCODER);
+}
+
+/**
+ * The interrupt handler called when the SysTick counter reaches 0.
+ */
+void SysTickIntHandler (void) {
+	isrEnter(ISR_SYSTICK, SysTickPeriodGet() - 1 - SysTickValueGet());
+
+	// Trigger an ADC conversion
+	triggerADC();
+	tasks[BUFFER_AVG].blocked = 0; // Can take average after new value stored
+
+	// Update the status of the buttons
+	updateButtons();
+	tasks[BUTTONS].blocked = 0; // Can respond to new button press now
+
+	// The yaw is kept up to date by YawIntHandler
 	tasks[YAW_CTRL].blocked = 0; // Can control yaw after each measurement
+	isrExit(ISR_SYSTICK);
+}
+
+#ifdef CONTROL_IN_ISR
+/**
+ * The interrupt handler for the fixed-rate control timer. Runs the
+ * altitude average, both control laws and the PWM updates.
+ */
+void ControlIntHandler (void) {
+	isrEnter(ISR_CONTROL,
+			TimerLoadGet(TIMER1_BASE, TIMER_A) - TimerValueGet(TIMER1_BASE, TIMER_A));
+	TimerIntClear(TIMER1_BASE, TIMER_TIMA_TIMEOUT);
+	markControlPeriod();
+
+	calcAvgAltitude();
+	publishSnapshot();
+	if (flightModeRuns(FM_TASK_CONTROL)) {
+		altitudeControl();
+		yawControl();
+		blackBoxRecord(timerTicks / (SYSTICK_RATE_HZ / 1000));
+		flightLogRecord(timerTicks / (SYSTICK_RATE_HZ / 1000));
+	}
+	isrExit(ISR_CONTROL);
 }
 
+/**
+ * Configure the TIMER1 interrupt that runs the control laws at
+ * ALT_CTRL_RATE_HZ. Must be called after system clock set.
+ */
+void initControlTimer (void) {
+	SysCtlPeripheralReset(SYSCTL_PERIPH_TIMER1);
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER1);
+
+	TimerConfigure(TIMER1_BASE, TIMER_CFG_PERIODIC);
+	TimerLoadSet(TIMER1_BASE, TIMER_A, SysCtlClockGet() / ALT_CTRL_RATE_HZ);
+
+	TimerIntRegister(TIMER1_BASE, TIMER_A, ControlIntHandler);
+	TimerIntEnable(TIMER1_BASE, TIMER_TIMA_TIMEOUT);
+
+	TimerEnable(TIMER1_BASE, TIMER_A);
+}
+#endif
+
 /**
  * Initialise the GPIO ports and pins.
- * Input on PF5 and PF7
+ * Input on PF5 and PF7, with an interrupt on both edges of PF5
  * Output on PF2 and PD1
  */
 void initPins (void) {
@@ -159,6 +504,11 @@ void initPins (void) {
 	GPIOPadConfigSet(GPIO_PORTF_BASE, GPIO_PIN_5|GPIO_PIN_7, GPIO_STRENGTH_2MA,
 	   GPIO_PIN_TYPE_STD_WPU);
 
+	// Decode the yaw on every edge of channel A (PF5)
+	GPIOIntTypeSet(GPIO_PORTF_BASE, GPIO_PIN_5, GPIO_BOTH_EDGES);
+	GPIOPortIntRegister(GPIO_PORTF_BASE, YawIntHandler);
+	GPIOPinIntEnable(GPIO_PORTF_BASE, GPIO_PIN_5);
+
 	// Initialise PD1/PWM1 (Pin 53) for PWM output
 	GPIOPinTypePWM(GPIO_PORTD_BASE, GPIO_PIN_1);
 	// Initialise PF2/PWM4 (Pin 22) for PWM output
@@ -204,13 +554,70 @@ void initTimer (void) {
 }
 
 /**
- * Construct a status string and send via UART0.
+ * Change to another clock profile. The PLL keeps running, so only the
+ * system clock divisor is changed, while running from the crystal. Every
+ * timer, baud rate and PWM period derived from the system clock is then
+ * reprogrammed to keep its rate, with interrupts disabled so that no
+ * handler sees the new clock with an old setting. The SysTick rate, and
+ * so the ADC sample rate, button debouncing and task timing, does not
+ * change.
+ * The change waits while a flash write or erase is in progress, since
+ * its timing is derived from the system clock.
+ * @param profile One of the enumerated clock_profile values
+ */
+void setClockProfile (int profile) {
+	unsigned long rcc;
+	unsigned long clock;
+
+	if (HWREG(FLASH_FMC) & (FLASH_FMC_WRITE | FLASH_FMC_ERASE)) {
+		return; // Try again on the next loop
+	}
+
+	IntMasterDisable();
+	rcc = HWREG(SYSCTL_RCC) | SYSCTL_RCC_BYPASS;
+	HWREG(SYSCTL_RCC) = rcc;
+	rcc = (rcc & ~(SYSCTL_RCC_SYSDIV_M | SYSCTL_RCC_USESYSDIV))
+			| profiles[profile].sysDiv;
+	HWREG(SYSCTL_RCC) = rcc;
+	HWREG(SYSCTL_RCC) = rcc & ~SYSCTL_RCC_BYPASS;
+
+	clock = SysCtlClockGet();
+	SysTickPeriodSet(clock / SYSTICK_RATE_HZ);
+	TimerLoadSet(TIMER0_BASE, TIMER_A, clock / SYSTICK_RATE_HZ);
+#ifdef CONTROL_IN_ISR
+	TimerLoadSet(TIMER1_BASE, TIMER_A, clock / ALT_CTRL_RATE_HZ);
+#endif
+	PWMClockChanged();
+	UARTClockChanged();
+	FlashUsecSet(clock / 1000000);
+	IntMasterEnable();
+
+	// The display is only used from the background loop
+	displayClockChanged();
+	scaleSlowTasks(profiles[profile].slowTaskScale);
+
+	// Periods measured across the change are in mixed units
+	resetPeriodStats(&controlPeriod);
+	resetPeriodStats(&controlPeriodSample);
+	clockProfile = profile;
+}
+
+/**
+ * Construct a status string in a frame buffer and send via UART0.
+ * The message is skipped if both frame buffers are still being sent.
  */
 void sendStatus (void) {
-	char string[170];
+	char* string = (char*)UARTFrameBuffer();
 	char* heliMode;
+	unsigned int len;
+	heliSnapshot_t now;
+
+	if (string == 0) {
+		return;
+	}
 
-	switch (_heliState) {
+	getSnapshot(&now);
+	switch (now.heliState) {
 	case HELI_OFF:
 		heliMode = "Landed";
 		break;
@@ -218,7 +625,7 @@ void sendStatus (void) {
 		heliMode = "Takeoff";
 		break;
 	case HELI_ON:
-		heliMode = "Flying";
+		heliMode = (autoTuneAxis() == TUNE_NONE) ? "Flying" : "Auto-tune";
 		break;
 	case HELI_STOPPING:
 		heliMode = "Landing";
@@ -228,49 +635,250 @@ void sendStatus (void) {
 		break;
 	}
 
-	snprintf(string, 23, "Desired yaw: %d deg \n",
-			(_desiredYaw100 + 50) / 100);
-	snprintf(string + strlen(string), 22, "Actual yaw: %d deg \n",
-			(_yaw100 + 50) / 100);
-	snprintf(string + strlen(string), 24, "Desired altitude: %d%% \n",
-			_desiredAltitude);
-	snprintf(string + strlen(string), 33, "Actual altitude: %d%% \n",
-			_avgAltitude);
-	snprintf(string + strlen(string), 18, "Main rotor: %d%% \n",
-			(getDutyCycle100(MAIN_ROTOR) + 50) / 100);
-	snprintf(string + strlen(string), 18, "Tail rotor: %d%% \n",
-			(getDutyCycle100(TAIL_ROTOR) + 50) / 100);
-	snprintf(string + strlen(string), 22, "Heli mode: %s \n\n",
-			heliMode);
+	len = fmtStr(string, 0, "Desired yaw: ");
+	len = fmtInt(string, len, (now.desiredYaw100 + 50) / 100);
+	len = fmtStr(string, len, " deg \nActual yaw: ");
+	len = fmtInt(string, len, (now.yaw100 + 50) / 100);
+	len = fmtStr(string, len, " deg \nDesired altitude: ");
+	len = fmtInt(string, len, now.desiredAltitude);
+	len = fmtStr(string, len, "% \nActual altitude: ");
+	len = fmtInt(string, len, now.avgAltitude);
+	len = fmtStr(string, len, "% \nMain rotor: ");
+	len = fmtInt(string, len, (getDutyCycle100(MAIN_ROTOR) + 50) / 100);
+	len = fmtStr(string, len, "% \nTail rotor: ");
+	len = fmtInt(string, len, (getDutyCycle100(TAIL_ROTOR) + 50) / 100);
+	len = fmtStr(string, len, "% \nHeli mode: ");
+	len = fmtStr(string, len, heliMode);
+
+	// Control period since the last message: min-max shows the jitter
+	len = fmtStr(string, len, " \nControl period: ");
+	len = fmtUint(string, len, cyclesToUsec(controlPeriod.minPeriod));
+	len = fmtStr(string, len, "-");
+	len = fmtUint(string, len, cyclesToUsec(controlPeriod.maxPeriod));
+	resetPeriodStats(&controlPeriod);
+
+	len = fmtStr(string, len, " us \nUART dropped: ");
+	len = fmtUint(string, len, getTxStats()->dropped);
+	len = fmtStr(string, len, " max: ");
+	len = fmtUint(string, len, getTxStats()->highWater);
+	len = fmtStr(string, len, " \n\n");
+
+	UARTSendFrame(len, 0);
+}
+
+/*
+ * Telemetry channel getters, registered by initChannels()
+ */
+static long chanRawAltitude (void) {
+	return getRawAltitude();
+}
+
+static long chanAltitude (void) {
+	return _avgAltitude;
+}
+
+static long chanDesiredAltitude (void) {
+	return _desiredAltitude;
+}
+
+static long chanYawCounts (void) {
+	return _yaw100 / YAW_DEG_STEP_100;
+}
+
+static long chanDesiredYaw (void) {
+	return _desiredYaw100;
+}
+
+static long chanMainDuty (void) {
+	return getDutyCycle100(MAIN_ROTOR);
+}
+
+static long chanTailDuty (void) {
+	return getDutyCycle100(TAIL_ROTOR);
+}
+
+static long chanAltIntegrator (void) {
+	return getIntegrator(ALTITUDE_AXIS);
+}
+
+static long chanYawIntegrator (void) {
+	return getIntegrator(YAW_AXIS);
+}
+
+// Longest control period since the previous sample
+static long chanControlPeriod (void) {
+	unsigned long maxPeriod = controlPeriodSample.maxPeriod;
+
+	resetPeriodStats(&controlPeriodSample);
+	return cyclesToUsec(maxPeriod);
+}
+
+static long chanAdcLatency (void) {
+	return getIsrStats(ISR_ADC)->lastLatency;
+}
+
+static long chanBlackBoxCycles (void) {
+	return getBlackBoxStats()->lastCycles;
+}
+
+static long chanDisplayCycles (void) {
+	return displayCycles;
+}
+
+static long chanDisplayGlyphs (void) {
+	return getGlyphsDrawn();
+}
+
+static long chanDisplayBytes (void) {
+	return fbBytesSent();
+}
+
+static long chanButtonScans (void) {
+	return getButScans();
+}
+
+static long chanCpuBusy (void) {
+	return getCpuLoad()->busy10;
+}
+
+static long chanCpuIsr (void) {
+	return getCpuLoad()->isr10;
+}
+
+static long chanCpuTasks (void) {
+	return getCpuLoad()->tasks10;
+}
+
+static long chanStackUsed (void) {
+	return getStackHighWater();
+}
+
+static long chanClockKhz (void) {
+	return SysCtlClockGet() / 1000;
+}
+
+static long chanDeadlineMisses (void) {
+	unsigned long misses = 0;
+	int i;
+
+	for (i = 0; i < NUM_TASKS; i++) {
+		misses += tasks[i].misses;
+	}
+	return misses;
+}
+
+// Most any task has been late since the previous sample
+static long chanMaxLateness (void) {
+	unsigned long lateness = latenessSample;
+
+	latenessSample = 0;
+	return lateness * (1000000 / SYSTICK_RATE_HZ);
+}
+
+static long chanFlushCycles (void) {
+	unsigned long maxCycles = flushCycles;
+
+	flushCycles = 0;
+	return maxCycles;
+}
+
+// Signals that can be subscribed to as telemetry channels, registered by
+// initChannels() in this order
+static const struct {
+	const char* name;
+	channelGetter_t getter;
+} channelTable[] = {
+	{"adc_raw", chanRawAltitude},
+	{"altitude", chanAltitude},
+	{"desired_altitude", chanDesiredAltitude},
+	{"yaw_counts", chanYawCounts},
+	{"desired_yaw100", chanDesiredYaw},
+	{"main_duty100", chanMainDuty},
+	{"tail_duty100", chanTailDuty},
+	{"alt_integrator", chanAltIntegrator},
+	{"yaw_integrator", chanYawIntegrator},
+	{"control_period_us", chanControlPeriod},
+	{"adc_latency", chanAdcLatency},
+	{"blackbox_cycles", chanBlackBoxCycles},
+	{"display_cycles", chanDisplayCycles},
+	{"display_glyphs", chanDisplayGlyphs},
+	{"display_bytes", chanDisplayBytes},
+	{"flush_cycles", chanFlushCycles},
+	{"button_scans", chanButtonScans},
+	{"sys_clock_khz", chanClockKhz},
+	{"stack_used", chanStackUsed},
+	{"cpu_busy_pct10", chanCpuBusy},
+	{"cpu_isr_pct10", chanCpuIsr},
+	{"cpu_tasks_pct10", chanCpuTasks},
+	{"deadline_misses", chanDeadlineMisses},
+	{"max_lateness_us", chanMaxLateness}
+};
+#define NUM_CHANNELS (sizeof(channelTable) / sizeof(channelTable[0]))
+
+// Fails to compile if a channel frame cannot carry every channel
+typedef char channelTableFits[NUM_CHANNELS <= TELEM_MAX_CHANNELS ? 1 : -1];
 
-	UARTSend(string);
+/**
+ * Register the signals that can be subscribed to as telemetry channels.
+ * @return Number of channels that could not be registered
+ */
+unsigned int initChannels (void) {
+	unsigned int lost = 0;
+	unsigned int i;
+
+	for (i = 0; i < NUM_CHANNELS; i++) {
+		if (addTelemetryChannel(channelTable[i].name,
+				channelTable[i].getter) < 0) {
+			lost++;
+		}
+	}
+	return lost;
 }
 
 /**
  * Calls initialisation functions.
  */
 void initMain (void) {
-	// Set the system clock rate at maximum / 10 (20 MHz).
+	// Start with the landed clock profile; the clock is raised to the
+	// maximum (50 MHz) for takeoff by setClockProfile().
 	// Note that the PLL must be used in order to use the ADC (Peripheral docs,
-	// section 19.1). ADC rate = 8 MHz / 10.
-	SysCtlClockSet(SYSCTL_SYSDIV_10 | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN |
-				   SYSCTL_XTAL_8MHZ);
+	// section 19.1). The ADC is clocked from the PLL, not the system clock.
+	SysCtlClockSet(profiles[CLOCK_LANDED].sysDiv | SYSCTL_USE_PLL |
+				   SYSCTL_OSC_MAIN | SYSCTL_XTAL_8MHZ);
+	scaleSlowTasks(profiles[CLOCK_LANDED].slowTaskScale);
+
+	initCycleCounter();
 
 	initConsole();
+	channelsLost = initChannels();
 	tasks[MESSAGE].blocked = 0;
+	tasks[TELEMETRY].blocked = 0;
+	tasks[COMMANDS].blocked = 0;
+	tasks[FLIGHT_LOG].blocked = 0;
 
 	initDisplay();
 	tasks[DISPLAY].blocked = 0;
+	tasks[DISPLAY_FLUSH].blocked = 0;
+	tasks[CHART].blocked = 0;
+	tasks[CPU_LOAD].blocked = 0;
 
 	initPins();
 	initADC();
 	initButtons(VIRTUAL);
 	initPWMchan();
+	initAutoTune();
+	initFlightLog();
 	initSysTick();
 	initTimer();
+#ifdef CONTROL_IN_ISR
+	initControlTimer();
+#endif
 
 	SysCtlDelay(2);
 
+	// Assign interrupt priorities before any can be taken
+	initIntPriorities();
+
 	// Enable interrupts to the processor.
 	IntMasterEnable();
 }
@@ -279,26 +887,43 @@ void initMain (void) {
  * Main program loop.
  */
 int main (void) {
+	paintStack();
 	defineTasks();
 	initMain();
-	UARTSend("UART is operational.\n\n");
+	if (getTelemetryMode() == TELEMETRY_TEXT) {
+		UARTSend("UART is operational.\n\n");
+	}
+	if (channelsLost > 0) {
+		char string[40];
+		unsigned int len;
 
+		len = fmtStr(string, 0, "ERR telemetry channels lost: ");
+		len = fmtUint(string, len, channelsLost);
+		len = fmtStr(string, len, "\n");
+		telemetryText(string, len);
+	}
+
+	initCpuLoad();
 	while (1) {
-		if (_heliState == HELI_STARTING) {
-			powerUp();
-		}
+		// Count the last pass as task or idle time
+		cpuLoadMark(taskRan);
+		taskRan = 0;
 
-		if (_heliState == HELI_STOPPING) {
-			powerDown();
+		// Change the clock when the flight mode calls for another profile
+		if (flightModeClock() != clockProfile) {
+			setClockProfile(flightModeClock());
 		}
 
+#ifndef CONTROL_IN_ISR
 		// Calculate the mean of the values in the altitude buffer
 		if (isTimeFor(BUFFER_AVG)) {
 			calcAvgAltitude();
+			publishSnapshot();
 			tasks[ALTITUDE_CTRL].blocked = 0; // Can adjust altitude now
 			tasks[BUFFER_AVG].blocked = 1; // Block until next measurement
 			tasks[BUFFER_AVG].lastExecuted = timerTicks;
 		}
+#endif
 
 		// Check for button presses and perform associated actions
 		if (isTimeFor(BUTTONS)) {
@@ -307,32 +932,108 @@ int main (void) {
 			tasks[BUTTONS].lastExecuted = timerTicks;
 		}
 
+#ifndef CONTROL_IN_ISR
+		// The control tasks are not due while the flight mode does not
+		// run them
+		if (!flightModeRuns(FM_TASK_CONTROL)) {
+			holdTask(ALTITUDE_CTRL);
+			holdTask(YAW_CTRL);
+		}
+
 		// Adjust altitude to desired value
-		if (_heliState != HELI_OFF && isTimeFor(ALTITUDE_CTRL)) {
+		if (flightModeRuns(FM_TASK_CONTROL) && isTimeFor(ALTITUDE_CTRL)) {
+			markControlPeriod();
 			altitudeControl();
+			blackBoxRecord(timerTicks / (SYSTICK_RATE_HZ / 1000));
+			flightLogRecord(timerTicks / (SYSTICK_RATE_HZ / 1000));
 			tasks[ALTITUDE_CTRL].blocked = 1; // Block until next average
 			tasks[ALTITUDE_CTRL].lastExecuted = timerTicks;
 		}
 
 		// Adjust yaw to desired value
-		if (_heliState != HELI_OFF && isTimeFor(YAW_CTRL)) {
+		if (flightModeRuns(FM_TASK_CONTROL) && isTimeFor(YAW_CTRL)) {
 			yawControl();
 			tasks[YAW_CTRL].blocked = 1; // Block until next measurement
 			tasks[YAW_CTRL].lastExecuted = timerTicks;
 		}
+#endif
 
-		// Send status message
+		// Send status message. Text would corrupt the binary stream, so
+		// it is only sent in text mode.
 		if (isTimeFor(MESSAGE)) {
-			sendStatus();
+			if (getTelemetryMode() == TELEMETRY_TEXT) {
+				sendStatus();
+				startReport();
+			}
 			tasks[MESSAGE].lastExecuted = timerTicks;
 		}
 
-		// Refresh the display
+		// Handle commands received via UART0, and continue any black box
+		// dump and STATS report
+		if (isTimeFor(COMMANDS)) {
+			processCommands();
+			blackBoxService();
+			if (takeStatsRequest()) {
+				if (getTelemetryMode() == TELEMETRY_TEXT) {
+					sendStatus();
+				}
+				startReport();
+			}
+			sendReportLine();
+			tasks[COMMANDS].lastExecuted = timerTicks;
+		}
+
+		// Send binary telemetry
+		if (isTimeFor(TELEMETRY)) {
+			telemetryTick(timerTicks / (SYSTICK_RATE_HZ / 1000));
+			tasks[TELEMETRY].lastExecuted = timerTicks;
+		}
+
+		// Write the flight log to flash
+		if (isTimeFor(FLIGHT_LOG)) {
+			flightLogService();
+			tasks[FLIGHT_LOG].lastExecuted = timerTicks;
+		}
+
+		// Refresh the text page of the frame buffer
 		if (isTimeFor(DISPLAY)) {
-			displayAltitude();
-			displayYaw();
-			displayPWMStatus(getDutyCycle100(MAIN_ROTOR), getDutyCycle100(TAIL_ROTOR));
+			if (getDisplayPage() == PAGE_TEXT) {
+				unsigned long start = cycleCount();
+				heliSnapshot_t now;
+				getSnapshot(&now);
+				displayAltitude(&now);
+				displayYaw(&now);
+				displayPWMStatus(getDutyCycle100(MAIN_ROTOR), getDutyCycle100(TAIL_ROTOR));
+				displayCpuLoad(getCpuLoad());
+				displayCycles = cycleCount() - start;
+			}
 			tasks[DISPLAY].lastExecuted = timerTicks;
 		}
+
+		// Sample the chart history, and draw each new column if the chart
+		// page is shown
+		if (isTimeFor(CHART)) {
+			if (chartSample() && getDisplayPage() == PAGE_CHART) {
+				unsigned long start = cycleCount();
+				chartDrawNew();
+				displayCycles = cycleCount() - start;
+			}
+			tasks[CHART].lastExecuted = timerTicks;
+		}
+
+		// Send a few changed rows of the frame buffer to the display
+		if (isTimeFor(DISPLAY_FLUSH)) {
+			unsigned long start = cycleCount();
+			if (displayFlush() > 0 && cycleCount() - start > flushCycles) {
+				flushCycles = cycleCount() - start;
+			}
+			tasks[DISPLAY_FLUSH].lastExecuted = timerTicks;
+		}
+
+		// Work out the CPU shares of the last second
+		if (isTimeFor(CPU_LOAD)) {
+			cpuLoadUpdate();
+			tasks[CPU_LOAD].lastExecuted = timerTicks;
+		}
 	}
 }
@@ -0,0 +1,155 @@
+/*
+ * adc.c
+ *
+ * Host build of the ADC driver. The four sample sequencers of ADC0 are
+ * modelled, processor triggered, sampling the rig at 1 Msps.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "driverlib/adc.h"
+#include "driverlib/interrupt.h"
+#include "board.h"
+
+/*
+ * Constants
+ */
+#define NUM_SEQUENCES 4
+#define MAX_STEPS 8
+#define SAMPLE_NS 1000
+
+// FIFO depth of each sequencer
+static const int fifoDepth[NUM_SEQUENCES] = {8, 4, 4, 1};
+
+typedef struct {
+	tBoolean enabled;
+	unsigned long steps[MAX_STEPS];
+	int stepCount;
+	tBoolean converting;
+	unsigned long long doneNs; // When the conversion completes
+	unsigned long fifo[MAX_STEPS];
+	int fifoCount;
+} simSequence_t;
+
+/*
+ * Static variables (shared within this file)
+ */
+static simSequence_t sequences[NUM_SEQUENCES];
+static unsigned long status = 0; // Raw interrupt status, a bit per sequence
+static unsigned long mask = 0;
+
+/**
+ * Complete the conversions that are due, and pend the interrupts of the
+ * sequences that have finished.
+ */
+void simAdcUpdate (void) {
+	int seq;
+
+	for (seq = 0; seq < NUM_SEQUENCES; seq++) {
+		simSequence_t* s = &sequences[seq];
+		int i;
+
+		if (s->converting && simTimeNs() >= s->doneNs) {
+			s->converting = false;
+			for (i = 0; i < s->stepCount; i++) {
+				if (s->fifoCount < fifoDepth[seq]) {
+					s->fifo[s->fifoCount++] = simRigAdc(s->steps[i] & 0xF);
+				}
+				if (s->steps[i] & ADC_CTL_IE) {
+					status |= 1 << seq;
+				}
+			}
+		}
+		if (status & mask & (1 << seq)) {
+			simAssert(INT_ADC0SS0 + seq);
+		}
+	}
+}
+
+/**
+ * @param irq Interrupt number of a sequence
+ * @return 1 if its interrupt is still asserted
+ */
+int simAdcAsserted (unsigned long irq) {
+	return (status & mask & (1 << (irq - INT_ADC0SS0))) != 0;
+}
+
+void ADCSequenceConfigure (unsigned long ulBase, unsigned long ulSequenceNum,
+		unsigned long ulTrigger, unsigned long ulPriority) {
+	simTick();
+}
+
+void ADCSequenceStepConfigure (unsigned long ulBase,
+		unsigned long ulSequenceNum, unsigned long ulStep,
+		unsigned long ulConfig) {
+	simSequence_t* s = &sequences[ulSequenceNum];
+
+	simTick();
+	s->steps[ulStep] = ulConfig;
+	if (ulConfig & ADC_CTL_END) {
+		s->stepCount = ulStep + 1;
+	}
+}
+
+void ADCSequenceEnable (unsigned long ulBase, unsigned long ulSequenceNum) {
+	simTick();
+	sequences[ulSequenceNum].enabled = true;
+}
+
+void ADCSequenceDisable (unsigned long ulBase, unsigned long ulSequenceNum) {
+	simTick();
+	sequences[ulSequenceNum].enabled = false;
+}
+
+void ADCProcessorTrigger (unsigned long ulBase, unsigned long ulSequenceNum) {
+	simSequence_t* s = &sequences[ulSequenceNum];
+
+	simTick();
+	if (s->enabled && !s->converting) {
+		s->converting = true;
+		s->doneNs = simTimeNs() + (unsigned long long)s->stepCount * SAMPLE_NS;
+	}
+}
+
+long ADCSequenceDataGet (unsigned long ulBase, unsigned long ulSequenceNum,
+		unsigned long* pulBuffer) {
+	simSequence_t* s = &sequences[ulSequenceNum];
+	long count = s->fifoCount;
+	int i;
+
+	simTick();
+	for (i = 0; i < s->fifoCount; i++) {
+		pulBuffer[i] = s->fifo[i];
+	}
+	s->fifoCount = 0;
+	return count;
+}
+
+void ADCIntRegister (unsigned long ulBase, unsigned long ulSequenceNum,
+		void (*pfnHandler)(void)) {
+	IntRegister(INT_ADC0SS0 + ulSequenceNum, pfnHandler);
+	IntEnable(INT_ADC0SS0 + ulSequenceNum);
+}
+
+void ADCIntEnable (unsigned long ulBase, unsigned long ulSequenceNum) {
+	simTick();
+	mask |= 1 << ulSequenceNum;
+}
+
+void ADCIntDisable (unsigned long ulBase, unsigned long ulSequenceNum) {
+	simTick();
+	mask &= ~(1 << ulSequenceNum);
+}
+
+unsigned long ADCIntStatus (unsigned long ulBase, unsigned long ulSequenceNum,
+		tBoolean bMasked) {
+	simTick();
+	return (bMasked ? status & mask : status) & (1 << ulSequenceNum);
+}
+
+void ADCIntClear (unsigned long ulBase, unsigned long ulSequenceNum) {
+	simTick();
+	status &= ~(1 << ulSequenceNum);
+}
@@ -0,0 +1,157 @@
+/*
+ * board.c
+ *
+ * Simulated LM3S1968 board: the clock, the register file and the passing
+ * of simulated time.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_sysctl.h"
+#include "board.h"
+
+#include <stdlib.h>
+
+/*
+ * Constants
+ */
+// Registers are kept in a table, looked up by address. Only the registers
+// the firmware or the simulated peripherals use get an entry.
+#define MAX_REGISTERS 64
+
+// Data watchpoint and trace cycle counter (see timing.c)
+#define DWT_CYCCNT 0xE0001004
+
+/*
+ * Static variables (shared within this file)
+ */
+static struct {
+	unsigned long addr;
+	volatile unsigned long value;
+} registers[MAX_REGISTERS];
+static int registerCount = 0;
+
+static unsigned long long cycles = 0;
+static unsigned long long timePs = 0; // Picoseconds, as cycles vary in length
+static unsigned long long endPs = 0;
+
+/**
+ * Set up the board. Must be called before the firmware is started.
+ * @param seconds Simulated time after which the run ends
+ */
+void simInit (double seconds) {
+	endPs = (unsigned long long)(seconds * 1e12);
+	// The processor starts on the main oscillator, with the PLL bypassed
+	*simRegisterSlot(SYSCTL_RCC) = SYSCTL_RCC_BYPASS;
+}
+
+/**
+ * @return Cycles of the system clock since reset
+ */
+unsigned long long simCycles (void) {
+	return cycles;
+}
+
+/**
+ * @return Simulated time since reset, in nanoseconds
+ */
+unsigned long long simTimeNs (void) {
+	return timePs / 1000;
+}
+
+/**
+ * @param addr Address of a register
+ * @return The register's storage, without charging an access
+ */
+volatile unsigned long* simRegisterSlot (unsigned long addr) {
+	int i;
+
+	if (addr >= SIM_FLASH_START && addr < SIM_FLASH_END) {
+		return simFlashWord(addr);
+	}
+	for (i = 0; i < registerCount; i++) {
+		if (registers[i].addr == addr) {
+			return &registers[i].value;
+		}
+	}
+	if (registerCount == MAX_REGISTERS) {
+		fprintf(stderr, "heliHost: too many registers at 0x%08lx\n", addr);
+		exit(1);
+	}
+	registers[registerCount].addr = addr;
+	registers[registerCount].value = 0;
+	return &registers[registerCount++].value;
+}
+
+/**
+ * Charge one register access, then give the register its storage. The
+ * cycle counter reads as the simulated cycles, which do not wrap.
+ * @param addr Address of a register
+ * @return The register's storage
+ */
+volatile unsigned long* simRegister (unsigned long addr) {
+	volatile unsigned long* slot;
+
+	simTick();
+	slot = simRegisterSlot(addr);
+	if (addr == DWT_CYCCNT) {
+		*slot = (unsigned long)cycles;
+	}
+	return slot;
+}
+
+/**
+ * Move time on, and catch the peripherals and the rig up with it.
+ * Interrupts they raise are only pended here, never taken.
+ * @param n Cycles to move on by
+ */
+static void advance (unsigned long long n) {
+	cycles += n;
+	timePs += n * (1000000000000ull / simClock());
+
+	simSysTickUpdate();
+	simTimerUpdate();
+	simAdcUpdate();
+	simUartUpdate();
+	simFlashUpdate();
+	simRigUpdate();
+	simScriptUpdate();
+
+	if (timePs >= endPs) {
+		simEnd(0);
+	}
+}
+
+/**
+ * Move time on while the processor is stalled by a flash program or
+ * erase. Instructions are fetched from the flash, so nothing runs, not
+ * even an interrupt handler; interrupts raised meanwhile stay pending.
+ */
+static void stallForFlash (void) {
+	while (simFlashBusy()) {
+		advance(SIM_ACCESS_CYCLES);
+	}
+}
+
+/**
+ * Charge one register access and take any interrupts that are due.
+ */
+void simTick (void) {
+	advance(SIM_ACCESS_CYCLES);
+	stallForFlash();
+	simDispatch();
+}
+
+/**
+ * Spend cycles busy-waiting, taking interrupts as they fall due.
+ * @param n Cycles to wait
+ */
+void simDelay (unsigned long long n) {
+	while (n > 0) {
+		unsigned long long step = n < SIM_ACCESS_CYCLES ? n : SIM_ACCESS_CYCLES;
+		advance(step);
+		stallForFlash();
+		simDispatch();
+		n -= step;
+	}
+}
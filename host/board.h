@@ -0,0 +1,247 @@
+#ifndef BOARD_H_
+#define BOARD_H_
+
+/*
+ * board.h
+ *
+ * Simulated LM3S1968 board for the host build. The firmware runs
+ * unmodified on top of host implementations of the driver library calls
+ * it makes; this is the interface between those implementations, the
+ * interrupt controller, the clock and the model of the heli rig.
+ *
+ * Time is simulated, so a run is the same every time. It advances by
+ * SIM_ACCESS_CYCLES on each driver library call or register access,
+ * which stands in for the code run between accesses, and by the time
+ * taken by blocking calls. Interrupts are taken at those points, in
+ * priority order and nested as on the NVIC. The firmware's own code costs
+ * no simulated time, so cycle counts measured on the host show the
+ * interrupt and task scheduling, not the cost of the code: profile that
+ * with the host's tools.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include <stdio.h>
+
+/*
+ * Constants
+ */
+// Cycles charged for each driver library call or register access
+#define SIM_ACCESS_CYCLES 50
+
+// Clock sources: the PLL output, and the main oscillator when bypassed
+#define SIM_PLL_HZ 200000000ul
+#define SIM_XTAL_HZ 8000000ul
+
+// Simulated flash holding the flight log and saved gains. Only this part
+// of the flash is mapped into the host's address space.
+#define SIM_FLASH_START 0x00030000ul
+#define SIM_FLASH_END 0x00040000ul
+
+/*
+ * Clock and interrupts (board.c)
+ */
+/**
+ * Set up the board. Must be called before the firmware is started.
+ * @param seconds Simulated time after which the run ends
+ */
+void simInit (double seconds);
+
+/**
+ * @return Cycles of the system clock since reset
+ */
+unsigned long long simCycles (void);
+
+/**
+ * @return Simulated time since reset, in nanoseconds
+ */
+unsigned long long simTimeNs (void);
+
+/**
+ * @return The system clock frequency set by the clock control register
+ */
+unsigned long simClock (void);
+
+/**
+ * Charge one register access and take any interrupts that are due.
+ */
+void simTick (void);
+
+/**
+ * Spend cycles busy-waiting, taking interrupts as they fall due.
+ * @param n Cycles to wait
+ */
+void simDelay (unsigned long long n);
+
+/**
+ * @param addr Address of a register
+ * @return The register's storage, without charging an access
+ */
+volatile unsigned long* simRegisterSlot (unsigned long addr);
+
+/*
+ * Interrupt controller (interrupt.c)
+ */
+/**
+ * Set an interrupt pending.
+ * @param irq Interrupt or exception number
+ */
+void simPend (unsigned long irq);
+
+/**
+ * A level-sensitive interrupt source is asserted. Its interrupt is
+ * pended, unless its handler is running.
+ * @param irq Interrupt number
+ */
+void simAssert (unsigned long irq);
+
+/**
+ * Take the pending interrupts that may preempt what is running, highest
+ * priority first.
+ */
+void simDispatch (void);
+
+/*
+ * Peripherals: each update function catches its peripheral up with the
+ * current time, and each asserted function says whether a level-sensitive
+ * interrupt is still asserted after its handler has run.
+ */
+void simSysTickUpdate (void);
+void simTimerUpdate (void);
+int simTimerAsserted (unsigned long irq);
+void simAdcUpdate (void);
+int simAdcAsserted (unsigned long irq);
+int simGpioAsserted (unsigned long irq);
+void simUartUpdate (void);
+int simUartAsserted (unsigned long irq);
+void simFlashUpdate (void);
+
+/**
+ * Drive input pins from outside the chip.
+ * @param port Base address of the GPIO port
+ * @param pins Pins to drive
+ * @param level Level to drive each of them to, as a bit mask
+ */
+void simGpioDrive (unsigned long port, unsigned char pins,
+		unsigned char level);
+
+/**
+ * Queue bytes to arrive on the UART0 receive line at the baud rate.
+ * @param data Bytes to receive
+ * @param len Number of bytes
+ */
+void simUartReceive (const char* data, unsigned long len);
+
+/**
+ * @param file Where bytes sent on the UART0 transmit line are written
+ */
+void simUartOutput (FILE* file);
+
+/**
+ * Take the next byte of a basic-mode uDMA transfer. The channel is
+ * disabled once its last byte has been taken.
+ * @param channel uDMA channel number
+ * @return The byte, or -1 if the channel is not enabled
+ */
+int simDmaTake (unsigned long channel);
+
+/**
+ * @param channel uDMA channel number
+ * @return 1 if the channel is enabled, otherwise 0
+ */
+int simDmaActive (unsigned long channel);
+
+/**
+ * Set up the simulated flash, erased.
+ * @return 0 on success, -1 if it could not be mapped at its address
+ */
+int simFlashInit (void);
+
+/**
+ * @param addr Address of a word in the simulated flash
+ * @return The word's storage
+ */
+volatile unsigned long* simFlashWord (unsigned long addr);
+
+/**
+ * Load the flash from an image: each word in turn, little-endian.
+ * @param file Image to read, as written by simFlashSave()
+ * @return 0 on success, -1 if the image is not the size of the flash
+ */
+int simFlashLoad (FILE* file);
+
+/**
+ * Save the flash as an image: each word in turn, little-endian.
+ * @param file File to write to
+ */
+void simFlashSave (FILE* file);
+
+/**
+ * Cut the power halfway through a later program or erase started through
+ * the controller registers, ending the run.
+ * @param command FLASH_FMC_WRITE or FLASH_FMC_ERASE
+ * @param skip Number of such operations to let complete first
+ */
+void simFlashCut (unsigned long command, unsigned int skip);
+
+/**
+ * @return 1 while the flash is being programmed or erased, stalling the
+ * processor
+ */
+int simFlashBusy (void);
+
+/**
+ * @param pwmOut One of the PWM_OUT_n values
+ * @return Duty cycle of the output, 0 if it is disabled
+ */
+double simPwmDuty (unsigned long pwmOut);
+
+/**
+ * Write the display contents as a binary greyscale (PGM) image.
+ * @param file File to write to
+ */
+void simDisplayWrite (FILE* file);
+
+/*
+ * Heli rig (rig.c)
+ */
+/**
+ * Move the rig on to the current time.
+ */
+void simRigUpdate (void);
+
+/**
+ * @param channel ADC input channel
+ * @return A sample of the input, in 10-bit counts
+ */
+unsigned long simRigAdc (unsigned long channel);
+
+/**
+ * Press or release one of the buttons.
+ * @param name Button name: UP, DOWN, LEFT, RIGHT, SELECT or RESET
+ * @param pressed 1 to press it, 0 to release it
+ * @return 0, or -1 if there is no such button
+ */
+int simRigButton (const char* name, int pressed);
+
+/**
+ * Print the state of the rig.
+ * @param file File to print to
+ */
+void simRigReport (FILE* file);
+
+/*
+ * Host program (hostMain.c)
+ */
+/**
+ * Carry out the scripted events that are due.
+ */
+void simScriptUpdate (void);
+
+/**
+ * End the run and return to the host program.
+ * @param reason Why the run ended, or 0 if its time is up
+ */
+void simEnd (const char* reason);
+
+#endif /* BOARD_H_ */
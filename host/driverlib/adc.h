@@ -0,0 +1,40 @@
+#ifndef ADC_H_
+#define ADC_H_
+
+/*
+ * adc.h
+ *
+ * Host build stand-in for the driver library's ADC API.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#define ADC_TRIGGER_PROCESSOR 0x00000000
+
+// Step configuration
+#define ADC_CTL_CH0 0x00000000
+#define ADC_CTL_CH1 0x00000001
+#define ADC_CTL_CH2 0x00000002
+#define ADC_CTL_CH3 0x00000003
+#define ADC_CTL_END 0x00000020 // Last step of the sequence
+#define ADC_CTL_IE 0x00000040 // Interrupt when the step completes
+
+void ADCSequenceConfigure (unsigned long ulBase, unsigned long ulSequenceNum,
+		unsigned long ulTrigger, unsigned long ulPriority);
+void ADCSequenceStepConfigure (unsigned long ulBase,
+		unsigned long ulSequenceNum, unsigned long ulStep,
+		unsigned long ulConfig);
+void ADCSequenceEnable (unsigned long ulBase, unsigned long ulSequenceNum);
+void ADCSequenceDisable (unsigned long ulBase, unsigned long ulSequenceNum);
+void ADCProcessorTrigger (unsigned long ulBase, unsigned long ulSequenceNum);
+long ADCSequenceDataGet (unsigned long ulBase, unsigned long ulSequenceNum,
+		unsigned long* pulBuffer);
+void ADCIntRegister (unsigned long ulBase, unsigned long ulSequenceNum,
+		void (*pfnHandler)(void));
+void ADCIntEnable (unsigned long ulBase, unsigned long ulSequenceNum);
+void ADCIntDisable (unsigned long ulBase, unsigned long ulSequenceNum);
+unsigned long ADCIntStatus (unsigned long ulBase, unsigned long ulSequenceNum,
+		tBoolean bMasked);
+void ADCIntClear (unsigned long ulBase, unsigned long ulSequenceNum);
+
+#endif /* ADC_H_ */
@@ -0,0 +1,14 @@
+#ifndef DEBUG_H_
+#define DEBUG_H_
+
+/*
+ * debug.h
+ *
+ * Host build stand-in for the driver library's assertion macro.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#define ASSERT(expr)
+
+#endif /* DEBUG_H_ */
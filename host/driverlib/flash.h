@@ -0,0 +1,18 @@
+#ifndef FLASH_H_
+#define FLASH_H_
+
+/*
+ * flash.h
+ *
+ * Host build stand-in for the driver library's flash API.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+unsigned long FlashUsecGet (void);
+void FlashUsecSet (unsigned long ulClocks);
+long FlashErase (unsigned long ulAddress);
+long FlashProgram (unsigned long* pulData, unsigned long ulAddress,
+		unsigned long ulCount);
+
+#endif /* FLASH_H_ */
@@ -0,0 +1,60 @@
+#ifndef GPIO_H_
+#define GPIO_H_
+
+/*
+ * gpio.h
+ *
+ * Host build stand-in for the driver library's GPIO API.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#define GPIO_PIN_0 0x00000001
+#define GPIO_PIN_1 0x00000002
+#define GPIO_PIN_2 0x00000004
+#define GPIO_PIN_3 0x00000008
+#define GPIO_PIN_4 0x00000010
+#define GPIO_PIN_5 0x00000020
+#define GPIO_PIN_6 0x00000040
+#define GPIO_PIN_7 0x00000080
+
+// Pin directions
+#define GPIO_DIR_MODE_IN 0x00000000
+#define GPIO_DIR_MODE_OUT 0x00000001
+#define GPIO_DIR_MODE_HW 0x00000002
+
+// Interrupt types
+#define GPIO_FALLING_EDGE 0x00000000
+#define GPIO_RISING_EDGE 0x00000004
+#define GPIO_BOTH_EDGES 0x00000001
+#define GPIO_LOW_LEVEL 0x00000002
+#define GPIO_HIGH_LEVEL 0x00000006
+
+// Pad drive strengths and types
+#define GPIO_STRENGTH_2MA 0x00000001
+#define GPIO_STRENGTH_4MA 0x00000002
+#define GPIO_STRENGTH_8MA 0x00000004
+#define GPIO_PIN_TYPE_STD 0x00000008
+#define GPIO_PIN_TYPE_STD_WPU 0x0000000A
+#define GPIO_PIN_TYPE_STD_WPD 0x0000000C
+
+void GPIODirModeSet (unsigned long ulPort, unsigned char ucPins,
+		unsigned long ulPinIO);
+void GPIOPadConfigSet (unsigned long ulPort, unsigned char ucPins,
+		unsigned long ulStrength, unsigned long ulPadType);
+void GPIOIntTypeSet (unsigned long ulPort, unsigned char ucPins,
+		unsigned long ulIntType);
+void GPIOPinIntEnable (unsigned long ulPort, unsigned char ucPins);
+void GPIOPinIntDisable (unsigned long ulPort, unsigned char ucPins);
+long GPIOPinIntStatus (unsigned long ulPort, tBoolean bMasked);
+void GPIOPinIntClear (unsigned long ulPort, unsigned char ucPins);
+void GPIOPortIntRegister (unsigned long ulPort, void (*pfnHandler)(void));
+long GPIOPinRead (unsigned long ulPort, unsigned char ucPins);
+void GPIOPinWrite (unsigned long ulPort, unsigned char ucPins,
+		unsigned char ucVal);
+void GPIOPinTypeGPIOInput (unsigned long ulPort, unsigned char ucPins);
+void GPIOPinTypeGPIOOutput (unsigned long ulPort, unsigned char ucPins);
+void GPIOPinTypePWM (unsigned long ulPort, unsigned char ucPins);
+void GPIOPinTypeUART (unsigned long ulPort, unsigned char ucPins);
+
+#endif /* GPIO_H_ */
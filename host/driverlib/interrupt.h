@@ -0,0 +1,25 @@
+#ifndef INTERRUPT_H_
+#define INTERRUPT_H_
+
+/*
+ * interrupt.h
+ *
+ * Host build stand-in for the driver library's NVIC API.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+tBoolean IntMasterEnable (void);
+tBoolean IntMasterDisable (void);
+void IntRegister (unsigned long ulInterrupt, void (*pfnHandler)(void));
+void IntUnregister (unsigned long ulInterrupt);
+void IntPriorityGroupingSet (unsigned long ulBits);
+unsigned long IntPriorityGroupingGet (void);
+void IntPrioritySet (unsigned long ulInterrupt, unsigned char ucPriority);
+long IntPriorityGet (unsigned long ulInterrupt);
+void IntEnable (unsigned long ulInterrupt);
+void IntDisable (unsigned long ulInterrupt);
+void IntPendSet (unsigned long ulInterrupt);
+void IntPendClear (unsigned long ulInterrupt);
+
+#endif /* INTERRUPT_H_ */
@@ -0,0 +1,55 @@
+#ifndef PWM_H_
+#define PWM_H_
+
+/*
+ * pwm.h
+ *
+ * Host build stand-in for the driver library's PWM API.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+// Generators
+#define PWM_GEN_0 0x00000040
+#define PWM_GEN_1 0x00000080
+#define PWM_GEN_2 0x000000C0
+#define PWM_GEN_3 0x00000100
+
+// Outputs, and their bits for PWMOutputState()
+#define PWM_OUT_0 0x00000040
+#define PWM_OUT_1 0x00000041
+#define PWM_OUT_2 0x00000082
+#define PWM_OUT_3 0x00000083
+#define PWM_OUT_4 0x000000C4
+#define PWM_OUT_5 0x000000C5
+#define PWM_OUT_6 0x00000106
+#define PWM_OUT_7 0x00000107
+#define PWM_OUT_0_BIT 0x00000001
+#define PWM_OUT_1_BIT 0x00000002
+#define PWM_OUT_2_BIT 0x00000004
+#define PWM_OUT_3_BIT 0x00000008
+#define PWM_OUT_4_BIT 0x00000010
+#define PWM_OUT_5_BIT 0x00000020
+#define PWM_OUT_6_BIT 0x00000040
+#define PWM_OUT_7_BIT 0x00000080
+
+// Generator modes
+#define PWM_GEN_MODE_DOWN 0x00000000
+#define PWM_GEN_MODE_UP_DOWN 0x00000002
+#define PWM_GEN_MODE_SYNC 0x00000038
+#define PWM_GEN_MODE_NO_SYNC 0x00000000
+
+void PWMGenConfigure (unsigned long ulBase, unsigned long ulGen,
+		unsigned long ulConfig);
+void PWMGenPeriodSet (unsigned long ulBase, unsigned long ulGen,
+		unsigned long ulPeriod);
+unsigned long PWMGenPeriodGet (unsigned long ulBase, unsigned long ulGen);
+void PWMGenEnable (unsigned long ulBase, unsigned long ulGen);
+void PWMGenDisable (unsigned long ulBase, unsigned long ulGen);
+void PWMPulseWidthSet (unsigned long ulBase, unsigned long ulPWMOut,
+		unsigned long ulWidth);
+unsigned long PWMPulseWidthGet (unsigned long ulBase, unsigned long ulPWMOut);
+void PWMOutputState (unsigned long ulBase, unsigned long ulPWMOutBits,
+		tBoolean bEnable);
+
+#endif /* PWM_H_ */
@@ -0,0 +1,74 @@
+#ifndef SYSCTL_H_
+#define SYSCTL_H_
+
+/*
+ * sysctl.h
+ *
+ * Host build stand-in for the driver library's system control API.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+// Peripherals
+#define SYSCTL_PERIPH_ADC0 0x00100001
+#define SYSCTL_PERIPH_PWM 0x00100010
+#define SYSCTL_PERIPH_UART0 0x10000001
+#define SYSCTL_PERIPH_SSI0 0x10000010
+#define SYSCTL_PERIPH_TIMER0 0x10100001
+#define SYSCTL_PERIPH_TIMER1 0x10100002
+#define SYSCTL_PERIPH_TIMER2 0x10100004
+#define SYSCTL_PERIPH_TIMER3 0x10100008
+#define SYSCTL_PERIPH_GPIOA 0x20000001
+#define SYSCTL_PERIPH_GPIOB 0x20000002
+#define SYSCTL_PERIPH_GPIOC 0x20000004
+#define SYSCTL_PERIPH_GPIOD 0x20000008
+#define SYSCTL_PERIPH_GPIOE 0x20000010
+#define SYSCTL_PERIPH_GPIOF 0x20000020
+#define SYSCTL_PERIPH_GPIOG 0x20000040
+#define SYSCTL_PERIPH_GPIOH 0x20000080
+#define SYSCTL_PERIPH_UDMA 0x20002000
+
+// System clock divisors, SYSCTL_SYSDIV_n for divide by n
+#define SYSCTL_SYSDIV_1 0x07800000
+#define SYSCTL_SYSDIV_2 0x00C00000
+#define SYSCTL_SYSDIV_3 0x01400000
+#define SYSCTL_SYSDIV_4 0x01C00000
+#define SYSCTL_SYSDIV_5 0x02400000
+#define SYSCTL_SYSDIV_6 0x02C00000
+#define SYSCTL_SYSDIV_7 0x03400000
+#define SYSCTL_SYSDIV_8 0x03C00000
+#define SYSCTL_SYSDIV_9 0x04400000
+#define SYSCTL_SYSDIV_10 0x04C00000
+#define SYSCTL_SYSDIV_11 0x05400000
+#define SYSCTL_SYSDIV_12 0x05C00000
+#define SYSCTL_SYSDIV_13 0x06400000
+#define SYSCTL_SYSDIV_14 0x06C00000
+#define SYSCTL_SYSDIV_15 0x07400000
+#define SYSCTL_SYSDIV_16 0x07C00000
+
+// Clock sources
+#define SYSCTL_USE_PLL 0x00000000
+#define SYSCTL_USE_OSC 0x00003800
+#define SYSCTL_OSC_MAIN 0x00000000
+#define SYSCTL_XTAL_8MHZ 0x00000380
+
+// PWM clock divisors
+#define SYSCTL_PWMDIV_1 0x00000000
+#define SYSCTL_PWMDIV_2 0x00100000
+#define SYSCTL_PWMDIV_4 0x00120000
+#define SYSCTL_PWMDIV_8 0x00140000
+#define SYSCTL_PWMDIV_16 0x00160000
+#define SYSCTL_PWMDIV_32 0x00180000
+#define SYSCTL_PWMDIV_64 0x001A0000
+
+void SysCtlPeripheralReset (unsigned long ulPeripheral);
+void SysCtlPeripheralEnable (unsigned long ulPeripheral);
+void SysCtlPeripheralDisable (unsigned long ulPeripheral);
+void SysCtlReset (void);
+void SysCtlDelay (unsigned long ulCount);
+void SysCtlClockSet (unsigned long ulConfig);
+unsigned long SysCtlClockGet (void);
+void SysCtlPWMClockSet (unsigned long ulConfig);
+unsigned long SysCtlPWMClockGet (void);
+
+#endif /* SYSCTL_H_ */
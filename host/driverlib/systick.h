@@ -0,0 +1,21 @@
+#ifndef SYSTICK_H_
+#define SYSTICK_H_
+
+/*
+ * systick.h
+ *
+ * Host build stand-in for the driver library's SysTick API.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+void SysTickEnable (void);
+void SysTickDisable (void);
+void SysTickIntRegister (void (*pfnHandler)(void));
+void SysTickIntEnable (void);
+void SysTickIntDisable (void);
+void SysTickPeriodSet (unsigned long ulPeriod);
+unsigned long SysTickPeriodGet (void);
+unsigned long SysTickValueGet (void);
+
+#endif /* SYSTICK_H_ */
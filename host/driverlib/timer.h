@@ -0,0 +1,38 @@
+#ifndef TIMER_H_
+#define TIMER_H_
+
+/*
+ * timer.h
+ *
+ * Host build stand-in for the driver library's general-purpose timer API.
+ * Only full-width (32-bit) timer A is modelled.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#define TIMER_A 0x000000FF
+
+// Configurations
+#define TIMER_CFG_32_BIT_OS 0x00000001
+#define TIMER_CFG_32_BIT_PER 0x00000002
+#define TIMER_CFG_ONE_SHOT 0x00000021
+#define TIMER_CFG_PERIODIC 0x00000022
+
+// Interrupt sources
+#define TIMER_TIMA_TIMEOUT 0x00000001
+
+void TimerEnable (unsigned long ulBase, unsigned long ulTimer);
+void TimerDisable (unsigned long ulBase, unsigned long ulTimer);
+void TimerConfigure (unsigned long ulBase, unsigned long ulConfig);
+void TimerLoadSet (unsigned long ulBase, unsigned long ulTimer,
+		unsigned long ulValue);
+unsigned long TimerLoadGet (unsigned long ulBase, unsigned long ulTimer);
+unsigned long TimerValueGet (unsigned long ulBase, unsigned long ulTimer);
+void TimerIntRegister (unsigned long ulBase, unsigned long ulTimer,
+		void (*pfnHandler)(void));
+void TimerIntEnable (unsigned long ulBase, unsigned long ulIntFlags);
+void TimerIntDisable (unsigned long ulBase, unsigned long ulIntFlags);
+unsigned long TimerIntStatus (unsigned long ulBase, tBoolean bMasked);
+void TimerIntClear (unsigned long ulBase, unsigned long ulIntFlags);
+
+#endif /* TIMER_H_ */
@@ -0,0 +1,59 @@
+#ifndef UART_H_
+#define UART_H_
+
+/*
+ * uart.h
+ *
+ * Host build stand-in for the driver library's UART API.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+// Interrupt sources
+#define UART_INT_RT 0x00000040 // Receive timeout
+#define UART_INT_TX 0x00000020
+#define UART_INT_RX 0x00000010
+
+// Line configuration
+#define UART_CONFIG_WLEN_8 0x00000060
+#define UART_CONFIG_STOP_ONE 0x00000000
+#define UART_CONFIG_PAR_NONE 0x00000000
+
+// FIFO interrupt levels
+#define UART_FIFO_TX1_8 0x00000000
+#define UART_FIFO_TX2_8 0x00000001
+#define UART_FIFO_TX4_8 0x00000002
+#define UART_FIFO_TX6_8 0x00000003
+#define UART_FIFO_TX7_8 0x00000004
+#define UART_FIFO_RX1_8 0x00000000
+#define UART_FIFO_RX2_8 0x00000008
+#define UART_FIFO_RX4_8 0x00000010
+#define UART_FIFO_RX6_8 0x00000018
+#define UART_FIFO_RX7_8 0x00000020
+
+// uDMA requests
+#define UART_DMA_RX 0x00000001
+#define UART_DMA_TX 0x00000002
+
+void UARTConfigSetExpClk (unsigned long ulBase, unsigned long ulUARTClk,
+		unsigned long ulBaud, unsigned long ulConfig);
+void UARTFIFOEnable (unsigned long ulBase);
+void UARTFIFOLevelSet (unsigned long ulBase, unsigned long ulTxLevel,
+		unsigned long ulRxLevel);
+void UARTEnable (unsigned long ulBase);
+void UARTDisable (unsigned long ulBase);
+void UARTCharPut (unsigned long ulBase, unsigned char ucData);
+tBoolean UARTCharPutNonBlocking (unsigned long ulBase, unsigned char ucData);
+long UARTCharGetNonBlocking (unsigned long ulBase);
+tBoolean UARTCharsAvail (unsigned long ulBase);
+tBoolean UARTSpaceAvail (unsigned long ulBase);
+tBoolean UARTBusy (unsigned long ulBase);
+void UARTIntRegister (unsigned long ulBase, void (*pfnHandler)(void));
+void UARTIntEnable (unsigned long ulBase, unsigned long ulIntFlags);
+void UARTIntDisable (unsigned long ulBase, unsigned long ulIntFlags);
+unsigned long UARTIntStatus (unsigned long ulBase, tBoolean bMasked);
+void UARTIntClear (unsigned long ulBase, unsigned long ulIntFlags);
+void UARTDMAEnable (unsigned long ulBase, unsigned long ulDMAFlags);
+void UARTDMADisable (unsigned long ulBase, unsigned long ulDMAFlags);
+
+#endif /* UART_H_ */
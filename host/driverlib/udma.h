@@ -0,0 +1,51 @@
+#ifndef UDMA_H_
+#define UDMA_H_
+
+/*
+ * udma.h
+ *
+ * Host build stand-in for the driver library's uDMA API. Only basic mode
+ * transfers on the primary control structure are modelled.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#define UDMA_CHANNEL_UART0RX 8
+#define UDMA_CHANNEL_UART0TX 9
+
+#define UDMA_PRI_SELECT 0x00000000
+#define UDMA_ALT_SELECT 0x00000020
+
+// Channel attributes
+#define UDMA_ATTR_USEBURST 0x00000001
+#define UDMA_ATTR_ALTSELECT 0x00000002
+#define UDMA_ATTR_HIGH_PRIORITY 0x00000004
+#define UDMA_ATTR_REQMASK 0x00000008
+#define UDMA_ATTR_ALL 0x0000000F
+
+// Transfer modes
+#define UDMA_MODE_STOP 0x00000000
+#define UDMA_MODE_BASIC 0x00000001
+
+// Channel control
+#define UDMA_SIZE_8 0x00000000
+#define UDMA_SRC_INC_8 0x00000000
+#define UDMA_DST_INC_NONE 0xC0000000
+#define UDMA_ARB_4 0x00008000
+#define UDMA_ARB_8 0x0000C000
+
+void uDMAEnable (void);
+void uDMADisable (void);
+void uDMAControlBaseSet (void* pControlTable);
+void uDMAChannelAttributeEnable (unsigned long ulChannel, unsigned long ulAttr);
+void uDMAChannelAttributeDisable (unsigned long ulChannel,
+		unsigned long ulAttr);
+void uDMAChannelControlSet (unsigned long ulChannel, unsigned long ulControl);
+void uDMAChannelTransferSet (unsigned long ulChannel, unsigned long ulMode,
+		void* pvSrcAddr, void* pvDstAddr, unsigned long ulTransferSize);
+void uDMAChannelEnable (unsigned long ulChannel);
+void uDMAChannelDisable (unsigned long ulChannel);
+tBoolean uDMAChannelIsEnabled (unsigned long ulChannel);
+unsigned long uDMAChannelModeGet (unsigned long ulChannel);
+
+#endif /* UDMA_H_ */
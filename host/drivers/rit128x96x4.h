@@ -0,0 +1,19 @@
+#ifndef RIT128X96X4_H_
+#define RIT128X96X4_H_
+
+/*
+ * rit128x96x4.h
+ *
+ * Host build stand-in for the EK-LM3S1968 OLED display driver.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+void RIT128x96x4Init (unsigned long ulFrequency);
+void RIT128x96x4Enable (unsigned long ulFrequency);
+void RIT128x96x4Disable (void);
+void RIT128x96x4Clear (void);
+void RIT128x96x4ImageDraw (const unsigned char* pucImage, unsigned long ulX,
+		unsigned long ulY, unsigned long ulWidth, unsigned long ulHeight);
+
+#endif /* RIT128X96X4_H_ */
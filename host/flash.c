@@ -0,0 +1,325 @@
+/*
+ * flash.c
+ *
+ * Host build of the flash driver, and the flash controller registers the
+ * firmware writes directly. The simulated part of the flash is mapped at
+ * its own address, so the firmware can read it through pointers. It
+ * starts erased, or loaded from an image file that it is saved back to at
+ * the end of the run, so that a run can follow on from the last.
+ *
+ * The flash has a single bank that instructions are fetched from, so the
+ * processor stalls, interrupts included, while a word is programmed or a
+ * page erased. An erase or program takes effect when it completes. Power
+ * can be cut halfway through one, leaving it torn: half the word's bits
+ * programmed, or the second half of the page erased and the first half
+ * as it was.
+ *
+ * The firmware also reads the flash a word at a time through HWREG(),
+ * which on the host yields an unsigned long of the host's width. Each
+ * word is therefore also kept in that width, as programmed, so that such
+ * reads give back the value written. FlashProgram() is given a block of
+ * unsigned longs, which are wider on the host than on the target: the
+ * flash itself gets the block as laid out on the host, for reads through
+ * pointers to structures, and each unsigned long is also programmed into
+ * a word, for reads through HWREG().
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "inc/hw_flash.h"
+#include "driverlib/flash.h"
+#include "board.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+/*
+ * Constants
+ */
+#define FLASH_SIZE (SIM_FLASH_END - SIM_FLASH_START)
+#define ERASED 0xFFFFFFFFul
+#define PROGRAM_NS 50000ull // Time to program a word
+#define ERASE_NS 20000000ull // Time to erase a page
+
+/*
+ * Static variables (shared within this file)
+ */
+static unsigned char* bytes = 0; // The flash, at its address
+static unsigned long words[FLASH_SIZE / 4];
+static tBoolean busy = false;
+static unsigned long long busyUntilNs;
+
+// Operation started through the controller registers, while busy
+static unsigned long opCommand; // FLASH_FMC_WRITE, FLASH_FMC_ERASE, or 0
+		// for one started by the driver library, already carried out
+static unsigned long opAddr;
+static unsigned long opData;
+static unsigned long long opStartNs;
+static tBoolean opCut; // Power is cut halfway through it
+
+// Operation halfway through which power is to be cut, and how many more
+// of them to let complete first
+static unsigned long cutCommand = 0;
+static unsigned int cutSkip = 0;
+
+/**
+ * @param addr Address
+ * @return 1 if it is in the simulated flash
+ */
+static int inFlash (unsigned long addr) {
+	return addr >= SIM_FLASH_START && addr < SIM_FLASH_END;
+}
+
+/**
+ * Program a word. Programming can only clear bits.
+ * @param addr Address of the word
+ * @param value Value to program
+ */
+static void programWord (unsigned long addr, unsigned long value) {
+	unsigned long* word = &words[(addr - SIM_FLASH_START) / 4];
+
+	*word = (*word == ERASED) ? value : *word & value;
+}
+
+/**
+ * Program bytes into the flash. Programming can only clear bits.
+ * @param addr Address of the first byte
+ * @param data Bytes to program
+ * @param count Number of bytes
+ */
+static void programBytes (unsigned long addr, const void* data,
+		unsigned long count) {
+	unsigned char* dest = bytes + (addr - SIM_FLASH_START);
+	const unsigned char* src = data;
+	unsigned long i;
+
+	for (i = 0; i < count; i++) {
+		dest[i] &= src[i];
+	}
+}
+
+/**
+ * Erase the page holding an address.
+ * @param addr Address in the page
+ */
+static void erasePage (unsigned long addr) {
+	unsigned long page = (addr & ~(FLASH_ERASE_SIZE - 1)) - SIM_FLASH_START;
+	unsigned long i;
+
+	memset(bytes + page, 0xFF, FLASH_ERASE_SIZE);
+	for (i = 0; i < FLASH_ERASE_SIZE / 4; i++) {
+		words[page / 4 + i] = ERASED;
+	}
+}
+
+/**
+ * Carry out the operation in progress, or the part of it done by the time
+ * power is cut.
+ * @param torn 1 if power is cut halfway through it
+ */
+static void completeOp (int torn) {
+	unsigned int low;
+
+	if (opCommand == 0) {
+		return;
+	} else if (opCommand == FLASH_FMC_WRITE) {
+		// Only the low half of the word's bits have been programmed when
+		// it is torn
+		programWord(opAddr, torn ? opData | ~0xFFFFul : opData);
+		low = (unsigned int)*simFlashWord(opAddr);
+		programBytes(opAddr, &low, 4);
+	} else if (torn) {
+		unsigned long half = (opAddr & ~(FLASH_ERASE_SIZE - 1))
+				+ FLASH_ERASE_SIZE / 2;
+		unsigned long i;
+
+		memset(bytes + (half - SIM_FLASH_START), 0xFF, FLASH_ERASE_SIZE / 2);
+		for (i = 0; i < FLASH_ERASE_SIZE / 8; i++) {
+			words[(half - SIM_FLASH_START) / 4 + i] = ERASED;
+		}
+	} else {
+		erasePage(opAddr);
+	}
+}
+
+/**
+ * Set up the simulated flash, erased.
+ * @return 0 on success, -1 if it could not be mapped at its address
+ */
+int simFlashInit (void) {
+	void* mapped = mmap((void*)SIM_FLASH_START, FLASH_SIZE,
+			PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	unsigned long i;
+
+	if (mapped != (void*)SIM_FLASH_START) {
+		return -1;
+	}
+	bytes = mapped;
+	memset(bytes, 0xFF, FLASH_SIZE);
+	for (i = 0; i < FLASH_SIZE / 4; i++) {
+		words[i] = ERASED;
+	}
+	return 0;
+}
+
+/**
+ * Stall the processor while the driver library programs or erases.
+ * @param ns Time taken
+ */
+static void stall (unsigned long long ns) {
+	opCommand = 0;
+	opCut = false;
+	busyUntilNs = simTimeNs() + ns;
+	busy = true;
+	simTick();
+}
+
+/**
+ * Load the flash from an image: each word in turn, little-endian.
+ * @param file Image to read, as written by simFlashSave()
+ * @return 0 on success, -1 if the image is not the size of the flash
+ */
+int simFlashLoad (FILE* file) {
+	unsigned char word[4];
+	unsigned long i;
+
+	for (i = 0; i < FLASH_SIZE / 4; i++) {
+		if (fread(word, 1, 4, file) != 4) {
+			return -1;
+		}
+		words[i] = word[0] | (word[1] << 8) | (word[2] << 16)
+				| ((unsigned long)word[3] << 24);
+		memcpy(bytes + i * 4, word, 4);
+	}
+	return fgetc(file) == EOF ? 0 : -1;
+}
+
+/**
+ * Save the flash as an image: each word in turn, little-endian.
+ * @param file File to write to
+ */
+void simFlashSave (FILE* file) {
+	unsigned long i;
+
+	for (i = 0; i < FLASH_SIZE / 4; i++) {
+		fputc(words[i] & 0xFF, file);
+		fputc((words[i] >> 8) & 0xFF, file);
+		fputc((words[i] >> 16) & 0xFF, file);
+		fputc((words[i] >> 24) & 0xFF, file);
+	}
+}
+
+/**
+ * Cut the power halfway through a later program or erase started through
+ * the controller registers, ending the run.
+ * @param command FLASH_FMC_WRITE or FLASH_FMC_ERASE
+ * @param skip Number of such operations to let complete first
+ */
+void simFlashCut (unsigned long command, unsigned int skip) {
+	cutCommand = command;
+	cutSkip = skip;
+}
+
+/**
+ * @return 1 while the flash is being programmed or erased, stalling the
+ * processor
+ */
+int simFlashBusy (void) {
+	return busy;
+}
+
+/**
+ * @param addr Address of a word in the simulated flash
+ * @return The word's storage
+ */
+volatile unsigned long* simFlashWord (unsigned long addr) {
+	return &words[(addr - SIM_FLASH_START) / 4];
+}
+
+/**
+ * Carry out a write or erase started through the flash controller
+ * registers, and clear its bit in FLASH_FMC once it has taken its time.
+ */
+void simFlashUpdate (void) {
+	volatile unsigned long* fmc = simRegisterSlot(FLASH_FMC);
+	unsigned long addr;
+
+	if (busy) {
+		if (opCut && simTimeNs() >= (opStartNs + busyUntilNs) / 2) {
+			completeOp(1);
+			simEnd("power cut");
+		} else if (simTimeNs() >= busyUntilNs) {
+			completeOp(0);
+			*fmc = 0;
+			busy = false;
+		}
+		return;
+	}
+	if (!(*fmc & (FLASH_FMC_WRITE | FLASH_FMC_ERASE))) {
+		return;
+	}
+
+	addr = *simRegisterSlot(FLASH_FMA);
+	if ((*fmc & 0xFFFF0000) != FLASH_FMC_WRKEY || !inFlash(addr)) {
+		fprintf(stderr, "heliHost: flash command 0x%08lx at 0x%08lx ignored\n",
+				*fmc, addr);
+		*fmc = 0;
+		return;
+	}
+	opCommand = (*fmc & FLASH_FMC_WRITE) ? FLASH_FMC_WRITE : FLASH_FMC_ERASE;
+	opAddr = addr & ~3ul;
+	opData = *simRegisterSlot(FLASH_FMD);
+	opStartNs = simTimeNs();
+	busyUntilNs = opStartNs
+			+ (opCommand == FLASH_FMC_WRITE ? PROGRAM_NS : ERASE_NS);
+	opCut = false;
+	if (opCommand == cutCommand && cutSkip-- == 0) {
+		opCut = true;
+		cutCommand = 0;
+	}
+	*fmc &= FLASH_FMC_WRITE | FLASH_FMC_ERASE;
+	busy = true;
+}
+
+unsigned long FlashUsecGet (void) {
+	return HWREG(FLASH_USECRL) + 1;
+}
+
+void FlashUsecSet (unsigned long ulClocks) {
+	HWREG(FLASH_USECRL) = ulClocks - 1;
+}
+
+long FlashErase (unsigned long ulAddress) {
+	simTick();
+	if ((ulAddress & (FLASH_ERASE_SIZE - 1)) || !inFlash(ulAddress)) {
+		return -1;
+	}
+	while (busy) {
+		simTick();
+	}
+	erasePage(ulAddress);
+	stall(ERASE_NS);
+	return 0;
+}
+
+long FlashProgram (unsigned long* pulData, unsigned long ulAddress,
+		unsigned long ulCount) {
+	unsigned long i;
+
+	simTick();
+	if ((ulAddress & 3) || (ulCount & 3) || !inFlash(ulAddress)
+			|| (ulCount && !inFlash(ulAddress + ulCount - 1))) {
+		return -1;
+	}
+	while (busy) {
+		simTick();
+	}
+	programBytes(ulAddress, pulData, ulCount);
+	for (i = 0; i < ulCount / sizeof(unsigned long); i++) {
+		programWord(ulAddress + i * 4, pulData[i]);
+	}
+	stall(PROGRAM_NS * (ulCount / 4));
+	return 0;
+}
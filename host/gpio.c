@@ -0,0 +1,208 @@
+/*
+ * gpio.c
+ *
+ * Host build of the GPIO driver. Inputs are driven by the rig, and float
+ * high, as if pulled up, until they are.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
+#include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
+#include "board.h"
+
+#include <stdlib.h>
+
+/*
+ * Constants
+ */
+#define NUM_PORTS 8
+
+typedef struct {
+	unsigned long base;
+	unsigned long irq;
+	unsigned char input; // Levels driven from outside
+	unsigned char output; // Levels written
+	unsigned char dir; // Outputs
+	unsigned char levelSense; // Interrupt on level, not edge
+	unsigned char bothEdges;
+	unsigned char event; // Rising edge or high level
+	unsigned char mask;
+	unsigned char edges; // Raw status of the edge-sensitive pins
+} simPort_t;
+
+/*
+ * Static variables (shared within this file)
+ */
+static simPort_t ports[NUM_PORTS] = {
+	{GPIO_PORTA_BASE, INT_GPIOA, 0xFF},
+	{GPIO_PORTB_BASE, INT_GPIOB, 0xFF},
+	{GPIO_PORTC_BASE, INT_GPIOC, 0xFF},
+	{GPIO_PORTD_BASE, INT_GPIOD, 0xFF},
+	{GPIO_PORTE_BASE, INT_GPIOE, 0xFF},
+	{GPIO_PORTF_BASE, INT_GPIOF, 0xFF},
+	{GPIO_PORTG_BASE, INT_GPIOG, 0xFF},
+	{GPIO_PORTH_BASE, INT_GPIOH, 0xFF}
+};
+
+/**
+ * @param base Base address of a port
+ * @return The port
+ */
+static simPort_t* portAt (unsigned long base) {
+	int i;
+
+	for (i = 0; i < NUM_PORTS; i++) {
+		if (ports[i].base == base) {
+			return &ports[i];
+		}
+	}
+	fprintf(stderr, "heliHost: no GPIO port at 0x%08lx\n", base);
+	exit(1);
+}
+
+/**
+ * @param p Port
+ * @return Raw interrupt status: latched edges, and level-sensitive pins
+ *  at their active level
+ */
+static unsigned char rawStatus (const simPort_t* p) {
+	unsigned char levels = (p->output & p->dir) | (p->input & ~p->dir);
+
+	return (p->edges & ~p->levelSense)
+			| (p->levelSense & ~(levels ^ p->event));
+}
+
+/**
+ * Drive input pins from outside the chip, latching the edges that
+ * interrupts are watching for.
+ * @param port Base address of the GPIO port
+ * @param pins Pins to drive
+ * @param level Level to drive each of them to, as a bit mask
+ */
+void simGpioDrive (unsigned long port, unsigned char pins,
+		unsigned char level) {
+	simPort_t* p = portAt(port);
+	unsigned char old = p->input;
+	unsigned char changed;
+
+	p->input = (p->input & ~pins) | (level & pins);
+	changed = (old ^ p->input) & ~p->dir;
+	p->edges |= changed & (p->bothEdges | ~(p->input ^ p->event));
+	if (rawStatus(p) & p->mask) {
+		simAssert(p->irq);
+	}
+}
+
+/**
+ * @param irq Interrupt number of a port
+ * @return 1 if its interrupt is still asserted
+ */
+int simGpioAsserted (unsigned long irq) {
+	int i;
+
+	for (i = 0; i < NUM_PORTS; i++) {
+		if (ports[i].irq == irq) {
+			return (rawStatus(&ports[i]) & ports[i].mask) != 0;
+		}
+	}
+	return 0;
+}
+
+void GPIODirModeSet (unsigned long ulPort, unsigned char ucPins,
+		unsigned long ulPinIO) {
+	simPort_t* p = portAt(ulPort);
+
+	simTick();
+	if (ulPinIO == GPIO_DIR_MODE_OUT) {
+		p->dir |= ucPins;
+	} else {
+		p->dir &= ~ucPins;
+	}
+}
+
+void GPIOPadConfigSet (unsigned long ulPort, unsigned char ucPins,
+		unsigned long ulStrength, unsigned long ulPadType) {
+	simTick();
+}
+
+void GPIOIntTypeSet (unsigned long ulPort, unsigned char ucPins,
+		unsigned long ulIntType) {
+	simPort_t* p = portAt(ulPort);
+
+	simTick();
+	p->bothEdges = (ulIntType & GPIO_BOTH_EDGES) ?
+			p->bothEdges | ucPins : p->bothEdges & ~ucPins;
+	p->levelSense = (ulIntType & GPIO_LOW_LEVEL) ?
+			p->levelSense | ucPins : p->levelSense & ~ucPins;
+	p->event = (ulIntType & GPIO_RISING_EDGE) ?
+			p->event | ucPins : p->event & ~ucPins;
+}
+
+void GPIOPinIntEnable (unsigned long ulPort, unsigned char ucPins) {
+	simPort_t* p = portAt(ulPort);
+
+	simTick();
+	p->mask |= ucPins;
+	if (rawStatus(p) & p->mask) {
+		simAssert(p->irq);
+	}
+}
+
+void GPIOPinIntDisable (unsigned long ulPort, unsigned char ucPins) {
+	simTick();
+	portAt(ulPort)->mask &= ~ucPins;
+}
+
+long GPIOPinIntStatus (unsigned long ulPort, tBoolean bMasked) {
+	simPort_t* p = portAt(ulPort);
+
+	simTick();
+	return bMasked ? rawStatus(p) & p->mask : rawStatus(p);
+}
+
+void GPIOPinIntClear (unsigned long ulPort, unsigned char ucPins) {
+	simTick();
+	portAt(ulPort)->edges &= ~ucPins;
+}
+
+void GPIOPortIntRegister (unsigned long ulPort, void (*pfnHandler)(void)) {
+	simPort_t* p = portAt(ulPort);
+
+	IntRegister(p->irq, pfnHandler);
+	IntEnable(p->irq);
+}
+
+long GPIOPinRead (unsigned long ulPort, unsigned char ucPins) {
+	simPort_t* p = portAt(ulPort);
+
+	simTick();
+	return ((p->output & p->dir) | (p->input & ~p->dir)) & ucPins;
+}
+
+void GPIOPinWrite (unsigned long ulPort, unsigned char ucPins,
+		unsigned char ucVal) {
+	simPort_t* p = portAt(ulPort);
+
+	simTick();
+	p->output = (p->output & ~ucPins) | (ucVal & ucPins);
+}
+
+void GPIOPinTypeGPIOInput (unsigned long ulPort, unsigned char ucPins) {
+	GPIODirModeSet(ulPort, ucPins, GPIO_DIR_MODE_IN);
+}
+
+void GPIOPinTypeGPIOOutput (unsigned long ulPort, unsigned char ucPins) {
+	GPIODirModeSet(ulPort, ucPins, GPIO_DIR_MODE_OUT);
+}
+
+void GPIOPinTypePWM (unsigned long ulPort, unsigned char ucPins) {
+	GPIODirModeSet(ulPort, ucPins, GPIO_DIR_MODE_HW);
+}
+
+void GPIOPinTypeUART (unsigned long ulPort, unsigned char ucPins) {
+	GPIODirModeSet(ulPort, ucPins, GPIO_DIR_MODE_HW);
+}
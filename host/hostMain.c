@@ -0,0 +1,296 @@
+/*
+ * hostMain.c
+ *
+ * Runs the firmware on the simulated board, on the host, for a set time
+ * of simulated flight, with button presses and commands from a script.
+ *
+ * Usage: heliHost [--seconds n] [--script file] [--uart file]
+ *                 [--display file.pgm] [--flash file]
+ *  --seconds   Simulated time to run for (default 10)
+ *  --script    Events to play, one per line: "<ms> press <button>",
+ *              "<ms> release <button>", "<ms> send <command>",
+ *              "<ms> cut erase|program [n]" or "<ms> end", in time order.
+ *              A cut ends the run halfway through the next flash erase or
+ *              program, or the one after n more. '#' starts a comment.
+ *  --uart      File to write the bytes sent on UART0 to (default stdout)
+ *  --display   File to write the final display contents to, as a PGM
+ *  --flash     Image of the flash: loaded at the start if the file exists,
+ *              and written back at the end of the run
+ * A summary of the run is printed on stderr.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "inc/hw_flash.h"
+#include "board.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+/*
+ * Constants
+ */
+#define MAX_LINE 256
+
+enum script_action { SCRIPT_PRESS = 0, SCRIPT_RELEASE, SCRIPT_SEND,
+	SCRIPT_CUT, SCRIPT_END };
+
+typedef struct {
+	unsigned long long timeNs;
+	int action; // One of the enumerated script_action values
+	char arg[MAX_LINE];
+} scriptEvent_t;
+
+// The firmware's stack: the target's stack section. The firmware runs on
+// it so that its stack high-water mark works; __STACK_TOP is defined by
+// the linker (see CMakeLists.txt).
+unsigned long __stack[SIM_STACK_BYTES / sizeof(unsigned long)]
+		__attribute__((aligned(16)));
+
+// The firmware's main(), renamed in the host build
+int heliMain (void);
+
+/*
+ * Static variables (shared within this file)
+ */
+static scriptEvent_t* events = 0;
+static int eventCount = 0;
+static int nextEvent = 0;
+
+static ucontext_t hostContext;
+static ucontext_t firmwareContext;
+static const char* endReason = 0;
+
+/**
+ * Read a script of events.
+ * @param path File to read
+ * @return 0 on success, -1 on error, which has been reported
+ */
+static int readScript (const char* path) {
+	FILE* in = fopen(path, "r");
+	char line[MAX_LINE];
+	int lineNumber = 0;
+
+	if (!in) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), in)) {
+		char* hash = strchr(line, '#');
+		char action[16];
+		double ms;
+		int used = 0;
+		scriptEvent_t* e;
+
+		lineNumber++;
+		if (hash) {
+			*hash = '\0';
+		}
+		line[strcspn(line, "\r\n")] = '\0';
+		if (sscanf(line, "%lf %15s %n", &ms, action, &used) < 2) {
+			if (strspn(line, " \t") == strlen(line)) {
+				continue; // Blank line or comment
+			}
+			fprintf(stderr, "%s: line %d not understood\n", path, lineNumber);
+			fclose(in);
+			return -1;
+		}
+
+		events = realloc(events, (eventCount + 1) * sizeof(scriptEvent_t));
+		if (!events) {
+			fprintf(stderr, "heliHost: out of memory\n");
+			exit(1);
+		}
+		e = &events[eventCount];
+		e->timeNs = (unsigned long long)(ms * 1e6);
+		strcpy(e->arg, line + used);
+		if (strcmp(action, "press") == 0) {
+			e->action = SCRIPT_PRESS;
+		} else if (strcmp(action, "release") == 0) {
+			e->action = SCRIPT_RELEASE;
+		} else if (strcmp(action, "send") == 0) {
+			e->action = SCRIPT_SEND;
+		} else if (strcmp(action, "cut") == 0
+				&& (strncmp(e->arg, "erase", 5) == 0
+				|| strncmp(e->arg, "program", 7) == 0)) {
+			e->action = SCRIPT_CUT;
+		} else if (strcmp(action, "end") == 0) {
+			e->action = SCRIPT_END;
+		} else {
+			e->action = -1;
+		}
+		if (e->action < 0 || (eventCount > 0
+				&& e->timeNs < events[eventCount - 1].timeNs)) {
+			fprintf(stderr, "%s: line %d not understood or out of order\n",
+					path, lineNumber);
+			fclose(in);
+			return -1;
+		}
+		eventCount++;
+	}
+	fclose(in);
+	return 0;
+}
+
+/**
+ * Carry out the scripted events that are due.
+ */
+void simScriptUpdate (void) {
+	while (nextEvent < eventCount && simTimeNs() >= events[nextEvent].timeNs) {
+		scriptEvent_t* e = &events[nextEvent++];
+
+		switch (e->action) {
+		case SCRIPT_PRESS:
+		case SCRIPT_RELEASE:
+			if (simRigButton(e->arg, e->action == SCRIPT_PRESS) != 0) {
+				fprintf(stderr, "heliHost: no button \"%s\"\n", e->arg);
+			}
+			break;
+		case SCRIPT_SEND:
+			simUartReceive(e->arg, strlen(e->arg));
+			simUartReceive("\r", 1);
+			break;
+		case SCRIPT_CUT:
+			simFlashCut(e->arg[0] == 'e' ? FLASH_FMC_ERASE : FLASH_FMC_WRITE,
+					atoi(e->arg + strcspn(e->arg, " ")));
+			break;
+		case SCRIPT_END:
+			simEnd("end of script");
+			break;
+		}
+	}
+}
+
+/**
+ * End the run and return to the host program.
+ * @param reason Why the run ended, or 0 if its time is up
+ */
+void simEnd (const char* reason) {
+	endReason = reason ? reason : "time up";
+	swapcontext(&firmwareContext, &hostContext);
+}
+
+/**
+ * Entry point of the firmware's context.
+ */
+static void runFirmware (void) {
+	heliMain();
+	endReason = "main() returned";
+}
+
+/**
+ * @return Wall-clock time in seconds
+ */
+static double wallSeconds (void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main (int argc, char** argv) {
+	double seconds = 10;
+	const char* uartPath = 0;
+	const char* displayPath = 0;
+	const char* flashPath = 0;
+	FILE* uart = stdout;
+	double wallStart;
+	double wall;
+	double simulated;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+			seconds = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+			if (readScript(argv[++i]) != 0) {
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--uart") == 0 && i + 1 < argc) {
+			uartPath = argv[++i];
+		} else if (strcmp(argv[i], "--display") == 0 && i + 1 < argc) {
+			displayPath = argv[++i];
+		} else if (strcmp(argv[i], "--flash") == 0 && i + 1 < argc) {
+			flashPath = argv[++i];
+		} else {
+			fprintf(stderr, "usage: %s [--seconds n] [--script file] "
+					"[--uart file] [--display file.pgm] [--flash file]\n",
+					argv[0]);
+			return 2;
+		}
+	}
+
+	if (uartPath) {
+		uart = fopen(uartPath, "wb");
+		if (!uart) {
+			perror(uartPath);
+			return 1;
+		}
+	}
+	if (simFlashInit() != 0) {
+		fprintf(stderr, "heliHost: cannot map the flash at 0x%08lx\n",
+				SIM_FLASH_START);
+		return 1;
+	}
+	if (flashPath) {
+		FILE* in = fopen(flashPath, "rb");
+
+		if (in) {
+			int loaded = simFlashLoad(in);
+
+			fclose(in);
+			if (loaded != 0) {
+				fprintf(stderr, "heliHost: %s is not a flash image\n",
+						flashPath);
+				return 1;
+			}
+		}
+	}
+	simInit(seconds);
+	simUartOutput(uart);
+
+	// Run the firmware on its own stack until simEnd() is called
+	getcontext(&firmwareContext);
+	firmwareContext.uc_stack.ss_sp = __stack;
+	firmwareContext.uc_stack.ss_size = sizeof(__stack);
+	firmwareContext.uc_link = &hostContext;
+	makecontext(&firmwareContext, runFirmware, 0);
+	wallStart = wallSeconds();
+	swapcontext(&hostContext, &firmwareContext);
+	wall = wallSeconds() - wallStart;
+
+	fflush(uart);
+	if (uart != stdout) {
+		fclose(uart);
+	}
+	if (displayPath) {
+		FILE* out = fopen(displayPath, "wb");
+
+		if (!out) {
+			perror(displayPath);
+			return 1;
+		}
+		simDisplayWrite(out);
+		fclose(out);
+	}
+	if (flashPath) {
+		FILE* out = fopen(flashPath, "wb");
+
+		if (!out) {
+			perror(flashPath);
+			return 1;
+		}
+		simFlashSave(out);
+		fclose(out);
+	}
+
+	simulated = simTimeNs() / 1e9;
+	fprintf(stderr, "heliHost: %s after %.3f s simulated in %.3f s "
+			"(%.1fx real time), %llu cycles\n", endReason, simulated, wall,
+			wall > 0 ? simulated / wall : 0, simCycles());
+	simRigReport(stderr);
+	return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef HW_FLASH_H_
+#define HW_FLASH_H_
+
+/*
+ * hw_flash.h
+ *
+ * Host build stand-in: the flash controller registers.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#define FLASH_FMA 0x400FD000 // Flash memory address
+#define FLASH_FMD 0x400FD004 // Flash memory data
+#define FLASH_FMC 0x400FD008 // Flash memory control
+#define FLASH_USECRL 0x400FE140 // Clocks per microsecond, minus 1
+
+#define FLASH_FMC_WRKEY 0xA4420000 // Key for writes to FLASH_FMC
+#define FLASH_FMC_ERASE 0x00000002 // Erase a page
+#define FLASH_FMC_WRITE 0x00000001 // Program a word
+
+#define FLASH_ERASE_SIZE 0x00000400
+
+#endif /* HW_FLASH_H_ */
@@ -0,0 +1,34 @@
+#ifndef HW_INTS_H_
+#define HW_INTS_H_
+
+/*
+ * hw_ints.h
+ *
+ * Host build stand-in: exception and interrupt numbers of the LM3S1968.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#define FAULT_SYSTICK 15
+#define INT_GPIOA 16
+#define INT_GPIOB 17
+#define INT_GPIOC 18
+#define INT_GPIOD 19
+#define INT_GPIOE 20
+#define INT_UART0 21
+#define INT_SSI0 23
+#define INT_ADC0SS0 30
+#define INT_ADC0SS1 31
+#define INT_ADC0SS2 32
+#define INT_ADC0SS3 33
+#define INT_TIMER0A 35
+#define INT_TIMER1A 37
+#define INT_TIMER2A 39
+#define INT_GPIOF 46
+#define INT_GPIOG 47
+#define INT_GPIOH 48
+#define INT_TIMER3A 51
+
+#define NUM_INTERRUPTS 64
+
+#endif /* HW_INTS_H_ */
@@ -0,0 +1,36 @@
+#ifndef HW_MEMMAP_H_
+#define HW_MEMMAP_H_
+
+/*
+ * hw_memmap.h
+ *
+ * Host build stand-in: base addresses of the LM3S1968 peripherals.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#define FLASH_BASE 0x00000000
+#define SRAM_BASE 0x20000000
+#define GPIO_PORTA_BASE 0x40004000
+#define GPIO_PORTB_BASE 0x40005000
+#define GPIO_PORTC_BASE 0x40006000
+#define GPIO_PORTD_BASE 0x40007000
+#define SSI0_BASE 0x40008000
+#define UART0_BASE 0x4000C000
+#define GPIO_PORTE_BASE 0x40024000
+#define GPIO_PORTF_BASE 0x40025000
+#define GPIO_PORTG_BASE 0x40026000
+#define GPIO_PORTH_BASE 0x40027000
+#define PWM_BASE 0x40028000
+#define TIMER0_BASE 0x40030000
+#define TIMER1_BASE 0x40031000
+#define TIMER2_BASE 0x40032000
+#define TIMER3_BASE 0x40033000
+#define ADC0_BASE 0x40038000
+#define ADC_BASE ADC0_BASE
+#define FLASH_CTRL_BASE 0x400FD000
+#define SYSCTL_BASE 0x400FE000
+#define UDMA_BASE 0x400FF000
+#define NVIC_BASE 0xE000E000
+
+#endif /* HW_MEMMAP_H_ */
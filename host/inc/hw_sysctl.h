@@ -0,0 +1,22 @@
+#ifndef HW_SYSCTL_H_
+#define HW_SYSCTL_H_
+
+/*
+ * hw_sysctl.h
+ *
+ * Host build stand-in: the system control registers that are modelled.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#define SYSCTL_RCC 0x400FE060 // Run-mode clock configuration
+
+#define SYSCTL_RCC_SYSDIV_M 0x07800000 // System clock divisor
+#define SYSCTL_RCC_USESYSDIV 0x00400000 // Enable the system clock divisor
+#define SYSCTL_RCC_USEPWMDIV 0x00100000 // Enable the PWM clock divisor
+#define SYSCTL_RCC_PWMDIV_M 0x000E0000 // PWM clock divisor
+#define SYSCTL_RCC_BYPASS 0x00000800 // Bypass the PLL
+#define SYSCTL_RCC_XTAL_M 0x000003C0 // Crystal frequency
+#define SYSCTL_RCC_SYSDIV_S 23
+
+#endif /* HW_SYSCTL_H_ */
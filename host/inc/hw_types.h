@@ -0,0 +1,28 @@
+#ifndef HW_TYPES_H_
+#define HW_TYPES_H_
+
+/*
+ * hw_types.h
+ *
+ * Host build stand-in for the StellarisWare common types. Register
+ * accesses go to the simulated board (see board.h), which charges each
+ * one a few cycles and gives the registers it models their side effects.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+typedef unsigned char tBoolean;
+
+#ifndef true
+#define true 1
+#endif
+
+#ifndef false
+#define false 0
+#endif
+
+volatile unsigned long* simRegister (unsigned long addr);
+
+#define HWREG(x) (*simRegister((unsigned long)(x)))
+
+#endif /* HW_TYPES_H_ */
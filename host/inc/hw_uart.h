@@ -0,0 +1,18 @@
+#ifndef HW_UART_H_
+#define HW_UART_H_
+
+/*
+ * hw_uart.h
+ *
+ * Host build stand-in: offsets of the UART registers that are modelled.
+ * The data register is only used as a uDMA destination.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#define UART_O_DR 0x00000000 // Data
+#define UART_O_IBRD 0x00000024 // Integer baud rate divisor
+#define UART_O_FBRD 0x00000028 // Fractional baud rate divisor, in 64ths
+#define UART_O_LCRH 0x0000002C // Line control
+
+#endif /* HW_UART_H_ */
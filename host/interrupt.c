@@ -0,0 +1,191 @@
+/*
+ * interrupt.c
+ *
+ * Host build of the interrupt controller driver: a model of the NVIC.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "board.h"
+
+/*
+ * Constants
+ */
+// Execution level of the background loop, below every handler
+#define THREAD_LEVEL 0x100
+
+/*
+ * Static variables (shared within this file)
+ */
+static void (*vectors[NUM_INTERRUPTS])(void);
+static unsigned char priorities[NUM_INTERRUPTS];
+static unsigned char enabled[NUM_INTERRUPTS] = {[FAULT_SYSTICK] = 1};
+static unsigned char pending[NUM_INTERRUPTS];
+static unsigned char active[NUM_INTERRUPTS]; // Handler is running
+static int pendingCount = 0;
+static unsigned long groupingBits = 7; // Preemptable bits of the priorities
+static tBoolean masked = false; // PRIMASK
+static int level = THREAD_LEVEL; // Preemption level now running
+
+/**
+ * @param irq Interrupt or exception number
+ * @return Its preemption level
+ */
+static int preemptLevel (unsigned long irq) {
+	return priorities[irq] >> (8 - groupingBits);
+}
+
+/**
+ * @param irq Interrupt or exception number
+ * @return 1 if the source of a level-sensitive interrupt is still asserted
+ */
+static int asserted (unsigned long irq) {
+	switch (irq) {
+	case INT_GPIOA: case INT_GPIOB: case INT_GPIOC: case INT_GPIOD:
+	case INT_GPIOE: case INT_GPIOF: case INT_GPIOG: case INT_GPIOH:
+		return simGpioAsserted(irq);
+	case INT_ADC0SS0: case INT_ADC0SS1: case INT_ADC0SS2: case INT_ADC0SS3:
+		return simAdcAsserted(irq);
+	case INT_TIMER0A: case INT_TIMER1A: case INT_TIMER2A: case INT_TIMER3A:
+		return simTimerAsserted(irq);
+	case INT_UART0:
+		return simUartAsserted(irq);
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Set an interrupt pending.
+ * @param irq Interrupt or exception number
+ */
+void simPend (unsigned long irq) {
+	if (!pending[irq]) {
+		pending[irq] = 1;
+		pendingCount++;
+	}
+}
+
+/**
+ * A level-sensitive interrupt source is asserted: pend its interrupt,
+ * unless its handler is running, in which case it is pended again when the
+ * handler returns if it is still asserted.
+ * @param irq Interrupt number
+ */
+void simAssert (unsigned long irq) {
+	if (!active[irq]) {
+		simPend(irq);
+	}
+}
+
+/**
+ * Take the pending interrupts that may preempt what is running, highest
+ * priority first. Each handler runs to completion, with its own preemption
+ * level in force, so that only higher priority interrupts are nested in it.
+ */
+void simDispatch (void) {
+	while (pendingCount > 0 && !masked) {
+		int best = -1;
+		int saved;
+		unsigned long irq;
+
+		// Lowest priority value wins, then lowest number
+		for (irq = 0; irq < NUM_INTERRUPTS; irq++) {
+			if (pending[irq] && enabled[irq] && vectors[irq]
+					&& (best < 0 || priorities[irq] < priorities[best])) {
+				best = irq;
+			}
+		}
+		if (best < 0 || preemptLevel(best) >= level) {
+			return;
+		}
+
+		pending[best] = 0;
+		pendingCount--;
+		saved = level;
+		level = preemptLevel(best);
+		active[best] = 1;
+		vectors[best]();
+		active[best] = 0;
+		level = saved;
+		if (asserted(best)) {
+			simPend(best);
+		}
+	}
+}
+
+tBoolean IntMasterEnable (void) {
+	tBoolean wasMasked;
+
+	simTick();
+	wasMasked = masked;
+	masked = false;
+	simDispatch();
+	return wasMasked;
+}
+
+tBoolean IntMasterDisable (void) {
+	tBoolean wasMasked;
+
+	simTick();
+	wasMasked = masked;
+	masked = true;
+	return wasMasked;
+}
+
+void IntRegister (unsigned long ulInterrupt, void (*pfnHandler)(void)) {
+	simTick();
+	vectors[ulInterrupt] = pfnHandler;
+}
+
+void IntUnregister (unsigned long ulInterrupt) {
+	simTick();
+	vectors[ulInterrupt] = 0;
+}
+
+void IntPriorityGroupingSet (unsigned long ulBits) {
+	simTick();
+	groupingBits = ulBits;
+}
+
+unsigned long IntPriorityGroupingGet (void) {
+	simTick();
+	return groupingBits;
+}
+
+void IntPrioritySet (unsigned long ulInterrupt, unsigned char ucPriority) {
+	simTick();
+	// Only the top three bits are implemented
+	priorities[ulInterrupt] = ucPriority & 0xE0;
+}
+
+long IntPriorityGet (unsigned long ulInterrupt) {
+	simTick();
+	return priorities[ulInterrupt];
+}
+
+void IntEnable (unsigned long ulInterrupt) {
+	simTick();
+	enabled[ulInterrupt] = 1;
+}
+
+void IntDisable (unsigned long ulInterrupt) {
+	simTick();
+	enabled[ulInterrupt] = 0;
+}
+
+void IntPendSet (unsigned long ulInterrupt) {
+	simPend(ulInterrupt);
+	simTick();
+}
+
+void IntPendClear (unsigned long ulInterrupt) {
+	simTick();
+	if (pending[ulInterrupt]) {
+		pending[ulInterrupt] = 0;
+		pendingCount--;
+	}
+}
@@ -0,0 +1,105 @@
+/*
+ * pwm.c
+ *
+ * Host build of the PWM driver. The outputs are read by the rig as duty
+ * cycles; the waveform itself is not modelled.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "driverlib/pwm.h"
+#include "board.h"
+
+/*
+ * Constants
+ */
+#define NUM_GENERATORS 4
+#define NUM_OUTPUTS 8
+
+/*
+ * Static variables (shared within this file)
+ */
+static unsigned long configs[NUM_GENERATORS];
+static unsigned long periods[NUM_GENERATORS];
+static tBoolean running[NUM_GENERATORS];
+static unsigned long widths[NUM_OUTPUTS];
+static unsigned long outputsOn = 0; // PWM_OUT_n_BIT of the enabled outputs
+
+/**
+ * @param gen One of the PWM_GEN_n values, or a PWM_OUT_n value
+ * @return Index of the generator
+ */
+static int genIndex (unsigned long gen) {
+	return ((gen >> 6) - 1) % NUM_GENERATORS;
+}
+
+/**
+ * @param pwmOut One of the PWM_OUT_n values
+ * @return Duty cycle of the output, 0 if it is disabled
+ */
+double simPwmDuty (unsigned long pwmOut) {
+	int gen = genIndex(pwmOut);
+	int out = pwmOut & 7;
+
+	if (!(outputsOn & (1 << out)) || !running[gen] || periods[gen] == 0) {
+		return 0;
+	}
+	if (widths[out] >= periods[gen]) {
+		return 1;
+	}
+	return (double)widths[out] / periods[gen];
+}
+
+void PWMGenConfigure (unsigned long ulBase, unsigned long ulGen,
+		unsigned long ulConfig) {
+	simTick();
+	configs[genIndex(ulGen)] = ulConfig;
+}
+
+void PWMGenPeriodSet (unsigned long ulBase, unsigned long ulGen,
+		unsigned long ulPeriod) {
+	int gen = genIndex(ulGen);
+
+	simTick();
+	// Counting up and down, the load register holds half the period
+	if (configs[gen] & PWM_GEN_MODE_UP_DOWN) {
+		ulPeriod &= ~1ul;
+	}
+	periods[gen] = ulPeriod;
+}
+
+unsigned long PWMGenPeriodGet (unsigned long ulBase, unsigned long ulGen) {
+	simTick();
+	return periods[genIndex(ulGen)];
+}
+
+void PWMGenEnable (unsigned long ulBase, unsigned long ulGen) {
+	simTick();
+	running[genIndex(ulGen)] = true;
+}
+
+void PWMGenDisable (unsigned long ulBase, unsigned long ulGen) {
+	simTick();
+	running[genIndex(ulGen)] = false;
+}
+
+void PWMPulseWidthSet (unsigned long ulBase, unsigned long ulPWMOut,
+		unsigned long ulWidth) {
+	simTick();
+	if (configs[genIndex(ulPWMOut)] & PWM_GEN_MODE_UP_DOWN) {
+		ulWidth &= ~1ul;
+	}
+	widths[ulPWMOut & 7] = ulWidth;
+}
+
+unsigned long PWMPulseWidthGet (unsigned long ulBase, unsigned long ulPWMOut) {
+	simTick();
+	return widths[ulPWMOut & 7];
+}
+
+void PWMOutputState (unsigned long ulBase, unsigned long ulPWMOutBits,
+		tBoolean bEnable) {
+	simTick();
+	outputsOn = bEnable ? outputsOn | ulPWMOutBits : outputsOn & ~ulPWMOutBits;
+}
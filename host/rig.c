@@ -0,0 +1,233 @@
+/*
+ * rig.c
+ *
+ * Model of the heli rig the board is wired to: the altitude sensor, the
+ * yaw encoder and the buttons, driven by the main and tail rotor PWM.
+ *
+ * The heli rises towards a height set by the main rotor duty cycle, with
+ * a first-order lag. Below the lift-off duty cycle the same lag pulls it
+ * down towards a height below the ground, so it lands with the speed it
+ * had on reaching the ground. It turns at a rate set by the difference between the
+ * tail and main rotor duty cycles, the tail rotor pushing against the main
+ * rotor's torque, but only while it is off the ground. The tether pulls it
+ * back towards the heading it started at.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/gpio.h"
+#include "driverlib/pwm.h"
+#include "board.h"
+
+#include <math.h>
+#include <string.h>
+
+/*
+ * Constants
+ */
+// Wiring of the rig to the board
+#define MAIN_PWM PWM_OUT_1
+#define TAIL_PWM PWM_OUT_4
+#define ALTITUDE_CHANNEL 0
+#define ENCODER_PORT GPIO_PORTF_BASE
+#define ENCODER_A GPIO_PIN_5
+#define ENCODER_B GPIO_PIN_7
+#define VIRTUAL_PORT GPIO_PORTB_BASE
+#define PHYSICAL_PORT GPIO_PORTG_BASE
+
+// The model moves on in steps of this many nanoseconds
+#define STEP_NS 100000
+
+// Altitude sensor: volts when landed and volts less at the top, read
+// against a 3 V reference by the 10-bit ADC
+#define LANDED_VOLTS 2.0
+#define RANGE_VOLTS 0.8
+#define ADC_VOLTS 3.0
+#define ADC_COUNTS 1023
+
+// Main rotor duty cycles at which the heli lifts off, and at which it
+// reaches the top; time constant of the climb in seconds
+#define LIFT_DUTY 0.10
+#define TOP_DUTY 0.50
+#define CLIMB_TAU 1.5
+
+// Yaw rate in degrees per second per unit of tail less main duty cycle,
+// its time constant in seconds, and the rate in degrees per second per
+// degree from the starting heading at which the tether pulls it back
+#define YAW_GAIN 400.0
+#define YAW_TAU 0.3
+#define TETHER 0.5
+
+// Degrees turned per quarter cycle of the encoder
+#define ENCODER_STEP_DEG 0.8
+
+// Buttons, each on a pin of the virtual port and of the physical port.
+// They are active low.
+static const struct {
+	const char* name;
+	unsigned char virtualPin;
+	unsigned char physicalPin; // 0 if there is none
+} buttons[] = {
+	{"UP", GPIO_PIN_5, GPIO_PIN_3},
+	{"DOWN", GPIO_PIN_6, GPIO_PIN_4},
+	{"LEFT", GPIO_PIN_3, GPIO_PIN_5},
+	{"RIGHT", GPIO_PIN_2, GPIO_PIN_6},
+	{"SELECT", GPIO_PIN_4, GPIO_PIN_7},
+	{"RESET", GPIO_PIN_1, 0}
+};
+
+/*
+ * Static variables (shared within this file)
+ */
+static double height = 0; // 0 landed to 1 at the top
+static double yaw = 0; // Degrees
+static double yawRate = 0; // Degrees per second
+static long encoderSteps = 0; // Quarter cycles reported by the encoder
+static unsigned long long nextStepNs = 0;
+static unsigned long noise = 1;
+// The last touchdown: when it was, and the climb rate (per second) the
+// heli hit the ground at; and when the motors were last turned off
+static int flying = 0;
+static unsigned long long touchdownNs = 0;
+static double touchdownRate = 0;
+static int motorsOn = 0;
+static unsigned long long motorsOffNs = 0;
+
+/**
+ * Move the model on by one step.
+ * @param dt Length of the step in seconds
+ */
+static void step (double dt) {
+	double main = simPwmDuty(MAIN_PWM);
+	double tail = simPwmDuty(TAIL_PWM);
+	double target = (main - LIFT_DUTY) / (TOP_DUTY - LIFT_DUTY);
+	double climb;
+
+	if (target > 1) {
+		target = 1;
+	}
+	climb = (target - height) / CLIMB_TAU;
+	height += climb * dt;
+	if (height <= 0) {
+		if (flying) {
+			// Touching down
+			flying = 0;
+			touchdownNs = simTimeNs();
+			touchdownRate = climb;
+		}
+		height = 0;
+	} else if (height > 0.01) {
+		flying = 1;
+	}
+
+	// The motors go off at the end of a landing
+	if (main == 0 && motorsOn) {
+		motorsOffNs = simTimeNs();
+	}
+	motorsOn = main > 0;
+
+	if (height < 0.01 && target <= 0) {
+		yawRate = 0; // Sitting on the ground
+	} else {
+		yawRate += (YAW_GAIN * (tail - main) - TETHER * yaw - yawRate) * dt
+				/ YAW_TAU;
+	}
+	yaw += yawRate * dt;
+}
+
+/**
+ * Move the encoder one quarter cycle towards the yaw, so that the
+ * firmware sees each edge.
+ */
+static void stepEncoder (void) {
+	long target = (long)floor(yaw / ENCODER_STEP_DEG);
+	int phase;
+
+	if (target == encoderSteps) {
+		return;
+	}
+	encoderSteps += target > encoderSteps ? 1 : -1;
+
+	// Channels (A, B) go 00, 01, 11, 10 as the heli turns clockwise
+	phase = encoderSteps & 3;
+	simGpioDrive(ENCODER_PORT, ENCODER_A | ENCODER_B,
+			(phase == 2 || phase == 3 ? ENCODER_A : 0)
+			| (phase == 1 || phase == 2 ? ENCODER_B : 0));
+}
+
+/**
+ * Move the rig on to the current time.
+ */
+void simRigUpdate (void) {
+	while (simTimeNs() >= nextStepNs) {
+		step(STEP_NS / 1e9);
+		nextStepNs += STEP_NS;
+	}
+	stepEncoder();
+}
+
+/**
+ * @param channel ADC input channel
+ * @return A sample of the input, in 10-bit counts
+ */
+unsigned long simRigAdc (unsigned long channel) {
+	double volts;
+	long counts;
+
+	if (channel != ALTITUDE_CHANNEL) {
+		return 0;
+	}
+	volts = LANDED_VOLTS - height * RANGE_VOLTS;
+	counts = (long)(volts / ADC_VOLTS * ADC_COUNTS + 0.5);
+
+	// A count of noise either way, the same on every run
+	noise = noise * 1103515245 + 12345;
+	counts += (long)((noise >> 16) % 3) - 1;
+
+	if (counts < 0) {
+		counts = 0;
+	} else if (counts > ADC_COUNTS) {
+		counts = ADC_COUNTS;
+	}
+	return counts;
+}
+
+/**
+ * Press or release one of the buttons.
+ * @param name Button name: UP, DOWN, LEFT, RIGHT, SELECT or RESET
+ * @param pressed 1 to press it, 0 to release it
+ * @return 0, or -1 if there is no such button
+ */
+int simRigButton (const char* name, int pressed) {
+	unsigned int i;
+
+	for (i = 0; i < sizeof(buttons) / sizeof(buttons[0]); i++) {
+		if (strcmp(buttons[i].name, name) == 0) {
+			simGpioDrive(VIRTUAL_PORT, buttons[i].virtualPin,
+					pressed ? 0 : buttons[i].virtualPin);
+			if (buttons[i].physicalPin) {
+				simGpioDrive(PHYSICAL_PORT, buttons[i].physicalPin,
+						pressed ? 0 : buttons[i].physicalPin);
+			}
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Print the state of the rig.
+ * @param file File to print to
+ */
+void simRigReport (FILE* file) {
+	fprintf(file, "rig: altitude %.1f%%, yaw %.1f deg, main %.1f%%, "
+			"tail %.1f%%\n", height * 100, yaw,
+			simPwmDuty(MAIN_PWM) * 100, simPwmDuty(TAIL_PWM) * 100);
+	if (touchdownNs) {
+		fprintf(file, "rig: touched down at %.3f s at %.2f%%/s, motors off "
+				"at %.3f s\n", touchdownNs / 1e9, touchdownRate * 100,
+				motorsOffNs / 1e9);
+	}
+}
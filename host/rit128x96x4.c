@@ -0,0 +1,88 @@
+/*
+ * rit128x96x4.c
+ *
+ * Host build of the OLED display driver: a 128x96 frame of 4-bit pixels,
+ * two to a byte with the left one in the high nibble. Drawing takes the
+ * time to send the image over the SSI at the driver's bit rate.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "drivers/rit128x96x4.h"
+#include "board.h"
+
+#include <string.h>
+
+/*
+ * Constants
+ */
+#define WIDTH 128
+#define HEIGHT 96
+#define COMMAND_BYTES 6 // Sent to set the window before each image
+
+/*
+ * Static variables (shared within this file)
+ */
+static unsigned char pixels[HEIGHT][WIDTH / 2];
+static unsigned long ssiHz = 1000000;
+
+/**
+ * Spend the time taken to send bytes to the display.
+ * @param count Number of bytes
+ */
+static void send (unsigned long count) {
+	simDelay((unsigned long long)count * 8 * simClock() / ssiHz);
+}
+
+/**
+ * Write the display contents as a binary greyscale (PGM) image.
+ * @param file File to write to
+ */
+void simDisplayWrite (FILE* file) {
+	int x, y;
+
+	fprintf(file, "P5\n%d %d\n15\n", WIDTH, HEIGHT);
+	for (y = 0; y < HEIGHT; y++) {
+		for (x = 0; x < WIDTH / 2; x++) {
+			fputc(pixels[y][x] >> 4, file);
+			fputc(pixels[y][x] & 0xF, file);
+		}
+	}
+}
+
+void RIT128x96x4Init (unsigned long ulFrequency) {
+	simTick();
+	ssiHz = ulFrequency;
+	memset(pixels, 0, sizeof(pixels));
+}
+
+void RIT128x96x4Enable (unsigned long ulFrequency) {
+	simTick();
+	ssiHz = ulFrequency;
+}
+
+void RIT128x96x4Disable (void) {
+	simTick();
+}
+
+void RIT128x96x4Clear (void) {
+	simTick();
+	memset(pixels, 0, sizeof(pixels));
+	send(sizeof(pixels) + COMMAND_BYTES);
+}
+
+void RIT128x96x4ImageDraw (const unsigned char* pucImage, unsigned long ulX,
+		unsigned long ulY, unsigned long ulWidth, unsigned long ulHeight) {
+	unsigned long row;
+
+	simTick();
+	if (ulX + ulWidth > WIDTH || ulY + ulHeight > HEIGHT) {
+		return;
+	}
+	for (row = 0; row < ulHeight; row++) {
+		memcpy(&pixels[ulY + row][ulX / 2], pucImage + row * (ulWidth / 2),
+				ulWidth / 2);
+	}
+	send(ulWidth / 2 * ulHeight + COMMAND_BYTES);
+}
@@ -0,0 +1,98 @@
+/*
+ * sysctl.c
+ *
+ * Host build of the system control driver: the clock configuration.
+ * Peripherals need no enabling on the host.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "inc/hw_sysctl.h"
+#include "driverlib/sysctl.h"
+#include "board.h"
+
+/*
+ * Constants
+ */
+// Cycles taken by each count of SysCtlDelay()'s loop
+#define DELAY_LOOP_CYCLES 3
+
+/*
+ * Static variables (shared within this file)
+ */
+static volatile unsigned long* rcc = 0;
+
+/**
+ * @return The clock control register's storage
+ */
+static volatile unsigned long* rccSlot (void) {
+	if (!rcc) {
+		rcc = simRegisterSlot(SYSCTL_RCC);
+	}
+	return rcc;
+}
+
+/**
+ * @return The system clock frequency set by the clock control register
+ */
+unsigned long simClock (void) {
+	unsigned long value = *rccSlot();
+	unsigned long clock = (value & SYSCTL_RCC_BYPASS) ? SIM_XTAL_HZ : SIM_PLL_HZ;
+
+	if (value & SYSCTL_RCC_USESYSDIV) {
+		clock /= ((value & SYSCTL_RCC_SYSDIV_M) >> SYSCTL_RCC_SYSDIV_S) + 1;
+	}
+	return clock;
+}
+
+void SysCtlPeripheralReset (unsigned long ulPeripheral) {
+	simTick();
+}
+
+void SysCtlPeripheralEnable (unsigned long ulPeripheral) {
+	simTick();
+}
+
+void SysCtlPeripheralDisable (unsigned long ulPeripheral) {
+	simTick();
+}
+
+void SysCtlReset (void) {
+	simTick();
+	simEnd("reset requested");
+}
+
+void SysCtlDelay (unsigned long ulCount) {
+	simDelay((unsigned long long)ulCount * DELAY_LOOP_CYCLES);
+}
+
+void SysCtlClockSet (unsigned long ulConfig) {
+	unsigned long value;
+
+	simTick();
+	value = *rccSlot() & ~(SYSCTL_RCC_SYSDIV_M | SYSCTL_RCC_USESYSDIV
+			| SYSCTL_RCC_BYPASS | SYSCTL_RCC_XTAL_M);
+	value |= ulConfig & (SYSCTL_RCC_SYSDIV_M | SYSCTL_RCC_USESYSDIV
+			| SYSCTL_RCC_BYPASS | SYSCTL_RCC_XTAL_M);
+	*rccSlot() = value;
+}
+
+unsigned long SysCtlClockGet (void) {
+	simTick();
+	return simClock();
+}
+
+void SysCtlPWMClockSet (unsigned long ulConfig) {
+	simTick();
+	*rccSlot() = (*rccSlot() & ~(SYSCTL_RCC_USEPWMDIV | SYSCTL_RCC_PWMDIV_M))
+			| (ulConfig & (SYSCTL_RCC_USEPWMDIV | SYSCTL_RCC_PWMDIV_M));
+}
+
+unsigned long SysCtlPWMClockGet (void) {
+	simTick();
+	if (!(*rccSlot() & SYSCTL_RCC_USEPWMDIV)) {
+		return SYSCTL_PWMDIV_1;
+	}
+	return *rccSlot() & (SYSCTL_RCC_USEPWMDIV | SYSCTL_RCC_PWMDIV_M);
+}
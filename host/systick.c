@@ -0,0 +1,82 @@
+/*
+ * systick.c
+ *
+ * Host build of the SysTick driver.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/systick.h"
+#include "board.h"
+
+/*
+ * Static variables (shared within this file)
+ */
+static unsigned long period = 0;
+static tBoolean running = false;
+static tBoolean intEnabled = false;
+static unsigned long long nextWrap = 0; // Cycle at which the count wraps
+
+/**
+ * Pend the SysTick exception for each wrap of the count that is due.
+ */
+void simSysTickUpdate (void) {
+	if (!running || period == 0) {
+		return;
+	}
+	while (simCycles() >= nextWrap) {
+		nextWrap += period;
+		if (intEnabled) {
+			simPend(FAULT_SYSTICK);
+		}
+	}
+}
+
+void SysTickEnable (void) {
+	simTick();
+	if (!running) {
+		running = true;
+		nextWrap = simCycles() + period;
+	}
+}
+
+void SysTickDisable (void) {
+	simTick();
+	running = false;
+}
+
+void SysTickIntRegister (void (*pfnHandler)(void)) {
+	IntRegister(FAULT_SYSTICK, pfnHandler);
+	intEnabled = true;
+}
+
+void SysTickIntEnable (void) {
+	simTick();
+	intEnabled = true;
+}
+
+void SysTickIntDisable (void) {
+	simTick();
+	intEnabled = false;
+}
+
+void SysTickPeriodSet (unsigned long ulPeriod) {
+	simTick();
+	period = ulPeriod;
+}
+
+unsigned long SysTickPeriodGet (void) {
+	simTick();
+	return period;
+}
+
+unsigned long SysTickValueGet (void) {
+	simTick();
+	if (!running || period == 0) {
+		return 0;
+	}
+	return (unsigned long)(nextWrap - simCycles() - 1);
+}
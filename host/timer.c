@@ -0,0 +1,173 @@
+/*
+ * timer.c
+ *
+ * Host build of the general-purpose timer driver. Timer A of timers 0 to
+ * 3 is modelled, as a 32-bit periodic or one-shot down counter.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/timer.h"
+#include "board.h"
+
+#include <stdlib.h>
+
+/*
+ * Constants
+ */
+#define NUM_TIMERS 4
+
+typedef struct {
+	unsigned long base;
+	unsigned long irq;
+	unsigned long config;
+	unsigned long load;
+	tBoolean running;
+	unsigned long long timeout; // Cycle at which the count reaches 0
+	unsigned long mask;
+	unsigned long status; // Raw interrupt status
+} simTimer_t;
+
+/*
+ * Static variables (shared within this file)
+ */
+static simTimer_t timers[NUM_TIMERS] = {
+	{TIMER0_BASE, INT_TIMER0A},
+	{TIMER1_BASE, INT_TIMER1A},
+	{TIMER2_BASE, INT_TIMER2A},
+	{TIMER3_BASE, INT_TIMER3A}
+};
+
+/**
+ * @param base Base address of a timer
+ * @return The timer
+ */
+static simTimer_t* timerAt (unsigned long base) {
+	int i;
+
+	for (i = 0; i < NUM_TIMERS; i++) {
+		if (timers[i].base == base) {
+			return &timers[i];
+		}
+	}
+	fprintf(stderr, "heliHost: no timer at 0x%08lx\n", base);
+	exit(1);
+}
+
+/**
+ * Count the timers down, and pend the interrupts of those that time out.
+ */
+void simTimerUpdate (void) {
+	int i;
+
+	for (i = 0; i < NUM_TIMERS; i++) {
+		simTimer_t* t = &timers[i];
+
+		while (t->running && simCycles() >= t->timeout) {
+			t->status |= TIMER_TIMA_TIMEOUT;
+			if ((t->config & 0xF) == TIMER_CFG_32_BIT_OS) {
+				t->running = false;
+			}
+			t->timeout += (unsigned long long)t->load + 1;
+		}
+		if (t->status & t->mask) {
+			simAssert(t->irq);
+		}
+	}
+}
+
+/**
+ * @param irq Interrupt number of a timer
+ * @return 1 if its interrupt is still asserted
+ */
+int simTimerAsserted (unsigned long irq) {
+	int i;
+
+	for (i = 0; i < NUM_TIMERS; i++) {
+		if (timers[i].irq == irq) {
+			return (timers[i].status & timers[i].mask) != 0;
+		}
+	}
+	return 0;
+}
+
+void TimerEnable (unsigned long ulBase, unsigned long ulTimer) {
+	simTimer_t* t = timerAt(ulBase);
+
+	simTick();
+	if (!t->running) {
+		t->running = true;
+		t->timeout = simCycles() + t->load;
+	}
+}
+
+void TimerDisable (unsigned long ulBase, unsigned long ulTimer) {
+	simTick();
+	timerAt(ulBase)->running = false;
+}
+
+void TimerConfigure (unsigned long ulBase, unsigned long ulConfig) {
+	simTimer_t* t = timerAt(ulBase);
+
+	simTick();
+	t->config = ulConfig;
+	t->running = false;
+}
+
+void TimerLoadSet (unsigned long ulBase, unsigned long ulTimer,
+		unsigned long ulValue) {
+	simTimer_t* t = timerAt(ulBase);
+
+	simTick();
+	t->load = ulValue;
+	// Writing the load register restarts the count
+	if (t->running) {
+		t->timeout = simCycles() + ulValue;
+	}
+}
+
+unsigned long TimerLoadGet (unsigned long ulBase, unsigned long ulTimer) {
+	simTick();
+	return timerAt(ulBase)->load;
+}
+
+unsigned long TimerValueGet (unsigned long ulBase, unsigned long ulTimer) {
+	simTimer_t* t = timerAt(ulBase);
+
+	simTick();
+	return t->running ? (unsigned long)(t->timeout - simCycles()) : t->load;
+}
+
+void TimerIntRegister (unsigned long ulBase, unsigned long ulTimer,
+		void (*pfnHandler)(void)) {
+	simTimer_t* t = timerAt(ulBase);
+
+	IntRegister(t->irq, pfnHandler);
+	IntEnable(t->irq);
+}
+
+void TimerIntEnable (unsigned long ulBase, unsigned long ulIntFlags) {
+	simTick();
+	timerAt(ulBase)->mask |= ulIntFlags;
+}
+
+void TimerIntDisable (unsigned long ulBase, unsigned long ulIntFlags) {
+	simTick();
+	timerAt(ulBase)->mask &= ~ulIntFlags;
+}
+
+unsigned long TimerIntStatus (unsigned long ulBase, tBoolean bMasked) {
+	simTimer_t* t = timerAt(ulBase);
+
+	simTick();
+	return bMasked ? t->status & t->mask : t->status;
+}
+
+void TimerIntClear (unsigned long ulBase, unsigned long ulIntFlags) {
+	simTick();
+	timerAt(ulBase)->status &= ~ulIntFlags;
+}
@@ -0,0 +1,327 @@
+/*
+ * uart.c
+ *
+ * Host build of the UART driver. UART0 is modelled with its 16-byte
+ * FIFOs, sending and receiving each byte in the time the baud rate
+ * divisor gives it. Bytes sent are written to a file.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_uart.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/uart.h"
+#include "driverlib/udma.h"
+#include "board.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Constants
+ */
+#define FIFO_SIZE 16
+#define LCRH_FEN 0x00000010 // FIFOs enabled
+#define BITS_PER_BYTE 10 // Start, 8 data and stop bits
+#define RX_TIMEOUT_BITS 32
+
+// FIFO levels at which the interrupts are raised, by UART_FIFO_TXn_8 and
+// UART_FIFO_RXn_8 / 8
+static const int fifoLevels[] = {2, 4, 8, 12, 14};
+
+/*
+ * Static variables (shared within this file)
+ */
+static FILE* output = 0;
+static tBoolean enabled = false;
+static unsigned long status = 0; // Raw interrupt status
+static unsigned long mask = 0;
+static unsigned long txLevel = 2;
+static unsigned long rxLevel = 8;
+static unsigned long dmaRequests = 0;
+
+static unsigned char txFifo[FIFO_SIZE];
+static int txCount = 0;
+static tBoolean txShifting = false; // A byte is in the shift register
+static unsigned char txByte;
+static unsigned long long txDone; // Cycle at which it has been sent
+
+static unsigned char rxFifo[FIFO_SIZE];
+static int rxCount = 0;
+static char* rxLine = 0; // Bytes still to arrive on the receive line
+static unsigned long rxLineLen = 0;
+static unsigned long rxLinePos = 0;
+static unsigned long long rxNext; // Cycle at which the next byte arrives
+static unsigned long long rxLast; // Cycle at which the last byte arrived
+static tBoolean rxTimedOut = false;
+
+/**
+ * @return Cycles taken to send or receive a byte at the current divisor
+ */
+static unsigned long long byteCycles (void) {
+	unsigned long long div = *simRegisterSlot(UART0_BASE + UART_O_IBRD) * 64
+			+ *simRegisterSlot(UART0_BASE + UART_O_FBRD);
+
+	// The divisor is in 64ths of 16 clocks per bit
+	return div ? div * BITS_PER_BYTE / 4 : 1;
+}
+
+/**
+ * @return Bytes the FIFOs hold, 1 when they are disabled
+ */
+static int fifoDepth (void) {
+	return (*simRegisterSlot(UART0_BASE + UART_O_LCRH) & LCRH_FEN) ?
+			FIFO_SIZE : 1;
+}
+
+/**
+ * @param base Base address of a UART, which must be UART0
+ */
+static void checkBase (unsigned long base) {
+	if (base != UART0_BASE) {
+		fprintf(stderr, "heliHost: no UART at 0x%08lx\n", base);
+		exit(1);
+	}
+}
+
+/**
+ * Move the next byte from the transmit FIFO to the shift register,
+ * raising the transmit interrupt as the FIFO drains past its level.
+ * @param start Cycle at which the byte starts to be sent
+ */
+static void txNext (unsigned long long start) {
+	txByte = txFifo[0];
+	memmove(txFifo, txFifo + 1, --txCount);
+	txShifting = true;
+	txDone = start + byteCycles();
+	if (txCount == txLevel) {
+		status |= UART_INT_TX;
+	}
+}
+
+/**
+ * Let the uDMA controller fill the transmit FIFO. The UART interrupt is
+ * raised when a transfer is complete.
+ */
+static void dmaFill (void) {
+	while ((dmaRequests & UART_DMA_TX) && txCount < fifoDepth()) {
+		int data = simDmaTake(UDMA_CHANNEL_UART0TX);
+
+		if (data < 0) {
+			return;
+		}
+		txFifo[txCount++] = data;
+		if (!simDmaActive(UDMA_CHANNEL_UART0TX)) {
+			simPend(INT_UART0);
+		}
+	}
+}
+
+/**
+ * Send and receive the bytes that are due, and pend the UART interrupt
+ * if it is raised.
+ */
+void simUartUpdate (void) {
+	unsigned long long now = simCycles();
+
+	dmaFill();
+	if (enabled && !txShifting && txCount > 0) {
+		txNext(now);
+	}
+	while (txShifting && now >= txDone) {
+		fputc(txByte, output ? output : stdout);
+		txShifting = false;
+		dmaFill();
+		if (txCount > 0) {
+			txNext(txDone);
+		}
+	}
+
+	while (enabled && rxLinePos < rxLineLen && now >= rxNext) {
+		if (rxCount < fifoDepth()) {
+			rxFifo[rxCount++] = rxLine[rxLinePos];
+		}
+		rxLinePos++;
+		rxLast = rxNext;
+		rxNext += byteCycles();
+		rxTimedOut = false;
+		if (rxCount == rxLevel) {
+			status |= UART_INT_RX;
+		}
+	}
+	if (rxCount > 0 && !rxTimedOut
+			&& now - rxLast >= byteCycles() * RX_TIMEOUT_BITS / BITS_PER_BYTE) {
+		rxTimedOut = true;
+		status |= UART_INT_RT;
+	}
+
+	if (status & mask) {
+		simAssert(INT_UART0);
+	}
+}
+
+/**
+ * @param irq Interrupt number of the UART
+ * @return 1 if its interrupt is still asserted
+ */
+int simUartAsserted (unsigned long irq) {
+	return (status & mask) != 0;
+}
+
+/**
+ * Queue bytes to arrive on the UART0 receive line at the baud rate.
+ * @param data Bytes to receive
+ * @param len Number of bytes
+ */
+void simUartReceive (const char* data, unsigned long len) {
+	if (rxLinePos == rxLineLen) {
+		rxLinePos = rxLineLen = 0;
+		rxNext = simCycles() + byteCycles();
+	}
+	rxLine = realloc(rxLine, rxLineLen + len);
+	if (!rxLine) {
+		fprintf(stderr, "heliHost: out of memory\n");
+		exit(1);
+	}
+	memcpy(rxLine + rxLineLen, data, len);
+	rxLineLen += len;
+}
+
+/**
+ * @param file Where bytes sent on the UART0 transmit line are written
+ */
+void simUartOutput (FILE* file) {
+	output = file;
+}
+
+void UARTConfigSetExpClk (unsigned long ulBase, unsigned long ulUARTClk,
+		unsigned long ulBaud, unsigned long ulConfig) {
+	unsigned long div = (((ulUARTClk * 8) / ulBaud) + 1) / 2;
+
+	checkBase(ulBase);
+	// The driver library waits for the transmitter to finish
+	while (txShifting || txCount > 0) {
+		simTick();
+	}
+	HWREG(UART0_BASE + UART_O_IBRD) = div / 64;
+	HWREG(UART0_BASE + UART_O_FBRD) = div % 64;
+	HWREG(UART0_BASE + UART_O_LCRH) = ulConfig;
+}
+
+void UARTFIFOEnable (unsigned long ulBase) {
+	checkBase(ulBase);
+	HWREG(UART0_BASE + UART_O_LCRH) |= LCRH_FEN;
+}
+
+void UARTFIFOLevelSet (unsigned long ulBase, unsigned long ulTxLevel,
+		unsigned long ulRxLevel) {
+	checkBase(ulBase);
+	simTick();
+	txLevel = fifoLevels[ulTxLevel];
+	rxLevel = fifoLevels[ulRxLevel >> 3];
+}
+
+void UARTEnable (unsigned long ulBase) {
+	checkBase(ulBase);
+	HWREG(UART0_BASE + UART_O_LCRH) |= LCRH_FEN;
+	enabled = true;
+}
+
+void UARTDisable (unsigned long ulBase) {
+	checkBase(ulBase);
+	while (txShifting) {
+		simTick();
+	}
+	HWREG(UART0_BASE + UART_O_LCRH) &= ~LCRH_FEN;
+	enabled = false;
+}
+
+void UARTCharPut (unsigned long ulBase, unsigned char ucData) {
+	while (!UARTSpaceAvail(ulBase)) {
+	}
+	txFifo[txCount++] = ucData;
+}
+
+tBoolean UARTCharPutNonBlocking (unsigned long ulBase, unsigned char ucData) {
+	if (!UARTSpaceAvail(ulBase)) {
+		return false;
+	}
+	txFifo[txCount++] = ucData;
+	return true;
+}
+
+long UARTCharGetNonBlocking (unsigned long ulBase) {
+	unsigned char data;
+
+	checkBase(ulBase);
+	simTick();
+	if (rxCount == 0) {
+		return -1;
+	}
+	data = rxFifo[0];
+	memmove(rxFifo, rxFifo + 1, --rxCount);
+	return data;
+}
+
+tBoolean UARTCharsAvail (unsigned long ulBase) {
+	checkBase(ulBase);
+	simTick();
+	return rxCount > 0;
+}
+
+tBoolean UARTSpaceAvail (unsigned long ulBase) {
+	checkBase(ulBase);
+	simTick();
+	return txCount < fifoDepth();
+}
+
+tBoolean UARTBusy (unsigned long ulBase) {
+	checkBase(ulBase);
+	simTick();
+	return txShifting || txCount > 0;
+}
+
+void UARTIntRegister (unsigned long ulBase, void (*pfnHandler)(void)) {
+	checkBase(ulBase);
+	IntRegister(INT_UART0, pfnHandler);
+	IntEnable(INT_UART0);
+}
+
+void UARTIntEnable (unsigned long ulBase, unsigned long ulIntFlags) {
+	checkBase(ulBase);
+	simTick();
+	mask |= ulIntFlags;
+}
+
+void UARTIntDisable (unsigned long ulBase, unsigned long ulIntFlags) {
+	checkBase(ulBase);
+	simTick();
+	mask &= ~ulIntFlags;
+}
+
+unsigned long UARTIntStatus (unsigned long ulBase, tBoolean bMasked) {
+	checkBase(ulBase);
+	simTick();
+	return bMasked ? status & mask : status;
+}
+
+void UARTIntClear (unsigned long ulBase, unsigned long ulIntFlags) {
+	checkBase(ulBase);
+	simTick();
+	status &= ~ulIntFlags;
+}
+
+void UARTDMAEnable (unsigned long ulBase, unsigned long ulDMAFlags) {
+	checkBase(ulBase);
+	simTick();
+	dmaRequests |= ulDMAFlags;
+}
+
+void UARTDMADisable (unsigned long ulBase, unsigned long ulDMAFlags) {
+	checkBase(ulBase);
+	simTick();
+	dmaRequests &= ~ulDMAFlags;
+}
@@ -0,0 +1,121 @@
+/*
+ * udma.c
+ *
+ * Host build of the uDMA driver. Basic-mode transfers of bytes to a
+ * peripheral are modelled; the peripheral takes each byte as it has room.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "inc/hw_types.h"
+#include "driverlib/udma.h"
+#include "board.h"
+
+/*
+ * Constants
+ */
+#define NUM_CHANNELS 32
+#define CHANNEL_MASK 0x1F
+
+typedef struct {
+	unsigned long mode;
+	const unsigned char* src;
+	unsigned long size;
+	unsigned long done; // Bytes transferred
+	tBoolean enabled;
+} simChannel_t;
+
+/*
+ * Static variables (shared within this file)
+ */
+static simChannel_t channels[NUM_CHANNELS];
+static tBoolean controllerOn = false;
+
+/**
+ * Take the next byte of a basic-mode uDMA transfer. The channel is
+ * disabled once its last byte has been taken.
+ * @param channel uDMA channel number
+ * @return The byte, or -1 if the channel is not enabled
+ */
+int simDmaTake (unsigned long channel) {
+	simChannel_t* c = &channels[channel];
+	int data;
+
+	if (!controllerOn || !c->enabled || c->mode != UDMA_MODE_BASIC) {
+		return -1;
+	}
+	data = c->src[c->done++];
+	if (c->done == c->size) {
+		c->enabled = false;
+		c->mode = UDMA_MODE_STOP;
+	}
+	return data;
+}
+
+/**
+ * @param channel uDMA channel number
+ * @return 1 if the channel is enabled, otherwise 0
+ */
+int simDmaActive (unsigned long channel) {
+	return channels[channel].enabled;
+}
+
+void uDMAEnable (void) {
+	simTick();
+	controllerOn = true;
+}
+
+void uDMADisable (void) {
+	simTick();
+	controllerOn = false;
+}
+
+void uDMAControlBaseSet (void* pControlTable) {
+	simTick();
+}
+
+void uDMAChannelAttributeEnable (unsigned long ulChannel, unsigned long ulAttr) {
+	simTick();
+}
+
+void uDMAChannelAttributeDisable (unsigned long ulChannel,
+		unsigned long ulAttr) {
+	simTick();
+}
+
+void uDMAChannelControlSet (unsigned long ulChannel, unsigned long ulControl) {
+	simTick();
+}
+
+void uDMAChannelTransferSet (unsigned long ulChannel, unsigned long ulMode,
+		void* pvSrcAddr, void* pvDstAddr, unsigned long ulTransferSize) {
+	simChannel_t* c = &channels[ulChannel & CHANNEL_MASK];
+
+	simTick();
+	c->mode = ulMode;
+	c->src = pvSrcAddr;
+	c->size = ulTransferSize;
+	c->done = 0;
+}
+
+void uDMAChannelEnable (unsigned long ulChannel) {
+	simChannel_t* c = &channels[ulChannel & CHANNEL_MASK];
+
+	simTick();
+	c->enabled = c->mode == UDMA_MODE_BASIC && c->size > 0;
+}
+
+void uDMAChannelDisable (unsigned long ulChannel) {
+	simTick();
+	channels[ulChannel & CHANNEL_MASK].enabled = false;
+}
+
+tBoolean uDMAChannelIsEnabled (unsigned long ulChannel) {
+	simTick();
+	return channels[ulChannel & CHANNEL_MASK].enabled;
+}
+
+unsigned long uDMAChannelModeGet (unsigned long ulChannel) {
+	simTick();
+	return channels[ulChannel & CHANNEL_MASK].mode;
+}
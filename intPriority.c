@@ -0,0 +1,161 @@
+/*
+ * intPriority.c
+ *
+ * Interrupt priority plan for the helicopter program, and runtime
+ * measurement of each interrupt's entry latency and preemption count.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "intPriority.h"
+#include "timing.h"
+#include "format.h"
+
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+
+#include "driverlib/interrupt.h"
+
+/*
+ * Static variables (shared within this file)
+ */
+
+// Statistics for each interrupt source, indexed by isr_id
+static isrStats_t isrStats[NUM_ISRS];
+
+// Handlers currently running, innermost last. There can be at most one
+// handler per preemption level active at once.
+static int activeIsr[NUM_ISRS];
+static unsigned long entryCycles[NUM_ISRS];
+static unsigned long nestedCycles[NUM_ISRS];
+static int isrDepth = 0;
+
+// Names used in the report, indexed by isr_id
+static const char* const isrNames[NUM_ISRS] = {
+	"Encoder", "ADC", "Timebase", "SysTick", "Control", "UART", "Button"
+};
+
+/**
+ * Set the priority grouping and the priority of each interrupt source.
+ * Must be called before interrupts are enabled.
+ */
+void initIntPriorities (void) {
+	IntPriorityGroupingSet(INT_PRIORITY_GROUPING);
+
+	IntPrioritySet(INT_GPIOF, ENCODER_INT_PRIORITY);
+	IntPrioritySet(INT_ADC0SS3, ADC_INT_PRIORITY);
+	IntPrioritySet(INT_TIMER0A, TIMEBASE_INT_PRIORITY);
+	IntPrioritySet(FAULT_SYSTICK, SYSTICK_INT_PRIORITY);
+	IntPrioritySet(INT_TIMER1A, CONTROL_INT_PRIORITY);
+	IntPrioritySet(INT_UART0, UART_INT_PRIORITY);
+	// Only one of the button ports is used
+	IntPrioritySet(INT_GPIOB, BUTTON_INT_PRIORITY);
+	IntPrioritySet(INT_GPIOG, BUTTON_INT_PRIORITY);
+}
+
+/**
+ * Record entry to an interrupt handler. Must be the first call in
+ * the handler.
+ * @param isr One of the enumerated isr_id values
+ * @param latency Cycles between the interrupt event and this call, or
+ * 0 if the source cannot be timestamped
+ */
+void isrEnter (int isr, unsigned long latency) {
+	isrStats_t* stats = &isrStats[isr];
+	tBoolean wasMasked;
+
+	// A handler that preempted this one between filling in the slot and
+	// taking it would use the same slot, so take it with interrupts off
+	wasMasked = IntMasterDisable();
+	// Any handler already running has been preempted by this one
+	if (isrDepth > 0) {
+		isrStats[activeIsr[isrDepth - 1]].preempted++;
+	}
+	activeIsr[isrDepth] = isr;
+	entryCycles[isrDepth] = cycleCount();
+	nestedCycles[isrDepth] = 0;
+	isrDepth++;
+	if (!wasMasked) {
+		IntMasterEnable();
+	}
+
+	stats->count++;
+	stats->lastLatency = latency;
+	if (latency > stats->maxLatency) {
+		stats->maxLatency = latency;
+	}
+}
+
+/**
+ * Record exit from an interrupt handler. Must be the last call in
+ * the handler.
+ * @param isr One of the enumerated isr_id values
+ */
+void isrExit (int isr) {
+	unsigned long elapsed;
+	tBoolean wasMasked;
+
+	// Once the slot is given up a preempting handler may reuse it, so read
+	// it and give it up with interrupts off
+	wasMasked = IntMasterDisable();
+	isrDepth--;
+	elapsed = cycleCount() - entryCycles[isrDepth];
+	isrStats[isr].cycles += elapsed - nestedCycles[isrDepth];
+
+	// Don't count this handler's time against the one it preempted
+	if (isrDepth > 0) {
+		nestedCycles[isrDepth - 1] += elapsed;
+	}
+	if (!wasMasked) {
+		IntMasterEnable();
+	}
+}
+
+/**
+ * Get the statistics of an interrupt source.
+ * @param isr One of the enumerated isr_id values
+ * @return The source's statistics
+ */
+const isrStats_t* getIsrStats (int isr) {
+	return &isrStats[isr];
+}
+
+/**
+ * @return Cycles spent in all the measured interrupt handlers since
+ * reset. Wraps around.
+ */
+unsigned long getIsrCyclesTotal (void) {
+	unsigned long total = 0;
+	int i;
+
+	// Nested handlers' time is excluded from each handler's own count,
+	// so nothing is counted twice
+	for (i = 0; i < NUM_ISRS; i++) {
+		total += isrStats[i].cycles;
+	}
+	return total;
+}
+
+/**
+ * Format a line reporting an interrupt's statistics and clear its maximum
+ * latency.
+ * @param isr One of the enumerated isr_id values
+ * @param string Buffer of at least INT_REPORT_LINE_LEN characters
+ * @return Length of the line
+ */
+unsigned int formatIntReport (int isr, char* string) {
+	unsigned int len;
+
+	len = fmtStr(string, 0, isrNames[isr]);
+	len = fmtStr(string, len, ": n=");
+	len = fmtUint(string, len, isrStats[isr].count);
+	len = fmtStr(string, len, " lat=");
+	len = fmtUint(string, len, isrStats[isr].lastLatency);
+	len = fmtStr(string, len, "/");
+	len = fmtUint(string, len, isrStats[isr].maxLatency);
+	len = fmtStr(string, len, " cyc pre=");
+	len = fmtUint(string, len, isrStats[isr].preempted);
+	len = fmtStr(string, len, " \n");
+	isrStats[isr].maxLatency = 0;
+	return len;
+}
@@ -0,0 +1,91 @@
+#ifndef INTPRIORITY_H_
+#define INTPRIORITY_H_
+
+/*
+ * intPriority.h
+ *
+ * Interrupt priority plan for the helicopter program, and runtime
+ * measurement of each interrupt's entry latency and preemption count.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+/*
+ * Constants
+ */
+// Number of preemptable priority bits. The LM3S1968 implements 3 priority
+// bits, so this gives 4 preemption levels with 2 sub-priorities each.
+#define INT_PRIORITY_GROUPING 2
+
+// NVIC priorities (upper 3 bits; lower value = higher priority)
+#define ENCODER_INT_PRIORITY 0x00 // Level 0: yaw quadrature edges
+#define ADC_INT_PRIORITY 0x40 // Level 1: altitude conversions
+#define TIMEBASE_INT_PRIORITY 0x60 // Level 1, sub-priority 1: task clock
+#define SYSTICK_INT_PRIORITY 0x80 // Level 2: ADC trigger and buttons
+#define BUTTON_INT_PRIORITY 0xA0 // Level 2, sub-priority 1: button edges
+#define CONTROL_INT_PRIORITY 0xC0 // Level 3: CONTROL_IN_ISR control laws
+#define UART_INT_PRIORITY 0xE0 // Level 3, sub-priority 1: serial transmit
+
+// Longest line formatIntReport() writes: a name and four counts of up to
+// 10 digits each
+#define INT_REPORT_LINE_LEN 80
+
+// Interrupt sources that are measured
+enum isr_id { ISR_ENCODER = 0, ISR_ADC, ISR_TIMEBASE, ISR_SYSTICK,
+	ISR_CONTROL, ISR_UART, ISR_BUTTON, NUM_ISRS };
+
+// Runtime statistics for one interrupt source
+typedef struct {
+	unsigned long count; // Number of times the handler has run
+	unsigned long lastLatency; // Cycles from the event to handler entry
+	unsigned long maxLatency;
+	unsigned long preempted; // Times the handler was preempted
+	unsigned long cycles; // Cycles spent in the handler, excluding
+			// handlers that preempted it
+} isrStats_t;
+
+/**
+ * Set the priority grouping and the priority of each interrupt source.
+ * Must be called before interrupts are enabled.
+ */
+void initIntPriorities (void);
+
+/**
+ * Record entry to an interrupt handler. Must be the first call in
+ * the handler.
+ * @param isr One of the enumerated isr_id values
+ * @param latency Cycles between the interrupt event and this call, or
+ * 0 if the source cannot be timestamped
+ */
+void isrEnter (int isr, unsigned long latency);
+
+/**
+ * Record exit from an interrupt handler. Must be the last call in
+ * the handler.
+ * @param isr One of the enumerated isr_id values
+ */
+void isrExit (int isr);
+
+/**
+ * Get the statistics of an interrupt source.
+ * @param isr One of the enumerated isr_id values
+ * @return The source's statistics
+ */
+const isrStats_t* getIsrStats (int isr);
+
+/**
+ * @return Cycles spent in all the measured interrupt handlers since
+ * reset. Wraps around.
+ */
+unsigned long getIsrCyclesTotal (void);
+
+/**
+ * Format a line reporting an interrupt's statistics and clear its maximum
+ * latency.
+ * @param isr One of the enumerated isr_id values
+ * @param string Buffer of at least INT_REPORT_LINE_LEN characters
+ * @return Length of the line
+ */
+unsigned int formatIntReport (int isr, char* string);
+
+#endif /* INTPRIORITY_H_ */
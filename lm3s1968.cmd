@@ -8,9 +8,11 @@
 
 --retain=g_pfnVectors
 
+/* 0x30000-0x3FBFF is reserved for the flight log (see flightLog.h) and the  */
+/* last 1 KB page of flash (0x3FC00) for auto-tuned gains                    */
 MEMORY
 {
-    FLASH (RX) : origin = 0x00000000, length = 0x00040000
+    FLASH (RX) : origin = 0x00000000, length = 0x00030000
     SRAM (RWX) : origin = 0x20000000, length = 0x00010000
 }
 
@@ -8,6 +8,8 @@
 
 #include "globals.h"
 #include "motorControl.h"
+#include "autoTune.h"
+#include "flightMode.h"
 
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
@@ -16,6 +18,9 @@
 #include "driverlib/pwm.h"
 #include "driverlib/gpio.h"
 
+// Set once the PWM generators are initialised
+static int initialised = 0;
+
 /**
  * Initialise the PWM generators. Should be called after the associated
  * GPIO pins have been enabled for output.
@@ -38,11 +43,12 @@ void initPWMchan (void) {
 				PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_NO_SYNC);
 
 	// Compute the PWM period based on the system clock.
-	SysCtlPWMClockSet(SYSCTL_PWMDIV_4);
+	SysCtlPWMClockSet(SYSCTL_PWMDIV_8);
 
-	// We set the PWM clock to be 1/4 the system clock, so set the period
-	// to be 1/4 the system clock divided by the desired frequency.
-	period = SysCtlClockGet() / 4 / PWM_RATE_HZ;
+	// We set the PWM clock to be 1/8 the system clock, so set the period
+	// to be 1/8 the system clock divided by the desired frequency. The
+	// period fits the 16-bit counter up to a 50 MHz system clock.
+	period = SysCtlClockGet() / PWM_DIVIDER / PWM_RATE_HZ;
 	// Generator 0
 	PWMGenPeriodSet(PWM_BASE, PWM_GEN_0, period);
 	PWMPulseWidthSet(PWM_BASE, PWM_OUT_1, period * MAIN_INITIAL_DUTY100 / 10000);
@@ -60,25 +66,164 @@ void initPWMchan (void) {
 	initialised = 1;
 }
 
+/*
+ * Static variables (shared within this file)
+ */
+
+// Current phase of the landing profile
+static int landingPhase = LANDING_DESCENT;
+
+// Number of consecutive control steps the heli has been stationary
+// on the ground while landing
+static unsigned int touchdownSteps = 0;
+
+// Double-buffered PI gains, indexed by bank then control_axis. Writers
+// fill the inactive bank and then switch activeBank with a single store,
+// so a control step never sees a half-updated set.
+static gains_t gainBank[2][2] = {
+	{{ALT_KP100, ALT_KI100}, {YAW_KP100, YAW_KI100}},
+	{{ALT_KP100, ALT_KI100}, {YAW_KP100, YAW_KI100}}
+};
+static volatile int activeBank = 0;
+
+// Integral gain used by the previous control step of each axis
+static long kiInUse[2] = {ALT_KI100, YAW_KI100};
+
+// Integrated error for each axis, indexed by control_axis
+static signed long errorIntegrated[2] = {200, 0};
+
+// Pending request from the background loop, or CTRL_REQ_NONE
+static volatile int pendingRequest = CTRL_REQ_NONE;
+
+// 1 if a fault has been requested and not yet serviced. Kept apart from
+// pendingRequest so that no later request can replace it.
+static volatile int faultPending = 0;
+
 /**
- * If the helicopter is at a low enough altitude, turn off the motors.
+ * Post a request to be carried out at the start of the next altitude
+ * control step. The request is a single word, so it can be handed to the
+ * control task safely whether that runs in the background loop or in an
+ * interrupt. A pending request that has not been serviced is replaced,
+ * except for CTRL_REQ_FAULT, which is held until it is serviced.
+ * @param request One of the enumerated control_request values
  */
-void powerDown (void) {
+void requestControl (int request) {
+	if (request == CTRL_REQ_FAULT) {
+		faultPending = 1;
+	} else {
+		pendingRequest = request;
+	}
+}
+
+/**
+ * Carry out any pending request from the background loop.
+ */
+static void serviceRequest (void) {
+	int request = pendingRequest;
+	pendingRequest = CTRL_REQ_NONE;
+
+	// A fault is acted on first; any other request is then carried out
+	// in the flight mode the fault leads to
+	if (faultPending) {
+		faultPending = 0;
+		flightModeEvent(FM_EV_FAULT);
+	}
+
+	switch (request) {
+	case CTRL_REQ_LAND:
+		flightModeEvent(FM_EV_LAND);
+		break;
+	case CTRL_REQ_TUNE:
+		startAutoTune(0);
+		break;
+	case CTRL_REQ_TUNE_SAVE:
+		startAutoTune(1);
+		break;
+	case CTRL_REQ_TUNE_STOP:
+		stopAutoTune();
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Begin a controlled-descent landing. Entry action of HELI_STOPPING; the
+ * descent itself is run by altitudeControl().
+ */
+void beginLanding (void) {
+	landingPhase = LANDING_DESCENT;
+	touchdownSteps = 0;
 	_desiredAltitude = 0;
+}
+
+/**
+ * Run one step of the controlled-descent landing profile. The main rotor
+ * duty cycle is adjusted to track a target vertical rate, which is reduced
+ * near the ground. The rate loop keeps running on the ground, where the
+ * heli cannot descend, so it winds the main rotor down. Once the heli has
+ * stopped moving with the main rotor at minimum, touchdown is signalled
+ * to the flight mode, which turns the motors off.
+ * @param altitude Measured altitude in %
+ * @param rate Measured vertical rate in % altitude per second
+ */
+void powerDown (int altitude, int rate) {
+	int targetRate;
 	unsigned int mainDuty = getDutyCycle100(MAIN_ROTOR);
 
-	// Check that the heli is close to the ground and that the main rotor
-	// has a low duty cycle before shutting off.
-	if (_avgAltitude < 5 && mainDuty <= MIN_DUTY100) {
-		PWMOutputState(PWM_BASE, PWM_OUT_1_BIT | PWM_OUT_4_BIT, false);
-		setDutyCycle100(MAIN_ROTOR, MAIN_INITIAL_DUTY100);
-		setDutyCycle100(TAIL_ROTOR, TAIL_INITIAL_DUTY100);
-		_heliState = HELI_OFF;
+#ifdef LANDING_STEP_DOWN
+	// The landing this profile replaced, kept for the host tests to compare
+	// against: the main rotor is wound down whatever the heli does
+	if (altitude < 5 && mainDuty <= MIN_DUTY100) {
+		flightModeEvent(FM_EV_TOUCHDOWN);
+	} else {
+		changeDutyCycle(MAIN_ROTOR, -MAX_DUTY_CHANGE100);
+	}
+	return;
+#endif
+
+	// Advance the landing phase based on altitude
+	if (altitude <= LANDING_TOUCHDOWN_ALTITUDE) {
+		landingPhase = LANDING_TOUCHDOWN;
+	} else if (altitude <= LANDING_FLARE_ALTITUDE &&
+			landingPhase == LANDING_DESCENT) {
+		landingPhase = LANDING_FLARE;
 	}
+
+	switch (landingPhase) {
+	case LANDING_DESCENT:
+		targetRate = LANDING_DESCENT_RATE;
+		break;
+	case LANDING_FLARE:
+		targetRate = LANDING_FLARE_RATE;
+		break;
+	default:
+		// Near the ground. The altitude cannot tell a heli just above the
+		// ground from one on it, so the rate loop carries on until the main
+		// rotor is at minimum and the altitude has settled.
+		if (rate == 0 && mainDuty <= MIN_DUTY100) {
+			touchdownSteps++;
+		} else {
+			touchdownSteps = 0;
+		}
+		if (touchdownSteps >= LANDING_CONFIRM_STEPS) {
+			flightModeEvent(FM_EV_TOUCHDOWN);
+			return;
+		}
+		targetRate = LANDING_TOUCHDOWN_RATE;
+		break;
+	}
+
+	// Rate loop: descending at the target rate takes a steady fall in
+	// power, and descending too fast (rate below target) adds power.
+	// changeDutyCycle() limits the size of each step.
+	changeDutyCycle(MAIN_ROTOR, targetRate * LANDING_RATE_FF
+			+ (targetRate - rate) * LANDING_RATE_KP);
 }
 
 /**
  * Turns on the motors and sets duty cycle of both to the initial amount.
+ * Entry action of HELI_STARTING.
  */
 void powerUp (void) {
 	if (!initialised) {
@@ -88,7 +233,43 @@ void powerUp (void) {
 	setDutyCycle100(MAIN_ROTOR, MAIN_INITIAL_DUTY100);
 	setDutyCycle100(TAIL_ROTOR, TAIL_INITIAL_DUTY100);
 	PWMOutputState(PWM_BASE, PWM_OUT_1_BIT | PWM_OUT_4_BIT, true);
-	_heliState = HELI_ON;
+}
+
+/**
+ * Turns off the motors and sets duty cycle of both back to the initial
+ * amount. Entry action of HELI_OFF.
+ */
+void motorsOff (void) {
+	if (!initialised) {
+		return;
+	}
+
+	PWMOutputState(PWM_BASE, PWM_OUT_1_BIT | PWM_OUT_4_BIT, false);
+	setDutyCycle100(MAIN_ROTOR, MAIN_INITIAL_DUTY100);
+	setDutyCycle100(TAIL_ROTOR, TAIL_INITIAL_DUTY100);
+}
+
+/**
+ * Recompute the PWM period after the system clock has changed, keeping
+ * the PWM frequency and the duty cycle of both rotors.
+ */
+void PWMClockChanged (void) {
+	unsigned int mainDuty100, tailDuty100;
+	unsigned long period;
+
+	if (!initialised) {
+		return;
+	}
+
+	// Read the duty cycles against the old period before changing it
+	mainDuty100 = getDutyCycle100(MAIN_ROTOR);
+	tailDuty100 = getDutyCycle100(TAIL_ROTOR);
+
+	period = SysCtlClockGet() / PWM_DIVIDER / PWM_RATE_HZ;
+	PWMGenPeriodSet(PWM_BASE, PWM_GEN_0, period);
+	PWMGenPeriodSet(PWM_BASE, PWM_GEN_2, period);
+	setDutyCycle100(MAIN_ROTOR, mainDuty100);
+	setDutyCycle100(TAIL_ROTOR, tailDuty100);
 }
 
 /**
@@ -165,6 +346,86 @@ void changeDutyCycle (unsigned long rotor, signed int amount) {
 	PWMPulseWidthSet(PWM_BASE, rotor, newPulseWidth);
 }
 
+/**
+ * Get the PI gains currently used by the controller for an axis.
+ * @param axis Either ALTITUDE_AXIS or YAW_AXIS
+ * @param axisGains Filled in with the current gains
+ */
+void getGains (int axis, gains_t* axisGains) {
+	*axisGains = gainBank[activeBank][axis];
+}
+
+/**
+ * @param gain100 A gain * 100
+ * @return The gain limited to 0 to MAX_GAIN100
+ */
+static long limitGain (long gain100) {
+	if (gain100 < 0) {
+		return 0;
+	}
+	return gain100 > MAX_GAIN100 ? MAX_GAIN100 : gain100;
+}
+
+/**
+ * Set the PI gains used by the controller for an axis. The new gains take
+ * effect atomically at the next control step, and the integrator is
+ * rescaled then so that the controller output does not jump. Each gain
+ * is limited to 0 to MAX_GAIN100, and the integrator to INTEGRATOR_LIMIT,
+ * so the controller's products cannot overflow whether the gains come
+ * from a command, the auto-tuner or flash.
+ * @param axis Either ALTITUDE_AXIS or YAW_AXIS
+ * @param axisGains The new gains
+ */
+void setGains (int axis, const gains_t* axisGains) {
+	int bank = activeBank;
+
+	gainBank[!bank][axis].kp100 = limitGain(axisGains->kp100);
+	gainBank[!bank][axis].ki100 = limitGain(axisGains->ki100);
+	gainBank[!bank][!axis] = gainBank[bank][!axis];
+	activeBank = !bank;
+}
+
+/**
+ * Get the integrated error of an axis's PI controller.
+ * @param axis Either ALTITUDE_AXIS or YAW_AXIS
+ * @return The integrated error
+ */
+long getIntegrator (int axis) {
+	return errorIntegrated[axis];
+}
+
+/**
+ * Limit an axis's integrated error to INTEGRATOR_LIMIT either way.
+ * @param axis Either ALTITUDE_AXIS or YAW_AXIS
+ */
+static void limitIntegrator (int axis) {
+	if (errorIntegrated[axis] > INTEGRATOR_LIMIT) {
+		errorIntegrated[axis] = INTEGRATOR_LIMIT;
+	} else if (errorIntegrated[axis] < -INTEGRATOR_LIMIT) {
+		errorIntegrated[axis] = -INTEGRATOR_LIMIT;
+	}
+}
+
+/**
+ * Get the gains for this control step of an axis. If they have changed
+ * since the last step, rescale the integrator to suit the new gains.
+ * @param axis Either ALTITUDE_AXIS or YAW_AXIS
+ * @return The gains to use
+ */
+static const gains_t* stepGains (int axis) {
+	const gains_t* axisGains = &gainBank[activeBank][axis];
+
+	if (axisGains->ki100 != kiInUse[axis]) {
+		if (axisGains->ki100 != 0) {
+			errorIntegrated[axis] = errorIntegrated[axis] * kiInUse[axis]
+					/ axisGains->ki100;
+			limitIntegrator(axis);
+		}
+		kiInUse[axis] = axisGains->ki100;
+	}
+	return axisGains;
+}
+
 /**
  * Adjusts the PWM duty cycle of the main rotor to control the altitude.
  */
@@ -172,19 +433,36 @@ void altitudeControl (void) {
 	if (!initialised) {
 		return;
 	}
+	serviceRequest();
+
+	heliSnapshot_t now;
+	getSnapshot(&now);
+
 	unsigned int mainDuty100 = getDutyCycle100(MAIN_ROTOR);
-	static signed long errorIntegrated = 200;
-	int error = _desiredAltitude - _avgAltitude;
+	static int prevAltitude = 0;
+	int error = now.desiredAltitude - now.avgAltitude;
+
+	// Estimate the vertical rate in % altitude per second
+	int rate = (now.avgAltitude - prevAltitude) * ALT_CTRL_RATE_HZ;
+	prevAltitude = now.avgAltitude;
 
 	// Bypass normal altitude control if the heli is landing
-	if (_heliState == HELI_STOPPING && mainDuty100 > MIN_DUTY100) {
-		changeDutyCycle(MAIN_ROTOR, -MAX_DUTY_CHANGE100);
-		errorIntegrated = 0;
+	if (now.heliState == HELI_STOPPING) {
+		powerDown(now.avgAltitude, rate);
+		errorIntegrated[ALTITUDE_AXIS] = 0;
+		return;
+	}
+
+	// Relay output replaces the PI controller while being auto-tuned
+	if (autoTuneAxis() == ALTITUDE_AXIS && autoTuneRelayOn()) {
+		setDutyCycle100(MAIN_ROTOR, autoTuneStep(now.avgAltitude));
 		return;
 	}
 
-	// bias = 1500; Kp = 25; Ki = 25/2
-	int newDuty100 = 1500 + error * 25 + errorIntegrated * 25 / 2;
+	// bias = 1500
+	const gains_t* gains = stepGains(ALTITUDE_AXIS);
+	int newDuty100 = 1500 + error * gains->kp100 / 100 +
+			errorIntegrated[ALTITUDE_AXIS] * gains->ki100 / 100;
 
 	// Don't allow duty cycle to change too much at once
 	if (newDuty100 > (signed int)mainDuty100 + MAX_DUTY_CHANGE100) {
@@ -199,6 +477,12 @@ void altitudeControl (void) {
 
 	setDutyCycle100(MAIN_ROTOR, newDuty100);
 
+	// Until the relay takes over, the PI controller's output is averaged
+	// as its bias
+	if (autoTuneAxis() == ALTITUDE_AXIS) {
+		autoTuneBias(newDuty100);
+	}
+
 	// If we are at saturation (5% and we want to go lower, or 95%
 	// and we want to go higher), don't integrate any further
 	if ((mainDuty100 <= MIN_DUTY100 && error < 0) ||
@@ -207,7 +491,8 @@ void altitudeControl (void) {
 	}
 
 	// delta t = 0.5 seconds
-	errorIntegrated += error / 2;
+	errorIntegrated[ALTITUDE_AXIS] += error / 2;
+	limitIntegrator(ALTITUDE_AXIS);
 }
 
 /**
@@ -217,12 +502,22 @@ void yawControl (void) {
 	if (!initialised) {
 		return;
 	}
-	static signed long errorIntegrated = 0;
+	heliSnapshot_t now;
+	getSnapshot(&now);
+
 	unsigned int tailDuty100 = getDutyCycle100(TAIL_ROTOR);
-	int error = _desiredYaw100 - _yaw100;
+	int error = now.desiredYaw100 - now.yaw100;
+
+	// Relay output replaces the PI controller while being auto-tuned
+	if (autoTuneAxis() == YAW_AXIS && autoTuneRelayOn()) {
+		setDutyCycle100(TAIL_ROTOR, autoTuneStep(now.yaw100));
+		return;
+	}
 
-	// bias = 1500; Kp = 1/4; Ki = 1/4
-	int newDuty100 = 1500 + (error / 4) + (errorIntegrated / 4);
+	// bias = 1500
+	const gains_t* gains = stepGains(YAW_AXIS);
+	int newDuty100 = 1500 + error * gains->kp100 / 100 +
+			errorIntegrated[YAW_AXIS] * gains->ki100 / 100;
 
 	// Don't allow duty cycle to change too much at once
 	if (newDuty100 > (signed int)tailDuty100 + MAX_DUTY_CHANGE100) {
@@ -237,6 +532,12 @@ void yawControl (void) {
 
 	setDutyCycle100(TAIL_ROTOR, newDuty100);
 
+	// Until the relay takes over, the PI controller's output is averaged
+	// as its bias
+	if (autoTuneAxis() == YAW_AXIS) {
+		autoTuneBias(newDuty100);
+	}
+
 	// If we are at saturation (5% and we want to go lower, or 95%
 	// and we want to go higher), don't integrate any further
 	if ((tailDuty100 <= MIN_DUTY100 && error < 0) ||
@@ -245,5 +546,6 @@ void yawControl (void) {
 	}
 
 	// delta t = 0.5 seconds
-	errorIntegrated += error / 2;
+	errorIntegrated[YAW_AXIS] += error / 2;
+	limitIntegrator(YAW_AXIS);
 }
@@ -15,6 +15,7 @@
 #define MAIN_ROTOR PWM_OUT_1
 #define TAIL_ROTOR PWM_OUT_4
 #define PWM_RATE_HZ 150 // Frequency of the PWM generator
+#define PWM_DIVIDER 8 // PWM clock = system clock / 8 (SYSCTL_PWMDIV_8)
 #define MAIN_INITIAL_DUTY100 500 // Initial duty cycle
 #define TAIL_INITIAL_DUTY100 500 // Initial duty cycle
 #define MIN_DUTY100 500
@@ -23,10 +24,61 @@
 // Maximum % * 100 the duty cycle is allowed to change at once
 #define MAX_DUTY_CHANGE100 500 // 5%
 
-/*
- * Static variables
- */
-static int initialised = 0;
+// Rate at which altitudeControl() and yawControl() are called, in Hz.
+// It stays at 2 Hz in every clock profile: the faster clock when flying
+// buys CPU headroom, but the control rate is set by the measurements and
+// the tuning, not the CPU. The altitude is a whole percent, so a vertical
+// rate estimated from one step to the next comes in steps of
+// ALT_CTRL_RATE_HZ % per second: 2%/s here, but 10%/s at 10 Hz, coarser
+// than the landing's target rates. The yaw encoder's 0.8 degree steps
+// limit the yaw error the same way. And the integrators (error / 2 per
+// step), the per-step duty change limit, the default gains and the
+// auto-tuner's relay experiments were all set for 2 Hz; a faster rate
+// would need them all tuned again.
+#define ALT_CTRL_RATE_HZ 2
+
+// Landing profile: target vertical rates in % altitude per second
+#define LANDING_DESCENT_RATE -8 // Above the flare altitude
+#define LANDING_FLARE_RATE -3 // Below the flare altitude
+#define LANDING_TOUCHDOWN_RATE -2 // Below the touchdown altitude
+#define LANDING_FLARE_ALTITUDE 20 // Percent
+#define LANDING_TOUCHDOWN_ALTITUDE 4 // Percent
+// Consecutive stationary control steps at minimum duty before shutdown
+#define LANDING_CONFIRM_STEPS 2
+// Rate loop gain: duty cycle % * 100 per (% altitude per second) of error
+#define LANDING_RATE_KP 20
+// Rate loop feed-forward: duty cycle % * 100 per step per (% altitude per
+// second) of target rate. Hovering 1% lower takes about 0.4% less duty
+// cycle, so descending at 1% per second takes 0.4% less every second.
+#define LANDING_RATE_FF 20
+
+enum landing_phase { LANDING_DESCENT = 0, LANDING_FLARE, LANDING_TOUCHDOWN };
+
+// Default controller gains, * 100
+#define ALT_KP100 2500 // Kp = 25
+#define ALT_KI100 1250 // Ki = 25/2
+#define YAW_KP100 25 // Kp = 1/4
+#define YAW_KI100 25 // Ki = 1/4
+
+// Largest gain * 100 (Kp or Ki = 200). The yaw error * 100 can reach
+// about 70000, so error * gain stays below 2^31.
+#define MAX_GAIN100 20000
+
+// Largest integrated error either way, so that integrator * gain stays
+// below 2^31 (the target's long is 32 bits, the host build's 64)
+#define INTEGRATOR_LIMIT (0x7FFFFFFFL / MAX_GAIN100)
+
+enum control_axis { ALTITUDE_AXIS = 0, YAW_AXIS = 1 };
+
+// Requests from the background loop to the control task
+enum control_request { CTRL_REQ_NONE = 0, CTRL_REQ_LAND, CTRL_REQ_TUNE,
+	CTRL_REQ_TUNE_SAVE, CTRL_REQ_TUNE_STOP, CTRL_REQ_FAULT };
+
+// PI controller gains for one axis
+typedef struct {
+	long kp100; // Proportional gain * 100
+	long ki100; // Integral gain * 100
+} gains_t;
 
 /**
  * Initialise the PWM generators.
@@ -36,15 +88,47 @@ static int initialised = 0;
 void initPWMchan (void);
 
 /**
- * Turn off the motors.
+ * Post a request to be carried out at the start of the next altitude
+ * control step. The request is a single word, so it can be handed to the
+ * control task safely whether that runs in the background loop or in an
+ * interrupt. A pending request that has not been serviced is replaced,
+ * except for CTRL_REQ_FAULT, which is held until it is serviced.
+ * @param request One of the enumerated control_request values
+ */
+void requestControl (int request);
+
+/**
+ * Begin a controlled-descent landing. Entry action of HELI_STOPPING; the
+ * descent itself is run by altitudeControl().
+ */
+void beginLanding (void);
+
+/**
+ * Run one step of the controlled-descent landing profile and signal
+ * FM_EV_TOUCHDOWN to the flight mode once touchdown is confirmed.
+ * @param altitude Measured altitude in %
+ * @param rate Measured vertical rate in % altitude per second
  */
-void powerDown (void);
+void powerDown (int altitude, int rate);
 
 /**
  * Turns on the motors and sets duty cycle of both to the initial amount.
+ * Entry action of HELI_STARTING.
  */
 void powerUp (void);
 
+/**
+ * Recompute the PWM period after the system clock has changed, keeping
+ * the PWM frequency and the duty cycle of both rotors.
+ */
+void PWMClockChanged (void);
+
+/**
+ * Turns off the motors and sets duty cycle of both back to the initial
+ * amount. Entry action of HELI_OFF.
+ */
+void motorsOff (void);
+
 /**
  * Sets the PWM duty cycle to be the duty cycle %. Has built in
  * safety at 5% or 95% if dutyCycle set above 95% or below 5%.
@@ -68,6 +152,29 @@ unsigned int getDutyCycle100 (unsigned long rotor);
  */
 void changeDutyCycle (unsigned long rotor, signed int amount);
 
+/**
+ * Get the PI gains currently used by the controller for an axis.
+ * @param axis Either ALTITUDE_AXIS or YAW_AXIS
+ * @param axisGains Filled in with the current gains
+ */
+void getGains (int axis, gains_t* axisGains);
+
+/**
+ * Set the PI gains used by the controller for an axis. The new gains take
+ * effect atomically at the next control step, and the integrator is
+ * rescaled then so that the controller output does not jump.
+ * @param axis Either ALTITUDE_AXIS or YAW_AXIS
+ * @param axisGains The new gains
+ */
+void setGains (int axis, const gains_t* axisGains);
+
+/**
+ * Get the integrated error of an axis's PI controller.
+ * @param axis Either ALTITUDE_AXIS or YAW_AXIS
+ * @return The integrated error
+ */
+long getIntegrator (int axis);
+
 /**
  * Adjusts the PWM duty cycle of the main rotor to control the altitude.
  */
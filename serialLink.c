@@ -1,5 +1,5 @@
 /*
- * uart.c
+ * serialLink.c
  *
  * Serial link via UART for outputting status information.
  * Based on HeliSerialTest.c by P. J. Bones
@@ -8,12 +8,156 @@
  */
 
 #include "serialLink.h"
+#include "intPriority.h"
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_uart.h"
 
 #include "driverlib/sysctl.h"
 #include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
 #include "driverlib/uart.h"
+#ifdef UART_TX_DMA
+#include "driverlib/udma.h"
+#endif
+
+#include "string.h"
+
+/*
+ * Static variables (shared within this file)
+ */
+
+// Transmit queue. txHead is only written by UARTSendBytes(), and txTail
+// by txFill() under lockTx() or from the interrupt handler.
+static unsigned char txBuf[TX_BUF_SIZE];
+static volatile unsigned int txHead = 0;
+static volatile unsigned int txTail = 0;
+
+static int txPolicy = TX_DROP;
+static txStats_t txStats;
+
+// Receive queue. rxHead is only written by the interrupt handler and
+// rxTail only by UARTGetChar().
+static unsigned char rxBuf[RX_BUF_SIZE];
+static volatile unsigned int rxHead = 0;
+static volatile unsigned int rxTail = 0;
+
+#ifdef UART_TX_DMA
+// uDMA channel control table. Must be aligned on a 1024-byte boundary.
+#if defined(ccs)
+#pragma DATA_ALIGN(dmaControlTable, 1024)
+static unsigned char dmaControlTable[1024];
+#else
+static unsigned char dmaControlTable[1024] __attribute__ ((aligned(1024)));
+#endif
+#endif
+
+// Double-buffered frames. Buffers are filled and sent alternately:
+// frameFill is the next buffer to hand out, frameSend the next to send.
+enum frame_state { FRAME_FREE = 0, FRAME_PENDING, FRAME_SENDING };
+static unsigned char frameBuf[2][FRAME_BUF_SIZE];
+static volatile int frameState[2] = {FRAME_FREE, FRAME_FREE};
+static unsigned long frameLen[2];
+static frameCallback_t frameDone[2];
+// Queue position at which each frame was submitted, so that it is sent
+// after the strings queued before it and before those queued after it
+static unsigned int frameMark[2];
+static int frameFill = 0;
+static int frameSend = 0;
+#ifndef UART_TX_DMA
+// Next byte of the frame being sent to put into the Tx FIFO
+static unsigned long framePos;
+#endif
+
+/**
+ * Keep UARTIntHandler() out while the background loop moves queued bytes
+ * or starts a frame. Every UART0 source is masked, not just the
+ * transmitter: the handler refills the FIFO on receive interrupts too.
+ */
+static void lockTx (void) {
+	IntDisable(INT_UART0);
+}
+
+/**
+ * Let UARTIntHandler() run again after lockTx(). An interrupt raised
+ * meanwhile is taken now.
+ */
+static void unlockTx (void) {
+	IntEnable(INT_UART0);
+}
+
+/**
+ * Start sending the next frame, which is due. With UART_TX_DMA the uDMA
+ * controller sends it; otherwise txFill() puts it into the Tx FIFO.
+ */
+static void frameStart (void) {
+	frameState[frameSend] = FRAME_SENDING;
+#ifdef UART_TX_DMA
+	uDMAChannelTransferSet(UDMA_CHANNEL_UART0TX | UDMA_PRI_SELECT,
+			UDMA_MODE_BASIC, frameBuf[frameSend],
+			(void*)(UART0_BASE + UART_O_DR), frameLen[frameSend]);
+	uDMAChannelEnable(UDMA_CHANNEL_UART0TX);
+#else
+	framePos = 0;
+#endif
+}
+
+/**
+ * Free the buffer of the frame being sent, call its callback, and move on
+ * to the other buffer.
+ */
+static void frameFinish (void) {
+	frameState[frameSend] = FRAME_FREE;
+	if (frameDone[frameSend]) {
+		frameDone[frameSend]();
+	}
+	frameSend ^= 1;
+}
+
+/**
+ * Move bytes from the transmit queue and the frames into the UART Tx FIFO
+ * in the order they were submitted, until there are none left or the
+ * FIFO is full. Starts each frame when the queue reaches it. Must be
+ * called under lockTx() or from the interrupt handler.
+ */
+static void txFill (void) {
+	unsigned int tail = txTail;
+	unsigned int limit;
+
+	for (;;) {
+		if (frameState[frameSend] == FRAME_SENDING) {
+#ifdef UART_TX_DMA
+			// The uDMA controller has the transmitter until the frame is sent
+			break;
+#else
+			while (framePos < frameLen[frameSend] &&
+					UARTSpaceAvail(UART0_BASE)) {
+				UARTCharPutNonBlocking(UART0_BASE,
+						frameBuf[frameSend][framePos++]);
+			}
+			if (framePos < frameLen[frameSend]) {
+				break;
+			}
+			frameFinish();
+#endif
+		}
+
+		limit = txHead;
+		if (frameState[frameSend] == FRAME_PENDING) {
+			limit = frameMark[frameSend];
+		}
+		while (tail != limit && UARTSpaceAvail(UART0_BASE)) {
+			UARTCharPutNonBlocking(UART0_BASE, txBuf[tail]);
+			tail = (tail + 1) & (TX_BUF_SIZE - 1);
+		}
+		if (tail != limit || frameState[frameSend] != FRAME_PENDING) {
+			break;
+		}
+		frameStart();
+	}
+	txTail = tail;
+}
 
 /**
  * Initialise UART0 with 8 bits, 1 stop bit, and no parity.
@@ -31,17 +175,209 @@ void initConsole (void) {
 			UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE);
 	UARTFIFOEnable(UART0_BASE);
 	UARTEnable(UART0_BASE);
+
+	// Interrupt when the Tx FIFO drains to 2 bytes, to refill it, and
+	// when the Rx FIFO is half full or has stopped receiving (timeout)
+	UARTFIFOLevelSet(UART0_BASE, UART_FIFO_TX2_8, UART_FIFO_RX4_8);
+	UARTIntRegister(UART0_BASE, UARTIntHandler);
+	UARTIntEnable(UART0_BASE, UART_INT_TX | UART_INT_RX | UART_INT_RT);
+
+#ifdef UART_TX_DMA
+	// Set up the uDMA channel for the UART0 transmitter: bytes from an
+	// incrementing source to the fixed data register
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+	uDMAEnable();
+	uDMAControlBaseSet(dmaControlTable);
+	uDMAChannelAttributeDisable(UDMA_CHANNEL_UART0TX, UDMA_ATTR_ALL);
+	uDMAChannelControlSet(UDMA_CHANNEL_UART0TX | UDMA_PRI_SELECT,
+			UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+	UARTDMAEnable(UART0_BASE, UART_DMA_TX);
+#endif
+}
+
+/**
+ * Recompute the UART0 baud rate divisor after the system clock has
+ * changed, keeping BAUD_RATE. The divisor registers are written directly
+ * rather than through UARTConfigSetExpClk(), which would wait for the
+ * transmit FIFO and any uDMA frame to drain. A character being sent
+ * during the change may be corrupted.
+ */
+void UARTClockChanged (void) {
+	// Divisor in 64ths, rounded (UARTConfigSetExpClk() in the driver
+	// library computes the same)
+	unsigned long div = (((SysCtlClockGet() * 8) / BAUD_RATE) + 1) / 2;
+
+	HWREG(UART0_BASE + UART_O_IBRD) = div / 64;
+	HWREG(UART0_BASE + UART_O_FBRD) = div % 64;
+	// The new divisor takes effect on a write to the line control register
+	HWREG(UART0_BASE + UART_O_LCRH) = HWREG(UART0_BASE + UART_O_LCRH);
 }
 
 /**
- * Transmit a string via UART0.
+ * Queue a string for transmission via UART0 and return without waiting
+ * for it to be sent. The queue is drained by the UART0 interrupt.
  * @param pucBuffer String of characters to send
  */
 void UARTSend (char* pucBuffer) {
-	// Loop while there are more characters to send
-	while (*pucBuffer) {
-		// Write the next character to the UART Tx FIFO
-		UARTCharPut(UART0_BASE, *pucBuffer);
-		pucBuffer++;
+	UARTSendBytes((const unsigned char*)pucBuffer, strlen(pucBuffer));
+}
+
+/**
+ * Queue a block of bytes for transmission via UART0. Like UARTSend(),
+ * but the data may contain zero bytes.
+ * @param pucBuffer Bytes to send
+ * @param ulCount Number of bytes to send
+ */
+void UARTSendBytes (const unsigned char* pucBuffer, unsigned long ulCount) {
+	unsigned int head = txHead;
+	unsigned int used, firstPart;
+
+	// One slot is kept free to tell a full queue from an empty one
+	if (ulCount > TX_BUF_SIZE - 1) {
+		txStats.dropped += ulCount;
+		return;
 	}
+	used = (head - txTail) & (TX_BUF_SIZE - 1);
+	if (ulCount > TX_BUF_SIZE - 1 - used) {
+		if (txPolicy == TX_DROP) {
+			txStats.dropped += ulCount;
+			return;
+		}
+		// Wait for the interrupt handler to make room
+		while (ulCount > TX_BUF_SIZE - 1 -
+				((head - txTail) & (TX_BUF_SIZE - 1))) {
+		}
+	}
+
+	// Copy in at most two pieces, either side of the end of the buffer
+	firstPart = TX_BUF_SIZE - head;
+	if (firstPart > ulCount) {
+		firstPart = ulCount;
+	}
+	memcpy(&txBuf[head], pucBuffer, firstPart);
+	memcpy(txBuf, pucBuffer + firstPart, ulCount - firstPart);
+	txHead = (head + ulCount) & (TX_BUF_SIZE - 1);
+
+	used = (txHead - txTail) & (TX_BUF_SIZE - 1);
+	if (used > txStats.highWater) {
+		txStats.highWater = used;
+	}
+
+	// Start transmission. The FIFO interrupt only fires when the level
+	// falls, so an idle transmitter has to be primed.
+	lockTx();
+	txFill();
+	unlockTx();
+}
+
+/**
+ * @return Bytes that can be queued by UARTSendBytes() now without any
+ * being dropped or waited for
+ */
+unsigned int UARTSendRoom (void) {
+	return TX_BUF_SIZE - 1 - ((txHead - txTail) & (TX_BUF_SIZE - 1));
+}
+
+/**
+ * Get the next free frame buffer to format a frame into. The frame is
+ * then sent with UARTSendFrame().
+ * @return A buffer of FRAME_BUF_SIZE bytes, or 0 if both buffers are
+ * waiting to be sent
+ */
+unsigned char* UARTFrameBuffer (void) {
+	if (frameState[frameFill] != FRAME_FREE) {
+		return 0;
+	}
+	return frameBuf[frameFill];
+}
+
+/**
+ * Send the buffer last returned by UARTFrameBuffer(). Frames and queued
+ * strings are sent in the order they were submitted, at message
+ * granularity. With UART_TX_DMA the uDMA controller sends the frame and
+ * the CPU does no work per byte; otherwise the UART0 interrupt puts it
+ * into the Tx FIFO from the buffer, without copying it into the queue.
+ * @param ulCount Number of bytes in the frame
+ * @param pfnDone Function called once the frame has been sent (uDMA) or
+ * put into the Tx FIFO, with the UART0 interrupt masked or from it, or 0
+ */
+void UARTSendFrame (unsigned long ulCount, frameCallback_t pfnDone) {
+	frameLen[frameFill] = ulCount;
+	frameDone[frameFill] = pfnDone;
+	frameMark[frameFill] = txHead;
+	frameState[frameFill] = FRAME_PENDING;
+	frameFill ^= 1;
+
+	// Start now if nothing else is being sent; otherwise the interrupt
+	// handler starts the frame once the transmitter is free
+	lockTx();
+	txFill();
+	unlockTx();
+}
+
+/**
+ * Get the next received character, without waiting.
+ * @return The character, or -1 if none has been received
+ */
+int UARTGetChar (void) {
+	int c;
+
+	if (rxTail == rxHead) {
+		return -1;
+	}
+	c = rxBuf[rxTail];
+	rxTail = (rxTail + 1) & (RX_BUF_SIZE - 1);
+	return c;
+}
+
+/**
+ * Handler for the UART0 interrupt. Refills the transmit FIFO from
+ * the queue and the frames, frees a frame's buffer when its uDMA transfer
+ * completes, and moves received characters into the receive queue.
+ */
+void UARTIntHandler (void) {
+	unsigned int next;
+
+	isrEnter(ISR_UART, 0);
+	UARTIntClear(UART0_BASE, UARTIntStatus(UART0_BASE, true));
+
+	// Empty the Rx FIFO into the receive queue
+	while (UARTCharsAvail(UART0_BASE)) {
+		next = (rxHead + 1) & (RX_BUF_SIZE - 1);
+		if (next == rxTail) {
+			UARTCharGetNonBlocking(UART0_BASE);
+			txStats.rxDropped++;
+		} else {
+			rxBuf[rxHead] = UARTCharGetNonBlocking(UART0_BASE);
+			rxHead = next;
+		}
+	}
+
+#ifdef UART_TX_DMA
+	// The uDMA controller disables the channel when a transfer completes
+	if (frameState[frameSend] == FRAME_SENDING &&
+			!uDMAChannelIsEnabled(UDMA_CHANNEL_UART0TX)) {
+		frameFinish();
+	}
+#endif
+
+	txFill();
+	isrExit(ISR_UART);
+}
+
+/**
+ * Choose what happens when a message does not fit in the transmit queue:
+ * TX_DROP discards the whole message, TX_BLOCK waits for space. TX_BLOCK
+ * must not be used if UARTSend() is called from an interrupt handler.
+ * @param policy Either TX_DROP or TX_BLOCK
+ */
+void setTxPolicy (int policy) {
+	txPolicy = policy;
+}
+
+/**
+ * @return The transmit and receive queue statistics
+ */
+const txStats_t* getTxStats (void) {
+	return &txStats;
 }
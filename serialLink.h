@@ -2,7 +2,7 @@
 #define SERIALLINK_H_
 
 /*
- * uart.h
+ * serialLink.h
  *
  * Serial link via UART for outputting status information.
  * Based on HeliSerialTest.c by P. J. Bones
@@ -13,7 +13,35 @@
 /*
  * Constants
  */
-#define BAUD_RATE 9600ul
+#define BAUD_RATE 115200ul
+
+// Build option: define UART_TX_DMA to send frames with the uDMA
+// controller. The LM3S1968 has no uDMA controller, so it must stay off
+// for this board; without it the UART0 interrupt sends frames from their
+// buffers.
+//#define UART_TX_DMA
+
+// Size of the transmit queue in bytes (must be a power of 2)
+#define TX_BUF_SIZE 512
+
+// Size of the receive queue in bytes (must be a power of 2)
+#define RX_BUF_SIZE 128
+
+// Size of each of the two frame buffers in bytes
+#define FRAME_BUF_SIZE 256
+
+// What UARTSend() does when a message does not fit in the queue
+enum tx_policy { TX_DROP = 0, TX_BLOCK };
+
+// Transmit queue statistics
+typedef struct {
+	unsigned long dropped; // Bytes discarded under the TX_DROP policy
+	unsigned int highWater; // Most bytes ever waiting in the queue
+	unsigned long rxDropped; // Bytes received while the Rx queue was full
+} txStats_t;
+
+// Function called from the UART0 interrupt when a frame has been sent
+typedef void (*frameCallback_t)(void);
 
 /**
  * Initialise UART0 with 8 bits, 1 stop bit, and no parity.
@@ -21,10 +49,77 @@
 void initConsole (void);
 
 /**
- * Transmit a string via UART0.
+ * Recompute the UART0 baud rate divisor after the system clock has
+ * changed, keeping BAUD_RATE.
+ */
+void UARTClockChanged (void);
+
+/**
+ * Queue a string for transmission via UART0 and return without waiting
+ * for it to be sent. The queue is drained by the UART0 interrupt.
  * @param pucBuffer String of characters to send
  */
 void UARTSend (char* pucBuffer);
 
+/**
+ * Queue a block of bytes for transmission via UART0. Like UARTSend(),
+ * but the data may contain zero bytes.
+ * @param pucBuffer Bytes to send
+ * @param ulCount Number of bytes to send
+ */
+void UARTSendBytes (const unsigned char* pucBuffer, unsigned long ulCount);
+
+/**
+ * @return Bytes that can be queued by UARTSendBytes() now without any
+ * being dropped or waited for
+ */
+unsigned int UARTSendRoom (void);
+
+/**
+ * Get the next free frame buffer to format a frame into. The frame is
+ * then sent with UARTSendFrame().
+ * @return A buffer of FRAME_BUF_SIZE bytes, or 0 if both buffers are
+ * waiting to be sent
+ */
+unsigned char* UARTFrameBuffer (void);
+
+/**
+ * Send the buffer last returned by UARTFrameBuffer(). Frames and queued
+ * strings are sent in the order they were submitted, at message
+ * granularity. With UART_TX_DMA the uDMA controller sends the frame and
+ * the CPU does no work per byte; otherwise the UART0 interrupt puts it
+ * into the Tx FIFO from the buffer, without copying it into the queue.
+ * @param ulCount Number of bytes in the frame
+ * @param pfnDone Function called once the frame has been sent (uDMA) or
+ * put into the Tx FIFO, with the UART0 interrupt masked or from it, or 0
+ */
+void UARTSendFrame (unsigned long ulCount, frameCallback_t pfnDone);
+
+/**
+ * Handler for the UART0 interrupt. Refills the transmit FIFO from
+ * the queue and the frames, frees a frame's buffer when its uDMA transfer
+ * completes, and moves received characters into the receive queue.
+ */
+void UARTIntHandler (void);
+
+/**
+ * Get the next received character, without waiting.
+ * @return The character, or -1 if none has been received
+ */
+int UARTGetChar (void);
+
+/**
+ * Choose what happens when a message does not fit in the transmit queue:
+ * TX_DROP discards the whole message, TX_BLOCK waits for space. TX_BLOCK
+ * must not be used if UARTSend() is called from an interrupt handler.
+ * @param policy Either TX_DROP or TX_BLOCK
+ */
+void setTxPolicy (int policy);
+
+/**
+ * @return The transmit and receive queue statistics
+ */
+const txStats_t* getTxStats (void);
+
 
 #endif /* SERIALLINK_H_ */
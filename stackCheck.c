@@ -0,0 +1,54 @@
+/*
+ * stackCheck.c
+ *
+ * Stack painting and high-water mark.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "stackCheck.h"
+
+/*
+ * Constants
+ */
+// Linker symbols: the bottom of the stack section and the initial stack
+// pointer. The stack grows down from __STACK_TOP towards __stack.
+extern unsigned long __stack;
+extern unsigned long __STACK_TOP;
+
+/**
+ * Fill the stack below the caller's frame with STACK_PAINT. Must be
+ * called first thing in main(), before interrupts are enabled.
+ */
+void paintStack (void) {
+	unsigned long here;
+	unsigned long* word = &__stack;
+	// Address of a local approximates the stack pointer
+	unsigned long* limit = (unsigned long*)((unsigned long)&here
+			- STACK_PAINT_MARGIN);
+
+	while (word < limit) {
+		*word++ = STACK_PAINT;
+	}
+}
+
+/**
+ * @return Most bytes of stack used since paintStack() was called
+ */
+unsigned long getStackHighWater (void) {
+	const unsigned long* word = &__stack;
+	const unsigned long* top = &__STACK_TOP;
+
+	// The stack grows down, so the lowest overwritten word is the deepest
+	while (word < top && *word == STACK_PAINT) {
+		word++;
+	}
+	return (unsigned long)top - (unsigned long)word;
+}
+
+/**
+ * @return Size of the stack in bytes
+ */
+unsigned long getStackSize (void) {
+	return (unsigned long)&__STACK_TOP - (unsigned long)&__stack;
+}
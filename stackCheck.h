@@ -0,0 +1,44 @@
+#ifndef STACKCHECK_H_
+#define STACKCHECK_H_
+
+/*
+ * stackCheck.h
+ *
+ * Stack high-water mark. The unused part of the stack is filled with a
+ * known pattern at boot; the deepest word no longer holding the pattern
+ * shows the most stack ever used, by the background loop and any
+ * interrupts nested on top of it.
+ *
+ * The stack is the .stack section, from __stack to __STACK_TOP (see
+ * lm3s1968.cmd). tools/stackDepth computes the worst case that this
+ * measurement can only approach.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+/*
+ * Constants
+ */
+// Pattern written to the unused stack
+#define STACK_PAINT 0xA5A5A5A5ul
+
+// Bytes below the caller's frame left unpainted, as room for paintStack()
+#define STACK_PAINT_MARGIN 32
+
+/**
+ * Fill the stack below the caller's frame with STACK_PAINT. Must be
+ * called first thing in main(), before interrupts are enabled.
+ */
+void paintStack (void);
+
+/**
+ * @return Most bytes of stack used since paintStack() was called
+ */
+unsigned long getStackHighWater (void);
+
+/**
+ * @return Size of the stack in bytes
+ */
+unsigned long getStackSize (void);
+
+#endif /* STACKCHECK_H_ */
@@ -0,0 +1,198 @@
+/*
+ * stripChart.c
+ *
+ * Sweeping strip charts of altitude and yaw history.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "stripChart.h"
+#include "frameBuffer.h"
+#include "format.h"
+#include "globals.h"
+
+/*
+ * Constants
+ */
+// Height of each chart, and the rows of the charts and their labels
+#define PLOT_HEIGHT 40
+#define ALT_LABEL_Y 0
+#define ALT_TOP 8
+#define YAW_LABEL_Y 48
+#define YAW_TOP 56
+
+// Row of zero yaw, and rows from there to either edge of the yaw chart
+#define YAW_MID (YAW_TOP + PLOT_HEIGHT / 2)
+#define YAW_HALF_HEIGHT (PLOT_HEIGHT / 2 - 1)
+
+// Columns blanked ahead of the newest column, marking the sweep
+#define BLANK_COLUMNS 2
+
+// Brightness of the measured value, the setpoint, the zero line and the
+// labels
+#define MEASURED_LEVEL 15
+#define SETPOINT_LEVEL 6
+#define AXIS_LEVEL 2
+#define LABEL_LEVEL 10
+
+// Label buffer size: room for a line of text and a formatted number
+#define LABEL_BUF_SIZE 32
+
+// One column of the chart, averaged over CHART_DECIMATION samples
+typedef struct {
+	short altitude; // Percent
+	short desiredAltitude; // Percent
+	short yaw; // Degrees
+	short desiredYaw; // Degrees
+} column_t;
+
+/*
+ * Static variables (shared within this file)
+ */
+
+static column_t ring[CHART_COLUMNS];
+
+// Columns completed and columns drawn since reset. Column n is held in
+// ring[n % CHART_COLUMNS] and drawn at x = n % CHART_COLUMNS.
+static unsigned long completed = 0;
+static unsigned long drawn = 0;
+
+// Sums of the samples for the column being built
+static long altitudeSum = 0;
+static long desiredAltitudeSum = 0;
+static long yawSum = 0;
+static long desiredYawSum = 0;
+static int samples = 0;
+
+/**
+ * @param altitude Altitude in percent
+ * @return Row of the altitude on the altitude chart
+ */
+static unsigned int altitudeRow (int altitude) {
+	if (altitude < 0) {
+		altitude = 0;
+	} else if (altitude > 100) {
+		altitude = 100;
+	}
+	return ALT_TOP + (PLOT_HEIGHT - 1) - altitude * (PLOT_HEIGHT - 1) / 100;
+}
+
+/**
+ * @param yaw Yaw in degrees
+ * @return Row of the yaw on the yaw chart
+ */
+static unsigned int yawRow (int yaw) {
+	if (yaw < -CHART_YAW_RANGE) {
+		yaw = -CHART_YAW_RANGE;
+	} else if (yaw > CHART_YAW_RANGE) {
+		yaw = CHART_YAW_RANGE;
+	}
+	return YAW_MID - yaw * YAW_HALF_HEIGHT / CHART_YAW_RANGE;
+}
+
+/**
+ * Draw a vertical line joining two rows, so that a fast change is shown
+ * as a line rather than two separate points.
+ * @param x Column
+ * @param from First row
+ * @param to Last row
+ */
+static void drawSpan (unsigned int x, unsigned int from, unsigned int to) {
+	if (from > to) {
+		fbFillRect(x, to, 1, from - to + 1, MEASURED_LEVEL);
+	} else {
+		fbFillRect(x, from, 1, to - from + 1, MEASURED_LEVEL);
+	}
+}
+
+/**
+ * Draw one column of both charts, and blank the columns ahead of it.
+ * @param n Number of the column since reset
+ */
+static void drawColumn (unsigned long n) {
+	const column_t* column = &ring[n % CHART_COLUMNS];
+	const column_t* previous = (n > 0) ? &ring[(n - 1) % CHART_COLUMNS] : column;
+	unsigned int x = n % CHART_COLUMNS;
+	int i;
+
+	fbFillRect(x, ALT_TOP, 1, PLOT_HEIGHT, 0);
+	fbSetPixel(x, altitudeRow(column->desiredAltitude), SETPOINT_LEVEL);
+	drawSpan(x, altitudeRow(previous->altitude), altitudeRow(column->altitude));
+
+	fbFillRect(x, YAW_TOP, 1, PLOT_HEIGHT, 0);
+	fbSetPixel(x, YAW_MID, AXIS_LEVEL);
+	fbSetPixel(x, yawRow(column->desiredYaw), SETPOINT_LEVEL);
+	drawSpan(x, yawRow(previous->yaw), yawRow(column->yaw));
+
+	for (i = 1; i <= BLANK_COLUMNS; i++) {
+		x = (n + i) % CHART_COLUMNS;
+		fbFillRect(x, ALT_TOP, 1, PLOT_HEIGHT, 0);
+		fbFillRect(x, YAW_TOP, 1, PLOT_HEIGHT, 0);
+	}
+}
+
+/**
+ * Add a sample of the current altitude, yaw and setpoints. Called every
+ * CHART_SAMPLE_MS milliseconds from the background loop.
+ * @return 1 if a new column was completed, otherwise 0
+ */
+int chartSample (void) {
+	column_t* column;
+	heliSnapshot_t now;
+
+	getSnapshot(&now);
+	altitudeSum += now.avgAltitude;
+	desiredAltitudeSum += now.desiredAltitude;
+	yawSum += now.yaw100;
+	desiredYawSum += now.desiredYaw100;
+	if (++samples < CHART_DECIMATION) {
+		return 0;
+	}
+
+	column = &ring[completed % CHART_COLUMNS];
+	column->altitude = altitudeSum / CHART_DECIMATION;
+	column->desiredAltitude = desiredAltitudeSum / CHART_DECIMATION;
+	column->yaw = yawSum / (CHART_DECIMATION * 100);
+	column->desiredYaw = desiredYawSum / (CHART_DECIMATION * 100);
+	completed++;
+
+	altitudeSum = 0;
+	desiredAltitudeSum = 0;
+	yawSum = 0;
+	desiredYawSum = 0;
+	samples = 0;
+	return 1;
+}
+
+/**
+ * Draw the columns completed since the last call into the frame buffer.
+ * Called after chartSample() while the chart page is shown.
+ */
+void chartDrawNew (void) {
+	while (drawn < completed) {
+		drawColumn(drawn);
+		drawn++;
+	}
+}
+
+/**
+ * Draw the labels and every column in the ring into the frame buffer.
+ * Called when the chart page is shown, after the frame buffer is cleared.
+ */
+void chartRedraw (void) {
+	char label[LABEL_BUF_SIZE];
+	unsigned int len;
+
+	len = fmtStr(label, 0, "Altitude, last ");
+	len = fmtFixed(label, len, CHART_COLUMNS * CHART_COLUMN_MS / 100, 1);
+	len = fmtStr(label, len, " s");
+	fbDrawString(label, 0, ALT_LABEL_Y, LABEL_LEVEL);
+
+	len = fmtStr(label, 0, "Yaw, +/-");
+	len = fmtInt(label, len, CHART_YAW_RANGE);
+	len = fmtStr(label, len, " deg");
+	fbDrawString(label, 0, YAW_LABEL_Y, LABEL_LEVEL);
+
+	drawn = (completed > CHART_COLUMNS) ? completed - CHART_COLUMNS : 0;
+	chartDrawNew();
+}
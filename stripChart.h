@@ -0,0 +1,53 @@
+#ifndef STRIPCHART_H_
+#define STRIPCHART_H_
+
+/*
+ * stripChart.h
+ *
+ * Strip charts of altitude and yaw against their setpoints over the last
+ * CHART_COLUMNS * CHART_COLUMN_MS milliseconds, drawn into the frame
+ * buffer on the chart page of the display.
+ *
+ * Samples are averaged in groups of CHART_DECIMATION into a ring with one
+ * entry per chart column. The chart is a sweep: each new column is drawn
+ * over the oldest one and the columns just ahead of it are blanked, so a
+ * new sample changes only a few pixel columns instead of moving the whole
+ * chart.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+/*
+ * Constants
+ */
+// Columns in the chart, one per entry of the ring
+#define CHART_COLUMNS 128
+
+// Samples averaged into each column, and time between samples
+#define CHART_DECIMATION 10
+#define CHART_SAMPLE_MS 10
+#define CHART_COLUMN_MS (CHART_DECIMATION * CHART_SAMPLE_MS)
+
+// Yaw shown at the top and bottom edges of the yaw chart, in degrees
+#define CHART_YAW_RANGE 360
+
+/**
+ * Add a sample of the current altitude, yaw and setpoints. Called every
+ * CHART_SAMPLE_MS milliseconds from the background loop.
+ * @return 1 if a new column was completed, otherwise 0
+ */
+int chartSample (void);
+
+/**
+ * Draw the columns completed since the last call into the frame buffer.
+ * Called after chartSample() while the chart page is shown.
+ */
+void chartDrawNew (void);
+
+/**
+ * Draw the labels and every column in the ring into the frame buffer.
+ * Called when the chart page is shown, after the frame buffer is cleared.
+ */
+void chartRedraw (void);
+
+#endif /* STRIPCHART_H_ */
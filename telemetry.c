@@ -0,0 +1,401 @@
+/*
+ * telemetry.c
+ *
+ * Compact binary telemetry sent via UART0, framed with COBS and a CRC-16.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "globals.h"
+#include "telemetry.h"
+#include "motorControl.h"
+#include "autoTune.h"
+#include "serialLink.h"
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+
+#include "driverlib/pwm.h"
+
+#include "string.h"
+
+/*
+ * Constants
+ */
+#define STATUS_PAYLOAD_LEN 24
+// Largest status payload plus CRC
+#define MAX_RAW_LEN 64
+// Largest text payload plus CRC
+#define MAX_TEXT_RAW_LEN (TELEM_MAX_TEXT_LEN + 4)
+// Bytes a text frame adds to its text: the header and CRC, the COBS code
+// byte and the delimiter
+#define TEXT_FRAME_OVERHEAD 6
+// Largest channel payload plus CRC
+#define MAX_CHANNEL_RAW_LEN (10 + 4 * TELEM_MAX_CHANNELS + 2)
+
+/*
+ * Static variables (shared within this file)
+ */
+
+static int telemetryMode = TELEMETRY_DEFAULT_MODE;
+
+// Send a status frame every frameDivider calls to telemetryTick(), or
+// never if it is 0
+static unsigned int frameDivider = TELEMETRY_MAX_RATE_HZ /
+		TELEMETRY_DEFAULT_RATE_HZ;
+static unsigned int tickCount = 0;
+
+// Flags carried into the next frame
+static unsigned char pendingFlags = 0;
+static unsigned long lastDropped = 0;
+
+// Text frame payload and encoded frame, kept off the stack. Text frames
+// are queued rather than sent from a frame buffer, so that a burst of
+// replies is not lost while both frame buffers are busy.
+static unsigned char textRaw[MAX_TEXT_RAW_LEN];
+static unsigned char textFrame[MAX_TEXT_RAW_LEN + 2];
+
+// Channel registry. A subscribed channel is sampled every
+// channelDivider calls to telemetryTick(); 0 means unsubscribed.
+typedef struct {
+	const char* name;
+	channelGetter_t getter;
+	unsigned int divider;
+	unsigned int count;
+} channel_t;
+
+static channel_t channels[TELEM_MAX_CHANNELS];
+static int numChannels = 0;
+static unsigned char channelRaw[MAX_CHANNEL_RAW_LEN];
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021), four bits at a time
+static const unsigned short crcTable[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/**
+ * Compute the CRC-16/CCITT-FALSE of a block of bytes.
+ */
+static unsigned short crc16 (const unsigned char* data, unsigned int len) {
+	unsigned short crc = 0xFFFF;
+
+	while (len--) {
+		crc = (crc << 4) ^ crcTable[(crc >> 12) ^ (*data >> 4)];
+		crc = (crc << 4) ^ crcTable[(crc >> 12) ^ (*data & 0x0F)];
+		data++;
+	}
+	return crc;
+}
+
+/**
+ * COBS-encode a block of bytes and append the zero delimiter.
+ * @param in Bytes to encode
+ * @param len Number of bytes to encode
+ * @param out Output buffer, at least len + len / 254 + 2 bytes
+ * @return Number of bytes written to out
+ */
+static unsigned int cobsEncode (const unsigned char* in, unsigned int len,
+		unsigned char* out) {
+	unsigned int codeIndex = 0;
+	unsigned int outIndex = 1;
+	unsigned char code = 1;
+
+	while (len--) {
+		if (*in != 0) {
+			out[outIndex++] = *in;
+			code++;
+		}
+		if (*in == 0 || code == 0xFF) {
+			out[codeIndex] = code;
+			codeIndex = outIndex++;
+			code = 1;
+		}
+		in++;
+	}
+	out[codeIndex] = code;
+	out[outIndex++] = 0;
+	return outIndex;
+}
+
+/**
+ * Store a 16-bit value little-endian.
+ */
+static unsigned char* put16 (unsigned char* p, unsigned int value) {
+	p[0] = value & 0xFF;
+	p[1] = (value >> 8) & 0xFF;
+	return p + 2;
+}
+
+/**
+ * Store a 32-bit value little-endian.
+ */
+static unsigned char* put32 (unsigned char* p, unsigned long value) {
+	p = put16(p, value & 0xFFFF);
+	return put16(p, value >> 16);
+}
+
+/**
+ * Append the CRC to a payload, encode it into a frame buffer and send it.
+ * @param raw Payload, with room for two more bytes
+ * @param len Length of the payload
+ */
+static void sendFrame (unsigned char* raw, unsigned int len) {
+	unsigned char* frame = UARTFrameBuffer();
+
+	if (frame == 0) {
+		pendingFlags |= TELEM_FLAG_SKIPPED;
+		return;
+	}
+	put16(raw + len, crc16(raw, len));
+	UARTSendFrame(cobsEncode(raw, len + 2, frame), 0);
+}
+
+/**
+ * Build and send a status frame.
+ */
+static void sendStatusFrame (unsigned long timeMs) {
+	unsigned char raw[MAX_RAW_LEN];
+	unsigned char* p = raw;
+	unsigned long dropped = getTxStats()->dropped;
+	heliSnapshot_t now;
+
+	if (dropped != lastDropped) {
+		pendingFlags |= TELEM_FLAG_TX_DROPPED;
+		lastDropped = dropped;
+	}
+	if (autoTuneAxis() != TUNE_NONE) {
+		pendingFlags |= TELEM_FLAG_TUNING;
+	}
+
+	getSnapshot(&now);
+	*p++ = TELEMETRY_VERSION;
+	*p++ = TELEM_STATUS;
+	p = put32(p, timeMs);
+	p = put32(p, now.yaw100);
+	p = put32(p, now.desiredYaw100);
+	p = put16(p, now.avgAltitude);
+	p = put16(p, now.desiredAltitude);
+	p = put16(p, getDutyCycle100(MAIN_ROTOR));
+	p = put16(p, getDutyCycle100(TAIL_ROTOR));
+	*p++ = now.heliState;
+	*p++ = pendingFlags;
+	pendingFlags = 0;
+
+	sendFrame(raw, p - raw);
+}
+
+/**
+ * Set the telemetry output format.
+ * @param mode Either TELEMETRY_TEXT or TELEMETRY_BINARY
+ */
+void setTelemetryMode (int mode) {
+	telemetryMode = mode;
+}
+
+/**
+ * @return The telemetry output format
+ */
+int getTelemetryMode (void) {
+	return telemetryMode;
+}
+
+/**
+ * Convert a rate to a number of calls to telemetryTick() between samples.
+ * @param rateHz Samples per second, or 0 for none
+ * @return The divider, or 0 for none
+ */
+static unsigned int rateToDivider (unsigned int rateHz) {
+	if (rateHz == 0) {
+		return 0;
+	}
+	if (rateHz > TELEMETRY_MAX_RATE_HZ) {
+		rateHz = TELEMETRY_MAX_RATE_HZ;
+	}
+	return TELEMETRY_MAX_RATE_HZ / rateHz;
+}
+
+/**
+ * Set the status frame rate. The rate is rounded to a whole divisor of
+ * TELEMETRY_MAX_RATE_HZ.
+ * @param rateHz Frames per second, up to TELEMETRY_MAX_RATE_HZ, or 0 to
+ * stop sending status frames
+ */
+void setTelemetryRate (unsigned int rateHz) {
+	frameDivider = rateToDivider(rateHz);
+	tickCount = 0;
+}
+
+/**
+ * Register a telemetry channel. Channels start unsubscribed.
+ * @param name Short name of the channel, without spaces. Must remain valid.
+ * @param getter Function that reads the channel's value
+ * @return The channel number, or -1 if TELEM_MAX_CHANNELS are registered
+ */
+int addTelemetryChannel (const char* name, channelGetter_t getter) {
+	if (numChannels == TELEM_MAX_CHANNELS) {
+		return -1;
+	}
+	channels[numChannels].name = name;
+	channels[numChannels].getter = getter;
+	channels[numChannels].divider = 0;
+	channels[numChannels].count = 0;
+	return numChannels++;
+}
+
+/**
+ * @return Number of registered channels
+ */
+int getTelemetryChannelCount (void) {
+	return numChannels;
+}
+
+/**
+ * @param channel Channel number
+ * @return Name of the channel
+ */
+const char* getTelemetryChannelName (int channel) {
+	return channels[channel].name;
+}
+
+/**
+ * Find a channel by name.
+ * @param name Name of the channel
+ * @return The channel number, or -1 if there is no such channel
+ */
+int findTelemetryChannel (const char* name) {
+	int i;
+
+	for (i = 0; i < numChannels; i++) {
+		if (strcmp(channels[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Subscribe to a channel, or change its rate. The rate is rounded to a
+ * whole divisor of TELEMETRY_MAX_RATE_HZ.
+ * @param channel Channel number
+ * @param rateHz Samples per second, up to TELEMETRY_MAX_RATE_HZ, or 0 to
+ * unsubscribe
+ */
+void subscribeTelemetryChannel (int channel, unsigned int rateHz) {
+	channels[channel].divider = rateToDivider(rateHz);
+	// Sample at the next tick, then at the new rate
+	channels[channel].count = channels[channel].divider;
+}
+
+/**
+ * @param channel Channel number
+ * @return The rate the channel is subscribed at, or 0 if it is not
+ */
+unsigned int getTelemetryChannelRate (int channel) {
+	if (channels[channel].divider == 0) {
+		return 0;
+	}
+	return TELEMETRY_MAX_RATE_HZ / channels[channel].divider;
+}
+
+/**
+ * Sample the channels that are due at this tick and send them in a
+ * channel frame. Nothing is sent if no channel is due.
+ * @param timeMs Time since reset in milliseconds
+ */
+static void sendChannelFrame (unsigned long timeMs) {
+	unsigned char* p = channelRaw + 10;
+	unsigned long mask = 0;
+	int i;
+
+	for (i = 0; i < numChannels; i++) {
+		if (channels[i].divider == 0) {
+			continue;
+		}
+		if (++channels[i].count >= channels[i].divider) {
+			channels[i].count = 0;
+			mask |= 1ul << i;
+			p = put32(p, channels[i].getter());
+		}
+	}
+	if (mask == 0) {
+		return;
+	}
+
+	channelRaw[0] = TELEMETRY_VERSION;
+	channelRaw[1] = TELEM_CHANNELS;
+	put32(channelRaw + 2, timeMs);
+	put32(channelRaw + 6, mask);
+	sendFrame(channelRaw, p - channelRaw);
+}
+
+/**
+ * Send a frame built by another module.
+ * @param raw Payload, starting with the version and type, with room for
+ * two more bytes
+ * @param len Length of the payload
+ * @return 1 if the frame was sent, or 0 if no frame buffer was free
+ */
+int sendTelemetryFrame (unsigned char* raw, unsigned int len) {
+	if (UARTFrameBuffer() == 0) {
+		return 0;
+	}
+	sendFrame(raw, len);
+	return 1;
+}
+
+/**
+ * Send text, such as a command reply, in the current format: as plain
+ * characters in text mode, or as text frames in binary mode so that the
+ * frame stream stays decodable.
+ * @param text Characters to send
+ * @param len Number of characters
+ */
+void telemetryText (const char* text, unsigned int len) {
+	unsigned int chunk;
+
+	if (telemetryMode != TELEMETRY_BINARY) {
+		UARTSendBytes((const unsigned char*)text, len);
+		return;
+	}
+	while (len > 0) {
+		chunk = (len > TELEM_MAX_TEXT_LEN) ? TELEM_MAX_TEXT_LEN : len;
+		textRaw[0] = TELEMETRY_VERSION;
+		textRaw[1] = TELEM_TEXT;
+		memcpy(textRaw + 2, text, chunk);
+		put16(textRaw + chunk + 2, crc16(textRaw, chunk + 2));
+		UARTSendBytes(textFrame, cobsEncode(textRaw, chunk + 4, textFrame));
+		text += chunk;
+		len -= chunk;
+	}
+}
+
+/**
+ * @param len Number of characters
+ * @return 1 if telemetryText() can queue that many characters now without
+ * any being dropped, otherwise 0
+ */
+int telemetryTextFits (unsigned int len) {
+	unsigned int frames = (len + TELEM_MAX_TEXT_LEN - 1) / TELEM_MAX_TEXT_LEN;
+
+	if (telemetryMode == TELEMETRY_BINARY) {
+		len += frames * TEXT_FRAME_OVERHEAD;
+	}
+	return len <= UARTSendRoom();
+}
+
+/**
+ * Called at TELEMETRY_MAX_RATE_HZ. In binary mode, sends a status frame
+ * when one is due and a channel frame when any subscribed channel is due.
+ * @param timeMs Time since reset in milliseconds
+ */
+void telemetryTick (unsigned long timeMs) {
+	if (telemetryMode != TELEMETRY_BINARY) {
+		return;
+	}
+	if (frameDivider != 0 && ++tickCount >= frameDivider) {
+		tickCount = 0;
+		sendStatusFrame(timeMs);
+	}
+	sendChannelFrame(timeMs);
+}
@@ -0,0 +1,167 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+/*
+ * telemetry.h
+ *
+ * Compact binary telemetry sent via UART0. Each frame is a little-endian
+ * payload followed by a CRC-16, encoded with COBS (Consistent Overhead
+ * Byte Stuffing) and terminated by a zero byte, so a receiver can always
+ * resynchronise on the next zero. tools/telemetryDecoder.cpp decodes the
+ * stream on the host.
+ *
+ * Status frame payload (24 bytes):
+ *  u8  version        u8  type (TELEM_STATUS)
+ *  u32 time (ms)
+ *  i32 yaw100         i32 desired yaw100
+ *  i16 altitude       i16 desired altitude (percent)
+ *  u16 main duty100   u16 tail duty100
+ *  u8  heli state     u8  flags (TELEM_FLAG_*)
+ *
+ * Text frame payload (up to TELEM_MAX_TEXT_LEN + 2 bytes):
+ *  u8  version        u8  type (TELEM_TEXT)
+ *  ASCII text, not terminated
+ *
+ * Channel frame payload (10 to 10 + 4 * TELEM_MAX_CHANNELS bytes):
+ *  u8  version        u8  type (TELEM_CHANNELS)
+ *  u32 time (ms)
+ *  u32 mask: bit n set if channel n is included (u16 in version 1)
+ *  i32 value of each included channel, lowest channel number first
+ *
+ * Channels are registered by the firmware with addTelemetryChannel() and
+ * numbered in the order they are registered. Each channel is subscribed
+ * at its own rate, and a channel frame carries only the channels that
+ * are due at that tick, so the link and CPU load follow what is watched.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+/*
+ * Constants
+ */
+#define TELEMETRY_VERSION 2
+
+// Rate at which telemetryTick() must be called, and the highest frame rate
+#define TELEMETRY_MAX_RATE_HZ 200
+#define TELEMETRY_DEFAULT_RATE_HZ 50
+
+// Frame types
+#define TELEM_STATUS 1
+#define TELEM_TEXT 2
+#define TELEM_CHANNELS 3
+#define TELEM_BLACKBOX 4 // See blackBox.h
+#define TELEM_FLIGHTLOG 5 // See flightLog.h
+
+// Longest text carried by one text frame. Longer text is split.
+#define TELEM_MAX_TEXT_LEN 120
+
+// Most channels that can be registered, one per bit of the mask
+#define TELEM_MAX_CHANNELS 32
+
+// Status frame flags
+#define TELEM_FLAG_TUNING 0x01 // Auto-tune is running
+#define TELEM_FLAG_TX_DROPPED 0x02 // UART bytes dropped since the last frame
+#define TELEM_FLAG_SKIPPED 0x04 // A frame was skipped: no free frame buffer
+
+// Telemetry output format
+enum telemetry_mode { TELEMETRY_TEXT = 0, TELEMETRY_BINARY };
+
+// Mode at reset. TELEMETRY_TEXT falls back to the periodic text status.
+#define TELEMETRY_DEFAULT_MODE TELEMETRY_BINARY
+
+// Function that reads the current value of a channel
+typedef long (*channelGetter_t)(void);
+
+/**
+ * Set the telemetry output format.
+ * @param mode Either TELEMETRY_TEXT or TELEMETRY_BINARY
+ */
+void setTelemetryMode (int mode);
+
+/**
+ * @return The telemetry output format
+ */
+int getTelemetryMode (void);
+
+/**
+ * Set the status frame rate. The rate is rounded to a whole divisor of
+ * TELEMETRY_MAX_RATE_HZ.
+ * @param rateHz Frames per second, up to TELEMETRY_MAX_RATE_HZ, or 0 to
+ * stop sending status frames
+ */
+void setTelemetryRate (unsigned int rateHz);
+
+/**
+ * Register a telemetry channel. Channels start unsubscribed.
+ * @param name Short name of the channel, without spaces. Must remain valid.
+ * @param getter Function that reads the channel's value
+ * @return The channel number, or -1 if TELEM_MAX_CHANNELS are registered
+ */
+int addTelemetryChannel (const char* name, channelGetter_t getter);
+
+/**
+ * @return Number of registered channels
+ */
+int getTelemetryChannelCount (void);
+
+/**
+ * @param channel Channel number
+ * @return Name of the channel
+ */
+const char* getTelemetryChannelName (int channel);
+
+/**
+ * Find a channel by name.
+ * @param name Name of the channel
+ * @return The channel number, or -1 if there is no such channel
+ */
+int findTelemetryChannel (const char* name);
+
+/**
+ * Subscribe to a channel, or change its rate. The rate is rounded to a
+ * whole divisor of TELEMETRY_MAX_RATE_HZ.
+ * @param channel Channel number
+ * @param rateHz Samples per second, up to TELEMETRY_MAX_RATE_HZ, or 0 to
+ * unsubscribe
+ */
+void subscribeTelemetryChannel (int channel, unsigned int rateHz);
+
+/**
+ * @param channel Channel number
+ * @return The rate the channel is subscribed at, or 0 if it is not
+ */
+unsigned int getTelemetryChannelRate (int channel);
+
+/**
+ * Send a frame built by another module.
+ * @param raw Payload, starting with the version and type, with room for
+ * two more bytes
+ * @param len Length of the payload
+ * @return 1 if the frame was sent, or 0 if no frame buffer was free
+ */
+int sendTelemetryFrame (unsigned char* raw, unsigned int len);
+
+/**
+ * Send text, such as a command reply, in the current format: as plain
+ * characters in text mode, or as text frames in binary mode so that the
+ * frame stream stays decodable.
+ * @param text Characters to send
+ * @param len Number of characters
+ */
+void telemetryText (const char* text, unsigned int len);
+
+/**
+ * @param len Number of characters
+ * @return 1 if telemetryText() can queue that many characters now without
+ * any being dropped, otherwise 0
+ */
+int telemetryTextFits (unsigned int len);
+
+/**
+ * Called at TELEMETRY_MAX_RATE_HZ. In binary mode, sends a status frame
+ * when one is due and a channel frame when any subscribed channel is due.
+ * @param timeMs Time since reset in milliseconds
+ */
+void telemetryTick (unsigned long timeMs);
+
+#endif /* TELEMETRY_H_ */
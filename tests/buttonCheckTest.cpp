@@ -0,0 +1,221 @@
+/*
+ * buttonCheckTest.cpp
+ *
+ * Unit test of the button actions (buttonCheck.c). Button events are fed
+ * to checkButtons() from a stub event queue, and the flight mode, the
+ * control requests and the display pages are stubs that record what was
+ * asked of them. A tap or hold of UP or DOWN must step or ramp the
+ * desired altitude, but not while UP or DOWN is held as a modifier of
+ * another button: UP with LEFT or RIGHT to change the display page, and
+ * UP or DOWN with SELECT to auto-tune.
+ *
+ * Usage: buttonCheckTest
+ *  Each failed check is printed, and the exit status is 1 if any failed.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+extern "C" {
+#include "buttonCheck.h"
+#include "buttonSet.h"
+#include "globals.h"
+#include "motorControl.h"
+#include "flightMode.h"
+#include "autoTune.h"
+}
+
+#include <cstdio>
+#include <deque>
+
+namespace {
+
+// Stub event queue, and the buttons held
+std::deque<butEvent_t> events;
+bool held[NUM_BUTTONS];
+
+// What the buttons asked for
+int flying = 1;
+int lastRequest = CTRL_REQ_NONE;
+int pageSteps = 0;
+
+int failures = 0;
+
+void fail(const char* what, long value) {
+	std::fprintf(stderr, "buttonCheckTest: %s (%ld)\n", what, value);
+	failures++;
+}
+
+/**
+ * Queue an event and handle it, tracking which buttons are held.
+ */
+void event(int button, int type) {
+	butEvent_t e = {};
+
+	e.button = static_cast<unsigned char>(button);
+	e.type = static_cast<unsigned char>(type);
+	if (type == BUT_EV_PRESS) {
+		held[button] = true;
+	} else if (type == BUT_EV_RELEASE) {
+		held[button] = false;
+	}
+	events.push_back(e);
+	checkButtons();
+}
+
+/**
+ * Press and hold a button for a long press followed by some repeats.
+ */
+void hold(int button, int repeats) {
+	event(button, BUT_EV_PRESS);
+	event(button, BUT_EV_LONG);
+	for (int i = 0; i < repeats; i++) {
+		event(button, BUT_EV_REPEAT);
+	}
+}
+
+/**
+ * Check the desired altitude and page steps against those expected, and
+ * start the next case from hovering at 50%.
+ */
+void expect(const char* name, int altitude, int pages, int request) {
+	if (_desiredAltitude != altitude) {
+		std::fprintf(stderr, "buttonCheckTest: %s: desired altitude %d, "
+				"expected %d\n", name, _desiredAltitude, altitude);
+		failures++;
+	}
+	if (pageSteps != pages) {
+		std::fprintf(stderr, "buttonCheckTest: %s: %d page steps, expected "
+				"%d\n", name, pageSteps, pages);
+		failures++;
+	}
+	if (lastRequest != request) {
+		std::fprintf(stderr, "buttonCheckTest: %s: request %d, expected %d\n",
+				name, lastRequest, request);
+		failures++;
+	}
+	for (int b = 0; b < NUM_BUTTONS; b++) {
+		if (held[b]) {
+			fail("button left held, button", b);
+		}
+	}
+	_desiredAltitude = 50;
+	_desiredYaw100 = 0;
+	pageSteps = 0;
+	lastRequest = CTRL_REQ_NONE;
+	flying = 1;
+}
+
+} // namespace
+
+// Stubs of the button set, the flight mode, the controllers, auto-tuning,
+// the display and SysCtl
+extern "C" {
+int getButEvent(butEvent_t* event) {
+	if (events.empty()) {
+		return 0;
+	}
+	*event = events.front();
+	events.pop_front();
+	return 1;
+}
+
+unsigned int isButHeld(unsigned int button) {
+	return button < NUM_BUTTONS && held[button];
+}
+
+void initButSet(unsigned char, unsigned long, unsigned int) {
+}
+
+void enableButInts(void) {
+}
+
+int flightModeRuns(int tasks) {
+	return (tasks & FM_TASK_SETPOINTS) ? flying : 0;
+}
+
+void flightModeEvent(int) {
+}
+
+void requestControl(int request) {
+	lastRequest = request;
+}
+
+int autoTuneAxis(void) {
+	return TUNE_NONE;
+}
+
+void changeDisplayPage(int step) {
+	pageSteps += step;
+}
+
+void SysCtlPeripheralReset(unsigned long) {
+}
+
+void SysCtlPeripheralEnable(unsigned long) {
+}
+
+void SysCtlReset(void) {
+	fail("reset", 0);
+}
+}
+
+int main() {
+	_heliState = HELI_ON;
+	_desiredAltitude = 50;
+
+	// A tap steps on release, a hold steps then ramps each repeat
+	event(UP, BUT_EV_PRESS);
+	event(UP, BUT_EV_RELEASE);
+	expect("UP tap", 50 + ALTITUDE_STEP, 0, CTRL_REQ_NONE);
+	hold(DOWN, 3);
+	event(DOWN, BUT_EV_RELEASE);
+	expect("DOWN hold", 50 - ALTITUDE_STEP - 3 * ALTITUDE_RAMP_STEP, 0,
+			CTRL_REQ_NONE);
+
+	// Not flying, no altitude change
+	flying = 0;
+	event(UP, BUT_EV_PRESS);
+	event(UP, BUT_EV_RELEASE);
+	expect("UP tap while not flying", 50, 0, CTRL_REQ_NONE);
+
+	// UP with RIGHT or LEFT changes the page only, however long UP is held
+	event(UP, BUT_EV_PRESS);
+	event(RIGHT, BUT_EV_PRESS);
+	event(RIGHT, BUT_EV_RELEASE);
+	event(UP, BUT_EV_RELEASE);
+	expect("UP+RIGHT tap", 50, 1, CTRL_REQ_NONE);
+	hold(UP, 0);
+	event(LEFT, BUT_EV_PRESS);
+	event(LEFT, BUT_EV_RELEASE);
+	for (int i = 0; i < 5; i++) {
+		event(UP, BUT_EV_REPEAT);
+	}
+	event(UP, BUT_EV_RELEASE);
+	expect("UP+LEFT held", 50, -1, CTRL_REQ_NONE);
+
+	// UP or DOWN with SELECT tunes, without an altitude change
+	event(UP, BUT_EV_PRESS);
+	event(SELECT, BUT_EV_PRESS);
+	event(SELECT, BUT_EV_RELEASE);
+	event(UP, BUT_EV_RELEASE);
+	expect("UP+SELECT", 50, 0, CTRL_REQ_TUNE);
+	hold(DOWN, 2);
+	event(SELECT, BUT_EV_PRESS);
+	event(DOWN, BUT_EV_REPEAT);
+	event(SELECT, BUT_EV_RELEASE);
+	event(DOWN, BUT_EV_RELEASE);
+	expect("DOWN held then SELECT", 50 - ALTITUDE_STEP - 2 * ALTITUDE_RAMP_STEP,
+			0, CTRL_REQ_TUNE_SAVE);
+
+	// A modifier used once does not hold back the next press
+	event(UP, BUT_EV_PRESS);
+	event(SELECT, BUT_EV_PRESS);
+	event(SELECT, BUT_EV_RELEASE);
+	event(UP, BUT_EV_RELEASE);
+	event(UP, BUT_EV_PRESS);
+	event(UP, BUT_EV_RELEASE);
+	expect("UP tap after UP+SELECT", 50 + ALTITUDE_STEP, 0, CTRL_REQ_TUNE);
+
+	std::printf("button actions: %s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,431 @@
+/*
+ * buttonTest.cpp
+ *
+ * Unit test of the button debouncer (button.c). Random press and release
+ * waveforms, clean and with bounce at every edge, are replayed through
+ * updateButtons() on a stub GPIO port, and through a model of the
+ * per-button state machine it replaced. Every press and release must be
+ * seen by both. On clean edges they must take it at the same tick. With
+ * bounce the vertical counters may take it later, because they count only
+ * consecutive samples, but by no more than the bounce. Short glitches,
+ * which the old state machine added up until they made a press or a
+ * release, must never make one.
+ * Scripted presses on the virtual buttons, whose timing is exact, must
+ * queue the press, release, long-press and repeat events of every
+ * button, simultaneous presses included, at the right times.
+ *
+ * Usage: buttonTest
+ *  Each failed check is printed, and the exit status is 1 if any failed.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+extern "C" {
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/gpio.h"
+#include "globals.h"
+#include "buttonSet.h"
+#include "intPriority.h"
+}
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+extern "C" const unsigned char BUTTON_PINS_B[];
+extern "C" const unsigned char BUTTON_PINS_G[];
+
+namespace {
+
+const unsigned int TICKS_PER_MS = SYSTICK_RATE_HZ / 1000;
+
+// Length of each waveform, and of the bounce at each of its edges, in ms
+const unsigned int WAVEFORM_MS = 20000;
+const unsigned int BOUNCE_MS = 3;
+
+int failures = 0;
+
+void fail(const char* what, int button, long value) {
+	std::fprintf(stderr, "buttonTest: %s, button %d (%ld)\n", what, button,
+			value);
+	failures++;
+}
+
+// Pins of the stub port that read low, i.e. whose button is pressed
+unsigned char pressedPins = 0;
+
+/**
+ * The per-button state machine updateButtons() used before the vertical
+ * counters, for one button whose presses are taken as soon as they are
+ * seen. Its counter only restarts when the state changes.
+ */
+class OldButton {
+public:
+	OldButton(unsigned int detect, unsigned int holdoff)
+			: detect_(detect), holdoff_(holdoff), in_(false), count_(0) {}
+
+	/**
+	 * @param pressed The pin's level at this tick
+	 * @return true if the button's state changed
+	 */
+	bool update(bool pressed) {
+		if (in_ != pressed) {
+			if (count_ >= (in_ ? holdoff_ : detect_)) {
+				in_ = pressed;
+				count_ = 0;
+				return true;
+			}
+			count_++;
+		}
+		return false;
+	}
+
+private:
+	unsigned int detect_;
+	unsigned int holdoff_;
+	bool in_;
+	unsigned int count_;
+};
+
+/**
+ * Make a random waveform for each button: presses of 20 to 300 ms
+ * separated by 150 to 400 ms, long enough for the release holdoff.
+ * @param bounce If true, each edge is followed by BOUNCE_MS of random
+ * levels
+ * @return The level of each button at each tick, bit n for button n
+ */
+std::vector<unsigned char> makeWaveform(std::mt19937& random, int buttons,
+		bool bounce) {
+	std::vector<unsigned char> levels(WAVEFORM_MS * TICKS_PER_MS, 0);
+
+	for (int b = 0; b < buttons; b++) {
+		size_t t = std::uniform_int_distribution<size_t>(0, 400)(random)
+				* TICKS_PER_MS;
+		bool pressed = false;
+
+		// End released, with time to settle
+		while (t < levels.size() - 500 * TICKS_PER_MS) {
+			size_t length = (pressed
+					? std::uniform_int_distribution<size_t>(150, 400)(random)
+					: std::uniform_int_distribution<size_t>(20, 300)(random))
+					* TICKS_PER_MS;
+
+			pressed = !pressed;
+			for (size_t i = t; i < t + length; i++) {
+				bool level = pressed;
+
+				if (bounce && i < t + BOUNCE_MS * TICKS_PER_MS) {
+					level = random() & 1;
+				}
+				levels[i] |= level ? 1 << b : 0;
+			}
+			t += length;
+		}
+	}
+	return levels;
+}
+
+/**
+ * Replay a waveform through updateButtons() and the old state machine,
+ * noting each tick at which a button's debounced state changes. Presses
+ * are taken with checkBut() as soon as they are seen.
+ * @param pins Pin of each button on the port
+ * @param detect, holdoff Limits of the old state machine's counter
+ * @param maxLate Ticks by which the new debouncer may be later
+ */
+void replay(const std::vector<unsigned char>& levels, const unsigned char* pins,
+		int buttons, unsigned int detect, unsigned int holdoff,
+		unsigned int maxLate, const char* name) {
+	std::vector<OldButton> old(buttons, OldButton(detect, holdoff));
+	std::vector<std::vector<size_t> > oldChanges(buttons);
+	std::vector<std::vector<size_t> > newChanges(buttons);
+	std::vector<bool> held(buttons, false);
+	butEvent_t event;
+
+	for (size_t t = 0; t < levels.size(); t++) {
+		pressedPins = 0;
+		for (int b = 0; b < buttons; b++) {
+			if (levels[t] & (1 << b)) {
+				pressedPins |= pins[b];
+			}
+		}
+		updateButtons();
+		for (int b = 0; b < buttons; b++) {
+			if (old[b].update(levels[t] & (1 << b))) {
+				oldChanges[b].push_back(t);
+			}
+			if (checkBut(b) != (isButHeld(b) && !held[b])) {
+				fail("press taken without a change to held", b, t);
+			}
+			if (isButHeld(b) != held[b]) {
+				held[b] = !held[b];
+				newChanges[b].push_back(t);
+			}
+		}
+		// The events are checked by runScript(); keep the queue from filling
+		while (getButEvent(&event)) {
+		}
+	}
+
+	for (int b = 0; b < buttons; b++) {
+		if (newChanges[b].size() != oldChanges[b].size()) {
+			std::fprintf(stderr, "buttonTest: %s: ", name);
+			fail("changes differ from the old state machine", b,
+					static_cast<long>(newChanges[b].size())
+					- static_cast<long>(oldChanges[b].size()));
+			continue;
+		}
+		for (size_t i = 0; i < newChanges[b].size(); i++) {
+			long late = static_cast<long>(newChanges[b][i])
+					- static_cast<long>(oldChanges[b][i]);
+
+			if (late < 0 || late > static_cast<long>(maxLate)) {
+				std::fprintf(stderr, "buttonTest: %s: ", name);
+				fail("ticks later than the old state machine", b, late);
+			}
+		}
+	}
+	std::printf("%s: %lu presses\n", name,
+			static_cast<unsigned long>(newChanges[0].size() / 2));
+}
+
+/**
+ * Hold a button for three seconds with a one-tick glitch every 10 ms: it
+ * must stay held throughout.
+ * @param pin Pin of the button on the port
+ */
+void holdWithGlitches(int button, unsigned char pin) {
+	const unsigned int ticks = 3000 * TICKS_PER_MS;
+
+	for (unsigned int t = 0; t < ticks; t++) {
+		pressedPins = (t % (10 * TICKS_PER_MS) == 0) ? 0 : pin;
+		updateButtons();
+		if (t >= 10 * TICKS_PER_MS && !isButHeld(button)) {
+			fail("released by glitches at tick", button, t);
+			break;
+		}
+	}
+	checkBut(button);
+	pressedPins = 0;
+	for (unsigned int t = 0; t < 1000 * TICKS_PER_MS; t++) {
+		updateButtons();
+	}
+}
+
+/**
+ * Release one button and, while its release is being debounced, give
+ * another a one-tick glitch every third tick: the second button's counter
+ * must restart after each glitch, and it must never be pressed.
+ * @param pins Pin of each button on the port
+ */
+void glitchWhileReleasing(int released, int noisy, const unsigned char* pins) {
+	pressedPins = pins[released];
+	for (unsigned int t = 0; t < 10 * TICKS_PER_MS; t++) {
+		updateButtons();
+	}
+	checkBut(released);
+	for (unsigned int t = 0; t < 200 * TICKS_PER_MS; t++) {
+		pressedPins = (t % 3 == 0 && isButHeld(released)) ? pins[noisy] : 0;
+		updateButtons();
+		if (isButHeld(noisy)) {
+			fail("pressed by glitches at tick", noisy, t);
+			break;
+		}
+	}
+	checkBut(noisy);
+}
+
+// One step of a press script: from the given time, the buttons in the
+// mask (bit n for button n) are pressed
+struct Step {
+	unsigned int ms;
+	unsigned char pressed;
+};
+
+/**
+ * Play a press script on the virtual buttons, and check the events
+ * queued, with their times from the first event, against those expected.
+ * @param steps Steps of the script, the last one releasing everything
+ */
+void runScript(const Step* steps, int numSteps, const butEvent_t* expected,
+		int numExpected, const char* name) {
+	std::vector<butEvent_t> events;
+	butEvent_t event;
+
+	for (int i = 0; i + 1 < numSteps; i++) {
+		pressedPins = 0;
+		for (int b = 0; b < NUM_BUTTONS; b++) {
+			if (steps[i].pressed & (1 << b)) {
+				pressedPins |= BUTTON_PINS_B[b];
+			}
+		}
+		for (unsigned int t = steps[i].ms * TICKS_PER_MS;
+				t < steps[i + 1].ms * TICKS_PER_MS; t++) {
+			updateButtons();
+			while (getButEvent(&event)) {
+				events.push_back(event);
+			}
+		}
+	}
+	pressedPins = 0;
+	for (unsigned int t = 0; t < TICKS_PER_MS; t++) {
+		updateButtons();
+	}
+	while (getButEvent(&event)) {
+		events.push_back(event);
+	}
+	for (int b = 0; b < NUM_BUTTONS; b++) {
+		checkBut(b);
+	}
+
+	if (events.size() != static_cast<size_t>(numExpected)) {
+		std::fprintf(stderr, "buttonTest: %s: %lu events, expected %d\n",
+				name, static_cast<unsigned long>(events.size()), numExpected);
+		failures++;
+		return;
+	}
+	for (int i = 0; i < numExpected; i++) {
+		unsigned long ms = events[i].timeMs - events[0].timeMs;
+
+		if (events[i].button != expected[i].button
+				|| events[i].type != expected[i].type
+				|| ms != expected[i].timeMs) {
+			std::fprintf(stderr, "buttonTest: %s: event %d is button %d type "
+					"%d at %lu ms, expected button %d type %d at %lu ms\n",
+					name, i, events[i].button, events[i].type, ms,
+					expected[i].button, expected[i].type, expected[i].timeMs);
+			failures++;
+		}
+	}
+	std::printf("%s: %d events\n", name, numExpected);
+}
+
+} // namespace
+
+// Stubs of the GPIO port and the interrupt bookkeeping
+extern "C" {
+void GPIODirModeSet(unsigned long, unsigned char, unsigned long) {
+}
+
+void GPIOPadConfigSet(unsigned long, unsigned char, unsigned long,
+		unsigned long) {
+}
+
+void GPIOIntTypeSet(unsigned long, unsigned char, unsigned long) {
+}
+
+void GPIOPinIntEnable(unsigned long, unsigned char) {
+}
+
+void GPIOPinIntDisable(unsigned long, unsigned char) {
+}
+
+void GPIOPinIntClear(unsigned long, unsigned char) {
+}
+
+void GPIOPortIntRegister(unsigned long, void (*)(void)) {
+}
+
+long GPIOPinRead(unsigned long, unsigned char ucPins) {
+	return ~pressedPins & ucPins;
+}
+
+void isrEnter(int, unsigned long) {
+}
+
+void isrExit(int) {
+}
+}
+
+int main() {
+	std::mt19937 random(1);
+
+	// The physical buttons, but for RESET, which has no pin
+	initButSet(UP_B | DOWN_B | LEFT_B | RIGHT_B | SELECT_B, PHYSICAL_PORT,
+			SYSTICK_RATE_HZ);
+	replay(makeWaveform(random, 5, false), BUTTON_PINS_G, 5,
+			BUT_DETECT * TICKS_PER_MS, BUT_HOLDOFF * TICKS_PER_MS, 0,
+			"physical, clean");
+	replay(makeWaveform(random, 5, true), BUTTON_PINS_G, 5,
+			BUT_DETECT * TICKS_PER_MS, BUT_HOLDOFF * TICKS_PER_MS,
+			BOUNCE_MS * TICKS_PER_MS, "physical, bouncing");
+	holdWithGlitches(UP, BUTTON_PINS_G[UP]);
+	glitchWhileReleasing(LEFT, RIGHT, BUTTON_PINS_G);
+
+	// The virtual buttons are taken at once
+	initButSet(UP_B | DOWN_B | LEFT_B | RIGHT_B | SELECT_B | RESET_B,
+			VIRTUAL_PORT, SYSTICK_RATE_HZ);
+	replay(makeWaveform(random, NUM_BUTTONS, false), BUTTON_PINS_B,
+			NUM_BUTTONS, 0, 0, 0, "virtual");
+
+	// UP is held for 1250 ms, and LEFT pressed briefly while it is, then
+	// UP is held again just long enough for another long press
+	const Step HOLD[] = {
+		{0, 1 << UP}, {200, 1 << UP | 1 << LEFT}, {300, 1 << UP}, {1250, 0},
+		{1400, 1 << UP}, {1400 + BUT_LONG_PRESS + 50, 0}
+	};
+	const butEvent_t HOLD_EVENTS[] = {
+		{0, UP, BUT_EV_PRESS},
+		{200, LEFT, BUT_EV_PRESS},
+		{300, LEFT, BUT_EV_RELEASE},
+		{BUT_LONG_PRESS, UP, BUT_EV_LONG},
+		{BUT_LONG_PRESS + BUT_REPEAT, UP, BUT_EV_REPEAT},
+		{BUT_LONG_PRESS + 2 * BUT_REPEAT, UP, BUT_EV_REPEAT},
+		{BUT_LONG_PRESS + 3 * BUT_REPEAT, UP, BUT_EV_REPEAT},
+		{BUT_LONG_PRESS + 4 * BUT_REPEAT, UP, BUT_EV_REPEAT},
+		{BUT_LONG_PRESS + 5 * BUT_REPEAT, UP, BUT_EV_REPEAT},
+		{BUT_LONG_PRESS + 6 * BUT_REPEAT, UP, BUT_EV_REPEAT},
+		{BUT_LONG_PRESS + 7 * BUT_REPEAT, UP, BUT_EV_REPEAT},
+		{1250, UP, BUT_EV_RELEASE},
+		{1400, UP, BUT_EV_PRESS},
+		{1400 + BUT_LONG_PRESS, UP, BUT_EV_LONG},
+		{1400 + BUT_LONG_PRESS + 50, UP, BUT_EV_RELEASE}
+	};
+	runScript(HOLD, sizeof(HOLD) / sizeof(HOLD[0]), HOLD_EVENTS,
+			sizeof(HOLD_EVENTS) / sizeof(HOLD_EVENTS[0]), "long press");
+
+	// Buttons pressed together are all queued at the same time, and
+	// DOWN, while inactive, is not queued at all
+	disableBut(DOWN);
+	const Step TOGETHER[] = {
+		{0, 1 << UP | 1 << DOWN | 1 << SELECT},
+		{50, 1 << UP | 1 << DOWN | 1 << SELECT | 1 << RIGHT},
+		{100, 0}, {200, 0}
+	};
+	const butEvent_t TOGETHER_EVENTS[] = {
+		{0, UP, BUT_EV_PRESS},
+		{0, SELECT, BUT_EV_PRESS},
+		{50, RIGHT, BUT_EV_PRESS},
+		{100, UP, BUT_EV_RELEASE},
+		{100, RIGHT, BUT_EV_RELEASE},
+		{100, SELECT, BUT_EV_RELEASE}
+	};
+	runScript(TOGETHER, sizeof(TOGETHER) / sizeof(TOGETHER[0]),
+			TOGETHER_EVENTS, sizeof(TOGETHER_EVENTS) / sizeof(TOGETHER_EVENTS[0]),
+			"together");
+	enableBut(DOWN);
+
+	// Events that find the queue full are counted, and the oldest kept
+	unsigned long dropped = getButEventsDropped();
+	for (int i = 0; i < BUT_QUEUE_SIZE; i++) {
+		pressedPins = (i % 2) ? 0 : BUTTON_PINS_B[UP];
+		updateButtons();
+	}
+	butEvent_t event;
+	int queued = 0;
+	while (getButEvent(&event)) {
+		if (event.type != (queued % 2 ? BUT_EV_RELEASE : BUT_EV_PRESS)) {
+			fail("queued out of order, event", UP, queued);
+		}
+		queued++;
+	}
+	checkBut(UP);
+	if (queued != BUT_QUEUE_SIZE - 1
+			|| getButEventsDropped() - dropped != 1) {
+		fail("queued events when full", UP, queued);
+	}
+
+	std::printf("%s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
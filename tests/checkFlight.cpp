@@ -0,0 +1,385 @@
+/*
+ * checkFlight.cpp
+ *
+ * Test tool that checks the telemetry stream recorded from a flight of
+ * the host build (heliHost --uart) against what the flight should show.
+ *
+ * Usage: checkFlight [options] file
+ *  --final-state n         The last status frame has heli state n
+ *  --final-altitude lo hi  The last status frame has an altitude (%) in
+ *                          lo..hi
+ *  --reach-altitude n      Some status frame has an altitude of n% or more
+ *  --text string           The text frames contain string; may be repeated
+ *  --no-text string        The text frames do not contain string; may be
+ *                          repeated
+ *  --text-value string lo hi
+ *                          The text frames contain string followed by a
+ *                          number in lo..hi, which is printed; may be
+ *                          repeated
+ *  --channel-range name lo hi from to
+ *                          Every sample of the named channel taken from
+ *                          from to to ms lies in lo..hi, and there is at
+ *                          least one; may be repeated. The flight must ask
+ *                          for CHANNELS, which names the channels. The
+ *                          range of the samples is printed.
+ *  --gains-changed         The flight asks for GAINS more than once, and
+ *                          the last reply differs from the first
+ *  --gains-of file         The last GAINS reply is the same as the last
+ *                          in the stream recorded in file, such as a
+ *                          flight that saved its gains before a reboot
+ * Whatever the options, the stream must decode without a CRC, framing or
+ * unknown frame error, and no status frame may carry the TX_DROPPED or
+ * SKIPPED flag. Each failed check is printed, and the exit status is 1 if
+ * any failed.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "telemetryDecoder.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Status frame flags that mean part of the stream was lost (telemetry.h)
+const int LOST_FLAGS = 0x02 | 0x04;
+
+int failures = 0;
+
+void fail(const char* what, long value) {
+	std::fprintf(stderr, "checkFlight: %s (%ld)\n", what, value);
+	failures++;
+}
+
+void usage(const char* name) {
+	std::fprintf(stderr, "usage: %s [--final-state n] [--final-altitude lo hi] "
+			"[--reach-altitude n] [--text string]... [--no-text string]... "
+			"[--text-value string lo hi]... "
+			"[--channel-range name lo hi from to]... [--gains-changed] "
+			"[--gains-of file] file\n", name);
+	std::exit(2);
+}
+
+// A range that the number after a text must lie in
+struct TextValue {
+	std::string text;
+	long low;
+	long high;
+};
+
+// A range that the samples of a channel must lie in
+struct ChannelRange {
+	std::string name;
+	long low;
+	long high;
+	unsigned long fromMs;
+	unsigned long toMs;
+};
+
+/**
+ * Find a channel's number in the CHANNELS reply, whose lines are
+ * "<number> <name> <rate> Hz".
+ * @return The channel number, or -1 if the reply does not name it
+ */
+int findChannel(const std::string& text, const std::string& name) {
+	std::istringstream lines(text);
+	std::string line;
+
+	while (std::getline(lines, line)) {
+		int channel;
+		char lineName[64];
+		unsigned int rate;
+		char hz[3];
+
+		if (std::sscanf(line.c_str(), "%d %63s %u %2s", &channel, lineName,
+				&rate, hz) == 4 && std::strcmp(hz, "Hz") == 0
+				&& name == lineName && channel >= 0
+				&& channel < heli::TELEM_MAX_CHANNELS) {
+			return channel;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Check the number after a text against a range, and print it.
+ */
+void checkTextValue(const std::string& text, const TextValue& value) {
+	size_t at = text.find(value.text);
+	const char* start;
+	char* end;
+	long number;
+
+	if (at == std::string::npos) {
+		std::fprintf(stderr, "checkFlight: no text \"%s\"\n",
+				value.text.c_str());
+		failures++;
+		return;
+	}
+	start = text.c_str() + at + value.text.size();
+	number = std::strtol(start, &end, 10);
+	if (end == start) {
+		std::fprintf(stderr, "checkFlight: no number after \"%s\"\n",
+				value.text.c_str());
+		failures++;
+		return;
+	}
+	std::printf("%s%ld\n", value.text.c_str(), number);
+	if (number < value.low || number > value.high) {
+		std::fprintf(stderr, "checkFlight: %s%ld not in %ld..%ld\n",
+				value.text.c_str(), number, value.low, value.high);
+		failures++;
+	}
+}
+
+/**
+ * Check the samples of a channel against a range, and print their range.
+ */
+void checkChannelRange(const std::vector<heli::ChannelFrame>& channels,
+		const std::string& text, const ChannelRange& range) {
+	int channel = findChannel(text, range.name);
+	unsigned long count = 0;
+	long low = 0;
+	long high = 0;
+
+	if (channel < 0) {
+		std::fprintf(stderr, "checkFlight: channel %s not listed\n",
+				range.name.c_str());
+		failures++;
+		return;
+	}
+	for (size_t i = 0; i < channels.size(); i++) {
+		const heli::ChannelFrame& f = channels[i];
+		long value = f.values[channel];
+
+		if (!(f.mask & (1u << channel)) || f.timeMs < range.fromMs
+				|| f.timeMs > range.toMs) {
+			continue;
+		}
+		if (count == 0 || value < low) {
+			low = value;
+		}
+		if (count == 0 || value > high) {
+			high = value;
+		}
+		count++;
+		if (value < range.low || value > range.high) {
+			std::fprintf(stderr, "checkFlight: %s at %lu ms (%ld)\n",
+					range.name.c_str(), static_cast<unsigned long>(f.timeMs),
+					value);
+			failures++;
+		}
+	}
+	if (count == 0) {
+		std::fprintf(stderr, "checkFlight: no samples of %s\n",
+				range.name.c_str());
+		failures++;
+		return;
+	}
+	std::printf("%s: %lu samples in %ld..%ld\n", range.name.c_str(), count,
+			low, high);
+}
+
+/**
+ * Decode a recorded telemetry stream.
+ * @return false if the file cannot be read
+ */
+bool decodeFile(const char* path, heli::TelemetryDecoder& decoder,
+		std::vector<heli::StatusFrame>& frames, std::string& text,
+		std::vector<heli::ChannelFrame>& channels) {
+	FILE* in = std::fopen(path, "rb");
+	uint8_t buf[256];
+	size_t n;
+
+	if (!in) {
+		std::perror(path);
+		return false;
+	}
+	while ((n = std::fread(buf, 1, sizeof(buf), in)) > 0) {
+		decoder.feed(buf, n, frames, &text, &channels);
+	}
+	std::fclose(in);
+	return true;
+}
+
+/**
+ * Find the replies to GAINS, whose lines are "ALT <kp> <ki> YAW <kp> <ki>".
+ */
+std::vector<std::string> findGains(const std::string& text) {
+	std::istringstream lines(text);
+	std::string line;
+	std::vector<std::string> gains;
+
+	while (std::getline(lines, line)) {
+		if (line.compare(0, 4, "ALT ") == 0) {
+			gains.push_back(line);
+		}
+	}
+	return gains;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	const char* path = 0;
+	long finalState = -1;
+	long finalLow = -1;
+	long finalHigh = -1;
+	long reach = -1;
+	std::vector<std::string> texts;
+	std::vector<std::string> absentTexts;
+	std::vector<TextValue> values;
+	std::vector<ChannelRange> ranges;
+	bool gainsChanged = false;
+	const char* gainsPath = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--final-state") == 0 && i + 1 < argc) {
+			finalState = std::atol(argv[++i]);
+		} else if (std::strcmp(argv[i], "--final-altitude") == 0 && i + 2 < argc) {
+			finalLow = std::atol(argv[++i]);
+			finalHigh = std::atol(argv[++i]);
+		} else if (std::strcmp(argv[i], "--reach-altitude") == 0 && i + 1 < argc) {
+			reach = std::atol(argv[++i]);
+		} else if (std::strcmp(argv[i], "--text") == 0 && i + 1 < argc) {
+			texts.push_back(argv[++i]);
+		} else if (std::strcmp(argv[i], "--no-text") == 0 && i + 1 < argc) {
+			absentTexts.push_back(argv[++i]);
+		} else if (std::strcmp(argv[i], "--text-value") == 0 && i + 3 < argc) {
+			TextValue value;
+
+			value.text = argv[++i];
+			value.low = std::atol(argv[++i]);
+			value.high = std::atol(argv[++i]);
+			values.push_back(value);
+		} else if (std::strcmp(argv[i], "--channel-range") == 0
+				&& i + 5 < argc) {
+			ChannelRange range;
+
+			range.name = argv[++i];
+			range.low = std::atol(argv[++i]);
+			range.high = std::atol(argv[++i]);
+			range.fromMs = std::strtoul(argv[++i], 0, 10);
+			range.toMs = std::strtoul(argv[++i], 0, 10);
+			ranges.push_back(range);
+		} else if (std::strcmp(argv[i], "--gains-changed") == 0) {
+			gainsChanged = true;
+		} else if (std::strcmp(argv[i], "--gains-of") == 0 && i + 1 < argc) {
+			gainsPath = argv[++i];
+		} else if (argv[i][0] == '-' || path) {
+			usage(argv[0]);
+		} else {
+			path = argv[i];
+		}
+	}
+	if (!path) {
+		usage(argv[0]);
+	}
+
+	heli::TelemetryDecoder decoder;
+	std::vector<heli::StatusFrame> frames;
+	std::vector<heli::ChannelFrame> channels;
+	std::string text;
+
+	if (!decodeFile(path, decoder, frames, text, channels)) {
+		return 1;
+	}
+
+	const heli::DecoderStats& stats = decoder.stats();
+	if (stats.crcErrors) {
+		fail("CRC errors", stats.crcErrors);
+	}
+	if (stats.framingErrors) {
+		fail("framing errors", stats.framingErrors);
+	}
+	if (stats.unknownFrames) {
+		fail("unknown frames", stats.unknownFrames);
+	}
+	if (frames.empty()) {
+		fail("no status frames", 0);
+		return 1;
+	}
+
+	bool reached = false;
+	for (size_t i = 0; i < frames.size(); i++) {
+		if (frames[i].flags & LOST_FLAGS) {
+			fail("data lost before the status frame at ms", frames[i].timeMs);
+		}
+		if (frames[i].altitude >= reach) {
+			reached = true;
+		}
+	}
+	if (reach >= 0 && !reached) {
+		fail("altitude never reached", reach);
+	}
+
+	const heli::StatusFrame& last = frames.back();
+	if (finalState >= 0 && last.heliState != finalState) {
+		fail("final heli state", last.heliState);
+	}
+	if (finalLow >= 0 && (last.altitude < finalLow || last.altitude > finalHigh)) {
+		fail("final altitude", last.altitude);
+	}
+	for (size_t i = 0; i < texts.size(); i++) {
+		if (text.find(texts[i]) == std::string::npos) {
+			std::fprintf(stderr, "checkFlight: no text \"%s\"\n",
+					texts[i].c_str());
+			failures++;
+		}
+	}
+	for (size_t i = 0; i < absentTexts.size(); i++) {
+		if (text.find(absentTexts[i]) != std::string::npos) {
+			std::fprintf(stderr, "checkFlight: unexpected text \"%s\"\n",
+					absentTexts[i].c_str());
+			failures++;
+		}
+	}
+	for (size_t i = 0; i < values.size(); i++) {
+		checkTextValue(text, values[i]);
+	}
+	for (size_t i = 0; i < ranges.size(); i++) {
+		checkChannelRange(channels, text, ranges[i]);
+	}
+
+	std::vector<std::string> gains = findGains(text);
+	if (gainsChanged) {
+		if (gains.size() < 2) {
+			fail("GAINS replies", static_cast<long>(gains.size()));
+		} else {
+			std::printf("gains: %s -> %s\n", gains.front().c_str(),
+					gains.back().c_str());
+			if (gains.front() == gains.back()) {
+				fail("gains unchanged", 0);
+			}
+		}
+	}
+	if (gainsPath) {
+		heli::TelemetryDecoder otherDecoder;
+		std::vector<heli::StatusFrame> otherFrames;
+		std::vector<heli::ChannelFrame> otherChannels;
+		std::string otherText;
+		std::vector<std::string> otherGains;
+
+		if (decodeFile(gainsPath, otherDecoder, otherFrames, otherText,
+				otherChannels)) {
+			otherGains = findGains(otherText);
+		}
+		if (gains.empty() || otherGains.empty()) {
+			fail("no GAINS reply to compare", 0);
+		} else if (gains.back() != otherGains.back()) {
+			std::fprintf(stderr, "checkFlight: gains %s, expected %s\n",
+					gains.back().c_str(), otherGains.back().c_str());
+			failures++;
+		}
+	}
+
+	std::printf("%lu frames, %lu status, final state %d altitude %d%%: %s\n",
+			stats.frames, static_cast<unsigned long>(frames.size()),
+			last.heliState, last.altitude, failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
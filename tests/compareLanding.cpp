@@ -0,0 +1,130 @@
+/*
+ * compareLanding.cpp
+ *
+ * Test tool that compares two landings of the host build, from the rig
+ * summaries heliHost prints on stderr: the controlled descent against the
+ * step-down landing it replaced (heliHostStepLanding).
+ *
+ * Usage: compareLanding [options] new.txt old.txt
+ *  --land-at s           Time at which the landing was asked for, in s
+ *  --max-speed-ratio r   The new landing touches down at no more than r
+ *                        times the old one's speed
+ *  --max-time-ratio r    The new landing, from the request until the
+ *                        motors are off, takes no more than r times as
+ *                        long as the old one
+ * Whatever the options, the new landing must touch down before the
+ * motors are turned off. Both landings are printed, each failed check is
+ * printed, and the exit status is 1 if any failed.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+struct Landing {
+	double touchdownS; // Time the heli reached the ground
+	double speed; // Speed it reached the ground at, in % altitude per s
+	double motorsOffS; // Time the motors were turned off
+};
+
+int failures = 0;
+
+void fail(const char* what, double value) {
+	std::fprintf(stderr, "compareLanding: %s (%.2f)\n", what, value);
+	failures++;
+}
+
+void usage(const char* name) {
+	std::fprintf(stderr, "usage: %s [--land-at s] [--max-speed-ratio r] "
+			"[--max-time-ratio r] new.txt old.txt\n", name);
+	std::exit(2);
+}
+
+/**
+ * Read the touchdown line of a rig summary.
+ * @return true if the file has one
+ */
+bool readLanding(const char* path, Landing* landing) {
+	FILE* in = std::fopen(path, "r");
+	char line[256];
+	bool found = false;
+
+	if (!in) {
+		std::perror(path);
+		return false;
+	}
+	while (std::fgets(line, sizeof(line), in)) {
+		double rate;
+
+		if (std::sscanf(line, "rig: touched down at %lf s at %lf%%/s, "
+				"motors off at %lf s", &landing->touchdownS, &rate,
+				&landing->motorsOffS) == 3) {
+			landing->speed = std::fabs(rate);
+			found = true;
+		}
+	}
+	std::fclose(in);
+	if (!found) {
+		std::fprintf(stderr, "compareLanding: no touchdown in %s\n", path);
+	}
+	return found;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	const char* paths[2] = {0, 0};
+	int count = 0;
+	double landAt = 0;
+	double maxSpeedRatio = -1;
+	double maxTimeRatio = -1;
+	Landing landings[2];
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--land-at") == 0 && i + 1 < argc) {
+			landAt = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--max-speed-ratio") == 0
+				&& i + 1 < argc) {
+			maxSpeedRatio = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--max-time-ratio") == 0
+				&& i + 1 < argc) {
+			maxTimeRatio = std::atof(argv[++i]);
+		} else if (argv[i][0] == '-' || count == 2) {
+			usage(argv[0]);
+		} else {
+			paths[count++] = argv[i];
+		}
+	}
+	if (count != 2) {
+		usage(argv[0]);
+	}
+	if (!readLanding(paths[0], &landings[0])
+			|| !readLanding(paths[1], &landings[1])) {
+		return 1;
+	}
+
+	const Landing& now = landings[0];
+	const Landing& old = landings[1];
+	double nowTime = now.motorsOffS - landAt;
+	double oldTime = old.motorsOffS - landAt;
+
+	std::printf("new: %.1f s, touchdown at %.2f%%/s\n", nowTime, now.speed);
+	std::printf("old: %.1f s, touchdown at %.2f%%/s\n", oldTime, old.speed);
+
+	if (now.motorsOffS < now.touchdownS) {
+		fail("motors off before touchdown, s", now.motorsOffS);
+	}
+	if (maxSpeedRatio >= 0 && now.speed > old.speed * maxSpeedRatio) {
+		fail("touchdown speed, %/s", now.speed);
+	}
+	if (maxTimeRatio >= 0 && nowTime > oldTime * maxTimeRatio) {
+		fail("landing time, s", nowTime);
+	}
+	std::printf("%s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * cpuLoadTest.cpp
+ *
+ * Unit test of the CPU load meter (cpuLoad.c) against a simulated cycle
+ * counter. Seconds of background loop passes, busy and idle, with
+ * interrupt cycles taken during them, are played through the meter, and
+ * the shares it works out must match the cycles played, to the tenth of
+ * a percent, including across a wrap of the cycle counter.
+ *
+ * Usage: cpuLoadTest
+ *  Each failed check is printed, and the exit status is 1 if any failed.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+extern "C" {
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "cpuLoad.h"
+#include "intPriority.h"
+#include "timing.h"
+}
+
+#include <cstdio>
+
+namespace {
+
+// Cycles in one simulated second
+const unsigned long CYCLES_PER_SECOND = 50000000;
+
+// The simulated cycle counter, and the interrupt cycles counted so far
+unsigned long cycles = 0;
+unsigned long isrTotal = 0;
+
+int failures = 0;
+
+/**
+ * Play a second of background loop passes.
+ * @param passes Passes in the second, all of the same length
+ * @param busyPerMille Thousandths of the passes that run a task
+ * @param isrPerMille Thousandths of each pass spent in interrupt handlers
+ */
+void playSecond(unsigned long passes, unsigned long busyPerMille,
+		unsigned long isrPerMille) {
+	const unsigned long perPass = CYCLES_PER_SECOND / passes;
+	const unsigned long isrPerPass = perPass / 1000 * isrPerMille;
+	unsigned long busyPasses = passes * busyPerMille / 1000;
+
+	for (unsigned long i = 0; i < passes; i++) {
+		// Spread the busy passes through the second
+		int busy = (i * busyPasses / passes) != ((i + 1) * busyPasses / passes);
+
+		cycles += perPass;
+		isrTotal += isrPerPass;
+		cpuLoadMark(busy);
+	}
+}
+
+/**
+ * Work out the shares of the second played and check them.
+ * @param tasks10, isr10 Tenths of a percent expected on tasks and in
+ * interrupt handlers
+ */
+void check(const char* name, unsigned int tasks10, unsigned int isr10) {
+	const cpuLoad_t* load;
+
+	cpuLoadUpdate();
+	load = getCpuLoad();
+	if (load->tasks10 != tasks10 || load->isr10 != isr10
+			|| load->busy10 != tasks10 + isr10) {
+		std::fprintf(stderr, "cpuLoadTest: %s: busy %u isr %u tasks %u, "
+				"expected %u %u %u\n", name, load->busy10, load->isr10,
+				load->tasks10, tasks10 + isr10, isr10, tasks10);
+		failures++;
+	}
+}
+
+} // namespace
+
+// Stubs of the cycle counter, the interrupt bookkeeping and the
+// interrupt mask
+extern "C" {
+unsigned long cycleCount(void) {
+	return cycles;
+}
+
+unsigned long getIsrCyclesTotal(void) {
+	return isrTotal;
+}
+
+tBoolean IntMasterDisable(void) {
+	return 0;
+}
+
+tBoolean IntMasterEnable(void) {
+	return 0;
+}
+}
+
+int main() {
+	initCpuLoad();
+
+	// Passes that ran a task count as task time less the interrupts
+	// taken during them, and the others as idle time
+	playSecond(1000, 0, 0);
+	check("idle", 0, 0);
+	playSecond(1000, 300, 0);
+	check("tasks", 300, 0);
+	playSecond(1000, 0, 200);
+	check("interrupts", 0, 200);
+	playSecond(2000, 250, 100);
+	check("both", 225, 100);
+	playSecond(1000, 1000, 50);
+	check("saturated", 950, 50);
+
+	// No passes: nothing counted, and nothing divided by zero
+	check("no passes", 0, 0);
+
+	// The cycle counter and the interrupt total wrap around
+	cycles = 0UL - CYCLES_PER_SECOND / 3;
+	isrTotal = 0UL - CYCLES_PER_SECOND / 7;
+	initCpuLoad();
+	playSecond(1000, 500, 100);
+	check("wrap", 450, 100);
+
+	std::printf("%s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * displayTest.cpp
+ *
+ * Unit test of the text page of the display (display.c), drawn into the
+ * frame buffer (frameBuffer.c). A random walk of the values shown, small
+ * steps as when hovering with the odd jump, is displayed refresh after
+ * refresh. Each refresh must draw exactly the characters that changed on
+ * each line, worked out from a model of the text, and the image built up
+ * this way must be the same as the whole page drawn afresh. A refresh
+ * that changes nothing must leave nothing to send to the display.
+ *
+ * Usage: displayTest
+ *  Each failed check is printed, and the exit status is 1 if any failed.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+extern "C" {
+#include "display.h"
+#include "frameBuffer.h"
+#include "inc/hw_types.h"
+#include "drivers/rit128x96x4.h"
+}
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+
+// Characters per display line, and lines on the text page
+const size_t LINE_WIDTH = 19;
+const int NUM_LINES = 8;
+
+// Model of the text on each line
+std::string shown[NUM_LINES];
+
+struct Values {
+	heliSnapshot_t now;
+	unsigned int mainDuty100;
+	unsigned int tailDuty100;
+	cpuLoad_t load;
+};
+
+int failures = 0;
+
+void fail(const char* what, long value) {
+	std::fprintf(stderr, "displayTest: %s (%ld)\n", what, value);
+	failures++;
+}
+
+/**
+ * Format a line as the display does: padded with spaces, or cut, to
+ * LINE_WIDTH.
+ */
+template <typename... Args>
+std::string line(const char* format, Args... args) {
+	char text[64];
+
+	std::snprintf(text, sizeof(text), format, args...);
+	return std::string(text).append(LINE_WIDTH, ' ').substr(0, LINE_WIDTH);
+}
+
+/**
+ * Display the values, and check that the characters drawn are those
+ * that changed in the model of the text.
+ */
+void refresh(const Values& v, const char* name) {
+	const std::string text[NUM_LINES] = {
+		line("Altitude: %d%%", v.now.avgAltitude),
+		line("Desired: %d%%", v.now.desiredAltitude),
+		line("Yaw*100: %d", v.now.yaw100),
+		line("Desired*100: %d", v.now.desiredYaw100),
+		line("Main rotor: %u.%02u%%", v.mainDuty100 / 100, v.mainDuty100 % 100),
+		line("Tail rotor: %u.%02u%%", v.tailDuty100 / 100, v.tailDuty100 % 100),
+		line("Heli state: %d", v.now.heliState),
+		line("CPU %u%% (ISR %u%%)", (v.load.busy10 + 5) / 10,
+				(v.load.isr10 + 5) / 10)
+	};
+	unsigned long changed = 0;
+	unsigned long before = getGlyphsDrawn();
+
+	for (int i = 0; i < NUM_LINES; i++) {
+		for (size_t c = 0; c < LINE_WIDTH; c++) {
+			changed += c >= shown[i].size() || shown[i][c] != text[i][c];
+		}
+		shown[i] = text[i];
+	}
+	displayAltitude(&v.now);
+	displayYaw(&v.now);
+	displayPWMStatus(v.mainDuty100, v.tailDuty100);
+	displayCpuLoad(&v.load);
+	if (getGlyphsDrawn() - before != changed) {
+		std::fprintf(stderr, "displayTest: %s: %lu characters drawn, %lu "
+				"changed\n", name, getGlyphsDrawn() - before, changed);
+		failures++;
+	}
+}
+
+/**
+ * Send everything left in the frame buffer to the display.
+ */
+void flush(void) {
+	for (int i = 0; i <= FB_HEIGHT / FB_FLUSH_ROWS && displayFlush() > 0;
+			i++) {
+	}
+}
+
+/**
+ * Take a step of the random walk: small changes, with the odd jump.
+ */
+int walk(std::mt19937& random, int value, int lo, int hi) {
+	if (random() % 20 == 0) {
+		return std::uniform_int_distribution<int>(lo, hi)(random);
+	}
+	value += std::uniform_int_distribution<int>(-2, 2)(random);
+	return std::min(hi, std::max(lo, value));
+}
+
+} // namespace
+
+// Stubs of the display driver and the strip charts
+extern "C" {
+void RIT128x96x4Init(unsigned long) {
+}
+
+void RIT128x96x4Enable(unsigned long) {
+}
+
+void RIT128x96x4Disable(void) {
+}
+
+void RIT128x96x4ImageDraw(const unsigned char*, unsigned long, unsigned long,
+		unsigned long, unsigned long) {
+}
+
+void chartRedraw(void) {
+}
+}
+
+int main() {
+	std::mt19937 random(1);
+	Values v = {};
+	unsigned char image[FB_HEIGHT * FB_ROW_BYTES];
+	char name[32];
+
+	v.now.avgAltitude = 50;
+	v.now.desiredAltitude = 50;
+	v.mainDuty100 = 4200;
+	v.tailDuty100 = 3800;
+	v.load.busy10 = 400;
+	v.load.isr10 = 100;
+
+	// The first refresh draws every character
+	initDisplay();
+	refresh(v, "first refresh");
+
+	for (int i = 0; i < 2000; i++) {
+		v.now.avgAltitude = walk(random, v.now.avgAltitude, -5, 105);
+		v.now.desiredAltitude = walk(random, v.now.desiredAltitude, 0, 100);
+		v.now.yaw100 = walk(random, v.now.yaw100, -36000, 36000);
+		v.now.desiredYaw100 = walk(random, v.now.desiredYaw100, -36000, 36000);
+		v.now.heliState = walk(random, v.now.heliState, 0, 3);
+		v.mainDuty100 = walk(random, v.mainDuty100, 0, 10000);
+		v.tailDuty100 = walk(random, v.tailDuty100, 0, 10000);
+		v.load.busy10 = walk(random, v.load.busy10, 0, 1000);
+		v.load.isr10 = walk(random, v.load.isr10, 0, v.load.busy10);
+		std::snprintf(name, sizeof(name), "refresh %d", i);
+		refresh(v, name);
+		if (random() % 10 != 0) {
+			continue;
+		}
+
+		// Drawn afresh on a cleared page, the text must look the same
+		std::memcpy(image, fbPixels(), sizeof(image));
+		changeDisplayPage(1);
+		changeDisplayPage(-1);
+		for (int l = 0; l < NUM_LINES; l++) {
+			shown[l].clear();
+		}
+		refresh(v, name);
+		if (std::memcmp(image, fbPixels(), sizeof(image)) != 0) {
+			fail("image differs from the page drawn afresh, refresh", i);
+		}
+
+		// Nothing changed, nothing drawn and nothing to send
+		flush();
+		refresh(v, name);
+		if (displayFlush() != 0) {
+			fail("rows to send after an unchanged refresh", i);
+		}
+	}
+
+	std::printf("%lu characters drawn: %s\n", getGlyphsDrawn(),
+			failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
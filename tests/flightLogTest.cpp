@@ -0,0 +1,242 @@
+/*
+ * flightLogTest.cpp
+ *
+ * Test tool for the flight log's recovery from power cuts (flightLog.h),
+ * run with the host build's flash image (heliHost --flash).
+ *
+ * Usage: flightLogTest seed image
+ *  Writes a flash image holding a full log: every page valid and every
+ *  slot holding a record, the newest page in the middle of the region so
+ *  that the log has wrapped. Each of these old records has a time of
+ *  OLD_TIME_MS or more, which no new record reaches.
+ *
+ * Usage: flightLogTest check [--old n] [--runs n] [--first-run n] dump
+ *  Checks a LOG DUMP recorded from the telemetry stream: the dump must be
+ *  complete and every record's check word correct, the old records must
+ *  all come first, in time order, and the new records must follow in
+ *  runs that each start again at a lower time. --old gives the number of
+ *  old records, --runs the number of runs of new records and --first-run
+ *  the number of records in the first of those runs. Each failed check is
+ *  printed, and the exit status is 1 if any failed.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "telemetryDecoder.h"
+#include "flightLog.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const unsigned long FLASH_START = 0x00030000;
+const unsigned long FLASH_END = 0x00040000;
+const int TELEM_FLIGHTLOG = 5; // telemetry.h
+
+// Page of the seeded log written last, and the sequence number of the
+// oldest page
+const unsigned int NEWEST_PAGE = 40;
+const uint32_t FIRST_SEQ = 1000;
+
+// Times of the seeded records: OLD_TIME_MS onwards, a control step apart
+const uint32_t OLD_TIME_MS = 10000000;
+const uint32_t STEP_MS = 500;
+
+int failures = 0;
+
+void fail(const char* what, long value) {
+	std::fprintf(stderr, "flightLogTest: %s (%ld)\n", what, value);
+	failures++;
+}
+
+uint32_t checkWord(const uint32_t* record) {
+	uint32_t sum = 0;
+
+	for (int i = 0; i < LOG_RECORD_WORDS - 1; i++) {
+		sum += record[i];
+	}
+	return sum ^ LOG_CHECK_KEY;
+}
+
+int seed(const char* path) {
+	std::vector<uint32_t> flash((FLASH_END - FLASH_START) / 4, 0xFFFFFFFF);
+
+	for (unsigned int page = 0; page < LOG_PAGES; page++) {
+		// The page after the newest is the oldest
+		uint32_t age = (page + LOG_PAGES - NEWEST_PAGE - 1) % LOG_PAGES;
+		uint32_t* p = &flash[(LOG_FLASH_START - FLASH_START
+				+ page * LOG_PAGE_SIZE) / 4];
+
+		p[0] = LOG_PAGE_MAGIC;
+		p[1] = FIRST_SEQ + age;
+		p[2] = 5; // Erase count
+		for (unsigned int slot = 0; slot < LOG_SLOTS_PER_PAGE; slot++) {
+			uint32_t* record = p + (slot + 1) * LOG_RECORD_WORDS;
+			uint32_t n = age * LOG_SLOTS_PER_PAGE + slot;
+
+			record[0] = OLD_TIME_MS + n * STEP_MS;
+			record[1] = n; // Yaw
+			record[2] = 0;
+			record[3] = 50 | (50 << 16); // Altitude, desired altitude
+			record[4] = 3000 | (3000 << 16); // Duty cycles
+			record[5] = 400 | (2 << 16); // Raw ADC, flying
+			record[6] = 0;
+			record[7] = checkWord(record);
+		}
+	}
+
+	FILE* out = std::fopen(path, "wb");
+	if (!out) {
+		std::perror(path);
+		return 1;
+	}
+	for (size_t i = 0; i < flash.size(); i++) {
+		for (int b = 0; b < 4; b++) {
+			std::fputc((flash[i] >> (8 * b)) & 0xFF, out);
+		}
+	}
+	std::fclose(out);
+	return 0;
+}
+
+int check(int argc, char** argv) {
+	const char* path = 0;
+	long expectOld = -1;
+	long expectRuns = -1;
+	long expectFirstRun = -1;
+
+	for (int i = 2; i < argc; i++) {
+		if (std::strcmp(argv[i], "--old") == 0 && i + 1 < argc) {
+			expectOld = std::atol(argv[++i]);
+		} else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+			expectRuns = std::atol(argv[++i]);
+		} else if (std::strcmp(argv[i], "--first-run") == 0 && i + 1 < argc) {
+			expectFirstRun = std::atol(argv[++i]);
+		} else if (argv[i][0] == '-' || path) {
+			return 2;
+		} else {
+			path = argv[i];
+		}
+	}
+	if (!path) {
+		return 2;
+	}
+
+	FILE* in = std::fopen(path, "rb");
+	if (!in) {
+		std::perror(path);
+		return 1;
+	}
+	heli::TelemetryDecoder decoder;
+	std::vector<heli::StatusFrame> frames;
+	std::vector<heli::RawFrame> others;
+	uint8_t buf[256];
+	size_t n;
+
+	while ((n = std::fread(buf, 1, sizeof(buf), in)) > 0) {
+		decoder.feed(buf, n, frames, nullptr, nullptr, &others);
+	}
+	std::fclose(in);
+	if (decoder.stats().crcErrors || decoder.stats().framingErrors) {
+		fail("stream errors", decoder.stats().crcErrors
+				+ decoder.stats().framingErrors);
+	}
+
+	std::vector<std::vector<uint32_t> > records;
+	bool ended = false;
+	for (size_t i = 0; i < others.size(); i++) {
+		const std::vector<uint8_t>& p = others[i].payload;
+
+		if (others[i].type != TELEM_FLIGHTLOG) {
+			continue;
+		}
+		if (ended) {
+			fail("frames after the end of the dump", i);
+			break;
+		}
+		if (p.size() < 3 || p.size() != 3u + p[2] * LOG_RECORD_WORDS * 4) {
+			fail("dump frame of the wrong length", p.size());
+			continue;
+		}
+		if (p[2] == 0) {
+			ended = true;
+		}
+		for (int r = 0; r < p[2]; r++) {
+			std::vector<uint32_t> record(LOG_RECORD_WORDS);
+
+			for (int w = 0; w < LOG_RECORD_WORDS; w++) {
+				const uint8_t* b = &p[3 + (r * LOG_RECORD_WORDS + w) * 4];
+				record[w] = b[0] | (b[1] << 8) | (b[2] << 16)
+						| (static_cast<uint32_t>(b[3]) << 24);
+			}
+			records.push_back(record);
+		}
+	}
+	if (!ended) {
+		fail("dump not complete, records", records.size());
+	}
+
+	long old = 0;
+	long runs = 0;
+	long firstRun = 0;
+	for (size_t i = 0; i < records.size(); i++) {
+		const std::vector<uint32_t>& r = records[i];
+		bool isOld = r[0] >= OLD_TIME_MS;
+
+		if (r[LOG_RECORD_WORDS - 1] != checkWord(r.data())) {
+			fail("bad check word in record", i);
+		}
+		if (isOld) {
+			old++;
+			if (runs > 0) {
+				fail("old record after new ones", i);
+			} else if (i > 0 && r[0] != records[i - 1][0] + STEP_MS) {
+				fail("old records out of order at", i);
+			}
+		} else {
+			// A new run starts at the first new record, and wherever the
+			// time goes back
+			if (runs == 0 || r[0] <= records[i - 1][0]) {
+				runs++;
+			}
+			if (runs == 1) {
+				firstRun++;
+			}
+		}
+	}
+
+	if (expectOld >= 0 && old != expectOld) {
+		fail("old records", old);
+	}
+	if (expectRuns >= 0 && runs != expectRuns) {
+		fail("runs of new records", runs);
+	}
+	if (expectFirstRun >= 0 && firstRun != expectFirstRun) {
+		fail("records in the first run", firstRun);
+	}
+	std::printf("%lu records: %ld old, %ld runs of new, %ld in the first: %s\n",
+			static_cast<unsigned long>(records.size()), old, runs, firstRun,
+			failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	int status = 2;
+
+	if (argc == 3 && std::strcmp(argv[1], "seed") == 0) {
+		status = seed(argv[2]);
+	} else if (argc >= 3 && std::strcmp(argv[1], "check") == 0) {
+		status = check(argc, argv);
+	}
+	if (status == 2) {
+		std::fprintf(stderr, "usage: %s seed image\n"
+				"       %s check [--old n] [--runs n] [--first-run n] dump\n",
+				argv[0], argv[0]);
+	}
+	return status;
+}
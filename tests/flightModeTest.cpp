@@ -0,0 +1,130 @@
+/*
+ * flightModeTest.cpp
+ *
+ * Unit test of the flight mode state machine (flightMode.c): every event
+ * in every mode, against the transitions, actions, tasks and clock
+ * profiles listed in flightMode.h. The actions are stubs that record
+ * their calls.
+ *
+ * Usage: flightModeTest
+ *  Each failed check is printed, and the exit status is 1 if any failed.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+extern "C" {
+#include "globals.h"
+#include "flightMode.h"
+}
+
+#include <cstdio>
+#include <string>
+
+namespace {
+
+const char* const MODE_NAMES[] = {"OFF", "STARTING", "ON", "STOPPING"};
+const char* const EVENT_NAMES[] = {"SELECT", "AIRBORNE", "LAND",
+	"TOUCHDOWN", "FAULT"};
+const int NUM_MODES = 4;
+
+// Actions called since the log was last cleared, in order
+std::string actions;
+
+// What each event does in each mode: the mode it ends in, including any
+// event raised by an entry action, and the actions run on the way
+struct Transition {
+	int mode;
+	const char* actions;
+};
+
+const Transition EXPECTED[NUM_MODES][NUM_FM_EVENTS] = {
+	// HELI_OFF: SELECT starts the motors, and the heli is then airborne
+	{{HELI_ON, "powerUp "}, {HELI_OFF, ""}, {HELI_OFF, ""},
+		{HELI_OFF, ""}, {HELI_OFF, ""}},
+	// HELI_STARTING
+	{{HELI_STARTING, ""}, {HELI_ON, ""}, {HELI_STARTING, ""},
+		{HELI_STARTING, ""}, {HELI_OFF, "motorsOff "}},
+	// HELI_ON: landing and a fault both stop auto-tuning and land
+	{{HELI_ON, ""}, {HELI_ON, ""},
+		{HELI_STOPPING, "stopAutoTune beginLanding "},
+		{HELI_ON, ""},
+		{HELI_STOPPING, "stopAutoTune beginLanding "}},
+	// HELI_STOPPING
+	{{HELI_STOPPING, ""}, {HELI_STOPPING, ""}, {HELI_STOPPING, ""},
+		{HELI_OFF, "motorsOff "}, {HELI_STOPPING, ""}}
+};
+
+// Tasks enabled and clock profile of each mode
+const int EXPECTED_TASKS[NUM_MODES] = {
+	FM_TASK_CALIBRATE | FM_TASK_FLASH_ERASE, 0,
+	FM_TASK_CONTROL | FM_TASK_SETPOINTS, FM_TASK_CONTROL};
+const int EXPECTED_CLOCK[NUM_MODES] = {CLOCK_LANDED, CLOCK_FLYING,
+	CLOCK_FLYING, CLOCK_FLYING};
+const int ALL_TASKS[] = {FM_TASK_CONTROL, FM_TASK_SETPOINTS,
+	FM_TASK_CALIBRATE, FM_TASK_FLASH_ERASE};
+
+int failures = 0;
+
+} // namespace
+
+// Stubs of the actions the state machine calls
+extern "C" {
+volatile int _heliState = HELI_OFF;
+
+void motorsOff(void) {
+	actions += "motorsOff ";
+}
+
+void powerUp(void) {
+	actions += "powerUp ";
+}
+
+void beginLanding(void) {
+	actions += "beginLanding ";
+}
+
+void stopAutoTune(void) {
+	actions += "stopAutoTune ";
+}
+}
+
+int main() {
+	for (int mode = 0; mode < NUM_MODES; mode++) {
+		for (int event = 0; event < NUM_FM_EVENTS; event++) {
+			const Transition& expected = EXPECTED[mode][event];
+
+			_heliState = mode;
+			actions.clear();
+			flightModeEvent(event);
+			if (_heliState != expected.mode || actions != expected.actions) {
+				std::fprintf(stderr, "flightModeTest: %s + %s: got %s (%s), "
+						"expected %s (%s)\n", MODE_NAMES[mode],
+						EVENT_NAMES[event], MODE_NAMES[_heliState],
+						actions.c_str(), MODE_NAMES[expected.mode],
+						expected.actions);
+				failures++;
+			}
+		}
+
+		_heliState = mode;
+		for (unsigned int i = 0; i < sizeof(ALL_TASKS) / sizeof(ALL_TASKS[0]);
+				i++) {
+			int runs = (EXPECTED_TASKS[mode] & ALL_TASKS[i]) != 0;
+
+			if (flightModeRuns(ALL_TASKS[i]) != runs) {
+				std::fprintf(stderr, "flightModeTest: %s runs tasks 0x%x: "
+						"got %d\n", MODE_NAMES[mode], ALL_TASKS[i], !runs);
+				failures++;
+			}
+		}
+		if (flightModeClock() != EXPECTED_CLOCK[mode]) {
+			std::fprintf(stderr, "flightModeTest: %s clock profile: got %d\n",
+					MODE_NAMES[mode], flightModeClock());
+			failures++;
+		}
+	}
+
+	std::printf("%d modes, %d events: %s\n", NUM_MODES, NUM_FM_EVENTS,
+			failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,365 @@
+/*
+ * formatBench.cpp
+ *
+ * Benchmark of the formatting module (format.c) against the snprintf()
+ * calls it replaced. Each fmt* function is first checked against the
+ * snprintf() format that does the same, over edge values and random
+ * ones. Then the status message of sendStatus() and the text page lines
+ * of display.c are built both ways from random values, and the time per
+ * message or page is printed. The times are on the host, so only their
+ * ratio carries over to the target.
+ *
+ * Usage: formatBench [rounds]
+ *  rounds  Messages and pages built each way per timing (default 200000);
+ *          each timing is the best of five
+ *  Each output that differs from snprintf()'s is printed, and the exit
+ *  status is 1 if any did.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+extern "C" {
+#include "format.h"
+}
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Display line width (display.c), and the frame buffer the status message
+// is built in (FRAME_BUF_SIZE, serialLink.h)
+const unsigned int LINE_WIDTH = 19;
+const size_t MESSAGE_LEN = 256;
+
+int failures = 0;
+
+// Defeats the optimiser: every message built is summed into this
+volatile unsigned long sink = 0;
+
+/**
+ * Compare an output and its length against snprintf()'s.
+ */
+void check(const char* what, long value, const char* text, unsigned int len,
+		const char* expected) {
+	if (std::strcmp(text, expected) != 0 || len != std::strlen(expected)) {
+		std::fprintf(stderr, "formatBench: %s(%ld): \"%s\" (%u), snprintf "
+				"\"%s\"\n", what, value, text, len, expected);
+		failures++;
+	}
+}
+
+/**
+ * Check each function against snprintf() for one value, appended after
+ * some text already in the buffer.
+ */
+void checkValue(long value) {
+	char buf[64];
+	char expected[64];
+	unsigned long magnitude = value < 0 ? 0ul - static_cast<unsigned long>(value)
+			: static_cast<unsigned long>(value);
+	unsigned int len;
+
+	len = fmtUint(buf, fmtStr(buf, 0, "x="), static_cast<unsigned long>(value));
+	std::snprintf(expected, sizeof(expected), "x=%lu",
+			static_cast<unsigned long>(value));
+	check("fmtUint", value, buf, len, expected);
+
+	len = fmtInt(buf, fmtStr(buf, 0, "x="), value);
+	std::snprintf(expected, sizeof(expected), "x=%ld", value);
+	check("fmtInt", value, buf, len, expected);
+
+	for (unsigned int width = 0; width <= 14; width += 7) {
+		len = fmtIntPadded(buf, fmtStr(buf, 0, "x="), value, width);
+		std::snprintf(expected, sizeof(expected), "x=%*ld", width, value);
+		check("fmtIntPadded", value, buf, len, expected);
+	}
+
+	for (unsigned int decimals = 0; decimals <= 9; decimals += 3) {
+		unsigned long scale = 1;
+
+		for (unsigned int i = 0; i < decimals; i++) {
+			scale *= 10;
+		}
+		len = fmtFixed(buf, fmtStr(buf, 0, "x="), value, decimals);
+		if (decimals == 0) {
+			std::snprintf(expected, sizeof(expected), "x=%ld", value);
+		} else {
+			std::snprintf(expected, sizeof(expected), "x=%s%lu.%0*lu",
+					value < 0 ? "-" : "", magnitude / scale, decimals,
+					magnitude % scale);
+		}
+		check("fmtFixed", value, buf, len, expected);
+	}
+
+	len = fmtPad(buf, fmtInt(buf, 0, value), LINE_WIDTH);
+	std::snprintf(expected, sizeof(expected), "%-*ld", LINE_WIDTH, value);
+	check("fmtPad", value, buf, len, expected);
+}
+
+// Values shown in one status message or text page
+struct Values {
+	long desiredYaw100;
+	long yaw100;
+	long desiredAltitude;
+	long avgAltitude;
+	unsigned long mainDuty100;
+	unsigned long tailDuty100;
+	long heliState;
+	unsigned long minPeriod;
+	unsigned long maxPeriod;
+	unsigned long dropped;
+	unsigned long highWater;
+	unsigned long busy10;
+	unsigned long isr10;
+};
+
+/**
+ * Build the status message of sendStatus() with the format module.
+ */
+unsigned int statusFmt(char* string, const Values& v) {
+	unsigned int len;
+
+	len = fmtStr(string, 0, "Desired yaw: ");
+	len = fmtInt(string, len, (v.desiredYaw100 + 50) / 100);
+	len = fmtStr(string, len, " deg \nActual yaw: ");
+	len = fmtInt(string, len, (v.yaw100 + 50) / 100);
+	len = fmtStr(string, len, " deg \nDesired altitude: ");
+	len = fmtInt(string, len, v.desiredAltitude);
+	len = fmtStr(string, len, "% \nActual altitude: ");
+	len = fmtInt(string, len, v.avgAltitude);
+	len = fmtStr(string, len, "% \nMain rotor: ");
+	len = fmtInt(string, len, (v.mainDuty100 + 50) / 100);
+	len = fmtStr(string, len, "% \nTail rotor: ");
+	len = fmtInt(string, len, (v.tailDuty100 + 50) / 100);
+	len = fmtStr(string, len, "% \nHeli mode: ");
+	len = fmtStr(string, len, "Flying");
+	len = fmtStr(string, len, " \nControl period: ");
+	len = fmtUint(string, len, v.minPeriod);
+	len = fmtStr(string, len, "-");
+	len = fmtUint(string, len, v.maxPeriod);
+	len = fmtStr(string, len, " us \nUART dropped: ");
+	len = fmtUint(string, len, v.dropped);
+	len = fmtStr(string, len, " max: ");
+	len = fmtUint(string, len, v.highWater);
+	len = fmtStr(string, len, " \n\n");
+	return len;
+}
+
+/**
+ * Build the same status message with snprintf(), as before the module.
+ */
+unsigned int statusPrintf(char* string, const Values& v) {
+	return std::snprintf(string, MESSAGE_LEN, "Desired yaw: %ld deg \n"
+			"Actual yaw: %ld deg \nDesired altitude: %ld%% \n"
+			"Actual altitude: %ld%% \nMain rotor: %ld%% \nTail rotor: %ld%% \n"
+			"Heli mode: %s \nControl period: %lu-%lu us \n"
+			"UART dropped: %lu max: %lu \n\n",
+			(v.desiredYaw100 + 50) / 100, (v.yaw100 + 50) / 100,
+			v.desiredAltitude, v.avgAltitude,
+			static_cast<long>((v.mainDuty100 + 50) / 100),
+			static_cast<long>((v.tailDuty100 + 50) / 100), "Flying",
+			v.minPeriod, v.maxPeriod, v.dropped, v.highWater);
+}
+
+/**
+ * Build the eight lines of the text page as display.c does, each padded
+ * to LINE_WIDTH.
+ * @return Total length of the lines
+ */
+unsigned int pageFmt(char lines[][LINE_WIDTH + 12], const Values& v) {
+	unsigned int len;
+	unsigned int total = 0;
+
+	len = fmtStr(lines[0], 0, "Altitude: ");
+	len = fmtInt(lines[0], len, v.avgAltitude);
+	len = fmtStr(lines[0], len, "%");
+	total += fmtPad(lines[0], len, LINE_WIDTH);
+	len = fmtStr(lines[1], 0, "Desired: ");
+	len = fmtInt(lines[1], len, v.desiredAltitude);
+	len = fmtStr(lines[1], len, "%");
+	total += fmtPad(lines[1], len, LINE_WIDTH);
+	len = fmtStr(lines[2], 0, "Yaw*100: ");
+	len = fmtInt(lines[2], len, v.yaw100);
+	total += fmtPad(lines[2], len, LINE_WIDTH);
+	len = fmtStr(lines[3], 0, "Desired*100: ");
+	len = fmtInt(lines[3], len, v.desiredYaw100);
+	total += fmtPad(lines[3], len, LINE_WIDTH);
+	len = fmtStr(lines[4], 0, "Main rotor: ");
+	len = fmtFixed(lines[4], len, v.mainDuty100, 2);
+	len = fmtStr(lines[4], len, "%");
+	total += fmtPad(lines[4], len, LINE_WIDTH);
+	len = fmtStr(lines[5], 0, "Tail rotor: ");
+	len = fmtFixed(lines[5], len, v.tailDuty100, 2);
+	len = fmtStr(lines[5], len, "%");
+	total += fmtPad(lines[5], len, LINE_WIDTH);
+	len = fmtStr(lines[6], 0, "Heli state: ");
+	len = fmtInt(lines[6], len, v.heliState);
+	total += fmtPad(lines[6], len, LINE_WIDTH);
+	len = fmtStr(lines[7], 0, "CPU ");
+	len = fmtUint(lines[7], len, (v.busy10 + 5) / 10);
+	len = fmtStr(lines[7], len, "% (ISR ");
+	len = fmtUint(lines[7], len, (v.isr10 + 5) / 10);
+	len = fmtStr(lines[7], len, "%)");
+	total += fmtPad(lines[7], len, LINE_WIDTH);
+	return total;
+}
+
+/**
+ * Build the same lines with snprintf(), as before the module.
+ */
+unsigned int pagePrintf(char lines[][LINE_WIDTH + 12], const Values& v) {
+	const size_t size = LINE_WIDTH + 12;
+	const int w = LINE_WIDTH;
+	char field[LINE_WIDTH + 12];
+	unsigned int total = 0;
+
+	std::snprintf(field, size, "Altitude: %ld%%", v.avgAltitude);
+	total += std::snprintf(lines[0], size, "%-*s", w, field);
+	std::snprintf(field, size, "Desired: %ld%%", v.desiredAltitude);
+	total += std::snprintf(lines[1], size, "%-*s", w, field);
+	total += std::snprintf(lines[2], size, "Yaw*100: %-*ld", w - 9, v.yaw100);
+	total += std::snprintf(lines[3], size, "Desired*100: %-*ld", w - 13,
+			v.desiredYaw100);
+	std::snprintf(field, size, "Main rotor: %lu.%02lu%%", v.mainDuty100 / 100,
+			v.mainDuty100 % 100);
+	total += std::snprintf(lines[4], size, "%-*s", w, field);
+	std::snprintf(field, size, "Tail rotor: %lu.%02lu%%", v.tailDuty100 / 100,
+			v.tailDuty100 % 100);
+	total += std::snprintf(lines[5], size, "%-*s", w, field);
+	total += std::snprintf(lines[6], size, "Heli state: %-*ld", w - 12,
+			v.heliState);
+	std::snprintf(field, size, "CPU %lu%% (ISR %lu%%)", (v.busy10 + 5) / 10,
+			(v.isr10 + 5) / 10);
+	total += std::snprintf(lines[7], size, "%-*s", w, field);
+	return total;
+}
+
+/**
+ * Random values in the ranges the heli shows.
+ */
+Values randomValues(std::mt19937& random) {
+	Values v;
+
+	v.desiredYaw100 = static_cast<long>(random() % 69001) - 34500;
+	v.yaw100 = static_cast<long>(random() % 72001) - 36000;
+	v.desiredAltitude = random() % 101;
+	v.avgAltitude = static_cast<long>(random() % 111) - 5;
+	v.mainDuty100 = random() % 10001;
+	v.tailDuty100 = random() % 10001;
+	v.heliState = random() % 4;
+	v.minPeriod = 499000 + random() % 1000;
+	v.maxPeriod = 500000 + random() % 25000;
+	v.dropped = random() % 3 == 0 ? random() % 1000 : 0;
+	v.highWater = random() % 512;
+	v.busy10 = random() % 1001;
+	v.isr10 = random() % (v.busy10 + 1);
+	return v;
+}
+
+/**
+ * Time a way of building messages or pages over the values, best of five.
+ * @return Nanoseconds per message or page
+ */
+template <typename Build>
+double timeBuild(const std::vector<Values>& values, unsigned long rounds,
+		Build build) {
+	double best = 0;
+
+	for (int run = 0; run < 5; run++) {
+		auto start = std::chrono::steady_clock::now();
+		unsigned long sum = 0;
+
+		for (unsigned long i = 0; i < rounds; i++) {
+			sum += build(values[i % values.size()]);
+		}
+		auto stop = std::chrono::steady_clock::now();
+		double ns = std::chrono::duration<double, std::nano>(stop - start)
+				.count() / rounds;
+
+		sink = sink + sum;
+		if (run == 0 || ns < best) {
+			best = ns;
+		}
+	}
+	return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned long rounds = argc > 1 ? std::strtoul(argv[1], 0, 10) : 200000;
+	std::mt19937 random(1);
+	std::vector<Values> values;
+	const long edges[] = {0, 1, -1, 9, 10, -10, 99, 100, 12345, -12345,
+			999999999, 1000000000, LONG_MAX, LONG_MIN, LONG_MIN + 1};
+
+	if (rounds == 0) {
+		std::fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+		return 2;
+	}
+
+	// Each function writes what snprintf() would
+	for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+		checkValue(edges[i]);
+	}
+	for (int i = 0; i < 100000; i++) {
+		long value = static_cast<long>(random()) - 0x7FFFFFFFl;
+
+		checkValue(value >> (random() % 32));
+	}
+
+	// So do the status message and the text page
+	for (int i = 0; i < 1000; i++) {
+		char message[MESSAGE_LEN];
+		char expected[MESSAGE_LEN];
+		char lines[8][LINE_WIDTH + 12];
+		char expectedLines[8][LINE_WIDTH + 12];
+		unsigned int len;
+
+		values.push_back(randomValues(random));
+		len = statusFmt(message, values.back());
+		statusPrintf(expected, values.back());
+		check("status message", i, message, len, expected);
+		pageFmt(lines, values.back());
+		pagePrintf(expectedLines, values.back());
+		for (int l = 0; l < 8; l++) {
+			check("page line", l, lines[l], std::strlen(lines[l]),
+					expectedLines[l]);
+		}
+	}
+
+	// Time them
+	double statusFmtNs = timeBuild(values, rounds, [](const Values& v) {
+		char message[MESSAGE_LEN];
+
+		return statusFmt(message, v) + static_cast<unsigned char>(message[20]);
+	});
+	double statusPrintfNs = timeBuild(values, rounds, [](const Values& v) {
+		char message[MESSAGE_LEN];
+
+		return statusPrintf(message, v) + static_cast<unsigned char>(message[20]);
+	});
+	double pageFmtNs = timeBuild(values, rounds, [](const Values& v) {
+		char lines[8][LINE_WIDTH + 12];
+
+		return pageFmt(lines, v) + static_cast<unsigned char>(lines[4][13]);
+	});
+	double pagePrintfNs = timeBuild(values, rounds, [](const Values& v) {
+		char lines[8][LINE_WIDTH + 12];
+
+		return pagePrintf(lines, v) + static_cast<unsigned char>(lines[4][13]);
+	});
+
+	std::printf("status message: fmt %.0f ns, snprintf %.0f ns (%.1fx)\n",
+			statusFmtNs, statusPrintfNs, statusPrintfNs / statusFmtNs);
+	std::printf("text page: fmt %.0f ns, snprintf %.0f ns (%.1fx)\n",
+			pageFmtNs, pagePrintfNs, pagePrintfNs / pageFmtNs);
+	std::printf("outputs match snprintf: %s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,260 @@
+/*
+ * frameBufferTest.cpp
+ *
+ * Unit test of the shadow frame buffer (frameBuffer.c). The display is a
+ * stub that keeps the image sent to it. Random pixels, rectangles and
+ * strings, some partly off the display, are drawn into both the frame
+ * buffer and a model of it, with flushes of a few rows between them.
+ * Each row sent must be exactly the span changed since it was last
+ * sent, and once flushed, the display must hold the same image as the
+ * frame buffer and the model. A row that keeps changing must not hold
+ * up the others.
+ *
+ * Usage: frameBufferTest
+ *  Each failed check is printed, and the exit status is 1 if any failed.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+extern "C" {
+#include "frameBuffer.h"
+#include "inc/hw_types.h"
+#include "drivers/rit128x96x4.h"
+}
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+namespace {
+
+// The image on the stub display, and the pixel bytes sent to it
+unsigned char display[FB_HEIGHT][FB_ROW_BYTES];
+unsigned long displayBytes = 0;
+
+// Model of the frame buffer, and of the changed span of each row in
+// bytes, empty (start == end) if unchanged
+unsigned char model[FB_HEIGHT][FB_ROW_BYTES];
+unsigned int spanStart[FB_HEIGHT];
+unsigned int spanEnd[FB_HEIGHT];
+
+int failures = 0;
+
+void fail(const char* what, long value) {
+	std::fprintf(stderr, "frameBufferTest: %s (%ld)\n", what, value);
+	failures++;
+}
+
+unsigned char getPixel(const unsigned char image[][FB_ROW_BYTES],
+		unsigned int x, unsigned int y) {
+	unsigned char b = image[y][x / 2];
+
+	return x & 1 ? b & 0x0F : b >> 4;
+}
+
+void setModelPixel(unsigned int x, unsigned int y, unsigned char level) {
+	unsigned char* p = &model[y][x / 2];
+
+	*p = x & 1 ? (*p & 0xF0) | level : (*p & 0x0F) | (level << 4);
+}
+
+void markModel(unsigned int y, unsigned int x0, unsigned int x1) {
+	if (spanStart[y] == spanEnd[y]) {
+		spanStart[y] = x0 / 2;
+		spanEnd[y] = x1 / 2 + 1;
+	} else {
+		spanStart[y] = std::min(spanStart[y], x0 / 2);
+		spanEnd[y] = std::max(spanEnd[y], x1 / 2 + 1);
+	}
+}
+
+/**
+ * Fill a rectangle in the model, clipped to the display.
+ */
+void modelRect(unsigned int x, unsigned int y, unsigned int width,
+		unsigned int height, unsigned char level) {
+	if (x >= FB_WIDTH || y >= FB_HEIGHT || width == 0) {
+		return;
+	}
+	width = std::min(width, FB_WIDTH - x);
+	height = std::min(height, FB_HEIGHT - y);
+	for (unsigned int j = y; j < y + height; j++) {
+		for (unsigned int i = x; i < x + width; i++) {
+			setModelPixel(i, j, level);
+		}
+		markModel(j, x, x + width - 1);
+	}
+}
+
+/**
+ * Draw a string into the frame buffer and the model. The model has no
+ * font, so it takes each character cell from the frame buffer after
+ * checking that the cell holds only the blank spacing and pixels of the
+ * string's level.
+ */
+void drawString(const char* text, unsigned int x, unsigned int y,
+		unsigned char level) {
+	const unsigned char (*pixels)[FB_ROW_BYTES] =
+			reinterpret_cast<const unsigned char (*)[FB_ROW_BYTES]>(fbPixels());
+
+	fbDrawString(text, x, y, level);
+	for (; *text != '\0' && x + FB_CHAR_WIDTH <= FB_WIDTH;
+			text++, x += FB_CHAR_WIDTH) {
+		modelRect(x, y, FB_CHAR_WIDTH, FB_CHAR_HEIGHT, 0);
+		for (unsigned int j = y; j < y + FB_CHAR_HEIGHT && j < FB_HEIGHT;
+				j++) {
+			for (unsigned int i = x; i < x + FB_CHAR_WIDTH; i++) {
+				unsigned char p = getPixel(pixels, i, j);
+
+				if (p != 0 && (p != level || i == x + FB_CHAR_WIDTH - 1
+						|| j == y + FB_CHAR_HEIGHT - 1)) {
+					fail("character cell pixel, column", i);
+				}
+				setModelPixel(i, j, p);
+			}
+		}
+	}
+}
+
+/**
+ * Flush until nothing is left to send, and check the rows sent by each
+ * call and the image on the display.
+ */
+void flushAll(const char* name) {
+	unsigned int rows = 0;
+	unsigned int sent;
+
+	for (unsigned int y = 0; y < FB_HEIGHT; y++) {
+		rows += spanStart[y] != spanEnd[y];
+	}
+	for (unsigned int calls = 0; calls <= FB_HEIGHT / FB_FLUSH_ROWS; calls++) {
+		sent = fbFlush(FB_FLUSH_ROWS);
+		if (sent != std::min(rows, static_cast<unsigned int>(FB_FLUSH_ROWS))) {
+			std::fprintf(stderr, "frameBufferTest: %s: %u rows flushed with %u "
+					"changed\n", name, sent, rows);
+			failures++;
+		}
+		rows -= std::min(rows, sent);
+	}
+	if (std::memcmp(fbPixels(), model, sizeof(model)) != 0) {
+		std::fprintf(stderr, "frameBufferTest: %s: frame buffer differs from "
+				"the model\n", name);
+		failures++;
+	}
+	if (std::memcmp(display, model, sizeof(model)) != 0) {
+		std::fprintf(stderr, "frameBufferTest: %s: display differs from the "
+				"model\n", name);
+		failures++;
+	}
+	if (fbBytesSent() != displayBytes) {
+		std::fprintf(stderr, "frameBufferTest: %s: %lu bytes counted, %lu "
+				"sent\n", name, fbBytesSent(), displayBytes);
+		failures++;
+	}
+}
+
+} // namespace
+
+// Stub of the display driver. Each row sent must be exactly the span
+// changed since it was last sent.
+extern "C" {
+void RIT128x96x4ImageDraw(const unsigned char* pucImage, unsigned long ulX,
+		unsigned long ulY, unsigned long ulWidth, unsigned long ulHeight) {
+	if ((ulX & 1) || (ulWidth & 1) || ulHeight != 1
+			|| ulX + ulWidth > FB_WIDTH || ulY >= FB_HEIGHT) {
+		fail("image drawn off the display or off whole bytes, row", ulY);
+		return;
+	}
+	if (ulX / 2 != spanStart[ulY] || ulWidth / 2 != spanEnd[ulY]
+			- spanStart[ulY] || ulWidth == 0) {
+		fail("span sent is not the span changed, row", ulY);
+	}
+	spanStart[ulY] = spanEnd[ulY] = 0;
+	std::memcpy(&display[ulY][ulX / 2], pucImage, ulWidth / 2);
+	displayBytes += ulWidth / 2;
+}
+}
+
+int main() {
+	std::mt19937 random(1);
+
+	// Clearing sends the whole display
+	std::memset(display, 0xFF, sizeof(display));
+	fbClear();
+	modelRect(0, 0, FB_WIDTH, FB_HEIGHT, 0);
+	flushAll("clear");
+
+	// Nothing changed, nothing sent
+	flushAll("unchanged");
+
+	// Random drawing, partly off the display, with a few rows flushed
+	// between the shapes, so that rows already sent change again
+	for (int pass = 0; pass < 200; pass++) {
+		int shapes = std::uniform_int_distribution<int>(1, 12)(random);
+		char name[32];
+
+		for (int s = 0; s < shapes; s++) {
+			unsigned int x = random() % (FB_WIDTH + 8);
+			unsigned int y = random() % (FB_HEIGHT + 8);
+			unsigned char level = random() % 16;
+
+			switch (random() % 3) {
+			case 0:
+				fbSetPixel(x, y, level);
+				if (x < FB_WIDTH && y < FB_HEIGHT) {
+					setModelPixel(x, y, level);
+					markModel(y, x, x);
+				}
+				break;
+			case 1: {
+				unsigned int width = random() % 40;
+				unsigned int height = random() % 20;
+
+				fbFillRect(x, y, width, height, level);
+				modelRect(x, y, width, height, level);
+				break;
+			}
+			default: {
+				char text[12];
+				int length = random() % (sizeof(text) - 1);
+
+				for (int i = 0; i < length; i++) {
+					// Includes characters outside the font
+					text[i] = static_cast<char>(random() % 0x90 + 1);
+				}
+				text[length] = '\0';
+				if (y < FB_HEIGHT) {
+					drawString(text, x, y, level);
+				}
+				break;
+			}
+			}
+			if (random() % 4 == 0) {
+				fbFlush(random() % (FB_FLUSH_ROWS + 1));
+			}
+		}
+		std::snprintf(name, sizeof(name), "pass %d", pass);
+		flushAll(name);
+	}
+
+	// A row redrawn before every flush still lets the others through
+	fbClear();
+	modelRect(0, 0, FB_WIDTH, FB_HEIGHT, 0);
+	std::memset(display, 0xFF, sizeof(display));
+	for (unsigned int calls = 0; calls < FB_HEIGHT / FB_FLUSH_ROWS + 1;
+			calls++) {
+		fbSetPixel(calls, 0, 15);
+		setModelPixel(calls, 0, 15);
+		markModel(0, calls, calls);
+		fbFlush(FB_FLUSH_ROWS);
+	}
+	if (std::memcmp(display[1], model[1],
+			sizeof(model) - sizeof(model[0])) != 0) {
+		fail("rows held up by a row that keeps changing", 0);
+	}
+
+	std::printf("%lu bytes sent: %s\n", fbBytesSent(),
+			failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,448 @@
+/*
+ * serialLinkTest.cpp
+ *
+ * Unit test of the UART0 transmit and receive queues (serialLink.c). The
+ * UART is a stub with a 16-byte Tx FIFO that sends one byte per step of
+ * a simulated line and raises the transmit interrupt when it drains to
+ * its trigger level. Built with UART_TX_DMA, a stub uDMA channel feeds it
+ * frames; otherwise the interrupt puts them into the FIFO. Random
+ * messages, with zero bytes, are queued or sent as frames between random
+ * stretches of line time: every message accepted must reach the line
+ * whole and in the order submitted, and every message that does not fit
+ * must be dropped whole and counted. Each frame's callback must be
+ * called once, after its last byte is sent (uDMA) or put into the FIFO,
+ * and a frame buffer must be free
+ * exactly when fewer than two frames are waiting. Characters also arrive
+ * while bytes are being put into the Tx FIFO, and their interrupt is
+ * taken at once unless UART0 is masked. Characters received while the
+ * receive queue is full must be counted and the rest kept in order.
+ *
+ * Usage: serialLinkTest, serialLinkDmaTest
+ *  Each failed check is printed, and the exit status is 1 if any failed.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+extern "C" {
+#include "inc/hw_types.h"
+#include "driverlib/uart.h"
+#include "driverlib/udma.h"
+#include "serialLink.h"
+#include "intPriority.h"
+}
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Depth of the stub UART's FIFOs, and the Tx level (2/8 full) at which
+// it raises the transmit interrupt
+const size_t FIFO_SIZE = 16;
+const size_t TX_TRIGGER = FIFO_SIZE * 2 / 8;
+
+std::deque<unsigned char> txFifo;
+std::deque<unsigned char> rxFifo;
+
+// The stub uDMA transfer: next byte to send and bytes left
+const unsigned char* dmaSource = 0;
+unsigned long dmaLeft = 0;
+bool dmaEnabled = false;
+
+// Bytes sent on the line so far
+std::vector<unsigned char> line;
+
+// Line position at which each frame sent but not yet done ends, and the
+// number of frames whose callback has been called
+std::deque<size_t> frameEnds;
+unsigned long framesDone = 0;
+
+// The UART0 interrupt: masked by IntDisable(), running, and raised while
+// masked or running, to be taken once it is neither
+bool uartMasked = false;
+bool inHandler = false;
+bool uartPending = false;
+
+// Characters received while bytes are put into the Tx FIFO: one every
+// RX_DURING_FILL bytes
+const unsigned long RX_DURING_FILL = 7;
+unsigned long rxDuringFill = 0;
+
+int failures = 0;
+
+void fail(const char* what, long value) {
+	std::fprintf(stderr, "serialLinkTest: %s (%ld)\n", what, value);
+	failures++;
+}
+
+/**
+ * Take the UART0 interrupt, and again for as long as it is raised while
+ * running.
+ */
+void interrupt(void) {
+	do {
+		uartPending = false;
+		inHandler = true;
+		UARTIntHandler();
+		inHandler = false;
+	} while (uartPending);
+}
+
+/**
+ * Raise the UART0 interrupt: taken now, preempting the background loop,
+ * unless it is masked or already running.
+ */
+void raiseInterrupt(void) {
+	if (uartMasked || inHandler) {
+		uartPending = true;
+	} else {
+		interrupt();
+	}
+}
+
+/**
+ * Run the line for a number of byte times: each sends the next byte in
+ * the Tx FIFO or, once it is empty, of the uDMA transfer. The transmit
+ * interrupt is raised when the FIFO drains to its trigger level and when
+ * a transfer completes.
+ */
+void runLine(unsigned int bytes) {
+	for (unsigned int i = 0; i < bytes; i++) {
+		if (!txFifo.empty()) {
+			line.push_back(txFifo.front());
+			txFifo.pop_front();
+			if (txFifo.size() == TX_TRIGGER || txFifo.empty()) {
+				raiseInterrupt();
+			}
+		} else if (dmaEnabled) {
+			line.push_back(*dmaSource++);
+			if (--dmaLeft == 0) {
+				dmaEnabled = false;
+				raiseInterrupt();
+			}
+		} else {
+			return;
+		}
+	}
+}
+
+// Bytes put into the Tx FIFO so far
+size_t fifoIn = 0;
+
+// Bytes expected on the line, in order, and how many of the first n of
+// them came from the queue rather than from frames, for each n
+std::vector<unsigned char> expected;
+std::vector<size_t> queuedAt(1, 0);
+
+void expect(const std::vector<unsigned char>& bytes, bool fromQueue) {
+	expected.insert(expected.end(), bytes.begin(), bytes.end());
+	for (size_t i = 0; i < bytes.size(); i++) {
+		queuedAt.push_back(queuedAt.back() + fromQueue);
+	}
+}
+
+/**
+ * @return Bytes taken from the queue so far
+ */
+size_t queueOut(void) {
+#ifdef UART_TX_DMA
+	// Frames bypass the FIFO
+	return fifoIn;
+#else
+	// Everything passes through the FIFO, in the order submitted
+	return queuedAt[fifoIn];
+#endif
+}
+
+// Called when a frame has been sent (uDMA) or put into the FIFO
+void frameDone(void) {
+#ifdef UART_TX_DMA
+	size_t done = line.size();
+#else
+	size_t done = fifoIn;
+#endif
+
+	if (frameEnds.empty() || done < frameEnds.front()) {
+		fail("frame done before its last byte was sent, frame", framesDone);
+	}
+	if (!frameEnds.empty()) {
+		frameEnds.pop_front();
+	}
+	framesDone++;
+}
+
+/**
+ * Take the characters received while bytes were put into the Tx FIFO
+ * from the receive queue, and check that none was lost or reordered.
+ */
+void drainReceived(void) {
+	static unsigned long taken = 0;
+	int c;
+
+	while ((c = UARTGetChar()) != -1) {
+		if (c != static_cast<int>(taken++ & 0xFF)) {
+			fail("character received during a fill", taken - 1);
+		}
+	}
+	if (taken != rxDuringFill) {
+		fail("characters received during fills missing", rxDuringFill - taken);
+		taken = rxDuringFill;
+	}
+}
+
+} // namespace
+
+// Stubs of the UART, uDMA and system control drivers, of the registers
+// written directly (HWREG), and of the interrupt bookkeeping
+extern "C" {
+volatile unsigned long* simRegister(unsigned long addr) {
+	static std::map<unsigned long, unsigned long> registers;
+
+	return &registers[addr];
+}
+
+void SysCtlPeripheralReset(unsigned long) {
+}
+
+void SysCtlPeripheralEnable(unsigned long) {
+}
+
+unsigned long SysCtlClockGet(void) {
+	return 50000000;
+}
+
+void GPIOPinTypeUART(unsigned long, unsigned char) {
+}
+
+void UARTConfigSetExpClk(unsigned long, unsigned long, unsigned long,
+		unsigned long) {
+}
+
+void UARTFIFOEnable(unsigned long) {
+}
+
+void UARTFIFOLevelSet(unsigned long, unsigned long, unsigned long) {
+}
+
+void UARTEnable(unsigned long) {
+}
+
+void UARTIntRegister(unsigned long, void (*)(void)) {
+}
+
+void UARTIntEnable(unsigned long, unsigned long) {
+}
+
+void UARTIntDisable(unsigned long, unsigned long) {
+}
+
+unsigned long UARTIntStatus(unsigned long, tBoolean) {
+	return UART_INT_TX;
+}
+
+void UARTIntClear(unsigned long, unsigned long) {
+}
+
+void UARTDMAEnable(unsigned long, unsigned long) {
+}
+
+tBoolean UARTSpaceAvail(unsigned long) {
+	return txFifo.size() < FIFO_SIZE;
+}
+
+tBoolean UARTCharPutNonBlocking(unsigned long, unsigned char ucData) {
+	if (txFifo.size() == FIFO_SIZE) {
+		return 0;
+	}
+	txFifo.push_back(ucData);
+	fifoIn++;
+	if (fifoIn % RX_DURING_FILL == 0) {
+		rxFifo.push_back(rxDuringFill++ & 0xFF);
+		raiseInterrupt();
+	}
+	return 1;
+}
+
+tBoolean UARTCharsAvail(unsigned long) {
+	return !rxFifo.empty();
+}
+
+long UARTCharGetNonBlocking(unsigned long) {
+	long c;
+
+	if (rxFifo.empty()) {
+		return -1;
+	}
+	c = rxFifo.front();
+	rxFifo.pop_front();
+	return c;
+}
+
+void uDMAEnable(void) {
+}
+
+void uDMAControlBaseSet(void*) {
+}
+
+void uDMAChannelAttributeDisable(unsigned long, unsigned long) {
+}
+
+void uDMAChannelControlSet(unsigned long, unsigned long) {
+}
+
+void uDMAChannelTransferSet(unsigned long, unsigned long, void* pvSrcAddr,
+		void*, unsigned long ulTransferSize) {
+	if (dmaEnabled) {
+		fail("transfer set while one is running", dmaLeft);
+	}
+	dmaSource = static_cast<const unsigned char*>(pvSrcAddr);
+	dmaLeft = ulTransferSize;
+}
+
+void uDMAChannelEnable(unsigned long) {
+	dmaEnabled = dmaLeft > 0;
+}
+
+tBoolean uDMAChannelIsEnabled(unsigned long) {
+	return dmaEnabled;
+}
+
+void IntDisable(unsigned long) {
+	uartMasked = true;
+}
+
+void IntEnable(unsigned long) {
+	uartMasked = false;
+	if (uartPending) {
+		interrupt();
+	}
+}
+
+void isrEnter(int, unsigned long) {
+}
+
+void isrExit(int) {
+}
+}
+
+int main() {
+	std::mt19937 random(1);
+	size_t accepted = 0; // Bytes queued, not counting frames
+	unsigned long dropped = 0;
+	unsigned int highWater = 0;
+	unsigned long frames = 0;
+
+	initConsole();
+	if (UARTSendRoom() != TX_BUF_SIZE - 1) {
+		fail("room when empty", UARTSendRoom());
+	}
+
+	// Messages of up to half the queue, queued faster than the line sends
+	// them, so that the queue wraps around many times and often fills.
+	// A third are sent as frames instead, when a frame buffer is free.
+	for (int i = 0; i < 5000; i++) {
+		std::vector<unsigned char> message(
+				std::uniform_int_distribution<size_t>(1, TX_BUF_SIZE / 2)(random));
+		size_t before;
+		bool fits;
+
+		for (size_t j = 0; j < message.size(); j++) {
+			message[j] = random() & 0xFF;
+		}
+		if (random() % 3 == 0) {
+			unsigned char* buf = UARTFrameBuffer();
+
+			if ((buf != 0) != (frames - framesDone < 2)) {
+				fail("frame buffer free with frames waiting",
+						frames - framesDone);
+			}
+			if (buf) {
+				message.resize(std::min<size_t>(message.size(),
+						FRAME_BUF_SIZE));
+				std::copy(message.begin(), message.end(), buf);
+				expect(message, false);
+				frameEnds.push_back(expected.size());
+				frames++;
+				UARTSendFrame(message.size(), frameDone);
+			}
+			runLine(std::uniform_int_distribution<unsigned int>(0, 200)(random));
+			drainReceived();
+			continue;
+		}
+
+		before = accepted - queueOut();
+		fits = message.size() <= TX_BUF_SIZE - 1 - before;
+		if (UARTSendRoom() != TX_BUF_SIZE - 1 - before) {
+			fail("room, message", i);
+		}
+		UARTSendBytes(message.data(), message.size());
+		if (fits) {
+			expect(message, true);
+			accepted += message.size();
+			highWater = std::max(highWater,
+					static_cast<unsigned int>(before + message.size()));
+		} else {
+			dropped += message.size();
+		}
+		if (getTxStats()->highWater != highWater) {
+			fail("high water, message", i);
+		}
+		runLine(std::uniform_int_distribution<unsigned int>(0, 200)(random));
+		drainReceived();
+	}
+
+	// A message that could never fit is dropped, however empty the queue
+	runLine(TX_BUF_SIZE + 2 * FRAME_BUF_SIZE + FIFO_SIZE);
+	drainReceived();
+	std::vector<unsigned char> tooLong(TX_BUF_SIZE, 'x');
+	UARTSendBytes(tooLong.data(), tooLong.size());
+	dropped += tooLong.size();
+
+	if (line != expected) {
+		size_t at = std::mismatch(line.begin(),
+				line.begin() + std::min(line.size(), expected.size()),
+				expected.begin()).first - line.begin();
+
+		fail("line differs from the messages accepted, at byte", at);
+	}
+	if (getTxStats()->dropped != dropped) {
+		fail("bytes dropped", getTxStats()->dropped);
+	}
+	if (dropped == 0 || highWater < TX_BUF_SIZE * 3 / 4) {
+		fail("queue never filled, high water", highWater);
+	}
+	if (framesDone != frames || frames == 0) {
+		fail("frames done", framesDone);
+	}
+
+	// Characters received while the receive queue is full are dropped
+	const int received = RX_BUF_SIZE + 50;
+	for (int i = 0; i < received; i++) {
+		rxFifo.push_back(i & 0xFF);
+		if (rxFifo.size() == FIFO_SIZE / 2) {
+			UARTIntHandler();
+		}
+	}
+	UARTIntHandler();
+	for (int i = 0; i < RX_BUF_SIZE - 1; i++) {
+		if (UARTGetChar() != (i & 0xFF)) {
+			fail("received character", i);
+			break;
+		}
+	}
+	if (UARTGetChar() != -1) {
+		fail("characters left in the receive queue", 0);
+	}
+	if (getTxStats()->rxDropped != received - (RX_BUF_SIZE - 1)) {
+		fail("characters dropped", getTxStats()->rxDropped);
+	}
+
+	std::printf("%lu bytes sent, %lu frames, %lu dropped, high water %u: "
+			"%s\n", static_cast<unsigned long>(line.size()), frames, dropped,
+			highWater, failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
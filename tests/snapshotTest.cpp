@@ -0,0 +1,96 @@
+/*
+ * snapshotTest.cpp
+ *
+ * Torture test of the sequence-locked state snapshot (globals.c). A timer
+ * signal stands in for the interrupt that publishes the snapshot: it
+ * preempts the reader at arbitrary points, as the control interrupt does
+ * on the target, and publishes globals that all hold the same count. The
+ * reader takes copies as fast as it can, and every copy must hold a
+ * single count, never going backwards.
+ *
+ * Usage: snapshotTest [seconds]
+ *  Runs for the given time (default 2). Prints the number of copies and
+ *  of publications seen, and exits with status 1 if any copy was torn.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+extern "C" {
+#include "globals.h"
+}
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <sys/time.h>
+
+namespace {
+
+// Microseconds between publications
+const long PUBLISH_INTERVAL_US = 20;
+
+volatile unsigned long published = 0;
+
+// The interrupt: sets every global to the next count and publishes them
+void publish(int) {
+	int n = static_cast<int>(++published);
+
+	_yaw100 = n;
+	_avgAltitude = n;
+	_desiredYaw100 = n;
+	_desiredAltitude = n;
+	_heliState = n & 3;
+	publishSnapshot();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	double seconds = argc > 1 ? std::atof(argv[1]) : 2;
+	struct sigaction action = {};
+	struct itimerval timer = {};
+	unsigned long copies = 0;
+	unsigned long changes = 0;
+	unsigned long torn = 0;
+	int last = 0;
+
+	action.sa_handler = publish;
+	sigaction(SIGALRM, &action, 0);
+	timer.it_interval.tv_usec = PUBLISH_INTERVAL_US;
+	timer.it_value.tv_usec = PUBLISH_INTERVAL_US;
+	setitimer(ITIMER_REAL, &timer, 0);
+
+	std::clock_t end = std::clock() + static_cast<std::clock_t>(seconds
+			* CLOCKS_PER_SEC);
+	while (std::clock() < end) {
+		heliSnapshot_t copy;
+
+		getSnapshot(&copy);
+		copies++;
+		if (copy.avgAltitude != copy.yaw100
+				|| copy.desiredYaw100 != copy.yaw100
+				|| copy.desiredAltitude != copy.yaw100
+				|| copy.heliState != (copy.yaw100 & 3)
+				|| copy.yaw100 < last) {
+			if (torn++ < 10) {
+				std::fprintf(stderr, "snapshotTest: torn copy %d %d %d %d %d "
+						"after %d\n", copy.yaw100, copy.avgAltitude,
+						copy.desiredYaw100, copy.desiredAltitude,
+						copy.heliState, last);
+			}
+		} else if (copy.yaw100 != last) {
+			changes++;
+			last = copy.yaw100;
+		}
+	}
+
+	timer.it_interval.tv_usec = 0;
+	timer.it_value.tv_usec = 0;
+	setitimer(ITIMER_REAL, &timer, 0);
+
+	std::printf("%lu copies, %lu publications, %lu seen, %lu torn: %s\n",
+			copies, static_cast<unsigned long>(published), changes, torn,
+			torn || changes == 0 ? "FAILED" : "ok");
+	return torn || changes == 0 ? 1 : 0;
+}
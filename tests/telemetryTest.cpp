@@ -0,0 +1,239 @@
+/*
+ * telemetryTest.cpp
+ *
+ * Unit test of the telemetry channels (telemetry.c): which channels are
+ * sampled at each tick for each subscribed rate, and how the samples are
+ * packed into channel frames. telemetry.c is linked against stubs of the
+ * serial link, whose output is decoded with tools/telemetryDecoder.cpp,
+ * and of the helicopter state.
+ *
+ * Usage: telemetryTest
+ *  Each failed check is printed, and the exit status is 1 if any failed.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+// Before the firmware headers, whose macros share names with its constants
+#include "telemetryDecoder.h"
+
+extern "C" {
+#include "globals.h"
+#include "telemetry.h"
+#include "serialLink.h"
+#include "autoTune.h"
+}
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what, long value) {
+	if (!ok) {
+		std::fprintf(stderr, "telemetryTest: %s (%ld)\n", what, value);
+		failures++;
+	}
+}
+
+// Everything sent on the stub serial link
+std::vector<uint8_t> sent;
+unsigned char frameBuffer[FRAME_BUF_SIZE];
+bool frameBufferFree = true;
+txStats_t txStats;
+
+// Current tick; each channel's getter returns a value made of the tick and
+// its channel number, so a value in the wrong place is seen
+unsigned long tick = 0;
+
+template <int N>
+long getChannel(void) {
+	return static_cast<long>(tick * 100 + N);
+}
+
+const channelGetter_t GETTERS[] = {
+	getChannel<0>, getChannel<1>, getChannel<2>, getChannel<3>,
+	getChannel<4>, getChannel<5>, getChannel<6>, getChannel<7>,
+	getChannel<8>, getChannel<9>, getChannel<10>, getChannel<11>,
+	getChannel<12>, getChannel<13>, getChannel<14>, getChannel<15>,
+	getChannel<16>, getChannel<17>, getChannel<18>, getChannel<19>,
+	getChannel<20>, getChannel<21>, getChannel<22>, getChannel<23>,
+	getChannel<24>, getChannel<25>, getChannel<26>, getChannel<27>,
+	getChannel<28>, getChannel<29>, getChannel<30>, getChannel<31>
+};
+const char* const NAMES[] = {
+	"c0", "c1", "c2", "c3", "c4", "c5", "c6", "c7", "c8", "c9", "c10",
+	"c11", "c12", "c13", "c14", "c15", "c16", "c17", "c18", "c19", "c20",
+	"c21", "c22", "c23", "c24", "c25", "c26", "c27", "c28", "c29", "c30",
+	"c31"
+};
+
+/**
+ * Run the telemetry for a number of ticks and decode what it sent.
+ */
+void run(unsigned int ticks, std::vector<heli::StatusFrame>& status,
+		std::vector<heli::ChannelFrame>& channels) {
+	heli::TelemetryDecoder decoder;
+
+	sent.clear();
+	for (unsigned int i = 0; i < ticks; i++) {
+		tick++;
+		telemetryTick(tick * (1000 / TELEMETRY_MAX_RATE_HZ));
+	}
+	decoder.feed(sent.data(), sent.size(), status, nullptr, &channels);
+	check(decoder.stats().crcErrors == 0 && decoder.stats().framingErrors == 0
+			&& decoder.stats().unknownFrames == 0, "frames not decoded",
+			decoder.stats().crcErrors + decoder.stats().framingErrors
+			+ decoder.stats().unknownFrames);
+}
+
+} // namespace
+
+// Stubs of the serial link and the helicopter state
+extern "C" {
+unsigned char* UARTFrameBuffer(void) {
+	return frameBufferFree ? frameBuffer : 0;
+}
+
+void UARTSendFrame(unsigned long ulCount, frameCallback_t) {
+	sent.insert(sent.end(), frameBuffer, frameBuffer + ulCount);
+}
+
+void UARTSendBytes(const unsigned char* pucBuffer, unsigned long ulCount) {
+	sent.insert(sent.end(), pucBuffer, pucBuffer + ulCount);
+}
+
+unsigned int UARTSendRoom(void) {
+	return TX_BUF_SIZE;
+}
+
+const txStats_t* getTxStats(void) {
+	return &txStats;
+}
+
+int autoTuneAxis(void) {
+	return TUNE_NONE;
+}
+
+unsigned int getDutyCycle100(unsigned long) {
+	return 500;
+}
+
+void getSnapshot(heliSnapshot_t* copy) {
+	std::memset(copy, 0, sizeof(*copy));
+}
+}
+
+int main() {
+	std::vector<heli::StatusFrame> status;
+	std::vector<heli::ChannelFrame> channels;
+
+	// Register every channel the mask can carry, and no more
+	for (int i = 0; i < TELEM_MAX_CHANNELS; i++) {
+		check(addTelemetryChannel(NAMES[i], GETTERS[i]) == i,
+				"channel number", i);
+	}
+	check(addTelemetryChannel("extra", GETTERS[0]) == -1,
+			"channel registered beyond the limit", TELEM_MAX_CHANNELS);
+	check(findTelemetryChannel("c17") == 17, "found c17 at",
+			findTelemetryChannel("c17"));
+	check(findTelemetryChannel("c32") == -1, "found c32 at",
+			findTelemetryChannel("c32"));
+
+	// Nothing is sent while nothing is subscribed
+	setTelemetryRate(0);
+	run(TELEMETRY_MAX_RATE_HZ, status, channels);
+	check(sent.empty(), "bytes sent with no subscriptions", sent.size());
+
+	// Rates are rounded to a whole number of ticks between samples
+	const struct {
+		int channel;
+		unsigned int rateHz;
+		unsigned int expectedHz; // Rate after rounding
+	} SUBS[] = {
+		{0, TELEMETRY_MAX_RATE_HZ, TELEMETRY_MAX_RATE_HZ},
+		{3, 50, 50},
+		{5, 7, 7}, // Every 28 ticks
+		{9, 3, 3}, // Every 66 ticks
+		{17, 1000, TELEMETRY_MAX_RATE_HZ},
+		{31, 10, 10} // The top bit of the mask
+	};
+	const int NUM_SUBS = sizeof(SUBS) / sizeof(SUBS[0]);
+	for (int i = 0; i < NUM_SUBS; i++) {
+		subscribeTelemetryChannel(SUBS[i].channel, SUBS[i].rateHz);
+		check(getTelemetryChannelRate(SUBS[i].channel) == SUBS[i].expectedHz,
+				"rounded rate of channel", SUBS[i].channel);
+	}
+
+	// Over one second, each channel is sampled at its next tick and then
+	// once every TELEMETRY_MAX_RATE_HZ / rate ticks, and only then
+	unsigned long firstTick = tick + 1;
+	run(TELEMETRY_MAX_RATE_HZ, status, channels);
+	check(status.empty(), "status frames at rate 0", status.size());
+	check(channels.size() == TELEMETRY_MAX_RATE_HZ, "channel frames",
+			channels.size());
+	for (size_t f = 0; f < channels.size(); f++) {
+		const heli::ChannelFrame& frame = channels[f];
+		unsigned long t = frame.timeMs / (1000 / TELEMETRY_MAX_RATE_HZ);
+		uint32_t expectedMask = 0;
+
+		for (int i = 0; i < NUM_SUBS; i++) {
+			unsigned int divider = TELEMETRY_MAX_RATE_HZ / SUBS[i].expectedHz;
+
+			if ((t - firstTick) % divider == 0) {
+				expectedMask |= 1u << SUBS[i].channel;
+			}
+		}
+		check(frame.mask == expectedMask, "mask at tick", t);
+		for (int c = 0; c < TELEM_MAX_CHANNELS; c++) {
+			if (frame.mask & (1u << c)) {
+				check(frame.values[c] == static_cast<int32_t>(t * 100 + c),
+						"value of channel", c);
+			}
+		}
+	}
+
+	// Unsubscribing stops a channel at once; changing a rate samples the
+	// channel at the next tick and then at the new rate
+	subscribeTelemetryChannel(0, 0);
+	subscribeTelemetryChannel(17, 0);
+	subscribeTelemetryChannel(3, 100);
+	channels.clear();
+	run(4, status, channels);
+	const uint32_t EXPECTED_MASKS[4] = {1u << 3, 0, 1u << 3, 0};
+	size_t next = 0;
+	for (int t = 0; t < 4; t++) {
+		uint32_t mask = 0;
+
+		if (next < channels.size() && channels[next].timeMs
+				== (tick - 3 + t) * (1000 / TELEMETRY_MAX_RATE_HZ)) {
+			mask = channels[next++].mask & ~(1u << 5 | 1u << 9 | 1u << 31);
+		}
+		check(mask == EXPECTED_MASKS[t], "mask after resubscribing, tick", t);
+	}
+
+	// The status rate is independent of the channels. A frame that finds
+	// no free frame buffer is skipped, and the next status frame says so.
+	for (int c = 0; c < TELEM_MAX_CHANNELS; c++) {
+		subscribeTelemetryChannel(c, 0);
+	}
+	setTelemetryRate(50);
+	status.clear();
+	run(TELEMETRY_MAX_RATE_HZ, status, channels);
+	check(status.size() == 50, "status frames at 50 Hz", status.size());
+	check(status.empty() || status.back().flags == 0, "flags",
+			status.empty() ? 0 : status.back().flags);
+	frameBufferFree = false;
+	run(4, status, channels);
+	frameBufferFree = true;
+	status.clear();
+	run(4, status, channels);
+	check(status.size() == 1 && (status[0].flags & TELEM_FLAG_SKIPPED),
+			"no skipped flag after a skipped frame", status.size());
+
+	std::printf("%d channels: %s\n", TELEM_MAX_CHANNELS,
+			failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * timing.c
+ *
+ * Cycle-accurate timing instrumentation using the Cortex-M3 DWT
+ * cycle counter.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "timing.h"
+
+#include "inc/hw_types.h"
+
+#include "driverlib/sysctl.h"
+
+/*
+ * Constants
+ */
+// Debug registers (ARMv7-M Architecture Reference Manual, C1.6 and C1.8)
+#define DEMCR 0xE000EDFC
+#define DEMCR_TRCENA 0x01000000
+#define DWT_CTRL 0xE0001000
+#define DWT_CTRL_CYCCNTENA 0x00000001
+#define DWT_CYCCNT 0xE0001004
+
+/**
+ * Enable the DWT cycle counter.
+ */
+void initCycleCounter (void) {
+	HWREG(DEMCR) |= DEMCR_TRCENA;
+	HWREG(DWT_CYCCNT) = 0;
+	HWREG(DWT_CTRL) |= DWT_CTRL_CYCCNTENA;
+}
+
+/**
+ * @return The current value of the free-running cycle counter
+ */
+unsigned long cycleCount (void) {
+	return HWREG(DWT_CYCCNT);
+}
+
+/**
+ * Convert a number of cycles at the current system clock to microseconds.
+ * @param cycles Number of cycles
+ * @return Time in microseconds
+ */
+unsigned long cyclesToUsec (unsigned long cycles) {
+	// Cycles per 10 us is whole in every clock profile (12.5 MHz is not
+	// a whole number of MHz), and the remainder is converted separately
+	// so that nothing overflows
+	unsigned long per10Usec = SysCtlClockGet() / 100000;
+
+	return cycles / per10Usec * 10 + cycles % per10Usec * 10 / per10Usec;
+}
+
+/**
+ * Record a run of an activity and update its period statistics.
+ * @param stats Statistics for the activity
+ * @param now Cycle count at the run
+ */
+void updatePeriodStats (periodStats_t* stats, unsigned long now) {
+	// Unsigned subtraction handles counter wrap-around
+	unsigned long period = now - stats->last;
+
+	if (stats->last != 0) {
+		if (stats->count == 0 || period < stats->minPeriod) {
+			stats->minPeriod = period;
+		}
+		if (stats->count == 0 || period > stats->maxPeriod) {
+			stats->maxPeriod = period;
+		}
+		stats->count++;
+	}
+	stats->last = now;
+}
+
+/**
+ * Clear the min. and max. period so that a new window is measured.
+ * The time of the previous run is kept.
+ * @param stats Statistics for the activity
+ */
+void resetPeriodStats (periodStats_t* stats) {
+	stats->count = 0;
+	stats->minPeriod = 0;
+	stats->maxPeriod = 0;
+}
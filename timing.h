@@ -0,0 +1,52 @@
+#ifndef TIMING_H_
+#define TIMING_H_
+
+/*
+ * timing.h
+ *
+ * Cycle-accurate timing instrumentation using the Cortex-M3 DWT
+ * cycle counter.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+// Statistics on the period between successive runs of an activity
+typedef struct {
+	unsigned long last; // Cycle count at the previous run
+	unsigned long count; // Number of periods measured
+	unsigned long minPeriod; // Shortest period in cycles
+	unsigned long maxPeriod; // Longest period in cycles
+} periodStats_t;
+
+/**
+ * Enable the DWT cycle counter.
+ */
+void initCycleCounter (void);
+
+/**
+ * @return The current value of the free-running cycle counter
+ */
+unsigned long cycleCount (void);
+
+/**
+ * Convert a number of cycles at the current system clock to microseconds.
+ * @param cycles Number of cycles
+ * @return Time in microseconds
+ */
+unsigned long cyclesToUsec (unsigned long cycles);
+
+/**
+ * Record a run of an activity and update its period statistics.
+ * @param stats Statistics for the activity
+ * @param now Cycle count at the run
+ */
+void updatePeriodStats (periodStats_t* stats, unsigned long now);
+
+/**
+ * Clear the min. and max. period so that a new window is measured.
+ * The time of the previous run is kept.
+ * @param stats Statistics for the activity
+ */
+void resetPeriodStats (periodStats_t* stats);
+
+#endif /* TIMING_H_ */
@@ -0,0 +1,80 @@
+/*
+ * blackBoxDecoder.cpp
+ *
+ * Host-side decoder for the black box flight recorder's blocks.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "blackBoxDecoder.h"
+
+namespace heli {
+
+namespace {
+
+// Dump frame header: version, type, block number, block count, trigger,
+// bytes used
+const size_t DUMP_HEADER_LEN = 6;
+
+/**
+ * Read one zigzag varint.
+ * @param p Position in the data, advanced past the value
+ * @param end End of the data
+ * @param value Set to the decoded value
+ * @return false if the data ends part way through the value
+ */
+bool getVarint(const uint8_t*& p, const uint8_t* end, int32_t& value) {
+	uint32_t code = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		if (p == end) {
+			return false;
+		}
+		uint8_t byte = *p++;
+		code |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			value = static_cast<int32_t>(code >> 1) ^ -static_cast<int32_t>(code & 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace
+
+const char* const BLACKBOX_FIELD_NAMES[BB_NUM_FIELDS] = {
+	"time_ms", "adc_raw", "altitude", "desired_altitude", "yaw100",
+	"desired_yaw100", "main_duty100", "tail_duty100", "state"
+};
+
+bool parseBlackBoxFrame(const uint8_t* payload, size_t len,
+		BlackBoxBlock& block) {
+	if (len < DUMP_HEADER_LEN || len != DUMP_HEADER_LEN + payload[5]) {
+		return false;
+	}
+	block.number = payload[2];
+	block.count = payload[3];
+	block.trigger = payload[4];
+	block.data.assign(payload + DUMP_HEADER_LEN, payload + len);
+	return true;
+}
+
+bool decodeBlackBoxBlock(const uint8_t* data, size_t len,
+		std::vector<BlackBoxRecord>& records) {
+	const uint8_t* p = data;
+	const uint8_t* end = data + len;
+	BlackBoxRecord record = BlackBoxRecord();
+
+	while (p != end) {
+		for (int i = 0; i < BB_NUM_FIELDS; i++) {
+			int32_t delta;
+			if (!getVarint(p, end, delta)) {
+				return false;
+			}
+			record.fields[i] += delta;
+		}
+		records.push_back(record);
+	}
+	return true;
+}
+
+} // namespace heli
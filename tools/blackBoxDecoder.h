@@ -0,0 +1,65 @@
+#ifndef BLACKBOXDECODER_H_
+#define BLACKBOXDECODER_H_
+
+/*
+ * blackBoxDecoder.h
+ *
+ * Host-side decoder for the black box flight recorder's blocks (see
+ * blackBox.h in the firmware). Each block holds delta, zigzag and varint
+ * encoded records, the first relative to zero.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace heli {
+
+// Fields of a record, in the order they are encoded
+enum BlackBoxField {
+	BB_TIME_MS, BB_ADC_RAW, BB_ALTITUDE, BB_DESIRED_ALTITUDE, BB_YAW100,
+	BB_DESIRED_YAW100, BB_MAIN_DUTY100, BB_TAIL_DUTY100, BB_STATE,
+	BB_NUM_FIELDS
+};
+
+// Names of the fields, indexed by BlackBoxField
+extern const char* const BLACKBOX_FIELD_NAMES[BB_NUM_FIELDS];
+
+// One recorded control step
+struct BlackBoxRecord {
+	int32_t fields[BB_NUM_FIELDS];
+};
+
+// A block as received in a dump frame
+struct BlackBoxBlock {
+	int number; // Position in the dump, oldest first
+	int count; // Number of blocks in the dump
+	int trigger; // Trigger that froze the recorder (BB_TRIG_* mask value)
+	std::vector<uint8_t> data; // Encoded records
+};
+
+/**
+ * Parse a dump frame payload (as returned in a RawFrame).
+ * @param payload Frame payload, starting with the version and type
+ * @param len Length of the payload
+ * @param block Filled in with the block
+ * @return false if the payload is malformed
+ */
+bool parseBlackBoxFrame(const uint8_t* payload, size_t len,
+		BlackBoxBlock& block);
+
+/**
+ * Decode the records of one block.
+ * @param data Encoded records
+ * @param len Number of bytes
+ * @param records Decoded records are appended to this
+ * @return false if the block ends part way through a record
+ */
+bool decodeBlackBoxBlock(const uint8_t* data, size_t len,
+		std::vector<BlackBoxRecord>& records);
+
+} // namespace heli
+
+#endif /* BLACKBOXDECODER_H_ */
@@ -0,0 +1,252 @@
+/*
+ * callGraph.cpp
+ *
+ * Host-side worst-case stack depth analysis of the firmware.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "callGraph.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace heli {
+
+namespace {
+
+// A DIE being read from the XML, and the attributes of interest
+struct Die {
+	std::string tag;
+	std::string name;
+	long frame;
+	bool indirect;
+};
+
+/**
+ * Read the whole of a stream.
+ * @param in Stream to read
+ * @return Its contents
+ */
+std::string readAll(FILE* in) {
+	std::string text;
+	char buf[4096];
+	size_t n;
+	while ((n = std::fread(buf, 1, sizeof(buf), in)) > 0) {
+		text.append(buf, n);
+	}
+	return text;
+}
+
+/**
+ * @param dies DIEs enclosing the current position, outermost first
+ * @return The name of the innermost enclosing function, or "" if none
+ */
+std::string enclosingFunction(const std::vector<Die>& dies) {
+	for (size_t i = dies.size(); i-- > 0;) {
+		if (dies[i].tag == "DW_TAG_subprogram") {
+			return dies[i].name;
+		}
+	}
+	return "";
+}
+
+// State of the depth search
+struct Search {
+	const CallGraph* graph;
+	std::map<std::string, long> depth; // Deepest chain found, by function
+	std::map<std::string, std::string> deepestCallee;
+	std::set<std::string> active; // Functions on the current chain
+	std::set<std::string> unknown;
+	std::set<std::string> recursive;
+};
+
+/**
+ * Find the depth of the deepest chain from a function, remembering the
+ * result for each function searched.
+ * @param s Search state
+ * @param name Function
+ * @return Bytes of stack used by the deepest chain
+ */
+long search(Search& s, const std::string& name) {
+	std::map<std::string, long>::const_iterator done = s.depth.find(name);
+	if (done != s.depth.end()) {
+		return done->second;
+	}
+	if (s.active.count(name)) {
+		s.recursive.insert(name);
+		return 0;
+	}
+
+	long frame = 0;
+	std::map<std::string, long>::const_iterator f = s.graph->frames.find(name);
+	if (f != s.graph->frames.end()) {
+		frame = f->second;
+	} else {
+		s.unknown.insert(name);
+	}
+
+	long deepest = 0;
+	std::string callee;
+	std::map<std::string, std::set<std::string> >::const_iterator c =
+			s.graph->calls.find(name);
+	if (c != s.graph->calls.end()) {
+		s.active.insert(name);
+		std::set<std::string>::const_iterator it;
+		for (it = c->second.begin(); it != c->second.end(); ++it) {
+			long d = search(s, *it);
+			if (d > deepest || callee.empty()) {
+				deepest = d;
+				callee = *it;
+			}
+		}
+		s.active.erase(name);
+	}
+
+	s.depth[name] = frame + deepest;
+	s.deepestCallee[name] = callee;
+	return frame + deepest;
+}
+
+} // namespace
+
+int readOfdXml(FILE* in, CallGraph& graph) {
+	std::string text = readAll(in);
+	std::vector<Die> dies;
+	std::string attribute;
+	int functions = 0;
+	size_t pos = 0;
+
+	while ((pos = text.find('<', pos)) != std::string::npos) {
+		size_t end = text.find('>', pos);
+		if (end == std::string::npos) {
+			break;
+		}
+		bool closing = text[pos + 1] == '/';
+		size_t nameStart = pos + (closing ? 2 : 1);
+		size_t nameEnd = text.find_first_of(" \t\r\n/>", nameStart);
+		std::string element = text.substr(nameStart, nameEnd - nameStart);
+		pos = end + 1;
+
+		if (element == "die") {
+			if (!closing) {
+				Die die = {"", "", -1, false};
+				dies.push_back(die);
+				continue;
+			}
+			if (dies.empty()) {
+				continue;
+			}
+			Die die = dies.back();
+			dies.pop_back();
+			if (die.tag == "DW_TAG_subprogram" && !die.name.empty() &&
+					die.frame >= 0) {
+				long& frame = graph.frames[die.name];
+				if (die.frame > frame) {
+					frame = die.frame;
+				}
+				functions++;
+			} else if (die.tag == "DW_TAG_TI_branch") {
+				std::string caller = enclosingFunction(dies);
+				if (caller.empty()) {
+					continue;
+				}
+				if (die.indirect || die.name.empty()) {
+					graph.indirect.insert(caller);
+				} else {
+					graph.calls[caller].insert(die.name);
+				}
+			}
+			continue;
+		}
+		if (closing || dies.empty()) {
+			continue;
+		}
+
+		// Elements holding text: the DIE tag, an attribute type or value
+		size_t textEnd = text.find('<', pos);
+		if (textEnd == std::string::npos) {
+			break;
+		}
+		std::string value = text.substr(pos, textEnd - pos);
+		if (element == "tag") {
+			dies.back().tag = value;
+		} else if (element == "type") {
+			attribute = value;
+		} else if (element == "string" && attribute == "DW_AT_name") {
+			dies.back().name = value;
+		} else if (element == "const" && attribute == "DW_AT_TI_max_frame_size") {
+			dies.back().frame = std::strtol(value.c_str(), 0, 0);
+		} else if (element == "flag" && attribute == "DW_AT_TI_indirect") {
+			dies.back().indirect = value == "true";
+		}
+	}
+	return functions;
+}
+
+bool readStackConfig(FILE* in, CallGraph& graph, std::string& error) {
+	char line[256];
+	int lineNumber = 0;
+
+	while (std::fgets(line, sizeof(line), in)) {
+		lineNumber++;
+		char* hash = std::strchr(line, '#');
+		if (hash) {
+			*hash = '\0';
+		}
+
+		char keyword[16];
+		char first[128];
+		char second[128];
+		int words = std::sscanf(line, "%15s %127s %127s", keyword, first, second);
+		if (words <= 0) {
+			continue; // Blank line or comment
+		}
+
+		char* end;
+		if (words == 3 && std::strcmp(keyword, "isr") == 0) {
+			IsrEntry isr;
+			isr.name = first;
+			isr.level = static_cast<int>(std::strtol(second, &end, 0));
+			if (*end == '\0') {
+				graph.isrs.push_back(isr);
+				continue;
+			}
+		} else if (words == 3 && std::strcmp(keyword, "call") == 0) {
+			graph.calls[first].insert(second);
+			graph.indirect.erase(first);
+			continue;
+		} else if (words == 3 && std::strcmp(keyword, "frame") == 0) {
+			long bytes = std::strtol(second, &end, 0);
+			if (*end == '\0') {
+				graph.frames[first] = bytes;
+				continue;
+			}
+		}
+
+		char buf[32];
+		std::snprintf(buf, sizeof(buf), "line %d", lineNumber);
+		error = buf;
+		return false;
+	}
+	return true;
+}
+
+StackDepth worstDepth(const CallGraph& graph, const std::string& root) {
+	Search s;
+	s.graph = &graph;
+
+	StackDepth result;
+	result.bytes = search(s, root);
+	std::set<std::string> onPath;
+	for (std::string name = root; !name.empty() && !onPath.count(name);
+			name = s.deepestCallee[name]) {
+		result.path.push_back(name);
+		onPath.insert(name);
+	}
+	result.unknown = s.unknown;
+	result.recursive = s.recursive;
+	return result;
+}
+
+} // namespace heli
@@ -0,0 +1,91 @@
+#ifndef CALLGRAPH_H_
+#define CALLGRAPH_H_
+
+/*
+ * callGraph.h
+ *
+ * Host-side worst-case stack depth analysis of the firmware. The frame
+ * size of each function and the direct calls between functions are read
+ * from the TI object file display utility's XML output of the linked
+ * program, which holds the compiler's DWARF debug information:
+ *
+ *     ofd470 -g -x --xml_indent=0 helicopter.out > helicopter.xml
+ *
+ * Each subprogram DIE gives the function's frame size
+ * (DW_AT_TI_max_frame_size) and holds a DW_TAG_TI_branch DIE for each call
+ * it makes. What the debug information cannot show, namely calls through
+ * function pointers, the interrupt handlers and their preemption levels,
+ * and frame sizes of code built without debug information, is read from a
+ * configuration file.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace heli {
+
+// Bytes stacked by the Cortex-M3 on exception entry: eight registers,
+// plus a word of padding to keep the stack 8-byte aligned
+const long EXCEPTION_FRAME_BYTES = 36;
+
+// An interrupt handler and the preemption level it runs at
+struct IsrEntry {
+	std::string name;
+	int level; // Lower levels preempt higher ones
+};
+
+// Frame sizes of the functions and the calls between them
+struct CallGraph {
+	std::map<std::string, long> frames; // Bytes, by function
+	std::map<std::string, std::set<std::string> > calls; // Callees, by caller
+	std::set<std::string> indirect; // Functions making unlisted indirect calls
+	std::vector<IsrEntry> isrs;
+};
+
+// Deepest call chain from one function
+struct StackDepth {
+	long bytes; // Total of the frames on the chain
+	std::vector<std::string> path; // Functions on the chain, outermost first
+	std::set<std::string> unknown; // Functions reached with no frame size
+	std::set<std::string> recursive; // Functions reached by recursion
+};
+
+/**
+ * Add the frame sizes and calls in ofd XML output to the call graph.
+ * @param in Stream to read
+ * @param graph Call graph to add to
+ * @return Number of functions with a frame size found
+ */
+int readOfdXml(FILE* in, CallGraph& graph);
+
+/**
+ * Add a configuration file to the call graph. Each line is blank, a
+ * comment starting with '#', or one of:
+ *  isr <handler> <level>      An interrupt handler and its preemption level
+ *  call <caller> <callee>     A call made through a function pointer
+ *  frame <function> <bytes>   Frame size of a function with no debug info
+ * @param in Stream to read
+ * @param graph Call graph to add to
+ * @param error Set to a description of the first bad line
+ * @return false if a line could not be understood
+ */
+bool readStackConfig(FILE* in, CallGraph& graph, std::string& error);
+
+/**
+ * Find the deepest call chain from a function. Recursive calls are not
+ * followed, and functions with no known frame size count as 0 bytes;
+ * both are listed in the result.
+ * @param graph Call graph
+ * @param root Function at the start of the chain
+ * @return The deepest chain
+ */
+StackDepth worstDepth(const CallGraph& graph, const std::string& root);
+
+} // namespace heli
+
+#endif /* CALLGRAPH_H_ */
@@ -0,0 +1,121 @@
+/*
+ * decodeBlackBox.cpp
+ *
+ * Command-line tool that decodes a black box dump (sent by the "BB DUMP"
+ * command) into CSV, one line per recorded control step, oldest first.
+ *
+ * Usage: decodeBlackBox [file]
+ *  Reads the telemetry stream from file (e.g. a serial device set to
+ *  115200 8N1 raw) or from standard input until the whole dump has been
+ *  received or the input ends. Other frames are ignored.
+ *
+ * Build: g++ -std=c++11 -O2 -o decodeBlackBox decodeBlackBox.cpp \
+ *            blackBoxDecoder.cpp telemetryDecoder.cpp
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "blackBoxDecoder.h"
+#include "telemetryDecoder.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+namespace {
+
+const char* triggerName(int trigger) {
+	switch (trigger) {
+	case 0x01: return "command";
+	case 0x02: return "state change";
+	case 0x04: return "fault";
+	default: return "unknown";
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	const char* path = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (argv[i][0] == '-' && argv[i][1] != '\0') {
+			std::fprintf(stderr, "usage: %s [file]\n", argv[0]);
+			return 2;
+		}
+		path = argv[i];
+	}
+
+	FILE* in = stdin;
+	if (path && std::strcmp(path, "-") != 0) {
+		in = std::fopen(path, "rb");
+		if (!in) {
+			std::perror(path);
+			return 1;
+		}
+	}
+
+	heli::TelemetryDecoder decoder;
+	std::vector<heli::StatusFrame> frames;
+	std::vector<heli::RawFrame> others;
+	std::map<int, heli::BlackBoxBlock> blocks;
+	int count = -1;
+	int trigger = 0;
+	uint8_t buf[256];
+	size_t n;
+
+	// Collect the blocks of one dump. A block numbered 0 starts a new dump.
+	while ((count < 0 || static_cast<int>(blocks.size()) < count) &&
+			(n = std::fread(buf, 1, sizeof(buf), in)) > 0) {
+		frames.clear();
+		others.clear();
+		decoder.feed(buf, n, frames, nullptr, nullptr, &others);
+		for (size_t i = 0; i < others.size(); i++) {
+			heli::BlackBoxBlock block;
+			if (others[i].type != heli::TELEM_BLACKBOX ||
+					!heli::parseBlackBoxFrame(others[i].payload.data(),
+							others[i].payload.size(), block)) {
+				continue;
+			}
+			if (block.number == 0) {
+				blocks.clear();
+			}
+			count = block.count;
+			trigger = block.trigger;
+			blocks[block.number] = block;
+		}
+	}
+	if (in != stdin) {
+		std::fclose(in);
+	}
+
+	for (int i = 0; i < heli::BB_NUM_FIELDS; i++) {
+		std::printf(i ? ",%s" : "%s", heli::BLACKBOX_FIELD_NAMES[i]);
+	}
+	std::printf("\n");
+
+	unsigned long numRecords = 0;
+	int badBlocks = 0;
+	std::map<int, heli::BlackBoxBlock>::const_iterator it;
+	for (it = blocks.begin(); it != blocks.end(); ++it) {
+		std::vector<heli::BlackBoxRecord> records;
+		if (!heli::decodeBlackBoxBlock(it->second.data.data(),
+				it->second.data.size(), records)) {
+			badBlocks++;
+		}
+		for (size_t r = 0; r < records.size(); r++) {
+			for (int f = 0; f < heli::BB_NUM_FIELDS; f++) {
+				std::printf(f ? ",%ld" : "%ld",
+						static_cast<long>(records[r].fields[f]));
+			}
+			std::printf("\n");
+		}
+		numRecords += records.size();
+	}
+
+	std::fprintf(stderr, "%lu records in %lu of %d blocks, %d bad; "
+			"frozen by %s\n", numRecords,
+			static_cast<unsigned long>(blocks.size()), count, badBlocks,
+			triggerName(trigger));
+	return (count > 0 && static_cast<int>(blocks.size()) == count) ? 0 : 1;
+}
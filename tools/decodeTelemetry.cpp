@@ -0,0 +1,181 @@
+/*
+ * decodeTelemetry.cpp
+ *
+ * Command-line tool that turns the helicopter's binary telemetry stream
+ * into CSV or aligned columns.
+ *
+ * Usage: decodeTelemetry [--columns] [--channels out.csv] [file]
+ *  Reads from file (e.g. a serial device set to 115200 8N1 raw) or from
+ *  standard input, and writes one line per status frame to standard
+ *  output. With --channels, each subscribed channel sample is written to
+ *  out.csv as a "time_ms,channel,value" line. The channel is named as in
+ *  the last CHANNELS reply in the stream, or numbered if the stream has
+ *  none (send CHANNELS before subscribing). Decoding errors are
+ *  summarised on standard error at the end.
+ *
+ * Build: g++ -std=c++11 -O2 -o decodeTelemetry decodeTelemetry.cpp \
+ *            telemetryDecoder.cpp
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "telemetryDecoder.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const COLUMNS[] = {
+	"time_ms", "yaw100", "desired_yaw100", "altitude", "desired_altitude",
+	"main_duty100", "tail_duty100", "state", "flags"
+};
+const int NUM_COLUMNS = sizeof(COLUMNS) / sizeof(COLUMNS[0]);
+const int COLUMN_WIDTH = 18;
+
+void printHeader(bool columns) {
+	for (int i = 0; i < NUM_COLUMNS; i++) {
+		if (columns) {
+			std::printf("%*s", COLUMN_WIDTH, COLUMNS[i]);
+		} else {
+			std::printf(i ? ",%s" : "%s", COLUMNS[i]);
+		}
+	}
+	std::printf("\n");
+}
+
+void printFrame(const heli::StatusFrame& f, bool columns) {
+	long values[] = {
+		static_cast<long>(f.timeMs), f.yaw100, f.desiredYaw100, f.altitude,
+		f.desiredAltitude, f.mainDuty100, f.tailDuty100, f.heliState, f.flags
+	};
+	for (int i = 0; i < NUM_COLUMNS; i++) {
+		if (columns) {
+			std::printf("%*ld", COLUMN_WIDTH, values[i]);
+		} else {
+			std::printf(i ? ",%ld" : "%ld", values[i]);
+		}
+	}
+	std::printf("\n");
+}
+
+// Learn a channel's name from a line of the CHANNELS reply:
+// "<number> <name> <rate> Hz"
+void learnChannelName(const std::string& line,
+		std::vector<std::string>& names) {
+	int channel;
+	char name[64];
+	unsigned int rate;
+	char hz[3];
+
+	if (std::sscanf(line.c_str(), "%d %63s %u %2s", &channel, name, &rate,
+			hz) == 4 && std::strcmp(hz, "Hz") == 0 && channel >= 0
+			&& channel < heli::TELEM_MAX_CHANNELS) {
+		names[channel] = name;
+	}
+}
+
+void printChannels(FILE* out, const heli::ChannelFrame& f,
+		const std::vector<std::string>& names) {
+	for (int i = 0; i < heli::TELEM_MAX_CHANNELS; i++) {
+		if (!(f.mask & (1u << i))) {
+			continue;
+		}
+		if (names[i].empty()) {
+			std::fprintf(out, "%lu,%d,%ld\n", static_cast<unsigned long>(f.timeMs),
+					i, static_cast<long>(f.values[i]));
+		} else {
+			std::fprintf(out, "%lu,%s,%ld\n", static_cast<unsigned long>(f.timeMs),
+					names[i].c_str(), static_cast<long>(f.values[i]));
+		}
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	bool columns = false;
+	const char* path = 0;
+	const char* channelPath = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--columns") == 0) {
+			columns = true;
+		} else if (std::strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
+			channelPath = argv[++i];
+		} else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+			std::fprintf(stderr, "usage: %s [--columns] [--channels out.csv] "
+					"[file]\n", argv[0]);
+			return 2;
+		} else {
+			path = argv[i];
+		}
+	}
+
+	FILE* in = stdin;
+	if (path && std::strcmp(path, "-") != 0) {
+		in = std::fopen(path, "rb");
+		if (!in) {
+			std::perror(path);
+			return 1;
+		}
+	}
+
+	FILE* channelOut = 0;
+	if (channelPath) {
+		channelOut = std::fopen(channelPath, "w");
+		if (!channelOut) {
+			std::perror(channelPath);
+			return 1;
+		}
+		std::fprintf(channelOut, "time_ms,channel,value\n");
+	}
+
+	heli::TelemetryDecoder decoder;
+	std::vector<heli::StatusFrame> frames;
+	std::vector<heli::ChannelFrame> channelFrames;
+	std::string text;
+	std::vector<std::string> names(heli::TELEM_MAX_CHANNELS);
+	uint8_t buf[256];
+	size_t n;
+
+	printHeader(columns);
+	while ((n = std::fread(buf, 1, sizeof(buf), in)) > 0) {
+		frames.clear();
+		channelFrames.clear();
+		decoder.feed(buf, n, frames, &text,
+				channelOut ? &channelFrames : nullptr);
+		for (size_t i = 0; i < frames.size(); i++) {
+			printFrame(frames[i], columns);
+		}
+		// Text frames (command replies) go to stderr a line at a time.
+		// They are read first, so a CHANNELS reply names the samples that
+		// arrive with it.
+		size_t end;
+		while ((end = text.find('\n')) != std::string::npos) {
+			std::string line = text.substr(0, end);
+
+			learnChannelName(line, names);
+			std::fprintf(stderr, "# %s\n", line.c_str());
+			text.erase(0, end + 1);
+		}
+		for (size_t i = 0; i < channelFrames.size(); i++) {
+			printChannels(channelOut, channelFrames[i], names);
+		}
+		std::fflush(stdout);
+	}
+
+	const heli::DecoderStats& stats = decoder.stats();
+	std::fprintf(stderr, "%lu frames, %lu CRC errors, %lu framing errors, "
+			"%lu unknown\n", stats.frames, stats.crcErrors,
+			stats.framingErrors, stats.unknownFrames);
+	if (in != stdin) {
+		std::fclose(in);
+	}
+	if (channelOut) {
+		std::fclose(channelOut);
+	}
+	return 0;
+}
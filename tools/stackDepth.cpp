@@ -0,0 +1,159 @@
+/*
+ * stackDepth.cpp
+ *
+ * Command-line tool that computes the worst-case stack depth of the
+ * firmware: the deepest call chain from main(), plus, for each interrupt
+ * preemption level, the deepest handler at that level and its exception
+ * frame, since one handler of each level can be nested on the next.
+ *
+ * Usage: stackDepth [--stack bytes] [--config file] xmlfile
+ *  xmlfile is the ofd470 XML output of the linked program (see
+ *  callGraph.h). The configuration file, by default stackDepth.cfg next
+ *  to this tool, lists the interrupt handlers and indirect calls. With
+ *  --stack, the exit status is 1 if the worst case does not fit.
+ *
+ * Build: g++ -std=c++11 -O2 -o stackDepth stackDepth.cpp callGraph.cpp
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "callGraph.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+/**
+ * Print one row of the report: a root function and its deepest chain.
+ * @param label Preemption level, or "-" for main()
+ * @param depth Deepest chain from the root
+ * @param extra Bytes added to the chain, such as the exception frame
+ */
+void printChain(const char* label, const heli::StackDepth& depth, long extra) {
+	std::printf("%-5s %6ld  ", label, depth.bytes + extra);
+	for (size_t i = 0; i < depth.path.size(); i++) {
+		std::printf(i ? " > %s" : "%s", depth.path[i].c_str());
+	}
+	std::printf("\n");
+}
+
+/**
+ * Print a set of function names after a heading, if it is not empty.
+ * @param heading Description of the functions
+ * @param names Function names
+ */
+void printNames(const char* heading, const std::set<std::string>& names) {
+	if (names.empty()) {
+		return;
+	}
+	std::fprintf(stderr, "%s:", heading);
+	std::set<std::string>::const_iterator it;
+	for (it = names.begin(); it != names.end(); ++it) {
+		std::fprintf(stderr, " %s", it->c_str());
+	}
+	std::fprintf(stderr, "\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	const char* xmlPath = 0;
+	std::string configPath = "stackDepth.cfg";
+	long stackSize = 0;
+
+	// The configuration file defaults to the tool's own directory
+	const char* slash = std::strrchr(argv[0], '/');
+	if (slash) {
+		configPath = std::string(argv[0], slash + 1 - argv[0]) + configPath;
+	}
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--stack") == 0 && i + 1 < argc) {
+			stackSize = std::strtol(argv[++i], 0, 0);
+		} else if (std::strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+			configPath = argv[++i];
+		} else if (argv[i][0] == '-' || xmlPath) {
+			std::fprintf(stderr, "usage: %s [--stack bytes] [--config file] "
+					"xmlfile\n", argv[0]);
+			return 2;
+		} else {
+			xmlPath = argv[i];
+		}
+	}
+	if (!xmlPath) {
+		std::fprintf(stderr, "usage: %s [--stack bytes] [--config file] "
+				"xmlfile\n", argv[0]);
+		return 2;
+	}
+
+	heli::CallGraph graph;
+	FILE* in = std::fopen(xmlPath, "r");
+	if (!in) {
+		std::perror(xmlPath);
+		return 1;
+	}
+	int functions = heli::readOfdXml(in, graph);
+	std::fclose(in);
+	if (functions == 0) {
+		std::fprintf(stderr, "%s: no frame sizes found\n", xmlPath);
+		return 1;
+	}
+
+	// Read after the XML, so that indirect calls it lists are accounted for
+	std::string error;
+	in = std::fopen(configPath.c_str(), "r");
+	if (!in) {
+		std::perror(configPath.c_str());
+		return 1;
+	}
+	bool configOk = heli::readStackConfig(in, graph, error);
+	std::fclose(in);
+	if (!configOk) {
+		std::fprintf(stderr, "%s: %s not understood\n", configPath.c_str(),
+				error.c_str());
+		return 1;
+	}
+
+	std::set<std::string> unknown;
+	std::set<std::string> recursive;
+
+	std::printf("Level  Bytes  Deepest chain\n");
+	heli::StackDepth mainDepth = heli::worstDepth(graph, "main");
+	printChain("-", mainDepth, 0);
+	unknown.insert(mainDepth.unknown.begin(), mainDepth.unknown.end());
+	recursive.insert(mainDepth.recursive.begin(), mainDepth.recursive.end());
+
+	// Deepest handler at each preemption level, including its exception frame
+	std::map<int, long> levelBytes;
+	for (size_t i = 0; i < graph.isrs.size(); i++) {
+		heli::StackDepth depth = heli::worstDepth(graph, graph.isrs[i].name);
+		long bytes = depth.bytes + heli::EXCEPTION_FRAME_BYTES;
+		char label[8];
+		std::snprintf(label, sizeof(label), "%d", graph.isrs[i].level);
+		printChain(label, depth, heli::EXCEPTION_FRAME_BYTES);
+		if (bytes > levelBytes[graph.isrs[i].level]) {
+			levelBytes[graph.isrs[i].level] = bytes;
+		}
+		unknown.insert(depth.unknown.begin(), depth.unknown.end());
+		recursive.insert(depth.recursive.begin(), depth.recursive.end());
+	}
+
+	long worst = mainDepth.bytes;
+	std::map<int, long>::const_iterator it;
+	for (it = levelBytes.begin(); it != levelBytes.end(); ++it) {
+		worst += it->second;
+	}
+	std::printf("Worst case: %ld bytes (main and one handler per level)\n",
+			worst);
+	if (stackSize > 0) {
+		std::printf("Stack: %ld bytes, %ld spare\n", stackSize,
+				stackSize - worst);
+	}
+
+	std::fflush(stdout);
+	printNames("No frame size (counted as 0)", unknown);
+	printNames("Recursive (not followed)", recursive);
+	printNames("Unlisted indirect calls in", graph.indirect);
+	return (stackSize > 0 && worst > stackSize) ? 1 : 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * telemetryDecoder.cpp
+ *
+ * Host-side decoder for the binary telemetry stream sent by the
+ * helicopter.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include "telemetryDecoder.h"
+
+namespace heli {
+
+namespace {
+
+// Status payload length (unchanged since version 1), excluding the CRC
+const size_t STATUS_PAYLOAD_LEN = 24;
+
+// Longest encoded frame accepted before the stream is assumed corrupt
+const size_t MAX_ENCODED_LEN = 512;
+
+uint16_t get16(const uint8_t* p) {
+	return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t get32(const uint8_t* p) {
+	return get16(p) | (static_cast<uint32_t>(get16(p + 2)) << 16);
+}
+
+} // namespace
+
+uint16_t crc16(const uint8_t* data, size_t len) {
+	uint16_t crc = 0xFFFF;
+
+	while (len--) {
+		crc ^= static_cast<uint16_t>(*data++) << 8;
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+bool cobsDecode(const uint8_t* in, size_t len, std::vector<uint8_t>& out) {
+	size_t i = 0;
+
+	out.clear();
+	while (i < len) {
+		uint8_t code = in[i++];
+		if (code == 0 || i + code - 1 > len) {
+			return false;
+		}
+		out.insert(out.end(), in + i, in + i + code - 1);
+		i += code - 1;
+		// A block shorter than 254 bytes implies a zero, unless it ends
+		// the frame
+		if (code != 0xFF && i < len) {
+			out.push_back(0);
+		}
+	}
+	return true;
+}
+
+TelemetryDecoder::TelemetryDecoder() : stats_() {
+}
+
+void TelemetryDecoder::feed(const uint8_t* data, size_t len,
+		std::vector<StatusFrame>& frames, std::string* text,
+		std::vector<ChannelFrame>* channels, std::vector<RawFrame>* others) {
+	for (size_t i = 0; i < len; i++) {
+		if (data[i] != 0) {
+			if (encoded_.size() < MAX_ENCODED_LEN) {
+				encoded_.push_back(data[i]);
+			}
+			continue;
+		}
+		// A partial frame at the start of the stream fails its CRC and
+		// is counted as an error
+		if (!encoded_.empty()) {
+			decodeFrame(frames, text, channels, others);
+		}
+		encoded_.clear();
+	}
+}
+
+void TelemetryDecoder::decodeFrame(std::vector<StatusFrame>& frames,
+		std::string* text, std::vector<ChannelFrame>* channels,
+		std::vector<RawFrame>* others) {
+	if (encoded_.size() >= MAX_ENCODED_LEN ||
+			!cobsDecode(encoded_.data(), encoded_.size(), raw_) ||
+			raw_.size() < 4) {
+		stats_.framingErrors++;
+		return;
+	}
+
+	size_t payloadLen = raw_.size() - 2;
+	if (crc16(raw_.data(), payloadLen) != get16(&raw_[payloadLen])) {
+		stats_.crcErrors++;
+		return;
+	}
+
+	const uint8_t* p = raw_.data();
+	if (p[0] <= TELEMETRY_VERSION && p[1] == TELEM_TEXT) {
+		if (text != nullptr) {
+			text->append(reinterpret_cast<const char*>(p + 2), payloadLen - 2);
+		}
+		stats_.frames++;
+		return;
+	}
+	if (p[0] <= TELEMETRY_VERSION && p[1] == TELEM_CHANNELS) {
+		ChannelFrame frame;
+		if (!decodeChannels(payloadLen, frame)) {
+			stats_.framingErrors++;
+			return;
+		}
+		if (channels != nullptr) {
+			channels->push_back(frame);
+		}
+		stats_.frames++;
+		return;
+	}
+	if (p[0] <= TELEMETRY_VERSION && p[1] != TELEM_STATUS && others != nullptr) {
+		RawFrame frame;
+		frame.type = p[1];
+		frame.payload.assign(p, p + payloadLen);
+		others->push_back(frame);
+		stats_.frames++;
+		return;
+	}
+	if (p[0] > TELEMETRY_VERSION || p[1] != TELEM_STATUS) {
+		stats_.unknownFrames++;
+		return;
+	}
+	if (payloadLen != STATUS_PAYLOAD_LEN) {
+		stats_.framingErrors++;
+		return;
+	}
+
+	StatusFrame frame;
+	frame.timeMs = get32(p + 2);
+	frame.yaw100 = static_cast<int32_t>(get32(p + 6));
+	frame.desiredYaw100 = static_cast<int32_t>(get32(p + 10));
+	frame.altitude = static_cast<int16_t>(get16(p + 14));
+	frame.desiredAltitude = static_cast<int16_t>(get16(p + 16));
+	frame.mainDuty100 = get16(p + 18);
+	frame.tailDuty100 = get16(p + 20);
+	frame.heliState = p[22];
+	frame.flags = p[23];
+	frames.push_back(frame);
+	stats_.frames++;
+}
+
+bool TelemetryDecoder::decodeChannels(size_t payloadLen,
+		ChannelFrame& frame) const {
+	const uint8_t* p = raw_.data();
+	// Version 1 had a 16-bit mask, version 2 a 32-bit mask
+	size_t offset = (p[0] >= 2) ? 10 : 8;
+	if (payloadLen < offset) {
+		return false;
+	}
+	frame.timeMs = get32(p + 2);
+	frame.mask = (p[0] >= 2) ? get32(p + 6) : get16(p + 6);
+
+	// One 32-bit value per set bit, lowest channel first
+	for (int i = 0; i < TELEM_MAX_CHANNELS; i++) {
+		frame.values[i] = 0;
+		if (frame.mask & (1u << i)) {
+			if (offset + 4 > payloadLen) {
+				return false;
+			}
+			frame.values[i] = static_cast<int32_t>(get32(p + offset));
+			offset += 4;
+		}
+	}
+	return offset == payloadLen;
+}
+
+} // namespace heli
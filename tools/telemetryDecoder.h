@@ -0,0 +1,122 @@
+#ifndef TELEMETRYDECODER_H_
+#define TELEMETRYDECODER_H_
+
+/*
+ * telemetryDecoder.h
+ *
+ * Host-side decoder for the binary telemetry stream sent by the
+ * helicopter (see telemetry.h in the firmware). Bytes are fed in as they
+ * arrive; complete, CRC-checked frames are returned.
+ *
+ * Author: J. Shaw and M. Rattner
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace heli {
+
+// Highest payload version this decoder understands
+const int TELEMETRY_VERSION = 2;
+
+// Frame types
+const int TELEM_STATUS = 1;
+const int TELEM_TEXT = 2;
+const int TELEM_CHANNELS = 3;
+const int TELEM_BLACKBOX = 4;
+
+// Most channels in a channel frame
+const int TELEM_MAX_CHANNELS = 32;
+
+// A decoded status frame
+struct StatusFrame {
+	uint32_t timeMs;
+	int32_t yaw100;
+	int32_t desiredYaw100;
+	int16_t altitude;
+	int16_t desiredAltitude;
+	uint16_t mainDuty100;
+	uint16_t tailDuty100;
+	uint8_t heliState;
+	uint8_t flags;
+};
+
+// A decoded channel frame: the subscribed channels due at one tick
+struct ChannelFrame {
+	uint32_t timeMs;
+	uint32_t mask; // Bit n set if channel n is included
+	int32_t values[TELEM_MAX_CHANNELS]; // Indexed by channel number
+};
+
+// A frame of a type not decoded here, such as a black box block
+struct RawFrame {
+	uint8_t type;
+	std::vector<uint8_t> payload; // Whole payload, including the header
+};
+
+// Counts of frames that could not be decoded
+struct DecoderStats {
+	unsigned long frames; // Frames decoded successfully
+	unsigned long crcErrors; // Frames whose CRC did not match
+	unsigned long framingErrors; // Invalid COBS data or wrong length
+	unsigned long unknownFrames; // Unsupported version or frame type
+};
+
+/**
+ * Compute the CRC-16/CCITT-FALSE used by the firmware.
+ * @param data Bytes to check
+ * @param len Number of bytes
+ * @return The CRC
+ */
+uint16_t crc16(const uint8_t* data, size_t len);
+
+/**
+ * Decode one COBS-encoded block (without its zero delimiter).
+ * @param in Encoded bytes
+ * @param len Number of encoded bytes
+ * @param out Receives the decoded bytes
+ * @return false if the encoding is invalid
+ */
+bool cobsDecode(const uint8_t* in, size_t len, std::vector<uint8_t>& out);
+
+class TelemetryDecoder {
+public:
+	TelemetryDecoder();
+
+	/**
+	 * Feed received bytes to the decoder.
+	 * @param data Received bytes
+	 * @param len Number of bytes
+	 * @param frames Decoded status frames are appended to this
+	 * @param text If not null, the text of text frames (command replies
+	 * and reports) is appended to this; otherwise text frames are dropped
+	 * @param channels If not null, decoded channel frames are appended to
+	 * this; otherwise channel frames are dropped
+	 * @param others If not null, frames of other types are appended to
+	 * this; otherwise they are counted as unknown
+	 */
+	void feed(const uint8_t* data, size_t len, std::vector<StatusFrame>& frames,
+			std::string* text = nullptr,
+			std::vector<ChannelFrame>* channels = nullptr,
+			std::vector<RawFrame>* others = nullptr);
+
+	/**
+	 * @return Counts of decoded and rejected frames so far
+	 */
+	const DecoderStats& stats() const { return stats_; }
+
+private:
+	void decodeFrame(std::vector<StatusFrame>& frames, std::string* text,
+			std::vector<ChannelFrame>* channels, std::vector<RawFrame>* others);
+	bool decodeChannels(size_t payloadLen, ChannelFrame& frame) const;
+
+	std::vector<uint8_t> encoded_;
+	std::vector<uint8_t> raw_;
+	DecoderStats stats_;
+};
+
+} // namespace heli
+
+#endif /* TELEMETRYDECODER_H_ */